@@ -50,7 +50,7 @@ else
 fi
 
 # list of tests to run
-tests="zlog_test_backend_lmdb zlog_test_backend_ram"
+tests="zlog_test_backend_lmdb zlog_test_backend_ram zlog_test_backend_segment"
 
 # run ceph backend tests
 export CEPH_CONF=/tmp/micro-osd/ceph.conf
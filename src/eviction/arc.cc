@@ -1,43 +1,20 @@
 #include"zlog/eviction/arc.h"
 #include<algorithm>
-#include<iostream>
-#include"zlog/cache.h"
 
 namespace zlog{
 
 ARC::~ARC(){}
 
 int ARC::cache_get_hit(uint64_t* pos){
-  
-  // std::cout << "read: " << *pos << std::endl;
-  
-  if(t1_hash_map.find(*pos) != t1_hash_map.end()){
-    // std::cout << "hit t1 " << std::endl;
-    auto it = t1_hash_map[*pos];
-    t2_eviction_list.splice(t2_eviction_list.begin(), t1_eviction_list, it);
-    t2_hash_map[*pos] = it;
-    t1_hash_map.erase(*pos);
-  }else if(t2_hash_map.find(*pos) != t2_hash_map.end()){
-    // std::cout << "hit t2 " << std::endl;
-    auto it = t2_hash_map[*pos];
-    t2_eviction_list.splice(t2_eviction_list.begin(), t2_eviction_list, it);
+  if(t1.contains(*pos)){
+    const size_t size = t1.erase(*pos);
+    t2.push_front(*pos, size);
+  }else if(t2.contains(*pos)){
+    auto it = t2.index[*pos].first;
+    t2.entries.splice(t2.entries.begin(), t2.entries, it);
   }else{
     return -1;
   }
-
-
-  // std::cout << "t1 hash: " << t1_hash_map.size() << std::endl;
-  // std::cout << "t1 list: " << t1_eviction_list.size() << std::endl;
-  // std::cout << "t2 hash: " << t2_hash_map.size() << std::endl;
-  // std::cout << "t2 list: " << t2_eviction_list.size() << std::endl;
-  // std::cout << "b1 hash: " << b1_hash_map.size() << std::endl;
-  // std::cout << "b1 list: " << b1_eviction_list.size() << std::endl;
-  // std::cout << "b2 hash: " << b2_hash_map.size() << std::endl;
-  // std::cout << "b2 list: " << b2_eviction_list.size() << std::endl;
-  
-  // std::cout << "------------------------------------------------" << std::endl;
-  // hit_count++;
-  // std::cout << hit_count << std::endl;
   return 0;
 }
 
@@ -45,114 +22,87 @@ int ARC::cache_get_miss(uint64_t pos){
   return 0;
 }
 
-int ARC::cache_put_miss(uint64_t pos){
-  if(b1_hash_map.find(pos) != b1_hash_map.end()){
-    // std::cout << "hit b1 " << std::endl;
-      
-    auto it = b1_hash_map[pos];
-    
-    arc_p = std::min(arc_p + get_delta_1(), (double)arc_c);
-    replace(pos);
-    t2_eviction_list.splice(t2_eviction_list.begin(), b1_eviction_list, it);
-    t2_hash_map[pos] = it;
-    b1_hash_map.erase(pos);
-
-  }else if(b2_hash_map.find(pos) != b2_hash_map.end()){
-    // std::cout << "hit b2 " << std::endl;
-    
-    auto it = b2_hash_map[pos];
-    arc_p = std::max(arc_p - get_delta_2(), 0.0);
-    replace(pos);
-    t2_eviction_list.splice(t2_eviction_list.begin(), b2_eviction_list, it);
-    t2_hash_map[pos] = it;
-    b2_hash_map.erase(pos);
-  }else{
-    // std::cout << "cache miss " << std::endl;
-    if(t1_hash_map.size() + b1_hash_map.size() >= arc_c){
-      if(t1_hash_map.size() < arc_c){
-        auto r = b1_eviction_list.back();
-        b1_hash_map.erase(r);
-        b1_eviction_list.pop_back();
-        replace(pos);
-      }else{
-        auto r = t1_eviction_list.back();
-        t1_hash_map.erase(r);
-        t1_eviction_list.pop_back();
-        cache_ref->cache_map.erase(r);
-      }
-    }else{
-      if(t1_hash_map.size() + b1_hash_map.size() + t2_hash_map.size() + b2_hash_map.size() >= arc_c){
-        if(t1_hash_map.size() + b1_hash_map.size() + t2_hash_map.size() + b2_hash_map.size() >= 2 * arc_c){
-          auto r = b2_eviction_list.back();
-          b2_hash_map.erase(r);
-          b2_eviction_list.pop_back();
-        }
-        replace(pos);
-      }
-    }
-    t1_eviction_list.push_front(pos);
-    t1_hash_map[pos] = t1_eviction_list.begin();
+// the adaptation step, scaled by the size of the entry. a hit in a ghost list
+// moves the target size of t1 by at least the size of the entry, and by more
+// when the other ghost list is larger.
+double ARC::get_delta(const List& hit, const List& other) const {
+  double delta = 1.0;
+  if(other.bytes > hit.bytes && hit.bytes > 0){
+    delta = (double)other.bytes / (double)hit.bytes;
   }
+  return delta;
+}
 
+int ARC::cache_put_miss(uint64_t pos, size_t size){
+  if(t1.contains(pos) || t2.contains(pos)){
+    return -1;
+  }
 
-  //  std::cout << "put: " << pos << std::endl;
+  b2_hit = false;
+
+  if(b1.contains(pos)){
+    // recently evicted from t1: favor recency
+    arc_p = std::min(arc_p + get_delta(b1, b2) * size, (double)arc_c);
+    b1.erase(pos);
+    t2.push_front(pos, size);
+  }else if(b2.contains(pos)){
+    // recently evicted from t2: favor frequency
+    arc_p = std::max(arc_p - get_delta(b2, b1) * size, 0.0);
+    b2.erase(pos);
+    t2.push_front(pos, size);
+    b2_hit = true;
+  }else{
+    t1.push_front(pos, size);
+  }
+
+  trim_ghosts();
 
-  // std::cout << "t1 hash: " << t1_hash_map.size() << std::endl;
-  // std::cout << "t1 list: " << t1_eviction_list.size() << std::endl;
-  // std::cout << "t2 hash: " << t2_hash_map.size() << std::endl;
-  // std::cout << "t2 list: " << t2_eviction_list.size() << std::endl;
-  // std::cout << "b1 hash: " << b1_hash_map.size() << std::endl;
-  // std::cout << "b1 list: " << b1_eviction_list.size() << std::endl;
-  // std::cout << "b2 hash: " << b2_hash_map.size() << std::endl;
-  // std::cout << "b2 list: " << b2_eviction_list.size() << std::endl;
-  
-  // std::cout << "------------------------------------------------" << std::endl;
   return 0;
 }
 
-uint64_t ARC::get_evicted(){
+int ARC::cache_remove(uint64_t pos){
+  for(auto l : {&t1, &t2, &b1, &b2}){
+    if(l->contains(pos)){
+      l->erase(pos);
+      return 0;
+    }
+  }
   return -1;
 }
 
-double ARC::get_delta_1(){
-  if(b1_hash_map.size() >= b2_hash_map.size()){
-    return 1.0;
-  }else{
-    return (double)(b2_hash_map.size()) / (double)(b1_hash_map.size());
+bool ARC::get_evicted(uint64_t* pos){
+  if(t1.bytes + t2.bytes <= arc_c || (t1.entries.empty() && t2.entries.empty())){
+    return false;
   }
-}
 
-double ARC::get_delta_2(){
-  if(b2_hash_map.size() >= b1_hash_map.size()){
-    return 1.0;
+  const bool from_t1 = !t1.entries.empty() && (t2.entries.empty() ||
+      t1.bytes > arc_p || (b2_hit && t1.bytes >= arc_p));
+
+  if(from_t1){
+    const auto r = t1.entries.back();
+    b1.push_front(r, t1.erase(r));
+    *pos = r;
   }else{
-    return (double)(b1_hash_map.size()) / (double)(b2_hash_map.size());
+    const auto r = t2.entries.back();
+    b2.push_front(r, t2.erase(r));
+    *pos = r;
   }
+
+  trim_ghosts();
+
+  return true;
 }
 
-int ARC::replace(uint64_t pos){
-  if(t1_hash_map.size() > 0 && (t1_hash_map.size() > arc_p || 
-  (b2_hash_map.find(pos) != b2_hash_map.end() && t1_hash_map.size() <= arc_p)
-  )){
-    auto r = t1_eviction_list.back();
-    t1_hash_map.erase(r);
-    t1_eviction_list.pop_back();
-    
-    cache_ref->cache_map.erase(r);
-
-    b1_eviction_list.push_front(r);
-    b1_hash_map[r] = b1_eviction_list.begin();
-  }else{
-    auto r = t2_eviction_list.back();
-    t2_hash_map.erase(r);
-    t2_eviction_list.pop_back();
-    
-    cache_ref->cache_map.erase(r);
-
-    b2_eviction_list.push_front(r);
-    b2_hash_map[r] = b2_eviction_list.begin();
+// bound the ghost lists so that t1+b1 holds at most c bytes, and all of the
+// lists together hold at most 2c bytes.
+void ARC::trim_ghosts(){
+  while(!b1.entries.empty() && t1.bytes + b1.bytes > arc_c){
+    b1.erase(b1.entries.back());
+  }
+  while(!b2.entries.empty() &&
+      t1.bytes + t2.bytes + b1.bytes + b2.bytes > 2 * arc_c){
+    b2.erase(b2.entries.back());
   }
-  return 0;
 }
 
-}
\ No newline at end of file
+}
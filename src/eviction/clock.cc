@@ -0,0 +1,110 @@
+#include"zlog/eviction/clock.h"
+
+namespace zlog{
+
+CLOCK::~CLOCK(){}
+
+int CLOCK::cache_get_hit(uint64_t* pos){
+  auto it = index.find(*pos);
+  if(it == index.end()){
+    return -1;
+  }
+  slots[it->second].referenced = true;
+  return 0;
+}
+
+int CLOCK::cache_get_miss(uint64_t pos){
+  return 0;
+}
+
+int CLOCK::cache_put_miss(uint64_t pos, size_t size){
+  if(index.find(pos) != index.end()){
+    return -1;
+  }
+
+  // the most recently freed slot is just behind the hand, so a new entry is
+  // the last to be considered for eviction.
+  size_t s;
+  if(!free_slots.empty()){
+    s = free_slots.back();
+    free_slots.pop_back();
+  }else{
+    s = slots.size();
+    slots.emplace_back();
+  }
+
+  slots[s] = Slot{pos, size, true, false, false};
+  index.emplace(pos, s);
+  cache_use += size;
+
+  return 0;
+}
+
+void CLOCK::free_slot(size_t s){
+  auto& slot = slots[s];
+  slot.used = false;
+  cache_use -= slot.size;
+  if(slot.hot){
+    hot_use -= slot.size;
+  }
+  index.erase(slot.pos);
+  free_slots.push_back(s);
+}
+
+int CLOCK::cache_remove(uint64_t pos){
+  auto it = index.find(pos);
+  if(it == index.end()){
+    return -1;
+  }
+  free_slot(it->second);
+  return 0;
+}
+
+void CLOCK::demote_hot(){
+  while(hot_use > hot_size){
+    if(hot_hand >= slots.size()){
+      hot_hand = 0;
+    }
+    auto& slot = slots[hot_hand++];
+    if(!slot.used || !slot.hot){
+      continue;
+    }
+    if(slot.referenced){
+      slot.referenced = false;
+    }else{
+      slot.hot = false;
+      hot_use -= slot.size;
+    }
+  }
+}
+
+// hot entries never use more than hot_size bytes, so while the cache is over
+// capacity there is a cold entry to evict.
+bool CLOCK::get_evicted(uint64_t* pos){
+  if(cache_use <= cache_size || index.empty()){
+    return false;
+  }
+
+  while(true){
+    if(hand >= slots.size()){
+      hand = 0;
+    }
+    const size_t s = hand++;
+    auto& slot = slots[s];
+    if(!slot.used || slot.hot){
+      continue;
+    }
+    if(slot.referenced){
+      slot.referenced = false;
+      slot.hot = true;
+      hot_use += slot.size;
+      demote_hot();
+      continue;
+    }
+    *pos = slot.pos;
+    free_slot(s);
+    return true;
+  }
+}
+
+}
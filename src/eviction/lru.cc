@@ -1,16 +1,16 @@
 #include"zlog/eviction/lru.h"
-#include"zlog/cache.h"
 
 namespace zlog{
 
 LRU::~LRU(){}
 
 int LRU::cache_get_hit(uint64_t* pos){
-  auto it = eviction_hash_map[*pos];
-  eviction_list.splice(eviction_list.begin(), eviction_list, it);
-  // hit_count++;
-  // std::cout << hit_count << std::endl;
-  
+  auto e = eviction_hash_map.find(*pos);
+  if(e == eviction_hash_map.end()){
+    return -1;
+  }
+  eviction_list.splice(eviction_list.begin(), eviction_list, e->second.it);
+
   return 0; 
 }
 
@@ -18,25 +18,40 @@ int LRU::cache_get_miss(uint64_t pos){
   return 0;
 }
 
-int LRU::cache_put_miss(uint64_t pos){
+int LRU::cache_put_miss(uint64_t pos, size_t size){
+  if(eviction_hash_map.find(pos) != eviction_hash_map.end()){
+    return -1;
+  }
+
   eviction_list.push_front(pos);
-  eviction_hash_map[pos] = eviction_list.begin();
+  eviction_hash_map[pos] = Entry{eviction_list.begin(), size};
+  cache_use += size;
 
-  if(eviction_hash_map.size() > cache_size){
-    auto r = eviction_list.back();
-    eviction_hash_map.erase(r);
-    cache_ref->cache_map.erase(r);
-    eviction_list.pop_back();
+  return 0;
+}
+
+int LRU::cache_remove(uint64_t pos){
+  auto e = eviction_hash_map.find(pos);
+  if(e == eviction_hash_map.end()){
+    return -1;
   }
 
+  cache_use -= e->second.size;
+  eviction_list.erase(e->second.it);
+  eviction_hash_map.erase(e);
+
   return 0;
 }
 
-uint64_t LRU::get_evicted(){
+bool LRU::get_evicted(uint64_t* pos){
+  if(cache_use <= cache_size || eviction_list.empty()){
+    return false;
+  }
+
   auto r = eviction_list.back();
-  eviction_hash_map.erase(r);
-  eviction_list.pop_back();
+  cache_remove(r);
+  *pos = r;
 
-  return r;
+  return true;
+}
 }
-}
\ No newline at end of file
@@ -0,0 +1,291 @@
+#include"zlog/eviction/tinylfu.h"
+#include<algorithm>
+#include<cmath>
+
+namespace zlog{
+
+const uint32_t TinyLFU::nil;
+
+TinyLFU::TinyLFU(size_t c_size) :
+  candidate(nil),
+  cache_size(c_size),
+  window_size(c_size / 100),
+  protected_size((c_size - c_size / 100) * 4 / 5),
+  sketch(),
+  sample_hits(0),
+  sample_misses(0),
+  prev_hit_rate(0.0),
+  window_step(c_size * 0.0625)
+{}
+
+TinyLFU::~TinyLFU(){}
+
+TinyLFU::FrequencySketch::FrequencySketch()
+{
+  ensure_capacity(0);
+}
+
+// resizing discards the counts, which is cheap while the cache is filling
+void TinyLFU::FrequencySketch::ensure_capacity(size_t entries){
+  size_t size = 64;
+  while(size < entries && size < (1ULL << 24)){
+    size <<= 1;
+  }
+  if(!table.empty() && size <= counter_mask + 1){
+    return;
+  }
+  table.assign(size / 16, 0);
+  counter_mask = size - 1;
+  additions = 0;
+  // reads of a log follow the tail, so an entry's count is only useful for as
+  // long as the entry is near the tail. counts are aged after one addition per
+  // word of counters, instead of after several additions per counter.
+  sample_size = table.size();
+}
+
+size_t TinyLFU::FrequencySketch::index_of(uint64_t pos, int row) const {
+  static const uint64_t seeds[] = {
+    0xc3a5c85c97cb3127ULL,
+    0xb492b66fbe98f273ULL,
+    0x9ae16a3b2f90404fULL,
+    0xcbf29ce484222325ULL
+  };
+  uint64_t h = (pos + seeds[row]) * 0x9e3779b97f4a7c15ULL;
+  h ^= h >> 32;
+  return h & counter_mask;
+}
+
+uint32_t TinyLFU::FrequencySketch::frequency(uint64_t pos) const {
+  uint32_t freq = 15;
+  for(int row = 0; row < 4; row++){
+    const size_t i = index_of(pos, row);
+    const uint32_t count = (table[i >> 4] >> ((i & 15) << 2)) & 0xf;
+    freq = std::min(freq, count);
+  }
+  return freq;
+}
+
+void TinyLFU::FrequencySketch::increment(uint64_t pos){
+  bool added = false;
+  for(int row = 0; row < 4; row++){
+    const size_t i = index_of(pos, row);
+    const int shift = (i & 15) << 2;
+    if(((table[i >> 4] >> shift) & 0xf) < 15){
+      table[i >> 4] += 1ULL << shift;
+      added = true;
+    }
+  }
+  if(added && ++additions >= sample_size){
+    reset();
+  }
+}
+
+void TinyLFU::FrequencySketch::reset(){
+  for(auto& word : table){
+    word = (word >> 1) & 0x7777777777777777ULL;
+  }
+  additions /= 2;
+}
+
+TinyLFU::List& TinyLFU::list(Queue queue){
+  switch(queue){
+    case WINDOW:
+      return window;
+    case PROBATION:
+      return probation;
+    default:
+      return protect;
+  }
+}
+
+void TinyLFU::push_front(Queue queue, uint32_t n){
+  auto& l = list(queue);
+  auto& node = nodes[n];
+  node.queue = queue;
+  node.prev = nil;
+  node.next = l.head;
+  if(l.head != nil){
+    nodes[l.head].prev = n;
+  }else{
+    l.tail = n;
+  }
+  l.head = n;
+  l.bytes += node.size;
+}
+
+void TinyLFU::unlink(uint32_t n){
+  auto& node = nodes[n];
+  auto& l = list(node.queue);
+  if(node.prev != nil){
+    nodes[node.prev].next = node.next;
+  }else{
+    l.head = node.next;
+  }
+  if(node.next != nil){
+    nodes[node.next].prev = node.prev;
+  }else{
+    l.tail = node.prev;
+  }
+  l.bytes -= node.size;
+}
+
+void TinyLFU::remove_node(uint32_t n){
+  unlink(n);
+  index.erase(nodes[n].pos);
+  free_nodes.push_back(n);
+  if(candidate == n){
+    candidate = nil;
+  }
+}
+
+void TinyLFU::record(bool hit){
+  if(hit){
+    sample_hits++;
+  }else{
+    sample_misses++;
+  }
+  // long samples average over phases such as a replay starting or finishing,
+  // which change the hit rate more than the window size does
+  if(sample_hits + sample_misses >= std::max<size_t>(100, 10 * index.size())){
+    climb();
+  }
+}
+
+// move the window size by a step in the direction that last improved the hit
+// rate, reversing when the hit rate drops. steps shrink while the hit rate is
+// stable and restart when it changes sharply.
+void TinyLFU::climb(){
+  const double hit_rate = (double)sample_hits / (sample_hits + sample_misses);
+  const double change = hit_rate - prev_hit_rate;
+  if(change < 0){
+    window_step = -window_step;
+  }
+  if(std::fabs(change) >= 0.05){
+    window_step = std::copysign(cache_size * 0.0625, window_step);
+  }else{
+    window_step *= 0.98;
+  }
+
+  const double min_window = cache_size / 100;
+  const double max_window = cache_size * 0.8;
+  const double size = std::min(max_window,
+      std::max(min_window, window_size + window_step));
+  window_size = size;
+  protected_size = (cache_size - window_size) * 4 / 5;
+
+  prev_hit_rate = hit_rate;
+  sample_hits = 0;
+  sample_misses = 0;
+}
+
+int TinyLFU::cache_get_hit(uint64_t* pos){
+  auto it = index.find(*pos);
+  if(it == index.end()){
+    return -1;
+  }
+
+  sketch.increment(*pos);
+  record(true);
+
+  const uint32_t n = it->second;
+  const Queue queue = nodes[n].queue;
+  if(candidate == n){
+    candidate = nil;
+  }
+  unlink(n);
+
+  if(queue == PROBATION){
+    push_front(PROTECTED, n);
+    // demote the least recently used protected entries to make room
+    while(protect.bytes > protected_size && protect.tail != n){
+      const uint32_t d = protect.tail;
+      unlink(d);
+      push_front(PROBATION, d);
+    }
+  }else{
+    push_front(queue, n);
+  }
+
+  return 0;
+}
+
+int TinyLFU::cache_get_miss(uint64_t pos){
+  return 0;
+}
+
+int TinyLFU::cache_put_miss(uint64_t pos, size_t size){
+  if(index.find(pos) != index.end()){
+    return -1;
+  }
+
+  sketch.ensure_capacity(index.size() + 1);
+  sketch.increment(pos);
+  record(false);
+
+  uint32_t n;
+  if(!free_nodes.empty()){
+    n = free_nodes.back();
+    free_nodes.pop_back();
+  }else{
+    n = nodes.size();
+    nodes.emplace_back();
+  }
+  nodes[n].pos = pos;
+  nodes[n].size = size;
+  index.emplace(pos, n);
+  push_front(WINDOW, n);
+
+  // the newest entry always stays in the window
+  while(window.bytes > window_size && window.tail != window.head){
+    const uint32_t c = window.tail;
+    unlink(c);
+    push_front(PROBATION, c);
+    candidate = c;
+  }
+
+  return 0;
+}
+
+int TinyLFU::cache_remove(uint64_t pos){
+  auto it = index.find(pos);
+  if(it == index.end()){
+    return -1;
+  }
+  remove_node(it->second);
+  return 0;
+}
+
+bool TinyLFU::get_evicted(uint64_t* pos){
+  if(window.bytes + probation.bytes + protect.bytes <= cache_size ||
+      index.empty()){
+    return false;
+  }
+
+  uint32_t victim;
+  if(probation.tail != nil){
+    victim = probation.tail;
+    // admit the candidate if it is read more often than the victim. a new
+    // entry has no reads yet, so ties go to the newer position, which is the
+    // one that tailing readers are about to read.
+    if(candidate != nil && candidate != victim){
+      const uint32_t candidate_freq = sketch.frequency(nodes[candidate].pos);
+      const uint32_t victim_freq = sketch.frequency(nodes[victim].pos);
+      if(candidate_freq < victim_freq || (candidate_freq == victim_freq &&
+            nodes[candidate].pos < nodes[victim].pos)){
+        victim = candidate;
+      }
+    }
+    candidate = nil;
+  }else if(protect.tail != nil){
+    victim = protect.tail;
+  }else{
+    victim = window.tail;
+  }
+
+  *pos = nodes[victim].pos;
+  remove_node(victim);
+
+  return true;
+}
+
+}
@@ -1,10 +1,14 @@
 #pragma once
+#include <algorithm>
 #include <cstdint>
 #include <functional>
 #include <map>
 #include <memory>
+#include <set>
 #include <string>
+#include <utility>
 #include <vector>
+#include "slice.h"
 
 namespace zlog {
 
@@ -168,10 +172,44 @@ class Backend {
    * -ESPIPE stale epoch
    * -ERANGE position hasn't been written
    * -ENODATA entry position has been invalidated
+   * -EIO entry failed checksum verification
    */
   virtual int Read(const std::string& oid, uint64_t epoch,
       uint64_t position, std::string *data_out) = 0;
 
+  /**
+   * Read a range of log positions from one object.
+   *
+   * The range is the positions min_position, min_position + stride, ... up to
+   * and including max_position, which are the positions an object holds when
+   * it is one of stride objects in a stripe. Readable entries in the range are
+   * returned in @entries_out. Positions in the range that have been filled or
+   * trimmed, including positions covered by the object's trim limit, are
+   * returned in @invalid_out. Positions that appear in neither output have not
+   * been written. Callers should bound the size of the range.
+   *
+   * @param oid
+   * @param epoch
+   * @param min_position
+   * @param max_position
+   * @param stride
+   * @param entries_out
+   * @param invalid_out
+   *
+   * @return 0 or non-zero
+   * -EINVAL bad input params, bad epoch, zero stride
+   * -ENOENT object doesn't exist / needs init
+   * -ESPIPE stale epoch
+   * -EIO an entry in the range failed checksum verification
+   * -EOPNOTSUPP range reads are not supported by the backend
+   */
+  virtual int ReadRange(const std::string& oid, uint64_t epoch,
+      uint64_t min_position, uint64_t max_position, uint32_t stride,
+      std::map<uint64_t, std::string> *entries_out,
+      std::set<uint64_t> *invalid_out) {
+    return -EOPNOTSUPP;
+  }
+
   /**
    * Write a log position.
    *
@@ -189,6 +227,135 @@ class Backend {
   virtual int Write(const std::string& oid, const std::string& data,
       uint64_t epoch, uint64_t position) = 0;
 
+  /**
+   * Write a batch of log positions to one object.
+   *
+   * Each entry is a (position, data) pair. On return @results holds one result
+   * per entry, with the same meaning as the return value of Write. A non-zero
+   * return value is an object-level error (e.g. stale epoch) that stopped the
+   * batch, and entries that were not written have their result set to it.
+   *
+   * The default implementation loops over Write. Backends should override it
+   * when a batch can be applied more efficiently than one entry at a time.
+   *
+   * @param oid
+   * @param epoch
+   * @param entries
+   * @param results
+   *
+   * @return 0 or non-zero
+   * -EINVAL bad input params
+   * -ENOENT object doesn't exist / needs init
+   * -ESPIPE stale epoch
+   */
+  virtual int WriteBatch(const std::string& oid, uint64_t epoch,
+      const std::vector<std::pair<uint64_t, const std::string*>>& entries,
+      std::vector<int> *results) {
+    if (entries.empty() || !results) {
+      return -EINVAL;
+    }
+
+    results->assign(entries.size(), 0);
+
+    for (size_t i = 0; i < entries.size(); i++) {
+      int ret = Write(oid, *entries[i].second, epoch, entries[i].first);
+      if (ret == -EINVAL || ret == -ENOENT || ret == -ESPIPE) {
+        std::fill(results->begin() + i, results->end(), ret);
+        return ret;
+      }
+      (*results)[i] = ret;
+    }
+
+    return 0;
+  }
+
+  /**
+   * Asynchronous versions of Read, Write, Fill, Seal and WriteBatch.
+   *
+   * A return value of zero means that the request was submitted, and @cb will
+   * be invoked exactly once with a result that has the same meaning as the
+   * return value of the synchronous interface. The callback may run before the
+   * call returns, and it may run on a backend thread. Output parameters, such
+   * as @data_out, must remain valid until the callback has run. A non-zero
+   * return value means that the request was not submitted, and @cb will not be
+   * invoked.
+   *
+   * Input parameters are only valid until the call returns or @cb is invoked,
+   * whichever comes first. In particular @oid, and @data for WriteAsync, may
+   * refer to a buffer that the caller reuses from within the callback, so an
+   * implementation that needs them after submitting the request, or after
+   * invoking @cb, must copy them first.
+   *
+   * The default implementations complete the request inline by calling the
+   * synchronous interface.
+   */
+  virtual int ReadAsync(const std::string& oid, uint64_t epoch,
+      uint64_t position, std::string *data_out, std::function<void(int)> cb) {
+    cb(Read(oid, epoch, position, data_out));
+    return 0;
+  }
+
+  virtual int WriteAsync(const std::string& oid, const std::string& data,
+      uint64_t epoch, uint64_t position, std::function<void(int)> cb) {
+    cb(Write(oid, data, epoch, position));
+    return 0;
+  }
+
+  virtual int FillAsync(const std::string& oid, uint64_t epoch,
+      uint64_t position, std::function<void(int)> cb) {
+    cb(Fill(oid, epoch, position));
+    return 0;
+  }
+
+  virtual int SealAsync(const std::string& oid, uint64_t epoch,
+      std::function<void(int)> cb) {
+    cb(Seal(oid, epoch));
+    return 0;
+  }
+
+  // unlike the other input parameters, @entries, and the data that they point
+  // to, must remain valid until the callback has run.
+  virtual int WriteBatchAsync(const std::string& oid, uint64_t epoch,
+      const std::vector<std::pair<uint64_t, const std::string*>>& entries,
+      std::vector<int> *results, std::function<void(int)> cb) {
+    cb(WriteBatch(oid, epoch, entries, results));
+    return 0;
+  }
+
+  /**
+   * Read a log position without copying the entry out of the backend.
+   *
+   * On success @data_out references the entry and keeps the memory holding it
+   * alive (see Slice). Return values are the same as for Read, and
+   * ReadSliceAsync completes like ReadAsync.
+   *
+   * The default implementations read into a new buffer that is owned by the
+   * slice. Backends that keep entries in memory, or that can pin entries in
+   * place, should override them.
+   */
+  virtual int ReadSlice(const std::string& oid, uint64_t epoch,
+      uint64_t position, Slice *data_out) {
+    auto data = std::make_shared<std::string>();
+    int ret = Read(oid, epoch, position, data.get());
+    if (!ret) {
+      *data_out = Slice(std::move(data));
+    }
+    return ret;
+  }
+
+  virtual int ReadSliceAsync(const std::string& oid, uint64_t epoch,
+      uint64_t position, Slice *data_out, std::function<void(int)> cb) {
+    auto data = std::make_shared<std::string>();
+    auto buf = data.get();
+    return ReadAsync(oid, epoch, position, buf,
+        [data, data_out, cb](int ret) {
+      if (!ret) {
+        *data_out = Slice(data);
+      }
+      cb(ret);
+    });
+  }
+
   /**
    * Fill a log position.
    *
@@ -254,6 +421,40 @@ class Backend {
    */
   virtual int MaxPos(const std::string& oid, uint64_t *pos_out, bool *empty_out) = 0;
 
+  /**
+   * Seal an object and return its maximum position.
+   *
+   * This is how the objects of a stripe are sealed when a new sequencer is
+   * proposed. Backends that override it can seal an object and read its
+   * maximum position in a single round trip. Unlike Seal, an epoch that isn't
+   * larger than the stored epoch is not an error. The object is already sealed
+   * at an epoch of at least @epoch, and its maximum position is returned.
+   *
+   * SealAndMaxPosAsync completes like ReadAsync.
+   *
+   * @param oid
+   * @param epoch
+   * @param pos_out
+   * @param empty_out
+   *
+   * @return 0 or non-zero
+   * -EINVAL bad input params
+   */
+  virtual int SealAndMaxPos(const std::string& oid, uint64_t epoch,
+      uint64_t *pos_out, bool *empty_out) {
+    int ret = Seal(oid, epoch);
+    if (ret && ret != -ESPIPE) {
+      return ret;
+    }
+    return MaxPos(oid, pos_out, empty_out);
+  }
+
+  virtual int SealAndMaxPosAsync(const std::string& oid, uint64_t epoch,
+      uint64_t *pos_out, bool *empty_out, std::function<void(int)> cb) {
+    cb(SealAndMaxPos(oid, epoch, pos_out, empty_out));
+    return 0;
+  }
+
   /**
    * Return the size of an object in bytes.
    *
@@ -267,6 +468,26 @@ class Backend {
    * -ENOENT object doesn't exist / needs init
    */
   virtual int Stat(const std::string& oid, size_t *size) = 0;
+
+  /**
+   * Verify the checksum of every readable entry in an object.
+   *
+   * Each entry is checksummed when it is written. Scrub checks all of the
+   * entries of an object that haven't been filled or trimmed, even when the
+   * backend has been configured to skip verification on reads, and returns
+   * the positions that failed in @corrupt_out.
+   *
+   * @param oid
+   * @param corrupt_out
+   *
+   * @return 0 or non-zero
+   * -EINVAL bad input params
+   * -ENOENT object doesn't exist / needs init
+   * -EOPNOTSUPP scrubbing is not supported by the backend
+   */
+  virtual int Scrub(const std::string& oid, std::set<uint64_t> *corrupt_out) {
+    return -EOPNOTSUPP;
+  }
 };
 
 }
@@ -36,22 +36,56 @@ class CephBackend : public Backend {
   int Read(const std::string& oid, uint64_t epoch,
       uint64_t position, std::string *data) override;
 
+  int ReadRange(const std::string& oid, uint64_t epoch,
+      uint64_t min_position, uint64_t max_position, uint32_t stride,
+      std::map<uint64_t, std::string> *entries_out,
+      std::set<uint64_t> *invalid_out) override;
+
   int Write(const std::string& oid, const std::string& data,
       uint64_t epoch, uint64_t position) override;
 
+  int WriteBatch(const std::string& oid, uint64_t epoch,
+      const std::vector<std::pair<uint64_t, const std::string*>>& entries,
+      std::vector<int> *results) override;
+
+  int WriteBatchAsync(const std::string& oid, uint64_t epoch,
+      const std::vector<std::pair<uint64_t, const std::string*>>& entries,
+      std::vector<int> *results, std::function<void(int)> cb) override;
+
+  int ReadAsync(const std::string& oid, uint64_t epoch,
+      uint64_t position, std::string *data_out,
+      std::function<void(int)> cb) override;
+
+  int WriteAsync(const std::string& oid, const std::string& data,
+      uint64_t epoch, uint64_t position, std::function<void(int)> cb) override;
+
   int Fill(const std::string& oid, uint64_t epoch,
       uint64_t position) override;
 
+  int FillAsync(const std::string& oid, uint64_t epoch,
+      uint64_t position, std::function<void(int)> cb) override;
+
   int Trim(const std::string& oid, uint64_t epoch,
       uint64_t position, bool trim_limit, bool trim_full) override;
 
   int Seal(const std::string& oid,
       uint64_t epoch) override;
 
+  int SealAsync(const std::string& oid, uint64_t epoch,
+      std::function<void(int)> cb) override;
+
   int MaxPos(const std::string& oid, uint64_t *pos, bool *empty) override;
 
+  int SealAndMaxPos(const std::string& oid, uint64_t epoch,
+      uint64_t *pos, bool *empty) override;
+
+  int SealAndMaxPosAsync(const std::string& oid, uint64_t epoch,
+      uint64_t *pos, bool *empty, std::function<void(int)> cb) override;
+
   int Stat(const std::string& oid, size_t *size) override;
 
+  int Scrub(const std::string& oid, std::set<uint64_t> *corrupt_out) override;
+
  private:
   std::map<std::string, std::string> options;
 
@@ -64,6 +98,9 @@ class CephBackend : public Backend {
   //         > 0 -> use omap when entry < max size
   boost::optional<uint32_t> omap_max_size_;
 
+  // entry checksums are verified by the object class on reads
+  bool verify_checksums_;
+
   static std::string LinkObjectName(const std::string& name);
 
   int CreateLinkObject(const std::string& name,
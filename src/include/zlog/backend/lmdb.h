@@ -1,7 +1,13 @@
 #pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <cstring>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
 #include <vector>
-#include <sstream>
 #include <iostream>
 #include <memory>
 #include <lmdb.h>
@@ -49,9 +55,25 @@ class LMDBBackend : public Backend {
   int Read(const std::string& oid, uint64_t epoch,
       uint64_t position, std::string *data) override;
 
+  int ReadSlice(const std::string& oid, uint64_t epoch,
+      uint64_t position, Slice *data_out) override;
+
+  int ReadSliceAsync(const std::string& oid, uint64_t epoch,
+      uint64_t position, Slice *data_out,
+      std::function<void(int)> cb) override;
+
+  int ReadRange(const std::string& oid, uint64_t epoch,
+      uint64_t min_position, uint64_t max_position, uint32_t stride,
+      std::map<uint64_t, std::string> *entries_out,
+      std::set<uint64_t> *invalid_out) override;
+
   int Write(const std::string& oid, const std::string& data,
       uint64_t epoch, uint64_t position) override;
 
+  int WriteBatch(const std::string& oid, uint64_t epoch,
+      const std::vector<std::pair<uint64_t, const std::string*>>& entries,
+      std::vector<int> *results) override;
+
   int Fill(const std::string& oid, uint64_t epoch,
       uint64_t position) override;
 
@@ -65,10 +87,22 @@ class LMDBBackend : public Backend {
 
   int Stat(const std::string& oid, size_t *size) override;
 
+  int Scrub(const std::string& oid, std::set<uint64_t> *corrupt_out) override;
+
  private:
   std::map<std::string, std::string> options;
   MDB_env *env;
+
+  // links, head objects and log object metadata are small and read by every
+  // operation, so they are kept apart from the bulk of the data in the views
+  // and entries databases.
   MDB_dbi db_obj;
+  MDB_dbi db_views;
+  MDB_dbi db_entries;
+
+  // objects with entries at or below their trim limit that haven't been
+  // deleted yet
+  MDB_dbi db_reclaim;
 
   struct LinkObject {
     char hoid[128];
@@ -83,27 +117,41 @@ class LMDBBackend : public Backend {
   struct LogObject {
     uint64_t epoch;
     int64_t trim_limit;
-    LogObject() : epoch(0), trim_limit(-1) {}
+    // the object's entries are keyed by id rather than by name
+    uint64_t id;
+    LogObject() : epoch(0), trim_limit(-1), id(0) {}
   };
 
   struct LogMaxPos {
     uint64_t maxpos;
   };
 
+  // the entry data follows the header
   struct LogEntry {
     bool trimmed;
     bool invalidated;
+    uint32_t crc; // crc32c of the entry data
     uint64_t position;
-    LogEntry() : trimmed(false), invalidated(false) {}
+    LogEntry() : trimmed(false), invalidated(false), crc(0) {}
   };
 
+  static bool VerifyEntry(const MDB_val& val);
+
   struct Transaction {
     MDB_txn *txn;
     LMDBBackend *be;
     bool closed;
 
+    // set when an update failed because the map is full. lmdb fails every
+    // later operation in the transaction, so they return -ENOSPC without
+    // calling into lmdb, and the transaction can only be aborted.
+    bool map_full;
+
+    // the size of the keys and values written
+    size_t bytes;
+
     Transaction(MDB_txn *txn, LMDBBackend *be) :
-      txn(txn), be(be), closed(false)
+      txn(txn), be(be), closed(false), map_full(false), bytes(0)
     {}
 
     ~Transaction() {
@@ -116,111 +164,349 @@ class LMDBBackend : public Backend {
     void Abort() {
       mdb_txn_abort(txn);
       closed = true;
+      be->ExitTransaction();
     }
 
     int Commit() {
       closed = true;
-      return mdb_txn_commit(txn);
+      int ret = mdb_txn_commit(txn);
+      be->ExitTransaction();
+      return ret;
     }
 
     int Get(const std::string& key, MDB_val& val) {
+      return Get(be->db_obj, key, val);
+    }
+
+    int Get(MDB_dbi dbi, const std::string& key, MDB_val& val) {
       MDB_val k;
       k.mv_size = key.size();
       k.mv_data = (void*)key.data();
-      int ret = mdb_get(txn, be->db_obj, &k, &val);
+      if (map_full)
+        return -ENOSPC;
+      int ret = mdb_get(txn, dbi, &k, &val);
       assert(ret == 0 || ret == MDB_NOTFOUND);
       if (ret == MDB_NOTFOUND)
         return -ENOENT;
       return 0;
     }
 
-    int GetAll(const std::string& prefix, std::vector<MDB_val> &keys) {
+    // visit the keys at or after start in order, until fn returns false
+    int Seek(MDB_dbi dbi, const std::string& start,
+        const std::function<bool(const MDB_val&, const MDB_val&)>& fn) {
+      if (map_full)
+        return -ENOSPC;
       MDB_cursor *cursor;
-      int ret = mdb_cursor_open(txn, be->db_obj, &cursor);
+      int ret = mdb_cursor_open(txn, dbi, &cursor);
       assert(ret == 0);
-      MDB_val key;
-      ret = mdb_cursor_get(cursor, &key, nullptr, MDB_FIRST);
-      if (ret == MDB_NOTFOUND) {
-        mdb_cursor_close(cursor);
-        return 0;
-      }
-      assert(ret == 0);
-      if (startsWith(key, prefix)) {
-        keys.push_back(key);
+      MDB_val key, val;
+      key.mv_size = start.size();
+      key.mv_data = (void*)start.data();
+      ret = mdb_cursor_get(cursor, &key, &val,
+          start.empty() ? MDB_FIRST : MDB_SET_RANGE);
+      while (ret == 0 && fn(key, val)) {
+        ret = mdb_cursor_get(cursor, &key, &val, MDB_NEXT);
       }
-      while ((ret = mdb_cursor_get(cursor, &key, nullptr, MDB_NEXT)) == 0) {
-        if (startsWith(key, prefix)) {
-          keys.push_back(key);
-        }
-      }
-      assert(ret == MDB_NOTFOUND);
+      assert(ret == 0 || ret == MDB_NOTFOUND);
       mdb_cursor_close(cursor);
       return 0;
     }
 
+    // collect the keys (and optionally values) that start with prefix
+    int GetAll(MDB_dbi dbi, const std::string& prefix,
+        std::vector<MDB_val> &keys, std::vector<MDB_val> *vals = nullptr) {
+      return Seek(dbi, prefix, [&](const MDB_val& key, const MDB_val& val) {
+        if (!startsWith(key, prefix)) {
+          return false;
+        }
+        keys.push_back(key);
+        if (vals) {
+          vals->push_back(val);
+        }
+        return true;
+      });
+    }
+
     int Put(const std::string& key, MDB_val& val, bool exclusive) {
+      return Put(be->db_obj, key, val, exclusive);
+    }
+
+    int Put(MDB_dbi dbi, const std::string& key, MDB_val& val,
+        bool exclusive) {
       MDB_val k;
       k.mv_size = key.size();
       k.mv_data = (void*)key.data();
       int flags = exclusive ? MDB_NOOVERWRITE : 0;
-      int ret = mdb_put(txn, be->db_obj, &k, &val, flags);
-      assert(ret == 0 || ret == MDB_KEYEXIST);
+      if (map_full)
+        return -ENOSPC;
+      int ret = mdb_put(txn, dbi, &k, &val, flags);
+      assert(ret == 0 || ret == MDB_KEYEXIST || ret == MDB_MAP_FULL);
       if (ret == MDB_KEYEXIST)
         return -EEXIST;
+      if (ret == MDB_MAP_FULL) {
+        map_full = true;
+        return -ENOSPC;
+      }
+      bytes += k.mv_size + val.mv_size;
       return 0;
     }
 
-    int Put(const std::string& key, const std::vector<unsigned char>& val,
-        bool exclusive) {
+    int Put(MDB_dbi dbi, const std::string& key,
+        const std::vector<unsigned char>& val, bool exclusive) {
       MDB_val v;
       v.mv_size = val.size();
       v.mv_data = (void*)val.data();
-      return Put(key, v, exclusive);
+      return Put(dbi, key, v, exclusive);
+    }
+
+    // delete the keys at or after start in order while fn returns true, up
+    // to max keys (0 for no limit)
+    int DeleteRange(MDB_dbi dbi, const std::string& start,
+        const std::function<bool(const MDB_val&)>& fn, size_t max,
+        size_t *count) {
+      *count = 0;
+      if (map_full)
+        return -ENOSPC;
+      MDB_cursor *cursor;
+      int ret = mdb_cursor_open(txn, dbi, &cursor);
+      assert(ret == 0);
+      MDB_val key, val;
+      key.mv_size = start.size();
+      key.mv_data = (void*)start.data();
+      *count = 0;
+      ret = mdb_cursor_get(cursor, &key, &val, MDB_SET_RANGE);
+      while (ret == 0 && (max == 0 || *count < max) && fn(key)) {
+        ret = mdb_cursor_del(cursor, 0);
+        if (ret) {
+          break;
+        }
+        (*count)++;
+        // after a delete the cursor moves to the key that followed
+        ret = mdb_cursor_get(cursor, &key, &val, MDB_NEXT);
+      }
+      mdb_cursor_close(cursor);
+      if (ret == MDB_MAP_FULL) {
+        map_full = true;
+        return -ENOSPC;
+      }
+      assert(ret == 0 || ret == MDB_NOTFOUND);
+      return 0;
     }
 
-    int Delete(const std::string& key) {
+    int Delete(MDB_dbi dbi, const std::string& key) {
       MDB_val k;
       k.mv_size = key.size();
       k.mv_data = (void*)key.data();
-      return mdb_del(txn, be->db_obj, &k, NULL);
+      if (map_full)
+        return -ENOSPC;
+      int ret = mdb_del(txn, dbi, &k, NULL);
+      if (ret == MDB_MAP_FULL) {
+        map_full = true;
+        return -ENOSPC;
+      }
+      return ret;
     }
 
   private:
     bool startsWith(const MDB_val &val, const std::string &prefix) {
       return val.mv_size >= prefix.size()
-         && std::strncmp(reinterpret_cast<const char*>(val.mv_data), prefix.c_str(), prefix.size()) == 0;
+         && std::memcmp(val.mv_data, prefix.data(), prefix.size()) == 0;
     }
   };
 
   Transaction NewTransaction(bool read_only = false);
 
-  std::string LogEntryKey(const std::string& oid,
-      uint64_t position)
+  // big-endian numbers sort numerically under lmdb's default byte-wise key
+  // comparison.
+  static void AppendNumber(std::string& key, uint64_t n)
+  {
+    for (int shift = 56; shift >= 0; shift -= 8) {
+      key.push_back(static_cast<char>((n >> shift) & 0xff));
+    }
+  }
+
+  // the number at the end of a key
+  static uint64_t KeyNumber(const MDB_val& key)
+  {
+    assert(key.mv_size >= sizeof(uint64_t));
+    const auto data = static_cast<const unsigned char*>(key.mv_data) +
+      key.mv_size - sizeof(uint64_t);
+    uint64_t n = 0;
+    for (size_t i = 0; i < sizeof(uint64_t); i++) {
+      n = (n << 8) | data[i];
+    }
+    return n;
+  }
+
+  // log entries are keyed by the object id followed by the position, so an
+  // object's entries are contiguous and in position order.
+  static std::string LogEntryPrefix(uint64_t id)
   {
-    std::stringstream ss;
-    ss << oid << ".entry." << position;
-    return ss.str();
+    std::string key;
+    key.reserve(2 * sizeof(uint64_t));
+    AppendNumber(key, id);
+    return key;
   }
 
-  std::string MaxPosKey(const std::string& oid)
+  static std::string LogEntryKey(uint64_t id, uint64_t position)
   {
-    std::stringstream ss;
-    ss << oid << ".maxpos";
-    return ss.str();
+    auto key = LogEntryPrefix(id);
+    AppendNumber(key, position);
+    return key;
   }
 
-  std::string ProjectionKey(const std::string& oid, uint64_t epoch)
+  // the max position is stored next to the object's metadata. the zero byte
+  // can't appear in object names.
+  static std::string MaxPosKey(const std::string& oid)
   {
-    std::stringstream ss;
-    ss << oid << "." << epoch;
-    return ss.str();
+    std::string key;
+    key.reserve(oid.size() + 2);
+    key.append(oid);
+    key.push_back('\0');
+    key.push_back('m');
+    return key;
+  }
+
+  // the counter from which log object ids are assigned
+  static std::string NextObjectIdKey()
+  {
+    return std::string("\0next_object_id", 15);
+  }
+
+  static std::string ProjectionKey(const std::string& oid, uint64_t epoch)
+  {
+    std::string key;
+    key.reserve(oid.size() + 1 + sizeof(uint64_t));
+    key.append(oid);
+    key.push_back('\0');
+    AppendNumber(key, epoch);
+    return key;
   }
 
   int CheckEpoch(Transaction& txn, uint64_t epoch, const std::string& oid,
       bool eq = false);
 
+  int GetEntry(Transaction& txn, const std::string& oid, uint64_t epoch,
+      uint64_t position, MDB_val *blob);
+
+  // the bodies of the log object updates. each runs inside a write
+  // transaction that may be shared with other updates, so an update that
+  // fails must return before modifying the transaction.
+  int ApplyWrite(Transaction& txn, const std::string& oid,
+      const std::string& data, uint32_t crc, uint64_t epoch,
+      uint64_t position);
+
+  int ApplyWriteBatch(Transaction& txn, const std::string& oid, uint64_t epoch,
+      const std::vector<std::pair<uint64_t, const std::string*>>& entries,
+      const std::vector<uint32_t>& crcs, std::vector<int> *results);
+
+  int ApplyFill(Transaction& txn, const std::string& oid, uint64_t epoch,
+      uint64_t position);
+
+  int ApplyTrim(Transaction& txn, const std::string& oid, uint64_t epoch,
+      uint64_t position, bool trim_limit, bool trim_full);
+
+  int ApplySeal(Transaction& txn, const std::string& oid, uint64_t epoch);
+
+  // deletes up to reclaim_batch_size of an object's entries at or below its
+  // trim limit, and sets done once none are left.
+  int ApplyReclaim(Transaction& txn, const std::string& oid, bool *done);
+
+  // removes an object's reclaim marker, and after a full trim its max
+  // position once the trim limit covers it.
+  int FinishReclaim(Transaction& txn, const std::string& oid,
+      const LogObject& lobj, bool trim_full);
+
+  // runs an update in a write transaction that is committed together with
+  // the updates of other threads, and returns the update's result.
+  int GroupCommit(const std::function<int(Transaction&)>& update);
+
+  struct PendingUpdate {
+    const std::function<int(Transaction&)> *update;
+    int result;
+    bool done;
+  };
+
+  void CommitBatch(const std::vector<PendingUpdate*>& batch);
+
+  // the map can only be resized while no transactions are open in this
+  // process. transactions are counted, and new transactions wait while the
+  // map is being resized.
+  void EnterTransaction();
+  void ExitTransaction();
+  int GrowMap(bool wait);
+  void MaybeGrowMap();
+
+  void SyncThread();
+
+  void ReclaimThread();
+  void Reclaim();
+
  private:
   bool need_close = false;
+
+  // entries are checksummed when written, and verified on reads unless
+  // disabled
+  bool verify_checksums = true;
+
+  // read transactions owned by slices. lmdb allows 126 readers by default.
+  static const int max_leased_txns = 64;
+  std::atomic<int> leased_txns{0};
+
+  // group commit. updates are queued, and the first thread to find no
+  // commit in progress becomes the leader: it waits up to the window for the
+  // batch to fill, and then applies and commits the queued updates in one
+  // transaction while the other threads wait for their results.
+  uint64_t group_commit_window_us = 0;
+  size_t group_commit_max_batch = 128;
+
+  std::mutex commit_lock;
+  std::condition_variable commit_cond;
+  std::condition_variable leader_cond;
+  std::deque<PendingUpdate*> commit_queue;
+  bool committing = false;
+
+  // the initial map size, and the size up to which it is doubled when it
+  // fills up (0 for no limit)
+  size_t map_size = 1ULL << 30;
+  size_t map_max_size = 0;
+
+  std::atomic<int> active_txns{0};
+  std::atomic<bool> resizing{false};
+  // the map is nearly full and waiting to be resized. slices copy entries
+  // instead of leasing transactions while this is set.
+  std::atomic<bool> grow_wanted{false};
+  std::mutex resize_lock;
+  std::condition_variable resize_cond;
+
+  // durability. with SYNC_NONE commits are written to the map and left for
+  // the operating system to flush, SYNC_PERIODIC adds a thread that flushes
+  // the map every sync_interval_ms or after sync_bytes are written, and
+  // SYNC_COMMIT flushes every group commit.
+  enum SyncMode {
+    SYNC_NONE,
+    SYNC_PERIODIC,
+    SYNC_COMMIT,
+  };
+
+  SyncMode sync_mode = SYNC_NONE;
+  uint64_t sync_interval_ms = 1000;
+  size_t sync_bytes = 0;
+
+  std::mutex sync_lock;
+  std::condition_variable sync_cond;
+  size_t unsynced_bytes = 0;
+  bool stop_sync = false;
+  std::thread sync_thread;
+
+  // background space reclamation for trimmed entries (0 to disable)
+  size_t reclaim_batch_size = 1024;
+
+  std::mutex reclaim_lock;
+  std::condition_variable reclaim_cond;
+  bool reclaim_pending = true;
+  std::atomic<bool> stop_reclaim{false};
+  std::thread reclaim_thread;
 };
 
 }
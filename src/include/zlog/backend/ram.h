@@ -1,4 +1,7 @@
 #pragma once
+#include <array>
+#include <atomic>
+#include <map>
 #include <vector>
 #include <sstream>
 #include <iostream>
@@ -17,6 +20,10 @@ class RAMBackend : public Backend {
  public:
   RAMBackend() :
     blackhole_(false),
+    verify_checksums_(true),
+    max_bytes_(0),
+    bytes_allocated_(0),
+    bytes_used_(0),
     options_{{"scheme", "ram"}}
   {}
 
@@ -48,9 +55,25 @@ class RAMBackend : public Backend {
   int Read(const std::string& oid, uint64_t epoch,
       uint64_t position, std::string *data) override;
 
+  int ReadSlice(const std::string& oid, uint64_t epoch,
+      uint64_t position, Slice *data_out) override;
+
+  int ReadSliceAsync(const std::string& oid, uint64_t epoch,
+      uint64_t position, Slice *data_out,
+      std::function<void(int)> cb) override;
+
+  int ReadRange(const std::string& oid, uint64_t epoch,
+      uint64_t min_position, uint64_t max_position, uint32_t stride,
+      std::map<uint64_t, std::string> *entries_out,
+      std::set<uint64_t> *invalid_out) override;
+
   int Write(const std::string& oid, const std::string& data,
       uint64_t epoch, uint64_t position) override;
 
+  int WriteBatch(const std::string& oid, uint64_t epoch,
+      const std::vector<std::pair<uint64_t, const std::string*>>& entries,
+      std::vector<int> *results) override;
+
   int Fill(const std::string& oid, uint64_t epoch,
       uint64_t position) override;
 
@@ -62,8 +85,13 @@ class RAMBackend : public Backend {
 
   int MaxPos(const std::string& oid, uint64_t *pos, bool *empty) override;
 
+  int SealAndMaxPos(const std::string& oid, uint64_t epoch,
+      uint64_t *pos, bool *empty) override;
+
   int Stat(const std::string& oid, size_t *size) override;
 
+  int Scrub(const std::string& oid, std::set<uint64_t> *corrupt_out) override;
+
  private:
   struct LinkObject {
     std::string hoid;
@@ -76,35 +104,147 @@ class RAMBackend : public Backend {
     std::map<uint64_t, std::string> projections;
   };
 
+  // entry data lives in a chunk of the object's arena. it is immutable once
+  // written and slices returned by ReadSlice share ownership of the chunk,
+  // which keeps it alive after the entry is trimmed.
   struct LogEntry {
+    bool exists;
     bool trimmed;
     bool invalidated;
-    std::string data;
-    LogEntry() : trimmed(false), invalidated(false) {}
+    uint32_t chunk;
+    uint32_t crc;     // crc32c of the payload
+    const char *data; // nullptr if the entry has no payload
+    size_t size;
+    LogEntry() :
+      exists(false),
+      trimmed(false),
+      invalidated(false),
+      chunk(0),
+      crc(0),
+      data(nullptr),
+      size(0)
+    {}
+  };
+
+  // payloads of an object are bump allocated from chunks that are released
+  // together when a full trim clears the object. chunks start small and
+  // double in size so that objects with few entries stay small.
+  struct Arena {
+    std::vector<std::shared_ptr<char>> chunks;
+    char *next;       // free space at the end of the last chunk
+    size_t avail;
+    size_t allocated; // bytes in all chunks
+    size_t used;      // payload bytes of entries that haven't been trimmed
+    Arena() : next(nullptr), avail(0), allocated(0), used(0) {}
+  };
+
+  // the entries of one log object. a striped log places positions that are
+  // congruent modulo the stripe width on each object, but the width isn't
+  // known to the backend. the table learns the layout (base + k * stride)
+  // from the positions it sees and stores entry k at index k of a vector.
+  // positions that don't fit the layout are kept in an overflow map until
+  // enough accumulate that the layout is recomputed.
+  class EntryTable {
+   public:
+    EntryTable() :
+      base_(0),
+      stride_(0),
+      count_(0),
+      relayout_at_(2)
+    {}
+
+    LogEntry *find(uint64_t position);
+
+    // the position must not already have an entry
+    LogEntry& insert(uint64_t position);
+
+    void clear();
+
+    bool empty() const {
+      return count_ == 0;
+    }
+
+    // f(position, entry)
+    template<typename F>
+    void for_each(F f) const {
+      for (uint64_t index = 0; index < dense_.size(); index++) {
+        if (dense_[index].exists) {
+          f(base_ + index * stride_, dense_[index]);
+        }
+      }
+      for (const auto& entry : sparse_) {
+        f(entry.first, entry.second);
+      }
+    }
+
+   private:
+    bool dense_index(uint64_t position, uint64_t *index) const;
+    void relayout();
+
+    uint64_t base_;
+    uint64_t stride_; // zero until a layout is chosen
+    size_t count_;
+    size_t relayout_at_;
+    std::vector<LogEntry> dense_;
+    std::map<uint64_t, LogEntry> sparse_;
   };
 
   struct LogObject {
     uint64_t epoch;
     uint64_t maxpos;
-    std::unordered_map<uint64_t, LogEntry> entries;
+    EntryTable entries;
+    Arena arena;
     boost::optional<uint64_t> trim_limit;
     LogObject() : epoch(0), maxpos(0) {}
   };
 
  private:
+  // the caller holds the lock of the shard that oid maps to
   int CheckEpoch(uint64_t epoch, const std::string& oid,
       bool eq, LogObject*& lobj);
 
+  int ReadEntry(const std::string& oid, uint64_t epoch, uint64_t position,
+      Slice *data);
+
+  // copy data and its checksum into the object's arena. returns -ENOSPC if
+  // that would take the backend past max_bytes.
+  int StoreEntry(LogObject *lobj, const std::string& data, uint32_t crc,
+      LogEntry *entry);
+
+  static bool VerifyEntry(const LogEntry& entry);
+
+  static void GetMaxPos(const LogObject& lobj, uint64_t *pos, bool *empty);
+
+  void ReleaseEntry(LogObject *lobj, LogEntry *entry);
+
+  void ReleaseArena(LogObject *lobj);
+
   bool startsWith(std::string s, std::string prefix) {
     return s.size() >= prefix.size() && std::equal(prefix.cbegin(), prefix.cend(), s.cbegin());
   }
 
+  // objects are spread over shards by a hash of their name so that
+  // operations on different objects don't contend on a single lock.
+  struct Shard {
+    std::mutex lock;
+    std::unordered_map<std::string,
+      boost::variant<LinkObject, ProjectionObject, LogObject>> objects;
+  };
+
+  static const size_t num_shards = 64;
+
+  Shard& shard_for(const std::string& oid) {
+    return shards_[std::hash<std::string>()(oid) % num_shards];
+  }
+
  private:
-  mutable std::mutex lock_;
   bool blackhole_;
+  bool verify_checksums_;
+  size_t max_bytes_; // zero for no limit
+  std::atomic<size_t> bytes_allocated_;
+  std::atomic<size_t> bytes_used_;
   std::map<std::string, std::string> options_;
-  std::unordered_map<std::string,
-    boost::variant<LinkObject, ProjectionObject, LogObject>> objects_;
+  std::array<Shard, num_shards> shards_;
 };
 
 }
@@ -0,0 +1,300 @@
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <boost/optional.hpp>
+#include "zlog/backend.h"
+
+namespace zlog {
+namespace storage {
+
+class IOEngine;
+
+namespace segment {
+
+// every object is an append-only segment file of records in a directory. the
+// state of an object, including the index from positions to the file offsets
+// of its entries, is rebuilt by scanning the file when it is first used, and
+// is dropped again when the object is idle and more than max_open_segments
+// objects are open. appends and asynchronous reads are issued through an I/O
+// engine.
+class SegmentBackend : public Backend {
+ public:
+  SegmentBackend();
+
+  ~SegmentBackend();
+
+  int Init(const std::string& path);
+
+  int Initialize(const std::map<std::string, std::string>& opts) override;
+
+  void Close();
+
+  std::map<std::string, std::string> meta() override;
+
+  int uniqueId(const std::string& hoid, uint64_t *id) override;
+
+  int CreateLog(const std::string& name, const std::string& view,
+      std::string *hoid_out, std::string *prefix_out) override;
+
+  int OpenLog(const std::string& name, std::string *hoid,
+      std::string *prefix_out) override;
+
+  int ListLinks(std::vector<std::string> &loids_out) override;
+
+  int ListHeads(std::vector<std::string> &ooids_out) override;
+
+  int ReadViews(const std::string& hoid,
+      uint64_t epoch, uint32_t max_views,
+      std::map<uint64_t, std::string> *views_out) override;
+
+  int ProposeView(const std::string& hoid,
+      uint64_t epoch, const std::string& view) override;
+
+  int Read(const std::string& oid, uint64_t epoch,
+      uint64_t position, std::string *data) override;
+
+  int ReadAsync(const std::string& oid, uint64_t epoch,
+      uint64_t position, std::string *data_out,
+      std::function<void(int)> cb) override;
+
+  int ReadRange(const std::string& oid, uint64_t epoch,
+      uint64_t min_position, uint64_t max_position, uint32_t stride,
+      std::map<uint64_t, std::string> *entries_out,
+      std::set<uint64_t> *invalid_out) override;
+
+  int Write(const std::string& oid, const std::string& data,
+      uint64_t epoch, uint64_t position) override;
+
+  int WriteAsync(const std::string& oid, const std::string& data,
+      uint64_t epoch, uint64_t position,
+      std::function<void(int)> cb) override;
+
+  int WriteBatch(const std::string& oid, uint64_t epoch,
+      const std::vector<std::pair<uint64_t, const std::string*>>& entries,
+      std::vector<int> *results) override;
+
+  int Fill(const std::string& oid, uint64_t epoch,
+      uint64_t position) override;
+
+  int Trim(const std::string& oid, uint64_t epoch,
+      uint64_t position, bool trim_limit, bool trim_full) override;
+
+  int Seal(const std::string& oid,
+      uint64_t epoch) override;
+
+  int MaxPos(const std::string& oid, uint64_t *pos, bool *empty) override;
+
+  int Stat(const std::string& oid, size_t *size) override;
+
+  int Scrub(const std::string& oid, std::set<uint64_t> *corrupt_out) override;
+
+ private:
+  enum SyncMode {
+    SYNC_NONE,
+    SYNC_COMMIT,
+  };
+
+  enum RecordType : uint8_t {
+    RECORD_ENTRY = 1,   // arg: position, payload: entry data
+    RECORD_FILL,        // arg: position
+    RECORD_TRIM,        // arg: position
+    RECORD_TRIM_LIMIT,  // arg: trim limit
+    RECORD_TRIM_FULL,   // arg: trim limit. drops all entries
+    RECORD_SEAL,        // arg: epoch
+    RECORD_LINK,        // payload: head object name
+    RECORD_HEAD,        // payload: data object prefix
+    RECORD_VIEW,        // arg: epoch, payload: view
+    RECORD_UNIQUE_ID,   // arg: next unique id
+  };
+
+  // records start at 8 byte aligned offsets. the checksum covers the header,
+  // with the checksum zeroed, and the payload. a zeroed header is padding or
+  // a punched hole, and the scan resumes at the next block.
+  struct RecordHeader {
+    uint32_t magic;
+    uint32_t crc;
+    uint32_t size;
+    uint8_t type;
+    uint8_t pad[3];
+    uint64_t arg;
+  };
+
+  static const uint32_t record_magic = 0x5a4c4f47;
+  static const size_t block_size = 4096;
+
+  struct IndexEntry {
+    uint64_t offset; // of the payload
+    uint32_t size;
+    bool trimmed;
+    bool invalidated;
+    // the record that added the entry hasn't been written yet
+    bool pending;
+  };
+
+  // a record waiting to be appended
+  struct PendingRecord {
+    RecordHeader header;
+    const char *data;
+    // start the record at a block boundary
+    bool align;
+    // the record added a pending index entry
+    bool reserved;
+    uint64_t offset;
+    int result;
+    bool done;
+    // asynchronous appends own their record and payload, and are completed
+    // by running the callback
+    std::string payload;
+    std::function<void(int)> cb;
+  };
+
+  // records appended to a file by one write
+  struct Batch;
+
+  enum ObjectKind {
+    OBJECT_NONE,
+    OBJECT_LINK,
+    OBJECT_HEAD,
+    OBJECT_LOG,
+  };
+
+  // an object is referenced by the segments map and by the operations that
+  // are using it, including appends and reads in flight. it is only dropped
+  // from the map when no operation holds a reference, and the file is closed
+  // when the last reference goes away.
+  struct Segment : std::enable_shared_from_this<Segment> {
+    ~Segment();
+
+    std::mutex lock;
+    std::condition_variable cond;
+
+    bool loaded = false;
+    int fd = -1;
+    // end of the last record, where the next one is appended
+    uint64_t tail = 0;
+    // a failed append leaves the file in an unknown state, after which the
+    // object returns this error until it is reloaded
+    int error = 0;
+
+    // the file is mapped for reads, and remapped as it grows
+    char *map = nullptr;
+    size_t map_size = 0;
+
+    std::deque<PendingRecord*> queue;
+    bool committing = false;
+
+    ObjectKind kind = OBJECT_NONE;
+
+    // link objects
+    std::string hoid;
+
+    // head objects
+    std::string prefix;
+    uint64_t view_epoch = 0;
+    uint64_t unique_id = 0;
+    std::map<uint64_t, std::string> views;
+
+    // log objects
+    uint64_t epoch = 0;
+    uint64_t maxpos = 0;
+    boost::optional<uint64_t> trim_limit;
+    std::unordered_map<uint64_t, IndexEntry> index;
+    size_t data_bytes = 0;
+
+    // position in the lru list, protected by the backend lock
+    std::list<std::string>::iterator lru;
+  };
+
+ private:
+  // look up an object, adding it to the map
+  std::shared_ptr<Segment> GetSegment(const std::string& oid);
+
+  // make an object the first to be closed once it is idle
+  void ReleaseSegment(Segment *seg);
+
+  // scan the object's file the first time it is used, and close idle
+  // objects while more than max_open_segments are open. an object that
+  // couldn't be loaded is removed from the map unless another operation is
+  // using it.
+  int Load(Segment *seg, const std::string& oid, bool create);
+
+  // open and scan the object's file, creating it if create is set. returns
+  // -ENOENT if the file doesn't exist.
+  int Scan(Segment *seg, const std::string& oid, bool create);
+
+  // update the state of an object from a record, as the record is read
+  // during a scan or after it has been appended
+  void Apply(Segment *seg, const RecordHeader& header, const char *payload,
+      uint64_t offset);
+
+  // append records to the object's file together with the records queued by
+  // other threads, and wait until they are written
+  int Commit(Segment *seg, std::unique_lock<std::mutex>& lk,
+      std::vector<PendingRecord>& records);
+
+  // write the queued records unless a write is already in flight. the lock
+  // is released while the write is submitted.
+  void StartCommit(Segment *seg, std::unique_lock<std::mutex>& lk);
+
+  void FinishCommit(Batch *batch, int ret);
+
+  // validate a write and add its pending entry to the index
+  int PrepareWrite(Segment *seg, uint64_t epoch, PendingRecord& record);
+
+  // wait until no records of the object are being appended
+  void WaitIdle(Segment *seg, std::unique_lock<std::mutex>& lk);
+
+  // map the file up to the end of an entry's record
+  int MapRecord(Segment *seg, const IndexEntry& entry, const char **record);
+
+  int ReadPayload(Segment *seg, const IndexEntry& entry, std::string *data);
+
+  // verify the header of a record in memory, and its checksum if checksum is
+  // set
+  static bool VerifyRecord(const char *record, uint32_t size, bool checksum);
+
+  // true if an intact record follows the record at offset
+  static bool FollowedByRecord(const char *data, uint64_t size,
+      uint64_t offset);
+
+  int CheckEpoch(Segment *seg, uint64_t epoch, bool eq = false);
+
+  int GetEntry(Segment *seg, uint64_t epoch, uint64_t position,
+      const IndexEntry **entry);
+
+  static PendingRecord MakeRecord(RecordType type, uint64_t arg,
+      const std::string *payload = nullptr);
+
+  std::string FileName(const std::string& oid) const;
+  static bool ParseFileName(const std::string& name, std::string *oid);
+
+ private:
+  std::map<std::string, std::string> options;
+  std::string path;
+  SyncMode sync_mode;
+  bool direct_io;
+  bool verify_checksums;
+  std::string io_engine_name;
+  unsigned io_depth;
+  unsigned io_threads;
+  size_t max_open_segments;
+  int dirfd;
+  std::unique_ptr<IOEngine> engine;
+
+  std::mutex lock;
+  std::unordered_map<std::string, std::shared_ptr<Segment>> segments;
+  // object names, most recently used first
+  std::list<std::string> lru;
+};
+
+}
+}
+}
@@ -1,48 +1,104 @@
 #pragma once
+#include<array>
+#include<atomic>
 #include<string>
 #include<sstream>
 #include<iostream>
+#include<memory>
 #include<unordered_map>
-#include<mutex>
+#include<vector>
 #include"zlog/eviction/lru.h"
 #include"zlog/eviction/arc.h"
+#include"zlog/eviction/tinylfu.h"
+#include"zlog/eviction/clock.h"
 #include"zlog/options.h"
-#include"zlog/mempool/mempool.h"
 #include"../../monitoring/statistics.h"
+#include"../../util/mutexlock.h"
 
 namespace zlog{
+
+// Cache of log entries keyed by position. The cache is split into shards by
+// position, and each shard owns an equal part of the options.cache_size byte
+// budget. Entries larger than a shard's budget are not cached.
+//
+// Cached entries are immutable and shared with readers, so a hit only copies a
+// reference. Hits take a shard's lock in shared mode. Instead of updating the
+// eviction policy, which would need exclusive access, a hit is recorded in a
+// small per-shard buffer that is replayed into the policy by the next put or
+// remove. Hits that arrive while the buffer is full are dropped, which only
+// affects the accuracy of the policy.
+//
+// A read or append may complete after a trim or fill of the same position has
+// removed the entry, and caching the result then would resurrect stale data.
+// Each shard has a generation that is advanced by every removal. Callers
+// record the generation of a position before issuing the I/O that produces its
+// entry, and a put with an older generation is dropped.
 class Cache{
   public:
-    Cache(const zlog::Options& ops) : options(ops){
-      current_cache_use = 0;
-
-      switch(options.eviction){
-        case zlog::Eviction::Eviction_Policy::LRU:
-          eviction = new LRU(options.cache_size, this);
-        break;
-        case zlog::Eviction::Eviction_Policy::ARC:
-          eviction = new ARC(options.cache_size, this);
-        break;
-        default:
-          eviction = new LRU(options.cache_size, this);
-          std::cout << "Eviction policy not implemented. Using default: LRU" << std::endl;   
-        break;
-      }
-    }
+    Cache(const zlog::Options& ops);
     ~Cache();
 
-    int put(uint64_t pos, const std::string& data);
-    int get(uint64_t* pos, std::string* data);
-    int remove(uint64_t* pos);
+    // returns 0 if the entry was inserted, or -1 if it wasn't cached
+    int put(uint64_t pos, const char *data, size_t size);
+
+    int put(uint64_t pos, const std::string& data){
+      return put(pos, data.data(), data.size());
+    }
+
+    // returns the generation of the shard that owns pos
+    uint64_t generation(uint64_t pos){
+      return shard(pos).generation.load(std::memory_order_acquire);
+    }
+
+    // same as put, but the entry isn't cached if the position's shard has
+    // seen a removal since the generation was recorded.
+    int put_if_current(uint64_t pos, const char *data, size_t size,
+        uint64_t generation);
+
+    int put_if_current(uint64_t pos, const std::string& data,
+        uint64_t generation){
+      return put_if_current(pos, data.data(), data.size(), generation);
+    }
 
-    std::unordered_map<uint64_t, zlog_mempool::cache::string> cache_map; //FIX
+    // returns the cached entry, or null on miss
+    std::shared_ptr<const std::string> get(uint64_t pos);
 
+    // returns 0 if the entry was removed, and 1 if it wasn't cached
+    int remove(uint64_t pos);
+
+    // remove all entries with positions less than or equal to pos
+    void remove_to(uint64_t pos);
+
+    static const size_t num_shards = 16;
+    static const size_t read_buffer_size = 64;
 
   private:
-    zlog::Eviction* eviction;
-    const zlog::Options& options;
-    int64_t current_cache_use;
-    std::mutex mut;
+    struct Shard{
+      port::RWMutex mut;
+      std::unordered_map<uint64_t, std::shared_ptr<const std::string>> cache_map;
+      std::unique_ptr<zlog::Eviction> eviction;
+
+      // positions (plus one, zero is empty) of recent hits
+      std::array<std::atomic<uint64_t>, read_buffer_size> read_buffer;
+      std::atomic<size_t> read_buffer_next;
+
+      // advanced by each removal. only modified with the lock held
+      // exclusively.
+      std::atomic<uint64_t> generation;
+    };
+
+    Shard& shard(uint64_t pos){
+      return *shards[pos % num_shards];
+    }
+
+    // replay recorded hits into the eviction policy. requires exclusive access.
+    void drain_read_buffer(Shard& s);
+
+    int insert(uint64_t pos, const char *data, size_t size,
+        const uint64_t *generation);
 
+    std::vector<std::unique_ptr<Shard>> shards;
+    size_t shard_size;
+    Statistics* statistics;
 };
 }
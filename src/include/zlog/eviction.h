@@ -1,22 +1,37 @@
 #pragma once
+#include<cstddef>
+#include<cstdint>
 #include<string>
 
 namespace zlog{
 
+// Eviction policies track the positions held by a cache and decide which of
+// them to drop. The capacity of a policy is expressed in bytes, and each
+// position is charged for the size of its data. Policies don't touch the
+// cached data: after inserting, the cache calls get_evicted until it returns
+// false and removes each of the returned positions.
 class Eviction{
 
   public:
 
     enum Eviction_Policy{
       LRU,
-      ARC
+      ARC,
+      TINYLFU,
+      CLOCK
     };
 
     virtual ~Eviction(){};
 
     virtual int cache_get_hit(uint64_t* pos) = 0;
     virtual int cache_get_miss(uint64_t pos) = 0;
-    virtual int cache_put_miss(uint64_t pos) = 0;
-    virtual uint64_t get_evicted() = 0;
+    virtual int cache_put_miss(uint64_t pos, size_t size) = 0;
+
+    // forget a position that was removed from the cache (e.g. trimmed)
+    virtual int cache_remove(uint64_t pos) = 0;
+
+    // returns true and sets pos if a position must be evicted to bring the
+    // cached data within the capacity of the policy.
+    virtual bool get_evicted(uint64_t* pos) = 0;
   };
-}
\ No newline at end of file
+}
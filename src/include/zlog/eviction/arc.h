@@ -5,35 +5,62 @@
 #include"zlog/eviction.h"
 
 namespace zlog{
-class Cache;
 class ARC: public Eviction{
 
   public:
-    ARC(int64_t cache_size, Cache* c_ref){
-      cache_ref = c_ref;
+    ARC(size_t cache_size){
       arc_c = cache_size;
+      arc_p = 0;
+      b2_hit = false;
     }
     ~ARC();
     
     int cache_get_hit(uint64_t* pos) override;
     int cache_get_miss(uint64_t pos) override;
-    int cache_put_miss(uint64_t pos) override;
-    uint64_t get_evicted() override;
+    int cache_put_miss(uint64_t pos, size_t size) override;
+    int cache_remove(uint64_t pos) override;
+    bool get_evicted(uint64_t* pos) override;
 
   private:
-    double get_delta_1();
-    double get_delta_2();
-    int replace(uint64_t pos);
-    std::unordered_map<uint64_t, std::list<uint64_t>::iterator> t1_hash_map;
-    std::unordered_map<uint64_t, std::list<uint64_t>::iterator> b1_hash_map;
-    std::unordered_map<uint64_t, std::list<uint64_t>::iterator> t2_hash_map;
-    std::unordered_map<uint64_t, std::list<uint64_t>::iterator> b2_hash_map;
-    std::list<uint64_t> t1_eviction_list;
-    std::list<uint64_t> b1_eviction_list;
-    std::list<uint64_t> t2_eviction_list;
-    std::list<uint64_t> b2_eviction_list;
+    // one of the ARC lists, ordered from most to least recently used. t1 and
+    // t2 hold cached positions, while the ghost lists b1 and b2 only remember
+    // positions recently evicted from t1 and t2. sizes are in bytes.
+    struct List{
+      std::list<uint64_t> entries;
+      std::unordered_map<uint64_t,
+        std::pair<std::list<uint64_t>::iterator, size_t>> index;
+      size_t bytes = 0;
+
+      bool contains(uint64_t pos) const {
+        return index.find(pos) != index.end();
+      }
+
+      void push_front(uint64_t pos, size_t size){
+        entries.push_front(pos);
+        index[pos] = std::make_pair(entries.begin(), size);
+        bytes += size;
+      }
+
+      // removes pos and returns its size
+      size_t erase(uint64_t pos){
+        auto it = index.find(pos);
+        const size_t size = it->second.second;
+        entries.erase(it->second.first);
+        index.erase(it);
+        bytes -= size;
+        return size;
+      }
+    };
+
+    double get_delta(const List& hit, const List& other) const;
+    void trim_ghosts();
+
+    List t1;
+    List t2;
+    List b1;
+    List b2;
     size_t arc_c;
     double arc_p;
-    Cache* cache_ref;
+    bool b2_hit;
 };
-}
\ No newline at end of file
+}
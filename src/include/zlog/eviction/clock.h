@@ -0,0 +1,60 @@
+#pragma once
+#include<string>
+#include<unordered_map>
+#include<vector>
+#include"zlog/eviction.h"
+
+namespace zlog{
+
+// CLOCK with hot and cold entries, a simplified CLOCK-Pro that doesn't track
+// non-resident positions. Entries live in a vector of slots and a hit only
+// sets the entry's reference bit. New positions are cold. The hand evicts cold
+// entries that weren't hit since they were inserted and promotes the ones that
+// were, so positions that are read once, such as by a replay of the log, leave
+// the cache without disturbing hot entries. When hot entries use more than half
+// of the capacity, a second hand demotes hot entries that weren't hit since it
+// last passed them. Without non-resident tracking the split is fixed, and the
+// cold half is large enough to hold new entries until tailing readers reach
+// them.
+class CLOCK: public Eviction{
+
+  public:
+    CLOCK(size_t c_size) :
+      hand(0),
+      hot_hand(0),
+      cache_size(c_size),
+      hot_size(c_size / 2),
+      cache_use(0),
+      hot_use(0)
+    {}
+    ~CLOCK();
+
+    int cache_get_hit(uint64_t* pos) override;
+    int cache_get_miss(uint64_t pos) override;
+    int cache_put_miss(uint64_t pos, size_t size) override;
+    int cache_remove(uint64_t pos) override;
+    bool get_evicted(uint64_t* pos) override;
+
+  private:
+    struct Slot{
+      uint64_t pos;
+      size_t size;
+      bool used;
+      bool hot;
+      bool referenced;
+    };
+
+    void free_slot(size_t s);
+    void demote_hot();
+
+    std::vector<Slot> slots;
+    std::vector<size_t> free_slots;
+    std::unordered_map<uint64_t, size_t> index;
+    size_t hand;
+    size_t hot_hand;
+    size_t cache_size;
+    size_t hot_size;
+    size_t cache_use;
+    size_t hot_use;
+};
+}
@@ -0,0 +1,111 @@
+#pragma once
+#include<string>
+#include<unordered_map>
+#include<vector>
+#include"zlog/eviction.h"
+
+namespace zlog{
+
+// W-TinyLFU. New positions enter a small LRU window. Positions that leave the
+// window join the probation segment of a segmented LRU, and a hit in probation
+// promotes an entry to the protected segment. When the cache is over capacity
+// the position that most recently left the window is kept only if a count-min
+// sketch estimates it is read more often than the probation victim, or as often
+// and it is the newer position, so a single pass over the log doesn't flush
+// frequently read entries.
+//
+// The window starts at 1% of the capacity and is resized by hill climbing on
+// the hit rate: each sample period the size moves in the direction that last
+// improved the hit rate, so recency-heavy workloads such as tailing readers
+// get a larger window.
+//
+// Entries are stored in a vector and linked by index instead of in std::list
+// nodes.
+class TinyLFU: public Eviction{
+
+  public:
+    TinyLFU(size_t c_size);
+    ~TinyLFU();
+
+    int cache_get_hit(uint64_t* pos) override;
+    int cache_get_miss(uint64_t pos) override;
+    int cache_put_miss(uint64_t pos, size_t size) override;
+    int cache_remove(uint64_t pos) override;
+    bool get_evicted(uint64_t* pos) override;
+
+  private:
+    // count-min sketch with four rows of 4-bit counters packed into words.
+    // all counters are halved after a sample of one addition per word of
+    // counters, so that estimates follow the tail of the log. the sketch
+    // grows with the number of entries.
+    class FrequencySketch{
+      public:
+        FrequencySketch();
+
+        void ensure_capacity(size_t entries);
+        void increment(uint64_t pos);
+        uint32_t frequency(uint64_t pos) const;
+
+      private:
+        size_t index_of(uint64_t pos, int row) const;
+        void reset();
+
+        std::vector<uint64_t> table;
+        size_t counter_mask;
+        size_t additions;
+        size_t sample_size;
+    };
+
+    enum Queue : uint8_t {
+      WINDOW,
+      PROBATION,
+      PROTECTED
+    };
+
+    static const uint32_t nil = UINT32_MAX;
+
+    struct Node{
+      uint64_t pos;
+      size_t size;
+      uint32_t prev;
+      uint32_t next;
+      Queue queue;
+    };
+
+    struct List{
+      uint32_t head = nil;
+      uint32_t tail = nil;
+      size_t bytes = 0;
+    };
+
+    List& list(Queue queue);
+    void push_front(Queue queue, uint32_t n);
+    void unlink(uint32_t n);
+    void remove_node(uint32_t n);
+    void record(bool hit);
+    void climb();
+
+    std::vector<Node> nodes;
+    std::vector<uint32_t> free_nodes;
+    std::unordered_map<uint64_t, uint32_t> index;
+
+    List window;
+    List probation;
+    List protect;
+
+    // the last position moved from the window to probation, which is the
+    // candidate for admission when an entry must be evicted.
+    uint32_t candidate;
+
+    size_t cache_size;
+    size_t window_size;
+    size_t protected_size;
+    FrequencySketch sketch;
+
+    // hill climbing state
+    uint64_t sample_hits;
+    uint64_t sample_misses;
+    double prev_hit_rate;
+    double window_step;
+};
+}
@@ -4,7 +4,9 @@
 #include <memory>
 #include <set>
 #include <string>
+#include <vector>
 #include "options.h"
+#include "slice.h"
 
 namespace zlog {
 
@@ -15,6 +17,43 @@ class Log {
   Log() {}
   virtual ~Log();
 
+  /**
+   * Iterates over the readable entries in a range of log positions. Filled and
+   * trimmed positions are skipped. Iteration stops at the end of the range, or
+   * at the first position that hasn't been written, in which case status()
+   * returns -ENOENT. An iterator is not thread-safe.
+   */
+  class Iterator {
+   public:
+    Iterator() {}
+    virtual ~Iterator() {}
+
+    // true if the iterator is positioned at an entry
+    virtual bool Valid() const = 0;
+
+    // position at the first / last readable entry in the range
+    virtual void SeekToFirst() = 0;
+    virtual void SeekToLast() = 0;
+
+    // position at the first readable entry at or after position
+    virtual void Seek(uint64_t position) = 0;
+
+    // move to the next / previous readable entry. requires Valid().
+    virtual void Next() = 0;
+    virtual void Prev() = 0;
+
+    // the current entry. requires Valid().
+    virtual uint64_t position() const = 0;
+    virtual const std::string& data() const = 0;
+
+    // 0, or the error that caused the iterator to become invalid
+    virtual int status() const = 0;
+
+   private:
+    Iterator(const Iterator&);
+    void operator=(const Iterator&);
+  };
+
   /**
    *
    */
@@ -28,6 +67,17 @@ class Log {
   virtual int appendAsync(const std::string& data,
       std::function<void(int, uint64_t)> cb) = 0;
 
+  /**
+   * Append a batch of entries. On success positions[i] is the position of
+   * data[i]. Positions are reserved as one contiguous range, and are normally
+   * returned as such, but entries that race with a fill or a sequencer change
+   * are relocated to new positions, so callers must not assume contiguity.
+   */
+  virtual int appendBatch(const std::vector<std::string>& data,
+      std::vector<uint64_t> *positions) = 0;
+  virtual int appendBatchAsync(const std::vector<std::string>& data,
+      std::function<void(int, const std::vector<uint64_t>&)> cb) = 0;
+
   /**
    *
    */
@@ -35,6 +85,23 @@ class Log {
   virtual int readAsync(uint64_t position,
       std::function<void(int, std::string&)> cb) = 0;
 
+  /**
+   * Read an entry without copying it. The slice references the entry in the
+   * cache or in backend memory where possible, and keeps it alive while the
+   * slice (or a copy of it) exists. Slices must be released before the log is
+   * deleted. Return values are the same as for Read.
+   */
+  virtual int ReadSlice(uint64_t position, Slice *data) = 0;
+  virtual int readSliceAsync(uint64_t position,
+      std::function<void(int, const Slice&)> cb) = 0;
+
+  /**
+   * Create an iterator over the inclusive range [start, end]. The caller owns
+   * the returned iterator, and must delete it before the log is deleted.
+   */
+  virtual int NewIterator(uint64_t start, uint64_t end,
+      Iterator **iterator) = 0;
+
   /**
    *
    */
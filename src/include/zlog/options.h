@@ -40,6 +40,10 @@ struct Options {
 
   uint32_t max_inflight_ops = 1024;
 
+  // maximum number of objects that are sealed concurrently when sealing a
+  // stripe, such as when a new sequencer searches for the tail of the log.
+  uint32_t max_inflight_seals = 32;
+
   int min_refresh_timeout_ms = 125;
   int max_refresh_timeout_ms = 5000;
 
@@ -0,0 +1,68 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <string>
+
+namespace zlog {
+
+/**
+ * A read-only reference to the data of a log entry. A slice shares ownership
+ * of the memory that it references, such as a cached entry, an entry stored by
+ * an in-memory backend, or a read transaction that keeps an entry mapped, and
+ * keeps it alive until the last copy of the slice is destroyed. Copying a slice
+ * doesn't copy the data.
+ *
+ * Slices that reference backend memory may hold backend resources, so they
+ * should be released promptly, and must be released before the log or backend
+ * they were read from is destroyed.
+ */
+class Slice {
+ public:
+  Slice() :
+    data_(nullptr),
+    size_(0)
+  {}
+
+  // a slice of memory kept alive by owner
+  Slice(std::shared_ptr<const void> owner, const char *data, size_t size) :
+    owner_(std::move(owner)),
+    data_(data),
+    size_(size)
+  {}
+
+  explicit Slice(std::shared_ptr<const std::string> s) :
+    data_(s ? s->data() : nullptr),
+    size_(s ? s->size() : 0)
+  {
+    owner_ = std::move(s);
+  }
+
+  const char *data() const {
+    return data_;
+  }
+
+  size_t size() const {
+    return size_;
+  }
+
+  bool empty() const {
+    return size_ == 0;
+  }
+
+  std::string ToString() const {
+    return data_ ? std::string(data_, size_) : std::string();
+  }
+
+  void clear() {
+    owner_.reset();
+    data_ = nullptr;
+    size_ = 0;
+  }
+
+ private:
+  std::shared_ptr<const void> owner_;
+  const char *data_;
+  size_t size_;
+};
+
+}
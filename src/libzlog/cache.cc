@@ -3,51 +3,169 @@
 #include<unordered_map>
 #include<tuple>
 #include<iterator>
+#include<algorithm>
 #include"include/zlog/eviction.h"
 #include"include/zlog/cache.h"
 
 namespace zlog{
 
+const size_t Cache::num_shards;
+const size_t Cache::read_buffer_size;
+
+Cache::Cache(const zlog::Options& ops) :
+  shard_size(ops.cache_size / num_shards),
+  statistics(ops.statistics)
+{
+  bool warned = false;
+  for(size_t i = 0; i < num_shards; i++){
+    std::unique_ptr<Shard> s(new Shard);
+    switch(ops.eviction){
+      case zlog::Eviction::Eviction_Policy::LRU:
+        s->eviction.reset(new LRU(shard_size));
+      break;
+      case zlog::Eviction::Eviction_Policy::ARC:
+        s->eviction.reset(new ARC(shard_size));
+      break;
+      case zlog::Eviction::Eviction_Policy::TINYLFU:
+        s->eviction.reset(new TinyLFU(shard_size));
+      break;
+      case zlog::Eviction::Eviction_Policy::CLOCK:
+        s->eviction.reset(new CLOCK(shard_size));
+      break;
+      default:
+        s->eviction.reset(new LRU(shard_size));
+        if(!warned){
+          std::cout << "Eviction policy not implemented. Using default: LRU" << std::endl;   
+          warned = true;
+        }
+      break;
+    }
+    for(auto& slot : s->read_buffer){
+      slot.store(0, std::memory_order_relaxed);
+    }
+    s->read_buffer_next.store(0, std::memory_order_relaxed);
+    s->generation.store(0, std::memory_order_relaxed);
+    shards.emplace_back(std::move(s));
+  }
+}
+
 Cache::~Cache(){}
 
-int Cache::put(uint64_t pos, const std::string& data){
-  int ret = 0;
-  mut.lock();
-  if(options.cache_size > 0 && data.size() < options.cache_size && cache_map.find(pos) == cache_map.end()){ 
-    eviction->cache_put_miss(pos);
-    zlog_mempool::cache::string pool_data(data.data(), data.size());
-    cache_map[pos] = zlog_mempool::cache::string(pool_data);
-  }else{
-    ret = -1;
+void Cache::drain_read_buffer(Shard& s){
+  const size_t count = std::min(
+      s.read_buffer_next.load(std::memory_order_relaxed), read_buffer_size);
+  for(size_t i = 0; i < count; i++){
+    uint64_t pos = s.read_buffer[i].exchange(0, std::memory_order_relaxed);
+    if(pos){
+      pos--;
+      // the position may have been removed since the hit was recorded, in
+      // which case the policy ignores it.
+      s.eviction->cache_get_hit(&pos);
+    }
   }
-  mut.unlock();
-  return ret;
+  s.read_buffer_next.store(0, std::memory_order_relaxed);
 }
 
-int Cache::get(uint64_t* pos, std::string* data){
+int Cache::put(uint64_t pos, const char *data, size_t size){
+  return insert(pos, data, size, nullptr);
+}
+
+int Cache::put_if_current(uint64_t pos, const char *data, size_t size,
+    uint64_t generation){
+  return insert(pos, data, size, &generation);
+}
+
+int Cache::insert(uint64_t pos, const char *data, size_t size,
+    const uint64_t *generation){
+  if(size > shard_size){
+    return -1;
+  }
+
+  // copy the data before taking the lock
+  auto entry = std::make_shared<const std::string>(data, size);
+
+  auto& s = shard(pos);
+  WriteLock lk(&s.mut);
+
+  // the entry was produced before a removal in this shard and may be stale
+  if(generation &&
+      *generation != s.generation.load(std::memory_order_relaxed)){
+    return -1;
+  }
+
+  drain_read_buffer(s);
+
+  if(!s.cache_map.emplace(pos, std::move(entry)).second){
+    return -1;
+  }
+  s.eviction->cache_put_miss(pos, size);
+
+  uint64_t evicted;
+  while(s.eviction->get_evicted(&evicted)){
+    s.cache_map.erase(evicted);
+  }
+
+  return s.cache_map.find(pos) != s.cache_map.end() ? 0 : -1;
+}
+
+std::shared_ptr<const std::string> Cache::get(uint64_t pos){
+  #ifdef WITH_STATS
+  RecordTick(statistics, CACHE_REQS);
+  #endif
+
+  auto& s = shard(pos);
+  {
+    ReadLock lk(&s.mut);
+
+    auto map_it = s.cache_map.find(pos);
+    if(map_it != s.cache_map.end()){
+      // the buffer is only drained with the lock held exclusively, so the
+      // reserved slot can't be reset before it is written.
+      const size_t slot = s.read_buffer_next.fetch_add(1,
+          std::memory_order_relaxed);
+      if(slot < read_buffer_size){
+        s.read_buffer[slot].store(pos + 1, std::memory_order_relaxed);
+      }
+      return map_it->second;
+    }
+  }
+
   #ifdef WITH_STATS
-  RecordTick(options.statistics, CACHE_REQS);
+  RecordTick(statistics, CACHE_MISSES);
   #endif
-  auto map_it = cache_map.find(*pos);
-  int ret = 0;       
-  mut.lock(); 
-  if(map_it != cache_map.end()){
-    data->assign((map_it->second).data(), (map_it->second).size());
-    eviction->cache_get_hit(pos);
-  }else{
-    #ifdef WITH_STATS
-    RecordTick(options.statistics, CACHE_MISSES);
-    #endif
-    ret = 1;
-  }
-  mut.unlock();
-  return ret;
-}
-
-int Cache::remove(uint64_t* pos){
-  if(cache_map.erase(*pos) > 0){
+
+  return nullptr;
+}
+
+int Cache::remove(uint64_t pos){
+  auto& s = shard(pos);
+  WriteLock lk(&s.mut);
+
+  s.generation.fetch_add(1, std::memory_order_release);
+  drain_read_buffer(s);
+
+  // ghost entries are dropped too so a trimmed position doesn't adapt the
+  // policy if it is read again
+  s.eviction->cache_remove(pos);
+  if(s.cache_map.erase(pos) > 0){
     return 0;    
   }
   return 1;
 }
+
+void Cache::remove_to(uint64_t pos){
+  for(auto& s : shards){
+    WriteLock lk(&s->mut);
+    s->generation.fetch_add(1, std::memory_order_release);
+    drain_read_buffer(*s);
+    for(auto it = s->cache_map.begin(); it != s->cache_map.end();){
+      if(it->first <= pos){
+        s->eviction->cache_remove(it->first);
+        it = s->cache_map.erase(it);
+      }else{
+        it++;
+      }
+    }
+  }
+}
 }
@@ -0,0 +1,219 @@
+#include "gtest/gtest.h"
+#include "include/zlog/cache.h"
+#include <atomic>
+#include <thread>
+#include <vector>
+
+static zlog::Options cache_options(size_t size,
+    zlog::Eviction::Eviction_Policy policy)
+{
+  zlog::Options options;
+  options.cache_size = size;
+  options.eviction = policy;
+  return options;
+}
+
+class CacheTest : public ::testing::TestWithParam<
+                  zlog::Eviction::Eviction_Policy> {};
+
+TEST_P(CacheTest, GetPutRemove) {
+  auto options = cache_options(1 << 20, GetParam());
+  zlog::Cache cache(options);
+
+  const uint64_t pos = 3;
+  ASSERT_FALSE(cache.get(pos));
+  ASSERT_EQ(cache.put(pos, "abc"), 0);
+  ASSERT_EQ(cache.put(pos, "xyz"), -1);
+
+  auto entry = cache.get(pos);
+  ASSERT_TRUE(entry);
+  ASSERT_EQ(*entry, "abc");
+
+  ASSERT_EQ(cache.remove(pos), 0);
+  ASSERT_EQ(cache.remove(pos), 1);
+  ASSERT_FALSE(cache.get(pos));
+
+  // readers keep their reference after removal
+  ASSERT_EQ(*entry, "abc");
+}
+
+TEST_P(CacheTest, RemoveTo) {
+  auto options = cache_options(1 << 20, GetParam());
+  zlog::Cache cache(options);
+
+  for (uint64_t pos = 0; pos < 100; pos++) {
+    ASSERT_EQ(cache.put(pos, std::to_string(pos)), 0);
+  }
+
+  cache.remove_to(49);
+
+  for (uint64_t pos = 0; pos < 100; pos++) {
+    auto entry = cache.get(pos);
+    if (pos <= 49) {
+      ASSERT_FALSE(entry);
+    } else {
+      ASSERT_TRUE(entry);
+      ASSERT_EQ(*entry, std::to_string(pos));
+    }
+  }
+}
+
+// a read or append that started before a trim must not cache its result
+TEST_P(CacheTest, StalePut) {
+  auto options = cache_options(1 << 20, GetParam());
+  zlog::Cache cache(options);
+
+  const uint64_t pos = 7;
+  auto gen = cache.generation(pos);
+  ASSERT_EQ(cache.remove(pos), 1);
+  ASSERT_EQ(cache.put_if_current(pos, "abc", gen), -1);
+  ASSERT_FALSE(cache.get(pos));
+
+  gen = cache.generation(pos);
+  ASSERT_EQ(cache.put_if_current(pos, "abc", gen), 0);
+  ASSERT_TRUE(cache.get(pos));
+
+  // remove_to invalidates every shard
+  const uint64_t other = pos + 1;
+  gen = cache.generation(other);
+  cache.remove_to(pos);
+  ASSERT_EQ(cache.put_if_current(other, "xyz", gen), -1);
+  ASSERT_FALSE(cache.get(other));
+  ASSERT_FALSE(cache.get(pos));
+}
+
+// the budget is in bytes and split evenly across shards
+TEST_P(CacheTest, ByteBudget) {
+  const size_t shard_size = 100;
+  auto options = cache_options(shard_size * zlog::Cache::num_shards,
+      GetParam());
+  zlog::Cache cache(options);
+
+  // larger than a shard
+  ASSERT_EQ(cache.put(0, std::string(shard_size + 1, 'x')), -1);
+
+  // each shard holds 10 entries of 10 bytes
+  const std::string entry(10, 'x');
+  const uint64_t count = 1000;
+  for (uint64_t pos = 0; pos < count; pos++) {
+    ASSERT_EQ(cache.put(pos, entry), 0);
+  }
+
+  uint64_t hits = 0;
+  for (uint64_t pos = 0; pos < count; pos++) {
+    if (cache.get(pos)) {
+      hits++;
+    }
+  }
+  ASSERT_EQ(hits, 10 * zlog::Cache::num_shards);
+
+  // the most recent entries are retained
+  ASSERT_TRUE(cache.get(count - 1));
+}
+
+// hits recorded by readers are replayed into the policy on the next put
+TEST_P(CacheTest, HitsAffectEviction) {
+  const size_t shard_size = 100;
+  auto options = cache_options(shard_size * zlog::Cache::num_shards,
+      GetParam());
+  zlog::Cache cache(options);
+
+  // fill one shard with 10 entries of 10 bytes
+  const std::string entry(10, 'x');
+  const uint64_t stride = zlog::Cache::num_shards;
+  for (uint64_t i = 0; i < 10; i++) {
+    ASSERT_EQ(cache.put(i * stride, entry), 0);
+  }
+
+  // touch the oldest entry, then insert another entry into the shard
+  ASSERT_TRUE(cache.get(0));
+  ASSERT_EQ(cache.put(10 * stride, entry), 0);
+
+  ASSERT_TRUE(cache.get(0));
+
+  // tinylfu admits the entry leaving its window (9) over the probation victim
+  // (1) because they are read equally often and 9 is the newer position.
+  ASSERT_FALSE(cache.get(1 * stride));
+  if (GetParam() == zlog::Eviction::Eviction_Policy::TINYLFU) {
+    ASSERT_TRUE(cache.get(9 * stride));
+  }
+}
+
+TEST_P(CacheTest, ConcurrentReaders) {
+  auto options = cache_options(1 << 20, GetParam());
+  zlog::Cache cache(options);
+
+  for (uint64_t pos = 0; pos < 1000; pos++) {
+    ASSERT_EQ(cache.put(pos, std::to_string(pos)), 0);
+  }
+
+  std::atomic<bool> failed(false);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 8; t++) {
+    threads.emplace_back([&, t] {
+      for (uint64_t i = 0; i < 20000; i++) {
+        const uint64_t pos = (i * 7 + t) % 1000;
+        auto entry = cache.get(pos);
+        if (entry && *entry != std::to_string(pos)) {
+          failed = true;
+        }
+        if (i % 100 == 0) {
+          cache.remove(pos);
+          cache.put(pos, std::to_string(pos));
+        }
+      }
+    });
+  }
+
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  ASSERT_FALSE(failed);
+}
+
+INSTANTIATE_TEST_CASE_P(Eviction, CacheTest,
+    ::testing::Values(
+      zlog::Eviction::Eviction_Policy::LRU,
+      zlog::Eviction::Eviction_Policy::ARC,
+      zlog::Eviction::Eviction_Policy::TINYLFU,
+      zlog::Eviction::Eviction_Policy::CLOCK));
+
+class ScanResistantCacheTest : public CacheTest {};
+
+// entries that are read repeatedly survive a pass over many more entries than
+// the cache holds
+TEST_P(ScanResistantCacheTest, Replay) {
+  const size_t shard_size = 100;
+  auto options = cache_options(shard_size * zlog::Cache::num_shards,
+      GetParam());
+  zlog::Cache cache(options);
+
+  // five hot entries of 10 bytes in one shard
+  const std::string entry(10, 'x');
+  const uint64_t stride = zlog::Cache::num_shards;
+  for (uint64_t i = 0; i < 5; i++) {
+    ASSERT_EQ(cache.put(i * stride, entry), 0);
+  }
+  for (int round = 0; round < 3; round++) {
+    for (uint64_t i = 0; i < 5; i++) {
+      ASSERT_TRUE(cache.get(i * stride));
+    }
+    // replays the recorded hits
+    ASSERT_EQ(cache.put((100 + round) * stride, entry), 0);
+  }
+
+  // scan 100 entries through the shard
+  for (uint64_t i = 1000; i < 1100; i++) {
+    cache.put(i * stride, entry);
+  }
+
+  for (uint64_t i = 0; i < 5; i++) {
+    ASSERT_TRUE(cache.get(i * stride));
+  }
+}
+
+INSTANTIATE_TEST_CASE_P(Eviction, ScanResistantCacheTest,
+    ::testing::Values(
+      zlog::Eviction::Eviction_Policy::TINYLFU,
+      zlog::Eviction::Eviction_Policy::CLOCK));
@@ -0,0 +1,54 @@
+#include <string>
+#include <vector>
+#include "util/crc32c.h"
+#include "gtest/gtest.h"
+
+// test vectors from rfc 3720, section b.4
+TEST(Crc32cTest, StandardResults) {
+  char buf[32];
+
+  memset(buf, 0, sizeof(buf));
+  ASSERT_EQ(0x8a9136aaU, zlog::crc32c::Value(buf, sizeof(buf)));
+
+  memset(buf, 0xff, sizeof(buf));
+  ASSERT_EQ(0x62a8ab43U, zlog::crc32c::Value(buf, sizeof(buf)));
+
+  for (int i = 0; i < 32; i++) {
+    buf[i] = i;
+  }
+  ASSERT_EQ(0x46dd794eU, zlog::crc32c::Value(buf, sizeof(buf)));
+
+  for (int i = 0; i < 32; i++) {
+    buf[i] = 31 - i;
+  }
+  ASSERT_EQ(0x113fdb5cU, zlog::crc32c::Value(buf, sizeof(buf)));
+
+  ASSERT_EQ(0xe3069283U, zlog::crc32c::Value("123456789", 9));
+}
+
+TEST(Crc32cTest, Extend) {
+  ASSERT_EQ(zlog::crc32c::Value("hello world", 11),
+      zlog::crc32c::Extend(zlog::crc32c::Value("hello ", 6), "world", 5));
+}
+
+// the hardware and table implementations agree for all of the block sizes
+// and alignments handled separately by the hardware implementation
+TEST(Crc32cTest, Portable) {
+  std::vector<char> buf(3 * 8192 * 2 + 64);
+  uint32_t x = 1;
+  for (auto& c : buf) {
+    x = x * 1103515245 + 12345;
+    c = x >> 16;
+  }
+
+  const std::vector<size_t> sizes{0, 1, 7, 8, 9, 255, 256, 767, 768, 769,
+    3 * 256 * 2 + 5, 8191, 3 * 8192 - 1, 3 * 8192, 3 * 8192 + 777,
+    3 * 8192 * 2};
+  for (size_t offset = 0; offset < 9; offset++) {
+    for (auto size : sizes) {
+      ASSERT_EQ(zlog::crc32c::Value(buf.data() + offset, size),
+          zlog::crc32c::ExtendPortable(0, buf.data() + offset, size))
+        << "offset " << offset << " size " << size;
+    }
+  }
+}
@@ -1,11 +1,11 @@
 #pragma once
 #include <iostream>
-#include <sstream>
+#include <string>
 #include "include/zlog/backend.h"
+#include "libzlog/stripe.h"
 
 namespace zlog {
 
-// in future reprsent oid as (stripe id, index) and then do caching in here??
 class LogBackend final {
  public:
   LogBackend(std::shared_ptr<Backend> backend,
@@ -50,53 +50,125 @@ class LogBackend final {
     return backend_->ProposeView(hoid_, epoch, view);
   }
 
-  int Read(const std::string& oid, uint64_t epoch, uint64_t position,
+  int Read(const ObjectId& oid, uint64_t epoch, uint64_t position,
       std::string *data_out) const {
-    std::stringstream prefixed_oid;
-    prefixed_oid << prefix_ << "." << oid;
-    return backend_->Read(prefixed_oid.str(), epoch, position, data_out);
+    return backend_->Read(object_name(oid), epoch, position, data_out);
   }
 
-  int Write(const std::string& oid, const std::string& data, uint64_t epoch,
+  int ReadRange(const ObjectId& oid, uint64_t epoch,
+      uint64_t min_position, uint64_t max_position, uint32_t stride,
+      std::map<uint64_t, std::string> *entries_out,
+      std::set<uint64_t> *invalid_out) const {
+    return backend_->ReadRange(object_name(oid), epoch, min_position,
+        max_position, stride, entries_out, invalid_out);
+  }
+
+  int Write(const ObjectId& oid, const std::string& data, uint64_t epoch,
       uint64_t position) const {
-    std::stringstream prefixed_oid;
-    prefixed_oid << prefix_ << "." << oid;
-    return backend_->Write(prefixed_oid.str(), data, epoch, position);
+    return backend_->Write(object_name(oid), data, epoch, position);
+  }
+
+  int WriteBatch(const ObjectId& oid, uint64_t epoch,
+      const std::vector<std::pair<uint64_t, const std::string*>>& entries,
+      std::vector<int> *results) const {
+    return backend_->WriteBatch(object_name(oid), epoch, entries, results);
+  }
+
+  int WriteBatchAsync(const ObjectId& oid, uint64_t epoch,
+      const std::vector<std::pair<uint64_t, const std::string*>>& entries,
+      std::vector<int> *results, std::function<void(int)> cb) const {
+    return backend_->WriteBatchAsync(object_name(oid), epoch, entries,
+        results, cb);
+  }
+
+  int ReadAsync(const ObjectId& oid, uint64_t epoch, uint64_t position,
+      std::string *data_out, std::function<void(int)> cb) const {
+    return backend_->ReadAsync(object_name(oid), epoch, position, data_out,
+        cb);
+  }
+
+  int ReadSliceAsync(const ObjectId& oid, uint64_t epoch, uint64_t position,
+      Slice *data_out, std::function<void(int)> cb) const {
+    return backend_->ReadSliceAsync(object_name(oid), epoch, position,
+        data_out, cb);
+  }
+
+  int WriteAsync(const ObjectId& oid, const std::string& data,
+      uint64_t epoch, uint64_t position, std::function<void(int)> cb) const {
+    return backend_->WriteAsync(object_name(oid), data, epoch, position, cb);
   }
 
-  int Fill(const std::string& oid, uint64_t epoch, uint64_t position) const {
-    std::stringstream prefixed_oid;
-    prefixed_oid << prefix_ << "." << oid;
-    return backend_->Fill(prefixed_oid.str(), epoch, position);
+  int Fill(const ObjectId& oid, uint64_t epoch, uint64_t position) const {
+    return backend_->Fill(object_name(oid), epoch, position);
   }
 
-  int Trim(const std::string& oid, uint64_t epoch, uint64_t position,
+  int FillAsync(const ObjectId& oid, uint64_t epoch, uint64_t position,
+      std::function<void(int)> cb) const {
+    return backend_->FillAsync(object_name(oid), epoch, position, cb);
+  }
+
+  int Trim(const ObjectId& oid, uint64_t epoch, uint64_t position,
       bool trim_limit = false, bool trim_full = false) const {
-    std::stringstream prefixed_oid;
-    prefixed_oid << prefix_ << "." << oid;
-    return backend_->Trim(prefixed_oid.str(), epoch, position, trim_limit,
+    return backend_->Trim(object_name(oid), epoch, position, trim_limit,
         trim_full);
   }
 
-  int Seal(const std::string& oid, uint64_t epoch) const {
-    std::stringstream prefixed_oid;
-    prefixed_oid << prefix_ << "." << oid;
-    return backend_->Seal(prefixed_oid.str(), epoch);
+  int Seal(const ObjectId& oid, uint64_t epoch) const {
+    return backend_->Seal(object_name(oid), epoch);
+  }
+
+  int MaxPos(const ObjectId& oid, uint64_t *pos_out, bool *empty_out) const {
+    return backend_->MaxPos(object_name(oid), pos_out, empty_out);
+  }
+
+  int SealAsync(const ObjectId& oid, uint64_t epoch,
+      std::function<void(int)> cb) const {
+    return backend_->SealAsync(object_name(oid), epoch, cb);
   }
 
-  int MaxPos(const std::string& oid, uint64_t *pos_out, bool *empty_out) const {
-    std::stringstream prefixed_oid;
-    prefixed_oid << prefix_ << "." << oid;
-    return backend_->MaxPos(prefixed_oid.str(), pos_out, empty_out);
+  int SealAndMaxPosAsync(const ObjectId& oid, uint64_t epoch,
+      uint64_t *pos_out, bool *empty_out, std::function<void(int)> cb) const {
+    return backend_->SealAndMaxPosAsync(object_name(oid), epoch, pos_out,
+        empty_out, cb);
   }
 
-  int Stat(const std::string& oid, size_t *size) const {
-    std::stringstream prefixed_oid;
-    prefixed_oid << prefix_ << "." << oid;
-    return backend_->Stat(prefixed_oid.str(), size);
+  int Stat(const ObjectId& oid, size_t *size) const {
+    return backend_->Stat(object_name(oid), size);
+  }
+
+  int Scrub(const ObjectId& oid, std::set<uint64_t> *corrupt_out) const {
+    return backend_->Scrub(object_name(oid), corrupt_out);
   }
 
  private:
+  // format the full name of an object into a per-thread buffer. once the
+  // buffer has grown to fit the names of the log's objects no further memory
+  // is allocated. the result is valid until the next call on the same thread,
+  // so it must only be used for the duration of a single backend call. a
+  // completion callback that runs inline may format another name on this
+  // thread, which is why the asynchronous backend calls only use their object
+  // name until they return or invoke the callback (see Backend::ReadAsync).
+  const std::string& object_name(const ObjectId& oid) const {
+    static thread_local std::string name;
+    name.assign(prefix_);
+    name.push_back('.');
+    append_number(name, oid.stripe_id);
+    name.push_back('.');
+    append_number(name, oid.index);
+    return name;
+  }
+
+  static void append_number(std::string& out, uint64_t value) {
+    char buf[20];
+    char *end = buf + sizeof(buf);
+    char *pos = end;
+    do {
+      *--pos = static_cast<char>('0' + (value % 10));
+      value /= 10;
+    } while (value);
+    out.append(pos, end - pos);
+  }
+
   const std::shared_ptr<Backend> backend_;
   const std::string hoid_;
   const std::string prefix_;
@@ -3,6 +3,7 @@
 #include <cerrno>
 #include <condition_variable>
 #include <iostream>
+#include <map>
 #include <mutex>
 #include <sstream>
 #include <string>
@@ -14,6 +15,7 @@
 #include "include/zlog/log.h"
 #include "include/zlog/backend.h"
 #include "include/zlog/cache.h"
+#include "log_iterator.h"
 
 namespace zlog {
 
@@ -21,18 +23,28 @@ LogImpl::LogImpl(std::shared_ptr<LogBackend> backend,
     const std::string& name,
     std::unique_ptr<ViewManager> view_mgr,
     const Options& opts) :
+  queued_ops_(0),
+  sleepers_(0),
+  num_inflight_ops_(0),
+  admission_waiters_(0),
   shutdown(false),
   backend(backend),
   name(name),
   view_mgr(std::move(view_mgr)),
-  num_inflight_ops_(0),
   options(opts)
 {
   assert(!this->name.empty());
   assert(this->view_mgr);
 
+#ifdef WITH_CACHE
+  if (options.cache_size > 0) {
+    cache.reset(new Cache(options));
+  }
+#endif
+
   for (int i = 0; i < options.finisher_threads; i++) {
-    finishers_.push_back(std::thread(&LogImpl::finisher_entry_, this));
+    finishers_.push_back(std::thread(&LogImpl::finisher_entry_, this,
+          static_cast<size_t>(i)));
   }
 
   append_propose_sequencer = 0;
@@ -45,11 +57,11 @@ LogImpl::LogImpl(std::shared_ptr<LogBackend> backend,
 LogImpl::~LogImpl()
 { 
   {
-    std::lock_guard<std::mutex> l(lock);
+    std::lock_guard<std::mutex> l(sleep_lock_);
     shutdown = true;
   }
   
-  finishers_cond_.notify_all();
+  sleep_cond_.notify_all();
   for (auto& finisher : finishers_) {
     finisher.join();
   }
@@ -57,6 +69,38 @@ LogImpl::~LogImpl()
   view_mgr->shutdown();
 }
 
+bool LogOp::submit_io(
+    const std::function<int(std::function<void(int)>)>& submit)
+{
+  io_state_ = IoState::Submitting;
+
+  int ret = submit([this](int ret) {
+    io_ret_ = ret;
+    // if the submitter hasn't handed off the op yet, then it will observe the
+    // completion and continue running the op itself.
+    auto expected = IoState::Submitting;
+    if (io_state_.compare_exchange_strong(expected, IoState::Completed)) {
+      return;
+    }
+    assert(expected == IoState::Deferred);
+    log_->resume_op(this);
+  });
+
+  if (ret) {
+    io_state_ = IoState::Completed;
+    io_ret_ = ret;
+    return true;
+  }
+
+  auto expected = IoState::Submitting;
+  if (io_state_.compare_exchange_strong(expected, IoState::Deferred)) {
+    return false;
+  }
+
+  assert(expected == IoState::Completed);
+  return true;
+}
+
 int TailOp::run()
 {
   while (true) {
@@ -116,21 +160,54 @@ int LogImpl::CheckTail(uint64_t *position_out)
 
 int ReadOp::run()
 {
+  const bool zero_copy = static_cast<bool>(slice_cb_);
+
+  if (!read_submitted_ && log_->cache) {
+    const auto entry = log_->cache->get(position_);
+    if (entry) {
+      if (zero_copy) {
+        slice_ = Slice(entry);
+      } else {
+        data_.assign(*entry);
+      }
+      return 0;
+    }
+  }
+
   while (true) {
-    const auto view = log_->view_mgr->view();
-    const auto oid = log_->view_mgr->map(view, position_);
-    if (!oid) {
-      int ret = log_->view_mgr->try_expand_view(position_);
-      if (ret) {
-        return ret;
+    if (!read_submitted_) {
+      const auto view = log_->view_mgr->view();
+      const auto oid = log_->view_mgr->map(view, position_);
+      if (!oid) {
+        int ret = log_->view_mgr->try_expand_view(position_);
+        if (ret) {
+          return ret;
+        }
+        continue;
+      }
+
+      oid_ = *oid;
+      epoch_ = view->epoch();
+      if (log_->cache) {
+        cache_gen_ = log_->cache->generation(position_);
+      }
+      read_submitted_ = true;
+      if (!submit_io([this, zero_copy](std::function<void(int)> cb) {
+        if (zero_copy) {
+          return log_->backend->ReadSliceAsync(oid_, epoch_, position_,
+              &slice_, cb);
+        }
+        return log_->backend->ReadAsync(oid_, epoch_, position_, &data_, cb);
+      })) {
+        return -EINPROGRESS;
       }
-      continue;
     }
 
-    int ret = log_->backend->Read(*oid, view->epoch(), position_, &data_);
+    read_submitted_ = false;
+    int ret = io_ret_;
 
     if (ret == -ESPIPE) {
-      log_->view_mgr->update_current_view(view->epoch());
+      log_->view_mgr->update_current_view(epoch_);
       continue;
     }
 
@@ -147,13 +224,23 @@ int ReadOp::run()
     // matters at all since newly created stripes are initialized in the
     // background (future work).
     if (ret == -ENOENT) {
-      int ret = log_->backend->Seal(*oid, view->epoch());
+      int ret = log_->backend->Seal(oid_, epoch_);
       if (ret && ret != -ESPIPE) {
         return ret;
       }
       continue;
     }
 
+    if (!ret && log_->cache) {
+      // dropped if a trim or fill of the position raced with the read
+      if (zero_copy) {
+        log_->cache->put_if_current(position_, slice_.data(),
+            slice_.size(), cache_gen_);
+      } else {
+        log_->cache->put_if_current(position_, data_, cache_gen_);
+      }
+    }
+
     return ret;
   }
 }
@@ -202,80 +289,212 @@ int LogImpl::readAsync(uint64_t position,
   return 0;
 }
 
-int AppendOp::run()
+int LogImpl::ReadSlice(const uint64_t position, Slice *data_out)
 {
-  while (true) {
-    const auto view = log_->view_mgr->view();
+  struct {
+    int ret;
+    bool done = false;
+    Slice data;
+    std::mutex lock;
+    std::condition_variable cond;
+  } ctx;
 
-    if (view->seq) {
-      // avoid obtaining a new append position when the view has been updated
-      // (e.g. because the mapping was extended), but the sequencer did not
-      // change. this is generally a minor optimization. but for completeness,
-      // it also handles the edge case in which stripes are configured to hold
-      // exactly one log entry. in this case a loop will be created by which the
-      // new position doesn't map, the map is extended, and then a new unmapped
-      // position is obtained.
-      if (!position_epoch_ || (*position_epoch_ != view->seq->epoch())) {
-        position_ = view->seq->check_tail(true);
-        position_epoch_ = view->seq->epoch();
-      }
-      assert(position_epoch_);
-      assert(*position_epoch_ > 0);
-      assert(*position_epoch_ == view->seq->epoch());
-    } else {
-      return -EIO;
+  int ret = readSliceAsync(position, [&](int ret, const Slice& data) {
+    {
+      std::lock_guard<std::mutex> lk(ctx.lock);
+      ctx.ret = ret;
+      ctx.done = true;
+      if (!ctx.ret) {
+        ctx.data = data;
+      }
+      ctx.cond.notify_one();
     }
+  });
 
-    const auto oid = log_->view_mgr->map(view, position_);
+  if (ret) {
+    return ret;
+  }
+
+  std::unique_lock<std::mutex> lk(ctx.lock);
+  ctx.cond.wait(lk, [&] { return ctx.done; });
+
+  if (!ctx.ret) {
+    *data_out = std::move(ctx.data);
+  }
+
+  return ctx.ret;
+}
+
+int LogImpl::readSliceAsync(uint64_t position,
+    std::function<void(int, const Slice&)> cb)
+{
+  auto op = std::unique_ptr<LogOp>(new ReadOp(this, position, cb));
+  queue_op(std::move(op));
+  return 0;
+}
+
+int ReadRangeOp::read_each(const ObjectId& oid, uint64_t epoch)
+{
+  entries_.clear();
+  invalid_.clear();
+
+  for (uint64_t position = min_position_;; position += stride_) {
+    std::string data;
+    int ret = log_->backend->Read(oid, epoch, position, &data);
+    if (!ret) {
+      entries_.emplace(position, std::move(data));
+    } else if (ret == -ENODATA) {
+      invalid_.insert(position);
+    } else if (ret != -ERANGE) {
+      return ret;
+    }
+
+    if ((max_position_ - position) < stride_) {
+      break;
+    }
+  }
+
+  return 0;
+}
+
+int ReadRangeOp::run()
+{
+  while (true) {
+    const auto view = log_->view_mgr->view();
+    const auto oid = log_->view_mgr->map(view, min_position_);
     if (!oid) {
-      log_->append_expand_view++;
-      int ret = log_->view_mgr->try_expand_view(position_);
+      int ret = log_->view_mgr->try_expand_view(min_position_);
       if (ret) {
         return ret;
       }
       continue;
     }
 
-    while (true) {
-      int ret = log_->backend->Write(*oid, data_, view->epoch(), position_);
-      if (!ret) {
+    int ret = log_->backend->ReadRange(*oid, view->epoch(), min_position_,
+        max_position_, stride_, &entries_, &invalid_);
+    if (ret == -EOPNOTSUPP) {
+      ret = read_each(*oid, view->epoch());
+    }
+
+    if (ret == -ESPIPE) {
+      log_->view_mgr->update_current_view(view->epoch());
+      continue;
+    }
+
+    // see ReadOp::run for initialization of mapped objects on read
+    if (ret == -ENOENT) {
+      int ret = log_->backend->Seal(*oid, view->epoch());
+      if (ret && ret != -ESPIPE) {
         return ret;
-      } else if (ret == -ENOENT) {
-        log_->append_seal++;
-        // this can happen if a new stripe has been created but not initialized,
-        // either because we are racing with initialization, or due to a fault in
-        // the process performing the initialization.
-        int ret = log_->backend->Seal(*oid, view->epoch());
-        if (!ret) {
-          // try the append again. the view and the position are still
-          // consistent, and there is no reason to think they are out-of-date.
-          continue;
-        } else if (ret != -ESPIPE) {
-          return ret;
+      }
+      continue;
+    }
+
+    return ret;
+  }
+}
+
+int LogImpl::NewIterator(uint64_t start, uint64_t end,
+    Iterator **iterator)
+{
+  if (start > end || !iterator) {
+    return -EINVAL;
+  }
+
+  *iterator = new LogIteratorImpl(this, start, end);
+
+  return 0;
+}
+
+int AppendOp::run()
+{
+  while (true) {
+    if (!write_submitted_) {
+      const auto view = log_->view_mgr->view();
+
+      if (view->seq) {
+        // avoid obtaining a new append position when the view has been updated
+        // (e.g. because the mapping was extended), but the sequencer did not
+        // change. this is generally a minor optimization. but for completeness,
+        // it also handles the edge case in which stripes are configured to hold
+        // exactly one log entry. in this case a loop will be created by which
+        // the new position doesn't map, the map is extended, and then a new
+        // unmapped position is obtained.
+        if (!position_epoch_ || (*position_epoch_ != view->seq->epoch())) {
+          position_ = view->seq->check_tail(true);
+          position_epoch_ = view->seq->epoch();
         }
-        assert(ret == -ESPIPE);
-        // unlike other backend interfaces, seal will return -ESPIPE if the
-        // epoch is less than _or equal_ to the stored epoch. if the write
-        // returned -ENOENT at epoch 100 because it was racing with
-        // initialization (also at epoch 100), then seal at epoch 100 will
-        // return -ESPIPE. the point is that when -ESPIPE is returned from seal
-        // we shouldn't refresh the striper and wait on a newer epoch. if there
-        // actually is a newer view, then that will be caught by the write
-        // interface. XXX: this would be a fantastic scenario to test for in a
-        // model, by incorrectly refreshing here causing a deadlock, or perhaps
-        // changing the epoch <= test in the backend.
-        break;
-      } else if (ret == -ESPIPE) {
-        log_->append_stale_view++;
-        log_->view_mgr->update_current_view(view->epoch());
-        break;
-      } else if (ret == -EROFS) {
-        log_->append_read_only++;
-        position_epoch_.reset(); // make sure to get a new position
-        break;
+        assert(position_epoch_);
+        assert(*position_epoch_ > 0);
+        assert(*position_epoch_ == view->seq->epoch());
       } else {
+        return -EIO;
+      }
+
+      const auto oid = log_->view_mgr->map(view, position_);
+      if (!oid) {
+        log_->append_expand_view++;
+        int ret = log_->view_mgr->try_expand_view(position_);
+        if (ret) {
+          return ret;
+        }
+        continue;
+      }
+
+      oid_ = *oid;
+      epoch_ = view->epoch();
+      if (log_->cache) {
+        cache_gen_ = log_->cache->generation(position_);
+      }
+      write_submitted_ = true;
+      if (!submit_io([this](std::function<void(int)> cb) {
+        return log_->backend->WriteAsync(oid_, data_, epoch_, position_, cb);
+      })) {
+        return -EINPROGRESS;
+      }
+    }
+
+    write_submitted_ = false;
+    int ret = io_ret_;
+
+    if (!ret) {
+      if (log_->cache) {
+        log_->cache->put_if_current(position_, data_, cache_gen_);
+      }
+      return ret;
+    } else if (ret == -ENOENT) {
+      log_->append_seal++;
+      // this can happen if a new stripe has been created but not initialized,
+      // either because we are racing with initialization, or due to a fault in
+      // the process performing the initialization.
+      int ret = log_->backend->Seal(oid_, epoch_);
+      if (ret && ret != -ESPIPE) {
         return ret;
       }
+      // on success, try the append again. the view and the position are still
+      // consistent, and there is no reason to think they are out-of-date.
+      //
+      // unlike other backend interfaces, seal will return -ESPIPE if the epoch
+      // is less than _or equal_ to the stored epoch. if the write returned
+      // -ENOENT at epoch 100 because it was racing with initialization (also at
+      // epoch 100), then seal at epoch 100 will return -ESPIPE. the point is
+      // that when -ESPIPE is returned from seal we shouldn't refresh the
+      // striper and wait on a newer epoch. if there actually is a newer view,
+      // then that will be caught by the write interface. XXX: this would be a
+      // fantastic scenario to test for in a model, by incorrectly refreshing
+      // here causing a deadlock, or perhaps changing the epoch <= test in the
+      // backend.
+      continue;
+    } else if (ret == -ESPIPE) {
+      log_->append_stale_view++;
+      log_->view_mgr->update_current_view(epoch_);
+      continue;
+    } else if (ret == -EROFS) {
+      log_->append_read_only++;
+      position_epoch_.reset(); // make sure to get a new position
+      continue;
+    } else {
+      return ret;
     }
   }
 }
@@ -324,34 +543,283 @@ int LogImpl::appendAsync(const std::string& data,
   return 0;
 }
 
-int FillOp::run()
+void AppendBatchOp::assign_positions(Sequencer *seq,
+    const std::vector<size_t>& entries)
+{
+  // a single reservation covers all of the entries
+  const uint64_t first = seq->reserve(entries.size());
+  for (size_t i = 0; i < entries.size(); i++) {
+    positions_[entries[i]] = first + i;
+  }
+}
+
+int AppendBatchOp::run()
 {
   while (true) {
-    const auto view = log_->view_mgr->view();
-    const auto oid = log_->view_mgr->map(view, position_);
-    if (!oid) {
-      int ret = log_->view_mgr->try_expand_view(position_);
-      if (ret) {
+    if (state_ == State::Map) {
+      if (pending_.empty()) {
+        return 0;
+      }
+
+      view_ = log_->view_mgr->view();
+
+      // see AppendOp::run for why positions are retained across views that
+      // share the same sequencer.
+      if (view_->seq) {
+        if (!position_epoch_ || (*position_epoch_ != view_->seq->epoch())) {
+          assign_positions(view_->seq.get(), pending_);
+          position_epoch_ = view_->seq->epoch();
+        }
+        assert(position_epoch_);
+        assert(*position_epoch_ > 0);
+        assert(*position_epoch_ == view_->seq->epoch());
+      } else {
+        return -EIO;
+      }
+
+      // group the pending entries by the object that they map to
+      objects_.clear();
+      boost::optional<uint64_t> unmapped;
+      for (const auto idx : pending_) {
+        const auto oid = log_->view_mgr->map(view_, positions_[idx]);
+        if (!oid) {
+          unmapped = positions_[idx];
+          break;
+        }
+        objects_[*oid].push_back(idx);
+      }
+
+      if (unmapped) {
+        log_->append_expand_view++;
+        int ret = log_->view_mgr->try_expand_view(*unmapped);
+        if (ret) {
+          return ret;
+        }
+        continue;
+      }
+
+      unwritten_.clear();
+      relocate_.clear();
+      object_ = objects_.cbegin();
+      state_ = State::Write;
+    }
+
+    if (state_ == State::Write) {
+      if (object_ == objects_.cend()) {
+        if (!relocate_.empty()) {
+          // the sequencer that handed out the original positions is still
+          // the active sequencer, and if it isn't, all of the pending entries
+          // will be assigned new positions when they are mapped anyway.
+          assign_positions(view_->seq.get(), relocate_);
+          unwritten_.insert(unwritten_.end(), relocate_.begin(),
+              relocate_.end());
+        }
+        pending_.swap(unwritten_);
+        state_ = State::Map;
+        continue;
+      }
+
+      const auto& entries = object_->second;
+
+      if (!io_submitted_) {
+        oid_ = object_->first;
+        epoch_ = view_->epoch();
+        batch_.clear();
+        cache_gens_.clear();
+        for (const auto idx : entries) {
+          batch_.emplace_back(positions_[idx], &data_[idx]);
+          if (log_->cache) {
+            cache_gens_.push_back(log_->cache->generation(positions_[idx]));
+          }
+        }
+
+        io_submitted_ = true;
+        if (!submit_io([this](std::function<void(int)> cb) {
+          return log_->backend->WriteBatchAsync(oid_, epoch_, batch_,
+              &results_, cb);
+        })) {
+          return -EINPROGRESS;
+        }
+      }
+
+      io_submitted_ = false;
+      int ret = io_ret_;
+      if (ret && ret != -ENOENT && ret != -ESPIPE) {
         return ret;
       }
+      assert(results_.size() == entries.size());
+
+      bool seal = false;
+      stale_ = false;
+      for (size_t i = 0; i < entries.size(); i++) {
+        const auto idx = entries[i];
+        switch (results_[i]) {
+          case 0:
+            if (log_->cache) {
+              log_->cache->put_if_current(positions_[idx], data_[idx],
+                  cache_gens_[i]);
+            }
+            break;
+          case -EROFS:
+            log_->append_read_only++;
+            relocate_.push_back(idx);
+            break;
+          case -ENOENT:
+            seal = true;
+            unwritten_.push_back(idx);
+            break;
+          case -ESPIPE:
+            stale_ = true;
+            unwritten_.push_back(idx);
+            break;
+          default:
+            return results_[i];
+        }
+      }
+
+      if (seal) {
+        log_->append_seal++;
+        state_ = State::Seal;
+        continue;
+      }
+
+      next_object();
       continue;
     }
 
-    int ret = log_->backend->Fill(*oid, view->epoch(), position_);
+    assert(state_ == State::Seal);
+
+    if (!io_submitted_) {
+      io_submitted_ = true;
+      if (!submit_io([this](std::function<void(int)> cb) {
+        return log_->backend->SealAsync(oid_, epoch_, cb);
+      })) {
+        return -EINPROGRESS;
+      }
+    }
+
+    io_submitted_ = false;
+    // see AppendOp::run for why -ESPIPE from seal is not treated as a stale
+    // view. in either case the entries are retried.
+    if (io_ret_ && io_ret_ != -ESPIPE) {
+      return io_ret_;
+    }
+
+    next_object();
+  }
+}
+
+void AppendBatchOp::next_object()
+{
+  if (stale_) {
+    log_->append_stale_view++;
+    log_->view_mgr->update_current_view(epoch_);
+    // the remaining objects are not attempted until the view is refreshed
+    for (auto it = std::next(object_); it != objects_.cend(); it++) {
+      unwritten_.insert(unwritten_.end(), it->second.cbegin(),
+          it->second.cend());
+    }
+    object_ = objects_.cend();
+  } else {
+    object_++;
+  }
+  state_ = State::Write;
+}
+
+int LogImpl::appendBatch(const std::vector<std::string>& data,
+    std::vector<uint64_t> *positions)
+{
+  struct {
+    int ret;
+    bool done = false;
+    std::vector<uint64_t> positions;
+    std::mutex lock;
+    std::condition_variable cond;
+  } ctx;
+
+  int ret = appendBatchAsync(data, [&](int ret,
+        const std::vector<uint64_t>& positions) {
+    {
+      std::lock_guard<std::mutex> lk(ctx.lock);
+      ctx.ret = ret;
+      ctx.done = true;
+      if (!ctx.ret) {
+        ctx.positions = positions;
+      }
+      ctx.cond.notify_one();
+    }
+  });
+
+  if (ret) {
+    return ret;
+  }
+
+  std::unique_lock<std::mutex> lk(ctx.lock);
+  ctx.cond.wait(lk, [&] { return ctx.done; });
+
+  if (!ctx.ret && positions) {
+    positions->swap(ctx.positions);
+  }
+
+  return ctx.ret;
+}
+
+int LogImpl::appendBatchAsync(const std::vector<std::string>& data,
+    std::function<void(int, const std::vector<uint64_t>&)> cb)
+{
+  if (data.empty()) {
+    return -EINVAL;
+  }
+
+  auto op = std::unique_ptr<LogOp>(new AppendBatchOp(this, data, cb));
+  queue_op(std::move(op));
+  return 0;
+}
+
+int FillOp::run()
+{
+  while (true) {
+    if (!fill_submitted_) {
+      const auto view = log_->view_mgr->view();
+      const auto oid = log_->view_mgr->map(view, position_);
+      if (!oid) {
+        int ret = log_->view_mgr->try_expand_view(position_);
+        if (ret) {
+          return ret;
+        }
+        continue;
+      }
+
+      oid_ = *oid;
+      epoch_ = view->epoch();
+      fill_submitted_ = true;
+      if (!submit_io([this](std::function<void(int)> cb) {
+        return log_->backend->FillAsync(oid_, epoch_, position_, cb);
+      })) {
+        return -EINPROGRESS;
+      }
+    }
+
+    fill_submitted_ = false;
+    int ret = io_ret_;
 
     if (ret == -ESPIPE) {
-      log_->view_mgr->update_current_view(view->epoch());
+      log_->view_mgr->update_current_view(epoch_);
       continue;
     }
 
     if (ret == -ENOENT) {
-      int ret = log_->backend->Seal(*oid, view->epoch());
+      int ret = log_->backend->Seal(oid_, epoch_);
       if (ret && ret != -ESPIPE) {
         return ret;
       }
       continue;
     }
 
+    if (!ret && log_->cache) {
+      log_->cache->remove(position_);
+    }
+
     return ret;
   }
 }
@@ -420,6 +888,10 @@ int TrimOp::run()
       continue;
     }
 
+    if (!ret && log_->cache) {
+      log_->cache->remove(position_);
+    }
+
     return ret;
   }
 }
@@ -546,6 +1018,10 @@ int TrimToOp::run()
     break;
   }
 
+  if (log_->cache) {
+    log_->cache->remove_to(position_);
+  }
+
   return 0;
 }
 
@@ -584,64 +1060,133 @@ int LogImpl::trimToAsync(uint64_t position, std::function<void(int)> cb)
   return 0;
 }
 
-void LogImpl::queue_op(std::unique_ptr<LogOp> op)
+void LogImpl::admit_op_()
 {
-  std::unique_lock<std::mutex> lk(lock);
+  auto inflight = num_inflight_ops_.load(std::memory_order_relaxed);
+  while (true) {
+    if (inflight < options.max_inflight_ops) {
+      if (num_inflight_ops_.compare_exchange_weak(inflight, inflight + 1)) {
+        return;
+      }
+      continue;
+    }
 
-  if (num_inflight_ops_ >= options.max_inflight_ops) {
-    std::condition_variable cond;
-    queue_op_waiters_.emplace_front(false, &cond);
-    auto it = queue_op_waiters_.begin();
-    cond.wait(lk, [&] {
-      assert(it->second == &cond);
-      return it->first;
+    // the waiter count is published before the inflight count is re-read,
+    // and retire_op_ drops the inflight count before reading the waiter
+    // count, so at least one side observes the other.
+    std::unique_lock<std::mutex> lk(admission_lock_);
+    admission_waiters_++;
+    admission_cond_.wait(lk, [&] {
+      inflight = num_inflight_ops_.load();
+      return inflight < options.max_inflight_ops;
     });
-    queue_op_waiters_.erase(it);
+    admission_waiters_--;
   }
+}
+
+void LogImpl::retire_op_()
+{
+  auto prev = num_inflight_ops_.fetch_sub(1);
+  assert(prev > 0);
+
+  if (admission_waiters_.load() > 0) {
+    std::lock_guard<std::mutex> lk(admission_lock_);
+    admission_cond_.notify_one();
+  }
+
+  // finishers wait for deferred ops to complete before exiting
+  if (prev == 1 && shutdown) {
+    std::lock_guard<std::mutex> lk(sleep_lock_);
+    sleep_cond_.notify_all();
+  }
+}
+
+void LogImpl::enqueue_op_(std::unique_ptr<LogOp> op)
+{
+  auto shard = op_shards_.Access();
+  {
+    std::lock_guard<std::mutex> lk(shard->lock);
+    shard->ops.emplace_back(std::move(op));
+    queued_ops_++;
+  }
+
+  if (sleepers_.load() > 0) {
+    std::lock_guard<std::mutex> lk(sleep_lock_);
+    sleep_cond_.notify_one();
+  }
+}
+
+void LogImpl::queue_op(std::unique_ptr<LogOp> op)
+{
+  admit_op_();
+  enqueue_op_(std::move(op));
+}
 
-  num_inflight_ops_++;
+void LogImpl::resume_op(LogOp *op)
+{
+  // the op was admitted when it was first queued
+  enqueue_op_(std::unique_ptr<LogOp>(op));
+}
 
-  pending_ops_.emplace_back(std::move(op));
-  finishers_cond_.notify_all();
+std::unique_ptr<LogOp> LogImpl::dequeue_op_(size_t home)
+{
+  const auto num_shards = op_shards_.Size();
+  for (size_t i = 0; i < num_shards; i++) {
+    auto shard = op_shards_.AccessAtCore((home + i) % num_shards);
+    std::lock_guard<std::mutex> lk(shard->lock);
+    if (!shard->ops.empty()) {
+      auto op = std::move(shard->ops.front());
+      shard->ops.pop_front();
+      queued_ops_--;
+      return op;
+    }
+  }
+  return nullptr;
 }
 
-void LogImpl::finisher_entry_()
+void LogImpl::finisher_entry_(size_t id)
 {
+  const auto home = id % op_shards_.Size();
+
   while (true) {
-    bool do_shutdown = false;
     std::unique_ptr<LogOp> op;
-    {
-      std::unique_lock<std::mutex> lk(lock);
-      finishers_cond_.wait(lk, [&] {
-        return !pending_ops_.empty() || shutdown;
-      });
+    if (queued_ops_.load() > 0) {
+      op = dequeue_op_(home);
+    }
 
-      if (shutdown) {
-        if (pending_ops_.empty()) {
-          break;
-        }
-        do_shutdown = true;
+    if (!op) {
+      std::unique_lock<std::mutex> lk(sleep_lock_);
+      sleepers_++;
+      sleep_cond_.wait(lk, [&] {
+        return queued_ops_.load() > 0 ||
+          (shutdown && num_inflight_ops_.load() == 0);
+      });
+      sleepers_--;
+      if (queued_ops_.load() == 0 && shutdown &&
+          num_inflight_ops_.load() == 0) {
+        break;
       }
-
-      assert(!pending_ops_.empty());
-      op = std::move(pending_ops_.front());
-      pending_ops_.pop_front();
+      continue;
     }
 
-    if (do_shutdown) {
-      op->callback(-ESHUTDOWN);
+    // ops that haven't started are failed during shutdown, but ops resuming
+    // after an asynchronous request are run to completion.
+    int ret;
+    if (shutdown && !op->deferred()) {
+      ret = -ESHUTDOWN;
     } else {
-      int ret = op->run();
-      op->callback(ret);
+      ret = op->run();
+      if (ret == -EINPROGRESS) {
+        // the op is now owned by the outstanding request
+        op.release();
+        continue;
+      }
     }
 
-    std::lock_guard<std::mutex> lk(lock);
-    assert(num_inflight_ops_ > 0);
-    num_inflight_ops_--;
-    if (!queue_op_waiters_.empty()) {
-      queue_op_waiters_.back().first = true;
-      queue_op_waiters_.back().second->notify_one();
-    }
+    op->callback(ret);
+    op.reset();
+
+    retire_op_();
   }
 }
 
@@ -1,15 +1,21 @@
 #pragma once
+#include <atomic>
 #include <condition_variable>
+#include <deque>
 #include <list>
+#include <map>
 #include <mutex>
+#include <set>
 #include <thread>
 
 #include "include/zlog/log.h"
 #include "include/zlog/statistics.h"
 #include "libseq/libseqr.h"
 #include "include/zlog/backend.h"
+#include "include/zlog/cache.h"
 #include "log_backend.h"
 #include "view_manager.h"
+#include "util/core_local.h"
 
 #define DEFAULT_STRIPE_SIZE 100
 
@@ -21,15 +27,43 @@ typedef void (*backend_release_t)(Backend*);
 class LogOp {
  public:
   LogOp(LogImpl *log) :
-    log_(log)
+    log_(log),
+    io_ret_(0),
+    io_state_(IoState::Idle)
   {}
 
   virtual ~LogOp() {}
+
+  // run returns -EINPROGRESS when the op is waiting on an asynchronous backend
+  // request. in that case ownership of the op passes to the request, and the
+  // op is resumed by calling run again on a finisher thread.
   virtual int run() = 0;
   virtual void callback(int ret) = 0;
 
+  // true when the op is being resumed after an asynchronous request
+  bool deferred() const {
+    return io_state_ == IoState::Deferred;
+  }
+
  protected:
+  // submit an asynchronous backend request. returns true if the request
+  // completed (or could not be submitted) before returning, in which case the
+  // result is in io_ret_. otherwise the op has been handed off, and the caller
+  // must return -EINPROGRESS from run without touching the op again.
+  bool submit_io(const std::function<int(std::function<void(int)>)>& submit);
+
   LogImpl *log_;
+  int io_ret_;
+
+ private:
+  enum class IoState {
+    Idle,
+    Submitting,
+    Completed,
+    Deferred,
+  };
+
+  std::atomic<IoState> io_state_;
 };
 
 class TailOp : public LogOp {
@@ -80,6 +114,7 @@ class FillOp : public LogOp {
   FillOp(LogImpl *log, uint64_t position, std::function<void(int)> cb) :
     LogOp(log),
     position_(position),
+    fill_submitted_(false),
     cb_(cb)
   {}
 
@@ -93,30 +128,88 @@ class FillOp : public LogOp {
 
  private:
   uint64_t position_;
+  bool fill_submitted_;
+  ObjectId oid_;
+  uint64_t epoch_;
   std::function<void(int)> cb_;
 };
 
+// reads an entry into a string, or into a slice that references the entry
+// without copying it when constructed with a slice callback.
 class ReadOp : public LogOp {
  public:
   ReadOp(LogImpl *log, uint64_t position,
       std::function<void(int, std::string&)> cb) :
     LogOp(log),
     position_(position),
+    read_submitted_(false),
     cb_(cb)
   {}
 
+  ReadOp(LogImpl *log, uint64_t position,
+      std::function<void(int, const Slice&)> cb) :
+    LogOp(log),
+    position_(position),
+    read_submitted_(false),
+    slice_cb_(cb)
+  {}
+
   int run() override;
 
   void callback(int ret) override {
     if (cb_) {
       cb_(ret, data_);
+    } else if (slice_cb_) {
+      slice_cb_(ret, slice_);
     }
   }
 
  private:
   uint64_t position_;
   std::string data_;
+  Slice slice_;
+  bool read_submitted_;
+  ObjectId oid_;
+  uint64_t epoch_;
+  // cache generation recorded before the read was submitted
+  uint64_t cache_gen_;
   std::function<void(int, std::string&)> cb_;
+  std::function<void(int, const Slice&)> slice_cb_;
+};
+
+// reads the positions in [min_position, max_position] that map to the object
+// containing min_position. stride is the distance between positions stored in
+// the same object.
+class ReadRangeOp : public LogOp {
+ public:
+  ReadRangeOp(LogImpl *log, uint64_t min_position, uint64_t max_position,
+      uint32_t stride, std::function<void(int, std::map<uint64_t, std::string>&,
+        std::set<uint64_t>&)> cb) :
+    LogOp(log),
+    min_position_(min_position),
+    max_position_(max_position),
+    stride_(stride),
+    cb_(cb)
+  {}
+
+  int run() override;
+
+  void callback(int ret) override {
+    if (cb_) {
+      cb_(ret, entries_, invalid_);
+    }
+  }
+
+ private:
+  int read_each(const ObjectId& oid, uint64_t epoch);
+
+  const uint64_t min_position_;
+  const uint64_t max_position_;
+  const uint32_t stride_;
+  std::map<uint64_t, std::string> entries_;
+  std::set<uint64_t> invalid_;
+  std::function<void(int, std::map<uint64_t, std::string>&,
+      std::set<uint64_t>&)> cb_;
 };
 
 // TODO: move or copy or reference for the data
@@ -127,6 +220,7 @@ class AppendOp : public LogOp {
     LogOp(log),
     data_(data.data(), data.size()),
     position_epoch_(boost::none),
+    write_submitted_(false),
     cb_(cb)
   {}
 
@@ -142,9 +236,87 @@ class AppendOp : public LogOp {
   std::string data_;
   uint64_t position_;
   boost::optional<uint64_t> position_epoch_;
+  bool write_submitted_;
+  ObjectId oid_;
+  uint64_t epoch_;
+  // cache generation recorded before the write was submitted
+  uint64_t cache_gen_;
   std::function<void(int, uint64_t)> cb_;
 };
 
+// writes a batch of entries. the entries are grouped by the object that their
+// positions map to, and the objects are written one at a time with a single
+// batched request each.
+class AppendBatchOp : public LogOp {
+ public:
+  AppendBatchOp(LogImpl *log, const std::vector<std::string>& data,
+      std::function<void(int, const std::vector<uint64_t>&)> cb) :
+    LogOp(log),
+    data_(data),
+    positions_(data.size()),
+    position_epoch_(boost::none),
+    state_(State::Map),
+    io_submitted_(false),
+    stale_(false),
+    cb_(cb)
+  {
+    for (size_t i = 0; i < data_.size(); i++) {
+      pending_.push_back(i);
+    }
+  }
+
+  int run() override;
+
+  void callback(int ret) override {
+    if (cb_) {
+      cb_(ret, positions_);
+    }
+  }
+
+ private:
+  enum class State {
+    // map the pending entries to objects
+    Map,
+    // write the entries of the current object
+    Write,
+    // seal the current object before its entries are retried
+    Seal,
+  };
+
+  void assign_positions(Sequencer *seq, const std::vector<size_t>& entries);
+  void next_object();
+
+  const std::vector<std::string> data_;
+  std::vector<uint64_t> positions_;
+  // indices of entries that have not yet been written
+  std::vector<size_t> pending_;
+  boost::optional<uint64_t> position_epoch_;
+
+  State state_;
+  bool io_submitted_;
+  std::shared_ptr<const VersionedView> view_;
+  // pending entries grouped by object, and the object being written
+  std::map<ObjectId, std::vector<size_t>> objects_;
+  std::map<ObjectId, std::vector<size_t>>::const_iterator object_;
+  // entries that weren't attempted because the view needs to be refreshed,
+  // and entries whose positions were taken (e.g. filled) and need to be
+  // relocated to new positions.
+  std::vector<size_t> unwritten_;
+  std::vector<size_t> relocate_;
+  // the current object's write found that the view is out-of-date
+  bool stale_;
+
+  // the request for the current object
+  ObjectId oid_;
+  uint64_t epoch_;
+  std::vector<std::pair<uint64_t, const std::string*>> batch_;
+  std::vector<int> results_;
+  // cache generations recorded before the batch was submitted
+  std::vector<uint64_t> cache_gens_;
+
+  std::function<void(int, const std::vector<uint64_t>&)> cb_;
+};
+
 class TrimToOp : public LogOp {
  public:
   TrimToOp(LogImpl *log, uint64_t position, std::function<void(int)> cb) :
@@ -186,25 +358,73 @@ class LogImpl : public Log {
 
  public:
   int Read(uint64_t position, std::string *data) override;
+  int ReadSlice(uint64_t position, Slice *data) override;
   int Append(const std::string& data, uint64_t *pposition) override;
+  int appendBatch(const std::vector<std::string>& data,
+      std::vector<uint64_t> *positions) override;
   int Fill(uint64_t position) override;
   int Trim(uint64_t position) override;
+  int NewIterator(uint64_t start, uint64_t end,
+      Iterator **iterator) override;
 
  public:
-  void finisher_entry_();
+  void finisher_entry_(size_t id);
   std::vector<std::thread> finishers_;
-  std::condition_variable finishers_cond_;
-  std::list<std::unique_ptr<LogOp>> pending_ops_;
   void queue_op(std::unique_ptr<LogOp> op);
 
+  // requeue an op whose asynchronous backend request has completed
+  void resume_op(LogOp *op);
+
+ private:
+  // ops are queued on the shard belonging to the submitting thread's core,
+  // and finishers pull from their home shard before stealing from the others.
+  // the padding keeps neighbouring shard locks off the same cache line.
+  struct OpQueueShard {
+    std::mutex lock;
+    std::deque<std::unique_ptr<LogOp>> ops;
+    char padding[CACHE_LINE_SIZE];
+  };
+
+  void enqueue_op_(std::unique_ptr<LogOp> op);
+  std::unique_ptr<LogOp> dequeue_op_(size_t home);
+  void admit_op_();
+  void retire_op_();
+
+  CoreLocalArray<OpQueueShard> op_shards_;
+
+  // number of ops sitting in a shard queue. updated under the shard lock
+  // together with the queue, so a finisher that observes a non-zero count
+  // and scans the shards will find the op unless another finisher beat it.
+  std::atomic<uint64_t> queued_ops_;
+
+  // finishers only block when the shards are empty. producers take the
+  // sleep lock and wake a single finisher only when one is sleeping.
+  std::mutex sleep_lock_;
+  std::condition_variable sleep_cond_;
+  std::atomic<uint32_t> sleepers_;
+
+  // bounds the number of queued, running, and deferred ops. the common case is a single
+  // compare-and-swap; the lock and condition are only touched when the limit
+  // has been reached.
+  std::atomic<uint32_t> num_inflight_ops_;
+  std::mutex admission_lock_;
+  std::condition_variable admission_cond_;
+  std::atomic<uint32_t> admission_waiters_;
+
+ public:
+
   int tailAsync(bool increment, std::function<void(int, uint64_t)> cb);
   int tailAsync(std::function<void(int, uint64_t)> cb) override {
     return tailAsync(false, cb);
   }
   int appendAsync(const std::string& data,
       std::function<void(int, uint64_t position)> cb) override;
+  int appendBatchAsync(const std::vector<std::string>& data,
+      std::function<void(int, const std::vector<uint64_t>&)> cb) override;
   int readAsync(uint64_t position,
       std::function<void(int, std::string&)> cb) override;
+  int readSliceAsync(uint64_t position,
+      std::function<void(int, const Slice&)> cb) override;
   int fillAsync(uint64_t position, std::function<void(int)> cb) override;
   int trimAsync(uint64_t position, std::function<void(int)> cb) override;
   int trimTo(uint64_t position) override;
@@ -227,8 +447,7 @@ class LogImpl : public Log {
   void PrintStats() override;
 
  public:
-  bool shutdown;
-  std::mutex lock;
+  std::atomic<bool> shutdown;
 
   // thread-safe
   const std::shared_ptr<LogBackend> backend;
@@ -237,14 +456,13 @@ class LogImpl : public Log {
 
   const std::unique_ptr<ViewManager> view_mgr;
 
+  // read cache. null unless built with caching and options.cache_size > 0
+  std::unique_ptr<Cache> cache;
+
   std::string exclusive_cookie;
   uint64_t exclusive_position;
   bool exclusive_empty;
 
-  uint32_t num_inflight_ops_;
-  std::list<std::pair<bool,
-    std::condition_variable*>> queue_op_waiters_;
-
   const Options options;
 };
 
@@ -273,6 +491,16 @@ class ReadOnlyLogImpl : public LogImpl {
     return -EROFS;
   }
 
+  int appendBatch(const std::vector<std::string>& data,
+      std::vector<uint64_t> *positions) override {
+    return -EROFS;
+  }
+
+  int appendBatchAsync(const std::vector<std::string>& data,
+      std::function<void(int, const std::vector<uint64_t>&)> cb) override {
+    return -EROFS;
+  }
+
   int Fill(uint64_t position) override {
     return -EROFS;
   }
@@ -0,0 +1,198 @@
+#include "log_iterator.h"
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include "log_impl.h"
+
+namespace zlog {
+
+void LogIteratorImpl::SeekToFirst()
+{
+  Seek(start_);
+}
+
+void LogIteratorImpl::SeekToLast()
+{
+  valid_ = false;
+  window_valid_ = false;
+
+  uint64_t tail;
+  int ret = log_->CheckTail(&tail);
+  if (ret) {
+    status_ = ret;
+    return;
+  }
+
+  // the tail is the next position to be assigned
+  if (tail == 0 || tail - 1 < start_) {
+    status_ = 0;
+    return;
+  }
+
+  seek(std::min(tail - 1, end_), false);
+}
+
+void LogIteratorImpl::Seek(uint64_t position)
+{
+  // entries may have been written since the window was read
+  window_valid_ = false;
+  seek(std::max(position, start_), true);
+}
+
+void LogIteratorImpl::Next()
+{
+  assert(valid_);
+  if (position_ == end_) {
+    valid_ = false;
+    return;
+  }
+  seek(position_ + 1, true);
+}
+
+void LogIteratorImpl::Prev()
+{
+  assert(valid_);
+  if (position_ == start_) {
+    valid_ = false;
+    return;
+  }
+  seek(position_ - 1, false);
+}
+
+void LogIteratorImpl::seek(uint64_t position, bool forward)
+{
+  valid_ = false;
+  status_ = 0;
+
+  // true if the window was read starting from the current position
+  bool fresh = false;
+
+  while (forward ? position <= end_ : position >= start_) {
+    // positions below the minimum valid position have been trimmed
+    const auto min_valid = log_->view_mgr->view()->object_map().min_valid_position();
+    if (position < min_valid) {
+      if (!forward) {
+        return;
+      }
+      position = min_valid;
+      continue;
+    }
+
+    if (!in_window(position)) {
+      int ret = fill_window(position, forward);
+      if (ret) {
+        status_ = ret;
+        return;
+      }
+      fresh = true;
+    }
+
+    const auto it = entries_.find(position);
+    if (it != entries_.end()) {
+      valid_ = true;
+      position_ = position;
+      data_ = &it->second;
+      return;
+    }
+
+    if (invalid_.count(position)) {
+      if (position == (forward ? end_ : start_)) {
+        return;
+      }
+      position = forward ? position + 1 : position - 1;
+      continue;
+    }
+
+    // the position may have been written since the window was read
+    if (!fresh) {
+      window_valid_ = false;
+      continue;
+    }
+
+    status_ = -ENOENT;
+    return;
+  }
+}
+
+int LogIteratorImpl::fill_window(uint64_t position, bool forward)
+{
+  window_valid_ = false;
+  entries_.clear();
+  invalid_.clear();
+
+  // without a mapping for the position the window is the single position, and
+  // reading it will expand the mapping for the next window.
+  uint64_t min_position = position;
+  uint64_t max_position = position;
+  uint32_t width = 1;
+
+  const auto view = log_->view_mgr->view();
+  const auto stripe = view->object_map().map_stripe(position);
+  if (stripe) {
+    width = stripe->width();
+    if (forward) {
+      max_position = std::min(stripe->max_position(), end_);
+      max_position = std::min(max_position,
+          min_position + (max_window_size - 1));
+    } else {
+      min_position = std::max(stripe->min_position(), start_);
+      min_position = std::max(min_position,
+          max_position - std::min(max_position, max_window_size - 1));
+    }
+  }
+
+  struct {
+    int ret = 0;
+    uint32_t pending = 0;
+    std::map<uint64_t, std::string> entries;
+    std::set<uint64_t> invalid;
+    std::mutex lock;
+    std::condition_variable cond;
+  } ctx;
+
+  // one range read for each object in the stripe
+  const uint64_t num_objects = std::min(uint64_t(width),
+      max_position - min_position + 1);
+  ctx.pending = num_objects;
+
+  for (uint64_t i = 0; i < num_objects; i++) {
+    const uint64_t first = min_position + i;
+    const uint64_t last = first + ((max_position - first) / width) * width;
+    auto op = std::unique_ptr<LogOp>(new ReadRangeOp(log_, first, last, width,
+          [&](int ret, std::map<uint64_t, std::string>& entries,
+            std::set<uint64_t>& invalid) {
+      std::lock_guard<std::mutex> lk(ctx.lock);
+      if (ret) {
+        if (!ctx.ret) {
+          ctx.ret = ret;
+        }
+      } else {
+        for (auto& entry : entries) {
+          ctx.entries.emplace(entry.first, std::move(entry.second));
+        }
+        ctx.invalid.insert(invalid.begin(), invalid.end());
+      }
+      if (--ctx.pending == 0) {
+        ctx.cond.notify_one();
+      }
+    }));
+    log_->queue_op(std::move(op));
+  }
+
+  std::unique_lock<std::mutex> lk(ctx.lock);
+  ctx.cond.wait(lk, [&] { return ctx.pending == 0; });
+
+  if (ctx.ret) {
+    return ctx.ret;
+  }
+
+  entries_.swap(ctx.entries);
+  invalid_.swap(ctx.invalid);
+  window_min_ = min_position;
+  window_max_ = max_position;
+  window_valid_ = true;
+
+  return 0;
+}
+
+}
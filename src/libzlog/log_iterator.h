@@ -0,0 +1,90 @@
+#pragma once
+#include <cassert>
+#include <map>
+#include <set>
+#include <string>
+#include "include/zlog/log.h"
+
+namespace zlog {
+
+class LogImpl;
+
+// LogIteratorImpl reads the log one window of positions at a time. a window
+// covers the remainder of the stripe containing the position being read, and is
+// filled by reading the range from every object in the stripe in parallel.
+class LogIteratorImpl : public Log::Iterator {
+ public:
+  LogIteratorImpl(LogImpl *log, uint64_t start, uint64_t end) :
+    log_(log),
+    start_(start),
+    end_(end),
+    valid_(false),
+    position_(0),
+    data_(nullptr),
+    status_(0),
+    window_valid_(false),
+    window_min_(0),
+    window_max_(0)
+  {}
+
+  LogIteratorImpl(const LogIteratorImpl&) = delete;
+  LogIteratorImpl& operator=(const LogIteratorImpl&) = delete;
+
+ public:
+  bool Valid() const override {
+    return valid_;
+  }
+
+  void SeekToFirst() override;
+  void SeekToLast() override;
+  void Seek(uint64_t position) override;
+  void Next() override;
+  void Prev() override;
+
+  uint64_t position() const override {
+    assert(valid_);
+    return position_;
+  }
+
+  const std::string& data() const override {
+    assert(valid_);
+    return *data_;
+  }
+
+  int status() const override {
+    return status_;
+  }
+
+ private:
+  // the maximum number of positions read into a window
+  static const uint64_t max_window_size = 1024;
+
+  // position the iterator at the first readable entry at or after (forward) or
+  // at or before (!forward) the position.
+  void seek(uint64_t position, bool forward);
+
+  // read the window extending from the position in the direction of iteration
+  int fill_window(uint64_t position, bool forward);
+
+  bool in_window(uint64_t position) const {
+    return window_valid_ && window_min_ <= position &&
+      position <= window_max_;
+  }
+
+  LogImpl * const log_;
+  const uint64_t start_;
+  const uint64_t end_;
+
+  bool valid_;
+  uint64_t position_;
+  const std::string *data_;
+  int status_;
+
+  bool window_valid_;
+  uint64_t window_min_;
+  uint64_t window_max_;
+  std::map<uint64_t, std::string> entries_;
+  std::set<uint64_t> invalid_;
+};
+
+}
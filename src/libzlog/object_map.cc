@@ -25,7 +25,7 @@ boost::optional<Stripe> ObjectMap::map_stripe(uint64_t position) const
   return boost::none;
 }
 
-std::pair<boost::optional<std::string>, bool>
+std::pair<boost::optional<ObjectId>, bool>
 ObjectMap::map(const uint64_t position) const
 {
   if (!stripes_by_pos_.empty()) {
@@ -41,7 +41,7 @@ ObjectMap::map(const uint64_t position) const
       const auto stripe_instance = stripe_pos / stripe_size;
       // stripe id is the instance relative to the stripe base id
       const auto stripe_id = it->second.base_id() + stripe_instance;
-      // generate the target object id
+      // compute the target object id
       auto oid = it->second.map(stripe_id, position);
       // the last stripe must also be the last instance
       auto last_stripe = std::next(it) == stripes_by_pos_.end() &&
@@ -52,7 +52,7 @@ ObjectMap::map(const uint64_t position) const
   return std::make_pair(boost::none, false);
 }
 
-boost::optional<std::vector<std::pair<std::string, bool>>>
+boost::optional<std::vector<std::pair<ObjectId, bool>>>
 ObjectMap::map_to(const uint64_t position, uint64_t& stripe_id, bool& done) const
 {
   // the max position is not mapped
@@ -60,9 +60,9 @@ ObjectMap::map_to(const uint64_t position, uint64_t& stripe_id, bool& done) cons
     return boost::none;
   }
 
-  // first: object name
+  // first: object id
   // second: complete map?
-  std::vector<std::pair<std::string, bool>> objects;
+  std::vector<std::pair<ObjectId, bool>> objects;
 
   assert(!done);
   if (stripe_id >= num_stripes()) {
@@ -46,9 +46,9 @@ class ObjectMap {
   bool valid() const;
 
  public:
-  // returns the object name that maps the position, if it exists. the second
+  // returns the object that maps the position, if it exists. the second
   // element is true iff the position maps to the last stripe in the object map.
-  std::pair<boost::optional<std::string>, bool> map(uint64_t position) const;
+  std::pair<boost::optional<ObjectId>, bool> map(uint64_t position) const;
 
   // expand the mapping to include the given position. true is returned when the
   // mapping changed, and false if the position is already mapped.
@@ -89,7 +89,7 @@ class ObjectMap {
   // iterate over objects that map from the beginning of the log up to the
   // position given. initialize stripe_id to 0, and done to false. when done
   // returns true, the return value can be ignored.
-  boost::optional<std::vector<std::pair<std::string, bool>>> map_to(
+  boost::optional<std::vector<std::pair<ObjectId, bool>>> map_to(
       uint64_t position, uint64_t& stripe_id, bool& done) const;
 
   // return the stripe that maps the position.
@@ -164,7 +164,7 @@ TEST(ObjectMapTest, MapA) {
 
   ASSERT_TRUE(om.map(0).first);
   ASSERT_TRUE(om.map(0).second);
-  ASSERT_EQ(*om.map(0).first, "0.0");
+  ASSERT_EQ(*om.map(0).first, zlog::ObjectId(0, 0));
   ASSERT_FALSE(om.map(1).first);
   ASSERT_FALSE(om.map(2).first);
 }
@@ -188,7 +188,7 @@ TEST(ObjectMapTest, MapB) {
     ASSERT_TRUE(om.map(p).first);
     ASSERT_TRUE(om.map(p).second);
   }
-  ASSERT_EQ(*om.map(111).first, "0.1");
+  ASSERT_EQ(*om.map(111).first, zlog::ObjectId(0, 1));
   ASSERT_FALSE(om.map(200).first);
   ASSERT_FALSE(om.map(201).first);
 }
@@ -212,17 +212,17 @@ TEST(ObjectMapTest, MapC) {
     ASSERT_TRUE(om.map(p).first);
     ASSERT_FALSE(om.map(p).second);
   }
-  ASSERT_EQ(*om.map(111).first, "0.1");
+  ASSERT_EQ(*om.map(111).first, zlog::ObjectId(0, 1));
   for (uint64_t p = 200; p < 400; p++) {
     ASSERT_TRUE(om.map(p).first);
     ASSERT_FALSE(om.map(p).second);
   }
-  ASSERT_EQ(*om.map(312).first, "1.2");
+  ASSERT_EQ(*om.map(312).first, zlog::ObjectId(1, 2));
   for (uint64_t p = 400; p < 600; p++) {
     ASSERT_TRUE(om.map(p).first);
     ASSERT_TRUE(om.map(p).second);
   }
-  ASSERT_EQ(*om.map(412).first, "2.2");
+  ASSERT_EQ(*om.map(412).first, zlog::ObjectId(2, 2));
   ASSERT_FALSE(om.map(600).first);
   ASSERT_FALSE(om.map(601).first);
 }
@@ -261,48 +261,48 @@ TEST(ObjectMapTest, MapD) {
     ASSERT_TRUE(om.map(p).first);
     ASSERT_FALSE(om.map(p).second);
   }
-  ASSERT_EQ(*om.map(75).first, "0.5");
+  ASSERT_EQ(*om.map(75).first, zlog::ObjectId(0, 5));
 
   for (uint64_t p = 100; p < 700; p++) {
     ASSERT_TRUE(om.map(p).first);
     ASSERT_FALSE(om.map(p).second);
   }
-  ASSERT_EQ(*om.map(105).first, "1.5");
-  ASSERT_EQ(*om.map(698).first, "1.18");
-  ASSERT_EQ(*om.map(699).first, "1.19");
+  ASSERT_EQ(*om.map(105).first, zlog::ObjectId(1, 5));
+  ASSERT_EQ(*om.map(698).first, zlog::ObjectId(1, 18));
+  ASSERT_EQ(*om.map(699).first, zlog::ObjectId(1, 19));
 
   for (uint64_t p = 700; p < 1300; p++) {
     ASSERT_TRUE(om.map(p).first);
     ASSERT_FALSE(om.map(p).second);
   }
-  ASSERT_EQ(*om.map(709).first, "2.9");
-  ASSERT_EQ(*om.map(1297).first, "2.17");
-  ASSERT_EQ(*om.map(1299).first, "2.19");
+  ASSERT_EQ(*om.map(709).first, zlog::ObjectId(2, 9));
+  ASSERT_EQ(*om.map(1297).first, zlog::ObjectId(2, 17));
+  ASSERT_EQ(*om.map(1299).first, zlog::ObjectId(2, 19));
 
   for (uint64_t p = 1300; p < 1330; p++) {
     ASSERT_TRUE(om.map(p).first);
     ASSERT_FALSE(om.map(p).second);
   }
-  ASSERT_EQ(*om.map(1300).first, "3.0");
-  ASSERT_EQ(*om.map(1327).first, "3.2");
-  ASSERT_EQ(*om.map(1329).first, "3.4");
+  ASSERT_EQ(*om.map(1300).first, zlog::ObjectId(3, 0));
+  ASSERT_EQ(*om.map(1327).first, zlog::ObjectId(3, 2));
+  ASSERT_EQ(*om.map(1329).first, zlog::ObjectId(3, 4));
 
   for (uint64_t p = 1330; p < 1360; p++) {
     ASSERT_TRUE(om.map(p).first);
     ASSERT_FALSE(om.map(p).second);
   }
-  ASSERT_EQ(*om.map(1330).first, "4.0");
-  ASSERT_EQ(*om.map(1331).first, "4.1");
-  ASSERT_EQ(*om.map(1332).first, "4.2");
-  ASSERT_EQ(*om.map(1359).first, "4.4");
+  ASSERT_EQ(*om.map(1330).first, zlog::ObjectId(4, 0));
+  ASSERT_EQ(*om.map(1331).first, zlog::ObjectId(4, 1));
+  ASSERT_EQ(*om.map(1332).first, zlog::ObjectId(4, 2));
+  ASSERT_EQ(*om.map(1359).first, zlog::ObjectId(4, 4));
 
   for (uint64_t p = 1360; p < 1390; p++) {
     ASSERT_TRUE(om.map(p).first);
     ASSERT_TRUE(om.map(p).second);
   }
-  ASSERT_EQ(*om.map(1360).first, "5.0");
-  ASSERT_EQ(*om.map(1377).first, "5.2");
-  ASSERT_EQ(*om.map(1389).first, "5.4");
+  ASSERT_EQ(*om.map(1360).first, zlog::ObjectId(5, 0));
+  ASSERT_EQ(*om.map(1377).first, zlog::ObjectId(5, 2));
+  ASSERT_EQ(*om.map(1389).first, zlog::ObjectId(5, 4));
 
   ASSERT_FALSE(om.map(1390).first);
   ASSERT_FALSE(om.map(1391).first);
@@ -703,8 +703,8 @@ TEST(ObjectMapTest, MapToSmall) {
     auto objs = om.map_to(0, stripe_id, done);
     ASSERT_TRUE(objs);
     ASSERT_FALSE(done);
-    std::vector<std::pair<std::string, bool>> expected{
-      std::make_pair("0.0", true),
+    std::vector<std::pair<zlog::ObjectId, bool>> expected{
+      std::make_pair(zlog::ObjectId(0, 0), true),
     };
     ASSERT_EQ(*objs, expected);
     ASSERT_EQ(stripe_id, 1u);
@@ -769,8 +769,8 @@ TEST(ObjectMapTest, MapTo) {
     ASSERT_TRUE(objs);
     ASSERT_FALSE(done);
 
-    std::vector<std::pair<std::string, bool>> expected{
-      std::make_pair("0.0", false)
+    std::vector<std::pair<zlog::ObjectId, bool>> expected{
+      std::make_pair(zlog::ObjectId(0, 0), false)
     };
     ASSERT_EQ(*objs, expected);
     ASSERT_EQ(stripe_id, 1u);
@@ -825,9 +825,9 @@ TEST(ObjectMapTest, MapTo) {
     auto objs = om.map_to(1, stripe_id, done);
     ASSERT_TRUE(objs);
     ASSERT_FALSE(done);
-    std::vector<std::pair<std::string, bool>> expected{
-      std::make_pair("0.0", false),
-      std::make_pair("0.1", false)
+    std::vector<std::pair<zlog::ObjectId, bool>> expected{
+      std::make_pair(zlog::ObjectId(0, 0), false),
+      std::make_pair(zlog::ObjectId(0, 1), false)
     };
     ASSERT_EQ(*objs, expected);
     ASSERT_EQ(stripe_id, 1u);
@@ -845,17 +845,17 @@ TEST(ObjectMapTest, MapTo) {
     auto objs = om.map_to(9, stripe_id, done);
     ASSERT_TRUE(objs);
     ASSERT_FALSE(done);
-    std::vector<std::pair<std::string, bool>> expected{
-      std::make_pair("0.0", false),
-      std::make_pair("0.1", false),
-      std::make_pair("0.2", false),
-      std::make_pair("0.3", false),
-      std::make_pair("0.4", false),
-      std::make_pair("0.5", false),
-      std::make_pair("0.6", false),
-      std::make_pair("0.7", false),
-      std::make_pair("0.8", false),
-      std::make_pair("0.9", false),
+    std::vector<std::pair<zlog::ObjectId, bool>> expected{
+      std::make_pair(zlog::ObjectId(0, 0), false),
+      std::make_pair(zlog::ObjectId(0, 1), false),
+      std::make_pair(zlog::ObjectId(0, 2), false),
+      std::make_pair(zlog::ObjectId(0, 3), false),
+      std::make_pair(zlog::ObjectId(0, 4), false),
+      std::make_pair(zlog::ObjectId(0, 5), false),
+      std::make_pair(zlog::ObjectId(0, 6), false),
+      std::make_pair(zlog::ObjectId(0, 7), false),
+      std::make_pair(zlog::ObjectId(0, 8), false),
+      std::make_pair(zlog::ObjectId(0, 9), false),
     };
     ASSERT_EQ(*objs, expected);
     ASSERT_EQ(stripe_id, 1u);
@@ -873,17 +873,17 @@ TEST(ObjectMapTest, MapTo) {
     auto objs = om.map_to(10, stripe_id, done);
     ASSERT_TRUE(objs);
     ASSERT_FALSE(done);
-    std::vector<std::pair<std::string, bool>> expected{
-      std::make_pair("0.0", false),
-      std::make_pair("0.1", false),
-      std::make_pair("0.2", false),
-      std::make_pair("0.3", false),
-      std::make_pair("0.4", false),
-      std::make_pair("0.5", false),
-      std::make_pair("0.6", false),
-      std::make_pair("0.7", false),
-      std::make_pair("0.8", false),
-      std::make_pair("0.9", false),
+    std::vector<std::pair<zlog::ObjectId, bool>> expected{
+      std::make_pair(zlog::ObjectId(0, 0), false),
+      std::make_pair(zlog::ObjectId(0, 1), false),
+      std::make_pair(zlog::ObjectId(0, 2), false),
+      std::make_pair(zlog::ObjectId(0, 3), false),
+      std::make_pair(zlog::ObjectId(0, 4), false),
+      std::make_pair(zlog::ObjectId(0, 5), false),
+      std::make_pair(zlog::ObjectId(0, 6), false),
+      std::make_pair(zlog::ObjectId(0, 7), false),
+      std::make_pair(zlog::ObjectId(0, 8), false),
+      std::make_pair(zlog::ObjectId(0, 9), false),
     };
     ASSERT_EQ(*objs, expected);
     ASSERT_EQ(stripe_id, 1u);
@@ -901,17 +901,17 @@ TEST(ObjectMapTest, MapTo) {
     auto objs = om.map_to(47, stripe_id, done);
     ASSERT_TRUE(objs);
     ASSERT_FALSE(done);
-    std::vector<std::pair<std::string, bool>> expected{
-      std::make_pair("0.0", false),
-      std::make_pair("0.1", false),
-      std::make_pair("0.2", false),
-      std::make_pair("0.3", false),
-      std::make_pair("0.4", false),
-      std::make_pair("0.5", false),
-      std::make_pair("0.6", false),
-      std::make_pair("0.7", false),
-      std::make_pair("0.8", false),
-      std::make_pair("0.9", false),
+    std::vector<std::pair<zlog::ObjectId, bool>> expected{
+      std::make_pair(zlog::ObjectId(0, 0), false),
+      std::make_pair(zlog::ObjectId(0, 1), false),
+      std::make_pair(zlog::ObjectId(0, 2), false),
+      std::make_pair(zlog::ObjectId(0, 3), false),
+      std::make_pair(zlog::ObjectId(0, 4), false),
+      std::make_pair(zlog::ObjectId(0, 5), false),
+      std::make_pair(zlog::ObjectId(0, 6), false),
+      std::make_pair(zlog::ObjectId(0, 7), false),
+      std::make_pair(zlog::ObjectId(0, 8), false),
+      std::make_pair(zlog::ObjectId(0, 9), false),
     };
     ASSERT_EQ(*objs, expected);
     ASSERT_EQ(stripe_id, 1u);
@@ -929,17 +929,17 @@ TEST(ObjectMapTest, MapTo) {
     auto objs = om.map_to(90, stripe_id, done);
     ASSERT_TRUE(objs);
     ASSERT_FALSE(done);
-    std::vector<std::pair<std::string, bool>> expected{
-      std::make_pair("0.0", true),
-      std::make_pair("0.1", false),
-      std::make_pair("0.2", false),
-      std::make_pair("0.3", false),
-      std::make_pair("0.4", false),
-      std::make_pair("0.5", false),
-      std::make_pair("0.6", false),
-      std::make_pair("0.7", false),
-      std::make_pair("0.8", false),
-      std::make_pair("0.9", false),
+    std::vector<std::pair<zlog::ObjectId, bool>> expected{
+      std::make_pair(zlog::ObjectId(0, 0), true),
+      std::make_pair(zlog::ObjectId(0, 1), false),
+      std::make_pair(zlog::ObjectId(0, 2), false),
+      std::make_pair(zlog::ObjectId(0, 3), false),
+      std::make_pair(zlog::ObjectId(0, 4), false),
+      std::make_pair(zlog::ObjectId(0, 5), false),
+      std::make_pair(zlog::ObjectId(0, 6), false),
+      std::make_pair(zlog::ObjectId(0, 7), false),
+      std::make_pair(zlog::ObjectId(0, 8), false),
+      std::make_pair(zlog::ObjectId(0, 9), false),
     };
     ASSERT_EQ(*objs, expected);
     ASSERT_EQ(stripe_id, 1u);
@@ -957,17 +957,17 @@ TEST(ObjectMapTest, MapTo) {
     auto objs = om.map_to(95, stripe_id, done);
     ASSERT_TRUE(objs);
     ASSERT_FALSE(done);
-    std::vector<std::pair<std::string, bool>> expected{
-      std::make_pair("0.0", true),
-      std::make_pair("0.1", true),
-      std::make_pair("0.2", true),
-      std::make_pair("0.3", true),
-      std::make_pair("0.4", true),
-      std::make_pair("0.5", true),
-      std::make_pair("0.6", false),
-      std::make_pair("0.7", false),
-      std::make_pair("0.8", false),
-      std::make_pair("0.9", false),
+    std::vector<std::pair<zlog::ObjectId, bool>> expected{
+      std::make_pair(zlog::ObjectId(0, 0), true),
+      std::make_pair(zlog::ObjectId(0, 1), true),
+      std::make_pair(zlog::ObjectId(0, 2), true),
+      std::make_pair(zlog::ObjectId(0, 3), true),
+      std::make_pair(zlog::ObjectId(0, 4), true),
+      std::make_pair(zlog::ObjectId(0, 5), true),
+      std::make_pair(zlog::ObjectId(0, 6), false),
+      std::make_pair(zlog::ObjectId(0, 7), false),
+      std::make_pair(zlog::ObjectId(0, 8), false),
+      std::make_pair(zlog::ObjectId(0, 9), false),
     };
     ASSERT_EQ(*objs, expected);
     ASSERT_EQ(stripe_id, 1u);
@@ -985,17 +985,17 @@ TEST(ObjectMapTest, MapTo) {
     auto objs = om.map_to(99, stripe_id, done);
     ASSERT_TRUE(objs);
     ASSERT_FALSE(done);
-    std::vector<std::pair<std::string, bool>> expected{
-      std::make_pair("0.0", true),
-      std::make_pair("0.1", true),
-      std::make_pair("0.2", true),
-      std::make_pair("0.3", true),
-      std::make_pair("0.4", true),
-      std::make_pair("0.5", true),
-      std::make_pair("0.6", true),
-      std::make_pair("0.7", true),
-      std::make_pair("0.8", true),
-      std::make_pair("0.9", true),
+    std::vector<std::pair<zlog::ObjectId, bool>> expected{
+      std::make_pair(zlog::ObjectId(0, 0), true),
+      std::make_pair(zlog::ObjectId(0, 1), true),
+      std::make_pair(zlog::ObjectId(0, 2), true),
+      std::make_pair(zlog::ObjectId(0, 3), true),
+      std::make_pair(zlog::ObjectId(0, 4), true),
+      std::make_pair(zlog::ObjectId(0, 5), true),
+      std::make_pair(zlog::ObjectId(0, 6), true),
+      std::make_pair(zlog::ObjectId(0, 7), true),
+      std::make_pair(zlog::ObjectId(0, 8), true),
+      std::make_pair(zlog::ObjectId(0, 9), true),
     };
     ASSERT_EQ(*objs, expected);
     ASSERT_EQ(stripe_id, 1u);
@@ -1013,17 +1013,17 @@ TEST(ObjectMapTest, MapTo) {
     auto objs = om.map_to(100, stripe_id, done);
     ASSERT_TRUE(objs);
     ASSERT_FALSE(done);
-    std::vector<std::pair<std::string, bool>> expected0{
-      std::make_pair("0.0", true),
-      std::make_pair("0.1", true),
-      std::make_pair("0.2", true),
-      std::make_pair("0.3", true),
-      std::make_pair("0.4", true),
-      std::make_pair("0.5", true),
-      std::make_pair("0.6", true),
-      std::make_pair("0.7", true),
-      std::make_pair("0.8", true),
-      std::make_pair("0.9", true),
+    std::vector<std::pair<zlog::ObjectId, bool>> expected0{
+      std::make_pair(zlog::ObjectId(0, 0), true),
+      std::make_pair(zlog::ObjectId(0, 1), true),
+      std::make_pair(zlog::ObjectId(0, 2), true),
+      std::make_pair(zlog::ObjectId(0, 3), true),
+      std::make_pair(zlog::ObjectId(0, 4), true),
+      std::make_pair(zlog::ObjectId(0, 5), true),
+      std::make_pair(zlog::ObjectId(0, 6), true),
+      std::make_pair(zlog::ObjectId(0, 7), true),
+      std::make_pair(zlog::ObjectId(0, 8), true),
+      std::make_pair(zlog::ObjectId(0, 9), true),
     };
     ASSERT_EQ(*objs, expected0);
     ASSERT_EQ(stripe_id, 1u);
@@ -1032,8 +1032,8 @@ TEST(ObjectMapTest, MapTo) {
     objs = om.map_to(100, stripe_id, done);
     ASSERT_TRUE(objs);
     ASSERT_FALSE(done);
-    std::vector<std::pair<std::string, bool>> expected1{
-      std::make_pair("1.0", false),
+    std::vector<std::pair<zlog::ObjectId, bool>> expected1{
+      std::make_pair(zlog::ObjectId(1, 0), false),
     };
     ASSERT_EQ(*objs, expected1);
     ASSERT_EQ(stripe_id, 2u);
@@ -1045,27 +1045,27 @@ TEST(ObjectMapTest, MapTo) {
     auto objs = om.map_to(1298, stripe_id, done);
     ASSERT_TRUE(objs);
     ASSERT_FALSE(done);
-    std::vector<std::pair<std::string, bool>> expected0{
-      std::make_pair("2.0", true),
-      std::make_pair("2.1", true),
-      std::make_pair("2.2", true),
-      std::make_pair("2.3", true),
-      std::make_pair("2.4", true),
-      std::make_pair("2.5", true),
-      std::make_pair("2.6", true),
-      std::make_pair("2.7", true),
-      std::make_pair("2.8", true),
-      std::make_pair("2.9", true),
-      std::make_pair("2.10", true),
-      std::make_pair("2.11", true),
-      std::make_pair("2.12", true),
-      std::make_pair("2.13", true),
-      std::make_pair("2.14", true),
-      std::make_pair("2.15", true),
-      std::make_pair("2.16", true),
-      std::make_pair("2.17", true),
-      std::make_pair("2.18", true),
-      std::make_pair("2.19", false),
+    std::vector<std::pair<zlog::ObjectId, bool>> expected0{
+      std::make_pair(zlog::ObjectId(2, 0), true),
+      std::make_pair(zlog::ObjectId(2, 1), true),
+      std::make_pair(zlog::ObjectId(2, 2), true),
+      std::make_pair(zlog::ObjectId(2, 3), true),
+      std::make_pair(zlog::ObjectId(2, 4), true),
+      std::make_pair(zlog::ObjectId(2, 5), true),
+      std::make_pair(zlog::ObjectId(2, 6), true),
+      std::make_pair(zlog::ObjectId(2, 7), true),
+      std::make_pair(zlog::ObjectId(2, 8), true),
+      std::make_pair(zlog::ObjectId(2, 9), true),
+      std::make_pair(zlog::ObjectId(2, 10), true),
+      std::make_pair(zlog::ObjectId(2, 11), true),
+      std::make_pair(zlog::ObjectId(2, 12), true),
+      std::make_pair(zlog::ObjectId(2, 13), true),
+      std::make_pair(zlog::ObjectId(2, 14), true),
+      std::make_pair(zlog::ObjectId(2, 15), true),
+      std::make_pair(zlog::ObjectId(2, 16), true),
+      std::make_pair(zlog::ObjectId(2, 17), true),
+      std::make_pair(zlog::ObjectId(2, 18), true),
+      std::make_pair(zlog::ObjectId(2, 19), false),
     };
     ASSERT_EQ(*objs, expected0);
     ASSERT_EQ(stripe_id, 3u);
@@ -1078,27 +1078,27 @@ TEST(ObjectMapTest, MapTo) {
     auto objs = om.map_to(1301, stripe_id, done);
     ASSERT_TRUE(objs);
     ASSERT_FALSE(done);
-    std::vector<std::pair<std::string, bool>> expected0{
-      std::make_pair("2.0", true),
-      std::make_pair("2.1", true),
-      std::make_pair("2.2", true),
-      std::make_pair("2.3", true),
-      std::make_pair("2.4", true),
-      std::make_pair("2.5", true),
-      std::make_pair("2.6", true),
-      std::make_pair("2.7", true),
-      std::make_pair("2.8", true),
-      std::make_pair("2.9", true),
-      std::make_pair("2.10", true),
-      std::make_pair("2.11", true),
-      std::make_pair("2.12", true),
-      std::make_pair("2.13", true),
-      std::make_pair("2.14", true),
-      std::make_pair("2.15", true),
-      std::make_pair("2.16", true),
-      std::make_pair("2.17", true),
-      std::make_pair("2.18", true),
-      std::make_pair("2.19", true),
+    std::vector<std::pair<zlog::ObjectId, bool>> expected0{
+      std::make_pair(zlog::ObjectId(2, 0), true),
+      std::make_pair(zlog::ObjectId(2, 1), true),
+      std::make_pair(zlog::ObjectId(2, 2), true),
+      std::make_pair(zlog::ObjectId(2, 3), true),
+      std::make_pair(zlog::ObjectId(2, 4), true),
+      std::make_pair(zlog::ObjectId(2, 5), true),
+      std::make_pair(zlog::ObjectId(2, 6), true),
+      std::make_pair(zlog::ObjectId(2, 7), true),
+      std::make_pair(zlog::ObjectId(2, 8), true),
+      std::make_pair(zlog::ObjectId(2, 9), true),
+      std::make_pair(zlog::ObjectId(2, 10), true),
+      std::make_pair(zlog::ObjectId(2, 11), true),
+      std::make_pair(zlog::ObjectId(2, 12), true),
+      std::make_pair(zlog::ObjectId(2, 13), true),
+      std::make_pair(zlog::ObjectId(2, 14), true),
+      std::make_pair(zlog::ObjectId(2, 15), true),
+      std::make_pair(zlog::ObjectId(2, 16), true),
+      std::make_pair(zlog::ObjectId(2, 17), true),
+      std::make_pair(zlog::ObjectId(2, 18), true),
+      std::make_pair(zlog::ObjectId(2, 19), true),
     };
     ASSERT_EQ(*objs, expected0);
     ASSERT_EQ(stripe_id, 3u);
@@ -1107,9 +1107,9 @@ TEST(ObjectMapTest, MapTo) {
     objs = om.map_to(1301, stripe_id, done);
     ASSERT_TRUE(objs);
     ASSERT_FALSE(done);
-    std::vector<std::pair<std::string, bool>> expected1{
-      std::make_pair("3.0", false),
-      std::make_pair("3.1", false),
+    std::vector<std::pair<zlog::ObjectId, bool>> expected1{
+      std::make_pair(zlog::ObjectId(3, 0), false),
+      std::make_pair(zlog::ObjectId(3, 1), false),
     };
     ASSERT_EQ(*objs, expected1);
     ASSERT_EQ(stripe_id, 4u);
@@ -1121,27 +1121,27 @@ TEST(ObjectMapTest, MapTo) {
     auto objs = om.map_to(1388, stripe_id, done);
     ASSERT_TRUE(objs);
     ASSERT_FALSE(done);
-    std::vector<std::pair<std::string, bool>> expected0{
-      std::make_pair("2.0", true),
-      std::make_pair("2.1", true),
-      std::make_pair("2.2", true),
-      std::make_pair("2.3", true),
-      std::make_pair("2.4", true),
-      std::make_pair("2.5", true),
-      std::make_pair("2.6", true),
-      std::make_pair("2.7", true),
-      std::make_pair("2.8", true),
-      std::make_pair("2.9", true),
-      std::make_pair("2.10", true),
-      std::make_pair("2.11", true),
-      std::make_pair("2.12", true),
-      std::make_pair("2.13", true),
-      std::make_pair("2.14", true),
-      std::make_pair("2.15", true),
-      std::make_pair("2.16", true),
-      std::make_pair("2.17", true),
-      std::make_pair("2.18", true),
-      std::make_pair("2.19", true),
+    std::vector<std::pair<zlog::ObjectId, bool>> expected0{
+      std::make_pair(zlog::ObjectId(2, 0), true),
+      std::make_pair(zlog::ObjectId(2, 1), true),
+      std::make_pair(zlog::ObjectId(2, 2), true),
+      std::make_pair(zlog::ObjectId(2, 3), true),
+      std::make_pair(zlog::ObjectId(2, 4), true),
+      std::make_pair(zlog::ObjectId(2, 5), true),
+      std::make_pair(zlog::ObjectId(2, 6), true),
+      std::make_pair(zlog::ObjectId(2, 7), true),
+      std::make_pair(zlog::ObjectId(2, 8), true),
+      std::make_pair(zlog::ObjectId(2, 9), true),
+      std::make_pair(zlog::ObjectId(2, 10), true),
+      std::make_pair(zlog::ObjectId(2, 11), true),
+      std::make_pair(zlog::ObjectId(2, 12), true),
+      std::make_pair(zlog::ObjectId(2, 13), true),
+      std::make_pair(zlog::ObjectId(2, 14), true),
+      std::make_pair(zlog::ObjectId(2, 15), true),
+      std::make_pair(zlog::ObjectId(2, 16), true),
+      std::make_pair(zlog::ObjectId(2, 17), true),
+      std::make_pair(zlog::ObjectId(2, 18), true),
+      std::make_pair(zlog::ObjectId(2, 19), true),
     };
     ASSERT_EQ(*objs, expected0);
     ASSERT_EQ(stripe_id, 3u);
@@ -1151,12 +1151,12 @@ TEST(ObjectMapTest, MapTo) {
     objs = om.map_to(1388, stripe_id, done);
     ASSERT_TRUE(objs);
     ASSERT_FALSE(done);
-    std::vector<std::pair<std::string, bool>> expected1{
-      std::make_pair("5.0", true),
-      std::make_pair("5.1", true),
-      std::make_pair("5.2", true),
-      std::make_pair("5.3", true),
-      std::make_pair("5.4", false),
+    std::vector<std::pair<zlog::ObjectId, bool>> expected1{
+      std::make_pair(zlog::ObjectId(5, 0), true),
+      std::make_pair(zlog::ObjectId(5, 1), true),
+      std::make_pair(zlog::ObjectId(5, 2), true),
+      std::make_pair(zlog::ObjectId(5, 3), true),
+      std::make_pair(zlog::ObjectId(5, 4), false),
     };
     ASSERT_EQ(*objs, expected1);
     ASSERT_EQ(stripe_id, 6u);
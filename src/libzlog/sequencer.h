@@ -21,6 +21,11 @@ class Sequencer {
     }
   }
 
+  // reserve count consecutive positions, returning the first.
+  uint64_t reserve(uint64_t count) {
+    return position_.fetch_add(count);
+  }
+
   // TODO: why?
   uint64_t epoch() const {
     return epoch_;
@@ -1,29 +1,31 @@
 #include "stripe.h"
-#include <sstream>
 
 namespace zlog {
 
-std::string Stripe::make_oid(uint64_t stripe_id, uint32_t index)
+std::string ObjectId::str() const
 {
-  std::stringstream oid;
-  oid << stripe_id << "." << index;
-  return oid.str();
+  return std::to_string(stripe_id) + "." + std::to_string(index);
 }
 
-std::string Stripe::make_oid(uint64_t stripe_id, uint32_t width, uint64_t position)
+std::ostream& operator<<(std::ostream& out, const ObjectId& oid)
 {
-  auto index = position % width;
-  return make_oid(stripe_id, index);
+  out << oid.stripe_id << "." << oid.index;
+  return out;
 }
 
-std::vector<std::string> Stripe::make_oids(const uint64_t stripe_id,
+ObjectId Stripe::make_oid(uint64_t stripe_id, uint32_t width, uint64_t position)
+{
+  return ObjectId(stripe_id, position % width);
+}
+
+std::vector<ObjectId> Stripe::make_oids(const uint64_t stripe_id,
     const uint32_t width)
 {
-  std::vector<std::string> oids;
+  std::vector<ObjectId> oids;
   oids.reserve(width);
 
   for (uint32_t i = 0; i < width; i++) {
-    oids.emplace_back(make_oid(stripe_id, i));
+    oids.emplace_back(stripe_id, i);
   }
 
   return oids;
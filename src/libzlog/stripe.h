@@ -1,5 +1,6 @@
 #pragma once
 #include <cassert>
+#include <ostream>
 #include <string>
 #include <vector>
 #include "libzlog/zlog_generated.h"
@@ -7,6 +8,42 @@
 
 namespace zlog {
 
+// ObjectId identifies a log object by the stripe it belongs to and its index
+// within that stripe. Object names are only materialized when a request is
+// handed to the backend (see LogBackend).
+struct ObjectId {
+  ObjectId() :
+    stripe_id(0),
+    index(0)
+  {}
+
+  ObjectId(uint64_t stripe_id, uint32_t index) :
+    stripe_id(stripe_id),
+    index(index)
+  {}
+
+  // the object name relative to the log's object prefix (e.g. "3.1")
+  std::string str() const;
+
+  bool operator==(const ObjectId& other) const {
+    return stripe_id == other.stripe_id && index == other.index;
+  }
+
+  bool operator!=(const ObjectId& other) const {
+    return !this->operator==(other);
+  }
+
+  bool operator<(const ObjectId& other) const {
+    return stripe_id < other.stripe_id ||
+      (stripe_id == other.stripe_id && index < other.index);
+  }
+
+  uint64_t stripe_id;
+  uint32_t index;
+};
+
+std::ostream& operator<<(std::ostream& out, const ObjectId& oid);
+
 // Stripe describes the storage layout of a contiguous range of log positions.
 // It also serves as the granularity at which log configuration changes are
 // managed. Because a log may have an unbounded number of stripes it is not
@@ -52,9 +89,13 @@ class Stripe {
   Stripe& operator=(Stripe&& other) = default;
 
  public:
-  static std::string make_oid(uint64_t stripe_id, uint32_t width,
+  static ObjectId make_oid(uint64_t stripe_id, uint32_t width,
       uint64_t position);
 
+  uint64_t id() const {
+    return stripe_id_;
+  }
+
   uint64_t min_position() const {
     return min_position_;
   }
@@ -67,7 +108,7 @@ class Stripe {
     return width_;
   }
 
-  const std::vector<std::string>& oids() const {
+  const std::vector<ObjectId>& oids() const {
     return oids_;
   }
 
@@ -85,16 +126,13 @@ class Stripe {
   }
 
  private:
-  // index is the pre-computed value: position % stripe-width
-  static std::string make_oid(uint64_t stripe_id, uint32_t index);
-
-  static std::vector<std::string> make_oids(uint64_t stripe_id, uint32_t width);
+  static std::vector<ObjectId> make_oids(uint64_t stripe_id, uint32_t width);
 
   uint64_t stripe_id_;
   uint32_t width_;
   uint64_t min_position_;
   uint64_t max_position_;
-  std::vector<std::string> oids_;
+  std::vector<ObjectId> oids_;
 };
 
 // MultiStripe is a compact representation of adjancent Stripe objects in the
@@ -165,9 +203,9 @@ class MultiStripe {
   nlohmann::json dump() const;
 
  public:
-  // given a stripe id and a position, compute the name of the object that the
-  // position maps to. the stripe id _must_ be represented by this MultiStripe.
-  std::string map(uint64_t stripe_id, uint64_t position) const {
+  // given a stripe id and a position, compute the object that the position
+  // maps to. the stripe id _must_ be represented by this MultiStripe.
+  ObjectId map(uint64_t stripe_id, uint64_t position) const {
     assert(base_id_ <= stripe_id);
     assert(stripe_id <= max_stripe_id());
     assert(min_position_ <= position);
@@ -219,8 +257,8 @@ class MultiStripe {
         max_position_ + (uint64_t)width_ * slots_);
   }
 
-  // construct a stripe object given its stripe id. this is an expensive
-  // operation since it pre-computes all of the object names.
+  // construct a stripe object given its stripe id. this allocates the list of
+  // object ids for the stripe, so avoid it on hot paths.
   Stripe stripe_by_id(uint64_t stripe_id) const {
     assert(base_id() <= stripe_id);
     assert(stripe_id <= max_stripe_id());
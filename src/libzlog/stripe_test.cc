@@ -44,25 +44,37 @@ TEST(StripeTest, Basic) {
   ASSERT_EQ(s.width(), 1u);
   ASSERT_EQ(s.min_position(), 0u);
   ASSERT_EQ(s.max_position(), 3u);
-  ASSERT_EQ(s.oids(), std::vector<std::string>{"0.0"});
+  ASSERT_EQ(s.oids(), std::vector<zlog::ObjectId>{zlog::ObjectId(0, 0)});
 
   s = zlog::Stripe(1, 2, 3, 4);
   ASSERT_EQ(s.width(), 2u);
   ASSERT_EQ(s.min_position(), 3u);
   ASSERT_EQ(s.max_position(), 4u);
-  ASSERT_EQ(s.oids(), std::vector<std::string>({"1.0","1.1"}));
+  ASSERT_EQ(s.oids(), std::vector<zlog::ObjectId>({
+        zlog::ObjectId(1, 0), zlog::ObjectId(1, 1)}));
 
   s = zlog::Stripe(6, 3, 4, 9);
   ASSERT_EQ(s.width(), 3u);
   ASSERT_EQ(s.min_position(), 4u);
   ASSERT_EQ(s.max_position(), 9u);
-  ASSERT_EQ(s.oids(), std::vector<std::string>({"6.0", "6.1", "6.2"}));
+  ASSERT_EQ(s.oids(), std::vector<zlog::ObjectId>({
+        zlog::ObjectId(6, 0), zlog::ObjectId(6, 1), zlog::ObjectId(6, 2)}));
 }
 
 TEST(StripeTest, MakeOID) {
   ASSERT_EQ(
       zlog::Stripe::make_oid(33, 44, 101),
-      "33.13");
+      zlog::ObjectId(33, 13));
+}
+
+TEST(StripeTest, ObjectId) {
+  ASSERT_EQ(zlog::ObjectId(0, 0).str(), "0.0");
+  ASSERT_EQ(zlog::ObjectId(33, 13).str(), "33.13");
+
+  ASSERT_EQ(zlog::ObjectId(1, 2), zlog::ObjectId(1, 2));
+  ASSERT_NE(zlog::ObjectId(1, 2), zlog::ObjectId(2, 1));
+  ASSERT_LT(zlog::ObjectId(1, 2), zlog::ObjectId(2, 1));
+  ASSERT_LT(zlog::ObjectId(2, 0), zlog::ObjectId(2, 1));
 }
 
 TEST(StripeTest, Equality) {
@@ -312,15 +324,15 @@ TEST(MultiStripeTest, Basic) {
 TEST(MultiStripeTest, Map) {
   ASSERT_EQ(
     zlog::MultiStripe(0, 10, 10, 0, 1, 99).map(0, 0),
-    "0.0");
+    zlog::ObjectId(0, 0));
 
   ASSERT_EQ(
     zlog::MultiStripe(10, 10, 10, 1000, 1, 1099).map(10, 1077),
-    "10.7");
+    zlog::ObjectId(10, 7));
 
   ASSERT_EQ(
     zlog::MultiStripe(10, 10, 10, 1000, 2, 1199).map(11, 1077),
-    "11.7");
+    zlog::ObjectId(11, 7));
 }
 
 TEST(MultiStripeTest, Extend) {
@@ -1,3 +1,4 @@
+#include <limits>
 #include <numeric>
 #include <deque>
 #include "libzlog/log_impl.h"
@@ -9,7 +10,7 @@
 
 TEST_P(LibZLogTest, OpenClose) {
   // TODO: we should... reverify this is true for at least ceph
-  if (backend() != "lmdb") {
+  if (backend() != "lmdb" && backend() != "segment") {
     std::cout << "OpenClose test not enabled for "
       << backend() << " backend" << std::endl;
     return;
@@ -50,6 +51,116 @@ TEST_P(LibZLogTest, OpenClose) {
   ASSERT_EQ(input, output);
 }
 
+// the tail hint maps to an earlier stripe than the tail. a new sequencer seals
+// every stripe from the hinted one up, and finds the tail in a later one.
+TEST_P(ZLogTest, OpenClose_TailHintBehindTail) {
+  options.stripe_width = 5;
+  options.stripe_slots = 10;
+  DoSetUp();
+
+  if (backend() != "lmdb" && backend() != "segment") {
+    std::cout << "OpenClose test not enabled for "
+      << backend() << " backend" << std::endl;
+    return;
+  }
+
+  auto *li = (zlog::LogImpl*)log;
+
+  for (unsigned i = 0; i < 5; i++) {
+    int ret = log->Append("asdf", nullptr);
+    ASSERT_EQ(ret, 0);
+  }
+
+  // map five stripes now, so appends below don't expand the mapping, which
+  // would refresh the hint
+  int ret = li->view_mgr->try_expand_view(249);
+  ASSERT_EQ(ret, 0);
+
+  uint64_t last;
+  for (unsigned i = 5; i < 155; i++) {
+    ret = log->Append("asdf", &last);
+    ASSERT_EQ(ret, 0);
+  }
+
+  // the hint is in the first stripe, and the tail in the fourth
+  const auto view = li->view_mgr->view();
+  ASSERT_TRUE(view->tail_hint());
+  ASSERT_LT(*view->tail_hint(), 50u);
+  ASSERT_GE(last, 150u);
+  ASSERT_LT(last, 200u);
+
+  ret = reopen();
+  ASSERT_EQ(ret, 0);
+
+  uint64_t tail;
+  ret = log->CheckTail(&tail);
+  ASSERT_EQ(ret, 0);
+  ASSERT_EQ(tail, last + 1);
+
+  uint64_t pos;
+  ret = log->Append("asdf", &pos);
+  ASSERT_EQ(ret, 0);
+  ASSERT_EQ(pos, last + 1);
+}
+
+// the tail hint is a position that was handed out but never written, so the
+// hinted stripe and every stripe after it are empty. a new sequencer finds the
+// tail by scanning backward from the hinted stripe.
+TEST_P(ZLogTest, OpenClose_TailHintNotWritten) {
+  options.stripe_width = 5;
+  options.stripe_slots = 10;
+  DoSetUp();
+
+  if (backend() != "lmdb" && backend() != "segment") {
+    std::cout << "OpenClose test not enabled for "
+      << backend() << " backend" << std::endl;
+    return;
+  }
+
+  auto *li = (zlog::LogImpl*)log;
+
+  uint64_t last;
+  for (unsigned i = 0; i < 55; i++) {
+    int ret = log->Append("asdf", &last);
+    ASSERT_EQ(ret, 0);
+  }
+  ASSERT_LT(last, 100u);
+
+  // hand out positions up to 179 without writing them
+  auto seq = li->view_mgr->view()->seq;
+  ASSERT_TRUE(seq);
+  while (seq->check_tail(false) < 180) {
+    seq->check_tail(true);
+  }
+
+  // the sequencer records the last position handed out when it expands the
+  // mapping
+  int ret = li->view_mgr->try_expand_view(249);
+  ASSERT_EQ(ret, 0);
+
+  const auto view = li->view_mgr->view();
+  ASSERT_TRUE(view->tail_hint());
+  ASSERT_EQ(*view->tail_hint(), 179u);
+
+  ret = reopen();
+  ASSERT_EQ(ret, 0);
+
+  uint64_t tail;
+  ret = log->CheckTail(&tail);
+  ASSERT_EQ(ret, 0);
+  ASSERT_EQ(tail, last + 1);
+
+  uint64_t pos;
+  ret = log->Append("asdf", &pos);
+  ASSERT_EQ(ret, 0);
+  ASSERT_EQ(pos, last + 1);
+
+  std::string entry;
+  ret = log->Read(last, &entry);
+  ASSERT_EQ(ret, 0);
+  ASSERT_EQ(entry, "asdf");
+}
+
 /*
  * Use a log name other than `mylog` below because the test fixture
  * automatically creates a log with that name before the test is run. The other
@@ -159,6 +270,53 @@ TEST_P(LibZLogTest, Append) {
   ASSERT_GT(pos2, pos);
 }
 
+TEST_P(LibZLogTest, AppendBatch) {
+  std::vector<uint64_t> positions;
+  int ret = log->appendBatch(std::vector<std::string>(), &positions);
+  ASSERT_EQ(ret, -EINVAL);
+
+  // enough entries to span multiple stripes
+  std::vector<std::string> batch;
+  for (int i = 0; i < 200; i++) {
+    batch.push_back("entry." + std::to_string(i));
+  }
+
+  for (int round = 0; round < 3; round++) {
+    ret = log->appendBatch(batch, &positions);
+    ASSERT_EQ(ret, 0);
+    ASSERT_EQ(positions.size(), batch.size());
+
+    for (size_t i = 0; i < batch.size(); i++) {
+      std::string entry;
+      ret = log->Read(positions[i], &entry);
+      ASSERT_EQ(ret, 0);
+      ASSERT_EQ(entry, batch[i]);
+    }
+  }
+
+  // relocate entries whose reserved positions are taken
+  uint64_t tail;
+  ret = log->CheckTail(&tail);
+  ASSERT_EQ(ret, 0);
+  ASSERT_EQ(log->Fill(tail + 1), 0);
+  ASSERT_EQ(log->Fill(tail + 3), 0);
+
+  ret = log->appendBatch(batch, &positions);
+  ASSERT_EQ(ret, 0);
+  ASSERT_EQ(positions.size(), batch.size());
+  std::set<uint64_t> unique(positions.begin(), positions.end());
+  ASSERT_EQ(unique.size(), batch.size());
+  ASSERT_EQ(unique.count(tail + 1), 0u);
+  ASSERT_EQ(unique.count(tail + 3), 0u);
+
+  for (size_t i = 0; i < batch.size(); i++) {
+    std::string entry;
+    ret = log->Read(positions[i], &entry);
+    ASSERT_EQ(ret, 0);
+    ASSERT_EQ(entry, batch[i]);
+  }
+}
+
 TEST_P(LibZLogTest, Fill) {
   int ret = log->Fill(0);
   ASSERT_EQ(ret, 0);
@@ -228,6 +386,165 @@ TEST_P(LibZLogTest, Read) {
   ASSERT_EQ(ret, -ENODATA);
 }
 
+TEST_P(LibZLogTest, ReadSlice) {
+  zlog::Slice entry;
+  int ret = log->ReadSlice(0, &entry);
+  ASSERT_EQ(ret, -ENOENT);
+
+  ret = log->Fill(0);
+  ASSERT_EQ(ret, 0);
+
+  ret = log->ReadSlice(0, &entry);
+  ASSERT_EQ(ret, -ENODATA);
+
+  const std::string input(1 << 16, 'x');
+  uint64_t pos;
+  ret = log->Append(input, &pos);
+  ASSERT_EQ(ret, 0);
+
+  // read twice, so that the second read may be served from the cache
+  for (int i = 0; i < 2; i++) {
+    ret = log->ReadSlice(pos, &entry);
+    ASSERT_EQ(ret, 0);
+    ASSERT_EQ(entry.ToString(), input);
+  }
+
+  // the slice outlives the entry
+  ret = log->Trim(pos);
+  ASSERT_EQ(ret, 0);
+  zlog::Slice trimmed;
+  ret = log->ReadSlice(pos, &trimmed);
+  ASSERT_EQ(ret, -ENODATA);
+  ASSERT_EQ(entry.ToString(), input);
+}
+
+TEST_P(LibZLogTest, Iterator) {
+  zlog::Log::Iterator *it;
+  ASSERT_EQ(log->NewIterator(10, 9, &it), -EINVAL);
+
+  // empty log
+  ASSERT_EQ(log->NewIterator(0, 1000, &it), 0);
+  it->SeekToFirst();
+  ASSERT_FALSE(it->Valid());
+  ASSERT_EQ(it->status(), -ENOENT);
+  it->SeekToLast();
+  ASSERT_FALSE(it->Valid());
+  delete it;
+
+  // enough entries to span multiple stripes
+  std::map<uint64_t, std::string> entries;
+  for (int i = 0; i < 300; i++) {
+    uint64_t pos;
+    const auto data = "entry." + std::to_string(i);
+    ASSERT_EQ(log->Append(data, &pos), 0);
+    entries[pos] = data;
+  }
+
+  // filled and trimmed positions are skipped
+  uint64_t tail;
+  ASSERT_EQ(log->CheckTail(&tail), 0);
+  ASSERT_EQ(log->Fill(tail), 0);
+  ASSERT_EQ(log->CheckTail(&tail), 0);
+  for (auto pos : {entries.begin()->first + 3, entries.rbegin()->first - 7}) {
+    ASSERT_EQ(log->Trim(pos), 0);
+    entries.erase(pos);
+  }
+
+  // start at the first entry. depending on how the log was initialized there
+  // may be unwritten positions before it.
+  ASSERT_EQ(log->NewIterator(entries.begin()->first,
+        std::numeric_limits<uint64_t>::max(), &it), 0);
+
+  auto expected = entries.begin();
+  for (it->SeekToFirst(); it->Valid(); it->Next()) {
+    ASSERT_TRUE(expected != entries.end());
+    ASSERT_EQ(it->position(), expected->first);
+    ASSERT_EQ(it->data(), expected->second);
+    expected++;
+  }
+  ASSERT_TRUE(expected == entries.end());
+  ASSERT_EQ(it->status(), -ENOENT);
+
+  auto rexpected = entries.rbegin();
+  for (it->SeekToLast(); it->Valid(); it->Prev()) {
+    ASSERT_TRUE(rexpected != entries.rend());
+    ASSERT_EQ(it->position(), rexpected->first);
+    ASSERT_EQ(it->data(), rexpected->second);
+    rexpected++;
+  }
+  ASSERT_TRUE(rexpected == entries.rend());
+  ASSERT_EQ(it->status(), 0);
+
+  // new entries are visible after seeking
+  uint64_t pos;
+  ASSERT_EQ(log->Append("new", &pos), 0);
+  it->Seek(tail);
+  ASSERT_TRUE(it->Valid());
+  ASSERT_EQ(it->position(), pos);
+  ASSERT_EQ(it->data(), "new");
+  delete it;
+
+  // bounded range
+  auto first = std::next(entries.begin(), 10);
+  auto last = std::next(entries.begin(), 20);
+  ASSERT_EQ(log->NewIterator(first->first, last->first, &it), 0);
+  size_t count = 0;
+  for (it->SeekToFirst(); it->Valid(); it->Next()) {
+    ASSERT_EQ(it->position(), first->first);
+    first++;
+    count++;
+  }
+  ASSERT_EQ(count, 11u);
+  ASSERT_EQ(it->status(), 0);
+  delete it;
+}
+
+// an unwritten position isn't skipped when another object in its stripe has
+// a higher trim limit
+TEST_P(ZLogTest, Iterator_MixedTrimLimits) {
+  options.stripe_width = 5;
+  options.stripe_slots = 20;
+  DoSetUp();
+  auto *li = (zlog::LogImpl*)log;
+
+  for (unsigned i = 0; i < 8; i++) {
+    ASSERT_EQ(log->Append("entry." + std::to_string(i), nullptr), 0);
+  }
+
+  // trim the object holding positions 0, 5, 10, ... past the end of the log
+  const auto view = li->view_mgr->view();
+  auto oid = li->view_mgr->map(view, 0);
+  ASSERT_TRUE(oid);
+  ASSERT_EQ(li->backend->Trim(*oid, view->epoch(), 10, true), 0);
+
+  // leave position 8 unwritten between written positions
+  oid = li->view_mgr->map(view, 9);
+  ASSERT_TRUE(oid);
+  ASSERT_EQ(li->backend->Write(*oid, "entry.9", view->epoch(), 9), 0);
+
+  zlog::Log::Iterator *it;
+  ASSERT_EQ(log->NewIterator(0, 20, &it), 0);
+
+  it->Seek(8);
+  ASSERT_FALSE(it->Valid());
+  ASSERT_EQ(it->status(), -ENOENT);
+
+  // positions held by the trimmed object are skipped
+  it->Seek(4);
+  ASSERT_TRUE(it->Valid());
+  ASSERT_EQ(it->position(), 4u);
+  it->Next();
+  ASSERT_TRUE(it->Valid());
+  ASSERT_EQ(it->position(), 6u);
+  it->Next();
+  ASSERT_TRUE(it->Valid());
+  ASSERT_EQ(it->position(), 7u);
+  it->Next();
+  ASSERT_FALSE(it->Valid());
+  ASSERT_EQ(it->status(), -ENOENT);
+  delete it;
+}
+
 TEST_P(LibZLogTest, Trim) {
   // can trim empty spot
   int ret = log->Trim(55);
@@ -737,7 +1054,9 @@ TEST_P(ZLogTest, TrimTo_NonEmptyC) {
     if (i == 0) {
       // trimming to 95 means the first object is the stripe is fully trimmed
       ASSERT_EQ(size, 0u);
-    } else {
+    } else if (backend() != "lmdb") {
+      // lmdb reclaims trimmed entries in the background, so the others may
+      // be empty by now too
       ASSERT_GT(size, 0u);
     }
   }
@@ -1745,7 +2064,8 @@ TEST_P(ZLogTest, TrimTo_NonEmptyG_A) {
     ASSERT_EQ(ret, 0);
     if (i == 100) {
       ASSERT_EQ(size, 0u);
-    } else {
+    } else if (backend() != "lmdb") {
+      // lmdb reclaims trimmed entries in the background
       ASSERT_GT(size, 0u);
     }
   }
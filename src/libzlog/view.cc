@@ -18,9 +18,15 @@ View View::decode(const std::string& view_data)
   const auto view = flatbuffers::GetRoot<zlog::fbs::View>(
       reinterpret_cast<const uint8_t*>(view_data.data()));
 
+  boost::optional<uint64_t> tail_hint;
+  if (view->has_tail_hint()) {
+    tail_hint = view->tail_hint();
+  }
+
   return View(
       ObjectMap::decode(view->object_map()),
-      SequencerConfig::decode(view->sequencer()));
+      SequencerConfig::decode(view->sequencer()),
+      tail_hint);
 }
 
 std::string View::create_initial(const Options& options)
@@ -65,6 +71,10 @@ std::string View::encode() const
   auto builder = zlog::fbs::ViewBuilder(fbb);
   builder.add_object_map(encoded_object_map);
   builder.add_sequencer(seq);
+  if (tail_hint_) {
+    builder.add_tail_hint(*tail_hint_);
+    builder.add_has_tail_hint(true);
+  }
 
   auto view = builder.Finish();
   fbb.Finish(view);
@@ -79,7 +89,7 @@ boost::optional<View> View::expand_mapping(const uint64_t position,
   const auto new_object_map = object_map_.expand_mapping(position,
       options);
   if (new_object_map) {
-    return View(*new_object_map, seq_config_);
+    return View(*new_object_map, seq_config_, tail_hint_);
   }
   return boost::none;
 }
@@ -89,14 +99,19 @@ boost::optional<View> View::advance_min_valid_position(uint64_t position) const
 {
   const auto new_object_map = object_map_.advance_min_valid_position(position);
   if (new_object_map) {
-    return View(*new_object_map, seq_config_);
+    return View(*new_object_map, seq_config_, tail_hint_);
   }
   return boost::none;
 }
 
 View View::with_sequencer_config(SequencerConfig seq_config) const
 {
-  return View(object_map_, seq_config);
+  return View(object_map_, seq_config, tail_hint_);
+}
+
+View View::with_tail_hint(uint64_t position) const
+{
+  return View(object_map_, seq_config_, position);
 }
 
 void View::dump(nlohmann::json& out) const
@@ -107,6 +122,11 @@ void View::dump(nlohmann::json& out) const
   } else {
     out["seq_config"] = nullptr;
   }
+  if (tail_hint_) {
+    out["tail_hint"] = *tail_hint_;
+  } else {
+    out["tail_hint"] = nullptr;
+  }
 }
 
 void VersionedView::dump(nlohmann::json& out) const
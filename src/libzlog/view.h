@@ -18,9 +18,11 @@ struct Options;
 
 class View {
  public:
-  View(ObjectMap object_map, boost::optional<SequencerConfig> seq_config) :
+  View(ObjectMap object_map, boost::optional<SequencerConfig> seq_config,
+      boost::optional<uint64_t> tail_hint = boost::none) :
     object_map_(object_map),
-    seq_config_(seq_config)
+    seq_config_(seq_config),
+    tail_hint_(tail_hint)
   {}
 
   View(const View& other) = default;
@@ -53,6 +55,9 @@ class View {
 
   View with_sequencer_config(SequencerConfig seq_config) const;
 
+  // returns a copy of this view with the tail hint set to position
+  View with_tail_hint(uint64_t position) const;
+
   const ObjectMap& object_map() const {
     return object_map_;
   }
@@ -61,9 +66,15 @@ class View {
     return seq_config_;
   }
 
+  // a lower bound on the tail recorded by the sequencer, if any
+  const boost::optional<uint64_t>& tail_hint() const {
+    return tail_hint_;
+  }
+
  private:
   ObjectMap object_map_;
   boost::optional<SequencerConfig> seq_config_;
+  boost::optional<uint64_t> tail_hint_;
 };
 
 class VersionedView : public View {
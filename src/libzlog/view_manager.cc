@@ -55,14 +55,14 @@ void ViewManager::shutdown()
   stripe_init_thread_.join();
 }
 
-boost::optional<std::vector<std::pair<std::string, bool>>>
+boost::optional<std::vector<std::pair<ObjectId, bool>>>
 ViewManager::map_to(const std::shared_ptr<const View>& view, const uint64_t position,
     uint64_t& stripe_id, bool& done) const
 {
   return view->object_map().map_to(position, stripe_id, done);
 }
 
-boost::optional<std::string> ViewManager::map(
+boost::optional<ObjectId> ViewManager::map(
     const std::shared_ptr<const View>& view,
     const uint64_t position)
 {
@@ -116,11 +116,21 @@ int ViewManager::try_expand_view(const uint64_t position)
     const auto next_epoch = curr_view->epoch() + 1;
 
     // build a new view that maps the target position
-    const auto new_view = curr_view->expand_mapping(position, options_);
+    auto new_view = curr_view->expand_mapping(position, options_);
     if (!new_view) {
       return 0;
     }
 
+    // the mapping is expanded as appends reach the end of the log, so this is
+    // where the active sequencer refreshes the tail hint for the next one.
+    if (curr_view->seq) {
+      const auto tail = curr_view->seq->check_tail(false);
+      const auto& hint = curr_view->tail_hint();
+      if (tail > 0 && (!hint || *hint < tail - 1)) {
+        new_view = new_view->with_tail_hint(tail - 1);
+      }
+    }
+
     // write the new view as the next epoch
     const auto data = new_view->encode();
     int ret = backend_->ProposeView(next_epoch, data);
@@ -166,12 +176,35 @@ int ViewManager::try_expand_view(const uint64_t position)
   }
 }
 
-int ViewManager::seal_stripe(const Stripe& stripe, uint64_t epoch,
+int ViewManager::seal_stripes(const ObjectMap& object_map,
+    uint64_t min_stripe_id, uint64_t max_stripe_id, uint64_t epoch,
     uint64_t *pposition, bool *pempty) const
 {
-  auto& oids = stripe.oids();
+  assert(min_stripe_id <= max_stripe_id);
+
+  std::vector<ObjectId> oids;
+  for (auto stripe_id = min_stripe_id; stripe_id <= max_stripe_id;
+       stripe_id++) {
+    const auto stripe = object_map.stripe_by_id(stripe_id);
+    oids.insert(oids.end(), stripe.oids().begin(), stripe.oids().end());
+  }
   assert(!oids.empty());
 
+  const size_t max_inflight =
+    std::max(options_.max_inflight_seals, uint32_t(1));
+
+  // up to max_inflight objects are sealed at a time. the first error returned
+  // for any object is kept, and no more requests are submitted after it.
+  struct {
+    std::mutex lock;
+    std::condition_variable cond;
+    size_t inflight = 0;
+    int ret = 0;
+  } ctx;
+
+  std::vector<uint64_t> max_pos(oids.size());
+  std::unique_ptr<bool[]> empty(new bool[oids.size()]);
+
   // Out-of-date epoch (-ESPIPE) is ignored. Sealing these objects ensures that
   // their stored epochs are set _at least_ to the sealing epoch. Any operations
   // we compute on the objects after sealing (e.g. MaxPos) don't take affect
@@ -179,31 +212,49 @@ int ViewManager::seal_stripe(const Stripe& stripe, uint64_t epoch,
   // Allowing this helps scenarios like sealing a stripe that was partially
   // sealed and then the new sealing task encountering an older epoch stored
   // than what is available as the latest view. This is effectively OCC.
-  for (auto& oid : oids) {
-    int ret = backend_->Seal(oid, epoch);
-    if (ret < 0 && ret != -ESPIPE) {
-      return ret;
+  for (size_t i = 0; i < oids.size(); i++) {
+    {
+      std::unique_lock<std::mutex> lk(ctx.lock);
+      ctx.cond.wait(lk, [&] { return ctx.inflight < max_inflight; });
+      if (ctx.ret) {
+        break;
+      }
+      ctx.inflight++;
+    }
+
+    auto complete = [&](int ret) {
+      std::lock_guard<std::mutex> lk(ctx.lock);
+      if (ret < 0 && !ctx.ret) {
+        ctx.ret = ret;
+      }
+      ctx.inflight--;
+      ctx.cond.notify_one();
+    };
+
+    int ret = backend_->SealAndMaxPosAsync(oids[i], epoch, &max_pos[i],
+        &empty[i], complete);
+    if (ret) {
+      complete(ret);
     }
   }
 
+  std::unique_lock<std::mutex> lk(ctx.lock);
+  ctx.cond.wait(lk, [&] { return ctx.inflight == 0; });
+  if (ctx.ret < 0) {
+    return ctx.ret;
+  }
+
   bool stripe_empty = true;
   // max pos only defined for non-empty stripe
   uint64_t stripe_max_pos = 0;
 
-  for (auto& oid : oids) {
-    bool empty;
-    uint64_t max_pos;
-    int ret = backend_->MaxPos(oid, &max_pos, &empty);
-    if (ret < 0) {
-      return ret;
-    }
-
-    if (empty) {
+  for (size_t i = 0; i < oids.size(); i++) {
+    if (empty[i]) {
       continue;
     }
 
     stripe_empty = false;
-    stripe_max_pos = std::max(stripe_max_pos, max_pos);
+    stripe_max_pos = std::max(stripe_max_pos, max_pos[i]);
   }
 
   if (pempty) {
@@ -263,16 +314,35 @@ int ViewManager::propose_sequencer()
     uint64_t max_pos;
 
     if (!curr_view->object_map().empty()) {
-      assert(curr_view->object_map().num_stripes() > 0);
-      for (auto stripe_id = curr_view->object_map().num_stripes(); stripe_id--;) {
-        const auto stripe = curr_view->object_map().stripe_by_id(stripe_id);
-        int ret = seal_stripe(stripe, next_epoch, &max_pos, &empty);
+      const auto& object_map = curr_view->object_map();
+      assert(object_map.num_stripes() > 0);
+      auto stripe_id = object_map.num_stripes();
+
+      // the tail is at least the hinted position, so it is in the stripe that
+      // maps the hint or in a later one. all of those stripes are sealed
+      // together rather than one at a time. they all need to be sealed, since
+      // appends to any of them may still be in flight at the old epoch, but
+      // when the hint is recent this is only one or two stripes.
+      if (curr_view->tail_hint()) {
+        const auto stripe = object_map.map_stripe(*curr_view->tail_hint());
+        if (stripe) {
+          int ret = seal_stripes(object_map, stripe->id(), stripe_id - 1,
+              next_epoch, &max_pos, &empty);
+          if (ret < 0) {
+            return ret;
+          }
+          stripe_id = stripe->id();
+        }
+      }
+
+      // otherwise, or if the hint was wrong, the tail is in the first
+      // non-empty stripe below
+      while (empty && stripe_id--) {
+        int ret = seal_stripes(object_map, stripe_id, stripe_id, next_epoch,
+            &max_pos, &empty);
         if (ret < 0) {
           return ret;
         }
-        if (!empty) {
-          break;
-        }
       }
     }
 
@@ -286,7 +356,10 @@ int ViewManager::propose_sequencer()
         (empty ? uint64_t(0) : (max_pos + 1)));
 
     // build the new view that'll be proposed
-    const auto new_view = curr_view->with_sequencer_config(seq_config);
+    auto new_view = curr_view->with_sequencer_config(seq_config);
+    if (!empty) {
+      new_view = new_view.with_tail_hint(max_pos);
+    }
 
     // propose the next view
     const auto data = new_view.encode();
@@ -52,7 +52,7 @@ class ViewManager final {
   int try_expand_view(uint64_t position);
   void async_expand_view(uint64_t position);
 
-  boost::optional<std::string> map(const std::shared_ptr<const View>& view,
+  boost::optional<ObjectId> map(const std::shared_ptr<const View>& view,
       uint64_t position);
 
   // schedule initialization of the stripe that maps the position.
@@ -65,7 +65,7 @@ class ViewManager final {
   // the current minimum.
   int advance_min_valid_position(uint64_t position);
 
-  boost::optional<std::vector<std::pair<std::string, bool>>> map_to(
+  boost::optional<std::vector<std::pair<ObjectId, bool>>> map_to(
       const std::shared_ptr<const View>& view, const uint64_t position,
       uint64_t& stripe_id, bool& done) const;
 
@@ -78,12 +78,14 @@ class ViewManager final {
   const std::unique_ptr<ViewReader> view_reader_;
 
  private:
-  // seals the given stripe with the given epoch. on success, *pempty will be
-  // set to true if the stripe is empty (no positions have been written, filled,
-  // etc...). if the stripe is non-empty, *pposition will be set to the maximum
-  // position written. otherwise it is left unmodified.
-  int seal_stripe(const Stripe& stripe, uint64_t epoch,
-      uint64_t *pposition, bool *pempty) const;
+  // seals the stripes with ids in [min_stripe_id, max_stripe_id] with the
+  // given epoch. on success, *pempty will be set to true if the stripes are
+  // empty (no positions have been written, filled, etc...). if the stripes are
+  // non-empty, *pposition will be set to the maximum position written.
+  // otherwise it is left unmodified.
+  int seal_stripes(const ObjectMap& object_map, uint64_t min_stripe_id,
+      uint64_t max_stripe_id, uint64_t epoch, uint64_t *pposition,
+      bool *pempty) const;
 
  private:
   // async view expansion
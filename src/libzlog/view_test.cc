@@ -106,3 +106,36 @@ TEST(ViewTest, SetSequencerConfig) {
   ASSERT_EQ(*view.seq_config(), seqconf);
   ASSERT_EQ(view.object_map(), om);
 }
+
+TEST(ViewTest, TailHint) {
+  std::map<uint64_t, zlog::MultiStripe> stripes;
+  auto om = zlog::ObjectMap(0, stripes, 0);
+
+  zlog::View view(om, boost::none);
+  ASSERT_FALSE(view.tail_hint());
+  ASSERT_FALSE(zlog::View::decode(view.encode()).tail_hint());
+
+  view = view.with_tail_hint(0);
+  ASSERT_TRUE(view.tail_hint());
+  ASSERT_EQ(*view.tail_hint(), 0u);
+  ASSERT_EQ(*zlog::View::decode(view.encode()).tail_hint(), 0u);
+
+  view = view.with_tail_hint(33);
+  ASSERT_EQ(*view.tail_hint(), 33u);
+  ASSERT_EQ(view.object_map(), om);
+  ASSERT_EQ(*zlog::View::decode(view.encode()).tail_hint(), 33u);
+
+  // the hint is kept by other view changes
+  zlog::SequencerConfig seqconf(22, "asdf", 33);
+  view = view.with_sequencer_config(seqconf);
+  ASSERT_EQ(*view.tail_hint(), 33u);
+
+  zlog::Options options;
+  auto maybe_view = view.expand_mapping(0, options);
+  ASSERT_TRUE(maybe_view);
+  ASSERT_EQ(*maybe_view->tail_hint(), 33u);
+
+  maybe_view = view.advance_min_valid_position(10);
+  ASSERT_TRUE(maybe_view);
+  ASSERT_EQ(*maybe_view->tail_hint(), 33u);
+}
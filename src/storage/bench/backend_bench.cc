@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <atomic>
 #include <condition_variable>
 #include <memory>
@@ -113,6 +114,72 @@ static void io_entry(std::shared_ptr<zlog::Backend> backend,
   }
 }
 
+// keeps qdepth asynchronous writes in flight from a single thread. latency is
+// measured from the call to WriteAsync until its callback runs.
+static void async_entry(std::shared_ptr<zlog::Backend> backend,
+    const std::vector<std::vector<std::string>>& objects,
+    uint64_t width, uint64_t slots, size_t entry_size,
+    uint64_t max_pos, rand_data_gen *gen, int qdepth,
+    std::vector<uint64_t> *latencies)
+{
+  assert(!objects.empty());
+  assert(objects[0].size() == width);
+
+  const auto slots_per_row = width * slots;
+
+  std::mutex async_lock;
+  std::condition_variable async_cond;
+  int inflight = 0;
+
+  std::unique_lock<std::mutex> lk(async_lock);
+  while (true) {
+    async_cond.wait(lk, [&] { return inflight < qdepth; });
+    if (shutdown) {
+      break;
+    }
+    inflight++;
+    lk.unlock();
+
+    auto pos = seq.fetch_add(1);
+    assert(pos < max_pos);
+
+    auto row = pos / slots_per_row;
+    auto col = pos % width;
+
+    std::string data;
+    data.append(gen->sample(), entry_size);
+
+    if (verify) {
+      std::lock_guard<std::mutex> lk(async_lock);
+      record.emplace(pos, data);
+    }
+
+    // the callback may run before WriteAsync returns
+    const auto start_ns = __getns(CLOCK_MONOTONIC);
+    int ret = backend->WriteAsync(objects[row][col], data, 1, pos,
+        [&, start_ns](int ret) {
+      const auto latency_ns = __getns(CLOCK_MONOTONIC) - start_ns;
+      if (ret) {
+        std::cerr << "write error: " << strerror(-ret) << std::endl;
+        assert(0);
+      }
+      std::lock_guard<std::mutex> lk(async_lock);
+      latencies->push_back(latency_ns);
+      op_count++;
+      inflight--;
+      async_cond.notify_one();
+    });
+    if (ret) {
+      std::cerr << "write error: " << strerror(-ret) << std::endl;
+      assert(0);
+    }
+
+    lk.lock();
+  }
+
+  async_cond.wait(lk, [&] { return inflight == 0; });
+}
+
 static void stats_entry()
 {
   while (true) {
@@ -151,6 +218,8 @@ int main(int argc, char **argv)
   std::string db_path;
   uint64_t max_pos;
   ssize_t omap_max_size;
+  std::vector<std::string> backend_opts;
+  bool async = false;
 
   po::options_description opts("Benchmark options");
   opts.add_options()
@@ -163,11 +232,13 @@ int main(int argc, char **argv)
     ("runtime", po::value<int>(&runtime)->default_value(0), "runtime")
     ("maxpos", po::value<uint64_t>(&max_pos)->default_value(1000000), "max pos")
     ("verify", po::bool_switch(&verify), "verify")
+    ("async", po::bool_switch(&async), "qdepth async writes from one thread")
 
     ("backend", po::value<std::string>(&backend_name)->required(), "backend")
     ("pool", po::value<std::string>(&pool)->default_value("zlog"), "pool (ceph)")
     ("db-path", po::value<std::string>(&db_path)->default_value("/tmp/zlog.bench.db"), "db path (lmdb)")
     ("omap-max-size", po::value<ssize_t>(&omap_max_size)->default_value(-1), "omap max size (ceph)")
+    ("backend-opt", po::value<std::vector<std::string>>(&backend_opts)->multitoken(), "backend options (key:value)")
   ;
 
   po::variables_map vm;
@@ -195,10 +266,19 @@ int main(int argc, char **argv)
       ss << omap_max_size;
       options.backend_options["omap_max_size"] = ss.str();
     }
-  } else if (backend_name == "lmdb") {
+  } else if (backend_name == "lmdb" || backend_name == "segment") {
     options.backend_options["path"] = db_path;
   }
 
+  for (auto option : backend_opts) {
+    auto pos = option.find(":");
+    if (pos == std::string::npos) {
+      std::cerr << "invalid option " << option << std::endl;
+      return 1;
+    }
+    options.backend_options[option.substr(0, pos)] = option.substr(pos + 1);
+  }
+
   std::shared_ptr<zlog::Backend> backend;
   int ret = zlog::Backend::Load(options.backend_name,
       options.backend_options, backend);
@@ -238,10 +318,18 @@ int main(int argc, char **argv)
     objects.push_back(tmp);
   }
 
+  std::vector<uint64_t> latencies;
+  const auto start_us = getus();
+
   std::vector<std::thread> io_threads;
-  for (int i = 0; i < qdepth; i++) {
-    io_threads.emplace_back(std::thread(io_entry, backend, objects,
-          width, slots, entry_size, max_pos, &dgen));
+  if (async) {
+    io_threads.emplace_back(std::thread(async_entry, backend, objects,
+          width, slots, entry_size, max_pos, &dgen, qdepth, &latencies));
+  } else {
+    for (int i = 0; i < qdepth; i++) {
+      io_threads.emplace_back(std::thread(io_entry, backend, objects,
+            width, slots, entry_size, max_pos, &dgen));
+    }
   }
 
   std::thread stats_thread(stats_entry);
@@ -253,6 +341,26 @@ int main(int argc, char **argv)
     t.join();
   }
 
+  // the mean number of writes in flight is the total time spent in flight
+  // divided by the runtime. it is below qdepth when the submitting thread
+  // can't keep up with completions.
+  if (async && !latencies.empty()) {
+    const auto elapsed_us = getus() - start_us;
+    const auto ops = latencies.size();
+    std::sort(latencies.begin(), latencies.end());
+    uint64_t total_ns = 0;
+    for (auto ns : latencies) {
+      total_ns += ns;
+    }
+    std::cout << "ops/sec " << (ops * 1000000ULL / elapsed_us)
+      << " MB/sec " << (ops * entry_size / elapsed_us)
+      << " inflight " << (double)total_ns / 1000.0 / elapsed_us
+      << " mean_us " << (total_ns / ops / 1000)
+      << " p50_us " << (latencies[ops / 2] / 1000)
+      << " p99_us " << (latencies[ops * 99 / 100] / 1000)
+      << std::endl;
+  }
+
   if (verify) {
     const auto slots_per_row = width * slots;
     for (auto it : record) {
@@ -1,23 +1,128 @@
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
 #include <sstream>
 #include <boost/uuid/uuid.hpp>
 #include <boost/uuid/uuid_generators.hpp>
 #include <boost/uuid/uuid_io.hpp>
+#include <boost/algorithm/string.hpp>
 #include <boost/optional.hpp>
 #include <boost/lexical_cast.hpp>
 #include "zlog/backend/ceph.h"
 #include "cls_zlog_client.h"
 #include "storage/ceph/cls_zlog_generated.h"
 #include "fbs_helper.h"
-#include "common.h"
 
 namespace zlog {
 namespace storage {
 namespace ceph {
 
+namespace {
+
+// state for an asynchronous request. it is released by the completion.
+struct AioContext {
+  librados::AioCompletion *completion;
+  std::function<void(int)> cb;
+  ::ceph::bufferlist bl;
+  std::string *data_out = nullptr;
+  uint64_t *pos_out = nullptr;
+  bool *empty_out = nullptr;
+};
+
+void aio_complete(librados::completion_t c, void *arg)
+{
+  auto ctx = static_cast<AioContext*>(arg);
+
+  int ret = ctx->completion->get_return_value();
+  if (ret > 0) {
+    ret = 0;
+  }
+
+  if (!ret && ctx->data_out) {
+    ctx->data_out->assign(ctx->bl.c_str(), ctx->bl.length());
+  }
+
+  if (!ret && ctx->empty_out) {
+    auto reply = fbs_bl_decode<cls_zlog::fbs::ReadMaxPosReply>(&ctx->bl);
+    if (!reply) {
+      ret = -EIO;
+    } else if (reply->empty()) {
+      *ctx->empty_out = true;
+    } else {
+      *ctx->empty_out = false;
+      *ctx->pos_out = reply->position();
+    }
+  }
+
+  ctx->completion->release();
+  auto cb = std::move(ctx->cb);
+  delete ctx;
+
+  cb(ret);
+}
+
+// SealAndMaxPosAsync completes when both of its requests have completed
+struct SealAndMaxPosContext {
+  SealAndMaxPosContext() :
+    pending(2),
+    seal_ret(0),
+    max_pos_ret(0)
+  {}
+
+  void complete() {
+    if (--pending > 0) {
+      return;
+    }
+    if (seal_ret && seal_ret != -ESPIPE) {
+      cb(seal_ret);
+    } else {
+      cb(max_pos_ret);
+    }
+  }
+
+  std::atomic<int> pending;
+  int seal_ret;
+  int max_pos_ret;
+  std::function<void(int)> cb;
+};
+
+// WriteBatchAsync falls back to writing entries individually, and completes
+// when all of the writes have completed.
+struct WriteBatchContext {
+  WriteBatchContext(size_t count, std::vector<int> *results,
+      std::function<void(int)> cb) :
+    pending(count),
+    results(results),
+    cb(cb)
+  {}
+
+  void complete(size_t i, int ret) {
+    (*results)[i] = ret;
+    if (--pending > 0) {
+      return;
+    }
+    // object-level errors are reported like the synchronous fallback
+    for (const auto result : *results) {
+      if (result == -EINVAL || result == -ENOENT || result == -ESPIPE) {
+        cb(result);
+        return;
+      }
+    }
+    cb(0);
+  }
+
+  std::atomic<size_t> pending;
+  std::vector<int> *results;
+  std::function<void(int)> cb;
+};
+
+}
+
 CephBackend::CephBackend() :
   cluster_(nullptr),
   ioctx_(nullptr),
-  omap_max_size_(boost::none)
+  omap_max_size_(boost::none),
+  verify_checksums_(true)
 {
 }
 
@@ -39,10 +144,12 @@ int CephBackend::Initialize(librados::IoCtx *ioctx)
   ioctx_ = ioctx;
   pool_ = ioctx_->get_pool_name();
   omap_max_size_ = boost::none;
+  verify_checksums_ = true;
 
   options["scheme"] = "ceph";
   options["conf_file"] = "";
   options["pool"] = pool_;
+  options["verify_checksums"] = "true";
 
   return RegisterCephApp();
 }
@@ -120,8 +227,15 @@ int CephBackend::Initialize(
     }
   }
 
+  it = opts.find("verify_checksums");
+  if (it != opts.end()) {
+    verify_checksums_ = boost::iequals(it->second, "yes") ||
+      boost::iequals(it->second, "true");
+  }
+
   options = opts;
   options["scheme"] = "ceph";
+  options["verify_checksums"] = verify_checksums_ ? "true" : "false";
 
   cluster_ = cluster;
   ioctx_ = ioctx;
@@ -367,7 +481,7 @@ int CephBackend::Read(const std::string& oid, uint64_t epoch,
   }
 
   librados::ObjectReadOperation op;
-  cls_zlog_client::cls_zlog_read(op, epoch, position);
+  cls_zlog_client::cls_zlog_read(op, epoch, position, verify_checksums_);
 
   ::ceph::bufferlist bl;
   int ret = ioctx_->operate(oid, &op, &bl);
@@ -380,6 +494,58 @@ int CephBackend::Read(const std::string& oid, uint64_t epoch,
   return 0;
 }
 
+int CephBackend::ReadRange(const std::string& oid, uint64_t epoch,
+    uint64_t min_position, uint64_t max_position, uint32_t stride,
+    std::map<uint64_t, std::string> *entries_out,
+    std::set<uint64_t> *invalid_out)
+{
+  if (oid.empty() || min_position > max_position || stride == 0) {
+    return -EINVAL;
+  }
+
+  librados::ObjectReadOperation op;
+  cls_zlog_client::cls_zlog_read_range(op, epoch, min_position, max_position,
+      stride, verify_checksums_);
+
+  ::ceph::bufferlist bl;
+  int ret = ioctx_->operate(oid, &op, &bl);
+  if (ret) {
+    return ret;
+  }
+
+  auto reply = fbs_bl_decode<cls_zlog::fbs::ReadEntriesReply>(&bl);
+  if (!reply) {
+    return -EIO;
+  }
+
+  std::map<uint64_t, std::string> entries;
+  if (reply->entries()) {
+    for (const auto entry : *reply->entries()) {
+      std::string data;
+      if (entry->data()) {
+        data.assign((const char*)entry->data()->data(),
+            entry->data()->size());
+      }
+      entries.emplace(entry->position(), std::move(data));
+    }
+  }
+
+  std::set<uint64_t> invalid;
+  if (reply->invalid()) {
+    invalid.insert(reply->invalid()->begin(), reply->invalid()->end());
+  }
+
+  if (entries_out) {
+    entries_out->swap(entries);
+  }
+
+  if (invalid_out) {
+    invalid_out->swap(invalid);
+  }
+
+  return 0;
+}
+
 int CephBackend::Write(const std::string& oid, const std::string& data,
     uint64_t epoch, uint64_t position)
 {
@@ -396,6 +562,125 @@ int CephBackend::Write(const std::string& oid, const std::string& data,
   return ioctx_->operate(oid, &op);
 }
 
+int CephBackend::WriteBatch(const std::string& oid, uint64_t epoch,
+    const std::vector<std::pair<uint64_t, const std::string*>>& entries,
+    std::vector<int> *results)
+{
+  if (oid.empty() || entries.empty() || !results) {
+    return -EINVAL;
+  }
+
+  librados::ObjectWriteOperation op;
+  cls_zlog_client::cls_zlog_write_batch(op, epoch, entries);
+
+  int ret = ioctx_->operate(oid, &op);
+  if (ret == -EROFS) {
+    // the batch is all-or-nothing and write operations can't return per-entry
+    // results. fall back to writing entries individually to find out which of
+    // the positions are taken.
+    return Backend::WriteBatch(oid, epoch, entries, results);
+  }
+
+  results->assign(entries.size(), ret);
+
+  return ret;
+}
+
+int CephBackend::WriteBatchAsync(const std::string& oid, uint64_t epoch,
+    const std::vector<std::pair<uint64_t, const std::string*>>& entries,
+    std::vector<int> *results, std::function<void(int)> cb)
+{
+  if (oid.empty() || entries.empty() || !results) {
+    return -EINVAL;
+  }
+
+  librados::ObjectWriteOperation op;
+  cls_zlog_client::cls_zlog_write_batch(op, epoch, entries);
+
+  auto ctx = new AioContext;
+  ctx->cb = [this, oid, epoch, &entries, results, cb](int ret) {
+    if (ret != -EROFS) {
+      results->assign(entries.size(), ret);
+      cb(ret);
+      return;
+    }
+
+    // see WriteBatch. the entries are written concurrently.
+    results->assign(entries.size(), 0);
+    auto batch = std::make_shared<WriteBatchContext>(entries.size(),
+        results, cb);
+    for (size_t i = 0; i < entries.size(); i++) {
+      int ret = WriteAsync(oid, *entries[i].second, epoch, entries[i].first,
+          [batch, i](int ret) { batch->complete(i, ret); });
+      if (ret) {
+        batch->complete(i, ret);
+      }
+    }
+  };
+  ctx->completion = librados::Rados::aio_create_completion(ctx,
+      aio_complete, nullptr);
+
+  int ret = ioctx_->aio_operate(oid, ctx->completion, &op);
+  if (ret) {
+    ctx->completion->release();
+    delete ctx;
+  }
+
+  return ret;
+}
+
+int CephBackend::ReadAsync(const std::string& oid, uint64_t epoch,
+    uint64_t position, std::string *data_out, std::function<void(int)> cb)
+{
+  if (oid.empty() || !data_out) {
+    return -EINVAL;
+  }
+
+  librados::ObjectReadOperation op;
+  cls_zlog_client::cls_zlog_read(op, epoch, position, verify_checksums_);
+
+  auto ctx = new AioContext;
+  ctx->cb = cb;
+  ctx->data_out = data_out;
+  ctx->completion = librados::Rados::aio_create_completion(ctx,
+      aio_complete, nullptr);
+
+  int ret = ioctx_->aio_operate(oid, ctx->completion, &op, &ctx->bl);
+  if (ret) {
+    ctx->completion->release();
+    delete ctx;
+  }
+
+  return ret;
+}
+
+int CephBackend::WriteAsync(const std::string& oid, const std::string& data,
+    uint64_t epoch, uint64_t position, std::function<void(int)> cb)
+{
+  if (oid.empty()) {
+    return -EINVAL;
+  }
+
+  ::ceph::bufferlist data_bl;
+  data_bl.append(data.data(), data.size());
+
+  librados::ObjectWriteOperation op;
+  cls_zlog_client::cls_zlog_write(op, epoch, position, data_bl);
+
+  auto ctx = new AioContext;
+  ctx->cb = cb;
+  ctx->completion = librados::Rados::aio_create_completion(ctx,
+      aio_complete, nullptr);
+
+  int ret = ioctx_->aio_operate(oid, ctx->completion, &op);
+  if (ret) {
+    ctx->completion->release();
+    delete ctx;
+  }
+
+  return ret;
+}
+
 int CephBackend::Fill(const std::string& oid, uint64_t epoch,
     uint64_t position)
 {
@@ -408,6 +693,30 @@ int CephBackend::Fill(const std::string& oid, uint64_t epoch,
   return ioctx_->operate(oid, &op);
 }
 
+int CephBackend::FillAsync(const std::string& oid, uint64_t epoch,
+    uint64_t position, std::function<void(int)> cb)
+{
+  if (oid.empty()) {
+    return -EINVAL;
+  }
+
+  librados::ObjectWriteOperation op;
+  cls_zlog_client::cls_zlog_invalidate(op, epoch, position, false, false);
+
+  auto ctx = new AioContext;
+  ctx->cb = cb;
+  ctx->completion = librados::Rados::aio_create_completion(ctx,
+      aio_complete, nullptr);
+
+  int ret = ioctx_->aio_operate(oid, ctx->completion, &op);
+  if (ret) {
+    ctx->completion->release();
+    delete ctx;
+  }
+
+  return ret;
+}
+
 int CephBackend::Trim(const std::string& oid, uint64_t epoch,
     uint64_t position, bool trim_limit, bool trim_full)
 {
@@ -437,58 +746,12 @@ int CephBackend::Trim(const std::string& oid, uint64_t epoch,
     return 0;
   }
 
-  const std::string prefix(ZLOG_ENTRY_KEY_PREFIX);
-
-  // TODO: configure the batch size for deletion
-  std::string start_after;
-  while (true) {
-    std::set<std::string> keys;
-    ret = ioctx_->omap_get_keys(oid, start_after, 1, &keys);
-    if (ret < 0) {
-      return ret;
-    }
-
-    if (keys.empty()) {
-      break;
-    }
-
-    start_after = *keys.rbegin();
-
-    for (auto it = keys.begin(); it != keys.end();) {
-      auto pos = it->find(prefix);
-      if (pos == std::string::npos) {
-        it = keys.erase(it);
-        continue;
-      }
-      if (pos != 0) {
-        std::cerr << "invalid" << std::endl;
-        return -EIO;
-      }
-      auto spos = it->substr(prefix.length(), std::string::npos);
-      uint64_t ipos;
-      try {
-        ipos = boost::lexical_cast<uint64_t>(spos);
-      } catch (const boost::bad_lexical_cast& e) {
-        return -EIO;
-      }
-      // normally we could skip, but trim_full should imply this property
-      if (ipos > position) {
-        return -EIO;
-      }
-      it++;
-    }
-
-    if (keys.empty()) {
-      continue;
-    }
+  // the entries are removed and the bytestream truncated in one operation
+  librados::ObjectWriteOperation reclaim_op;
+  cls_zlog_client::cls_zlog_trim_reclaim(reclaim_op, epoch);
+  reclaim_op.truncate(0);
 
-    ret = ioctx_->omap_rm_keys(oid, keys);
-    if (ret) {
-      return ret;
-    }
-  }
-
-  return ioctx_->trunc(oid, 0);
+  return ioctx_->operate(oid, &reclaim_op);
 }
 
 int CephBackend::Stat(const std::string& oid, size_t *size)
@@ -497,32 +760,21 @@ int CephBackend::Stat(const std::string& oid, size_t *size)
     return -EINVAL;
   }
 
-  size_t s;
-  int ret = ioctx_->stat(oid, &s, NULL);
+  librados::ObjectReadOperation op;
+  cls_zlog_client::cls_zlog_stat(op);
+
+  ::ceph::bufferlist bl;
+  int ret = ioctx_->operate(oid, &op, &bl);
   if (ret) {
     return ret;
   }
 
-  bool more = true;
-  std::string start_after = "";
-  while (more) {
-    std::map<std::string, ::ceph::bufferlist> out;
-    ret = ioctx_->omap_get_vals2(oid, start_after, 1, &out, &more);
-    if (ret) {
-      return ret;
-    }
-    if (out.empty())
-      break;
-    start_after = out.rbegin()->first;
-    for (auto& kv : out) {
-      // add in a bit for the entry header. also important if the entry is
-      // actually zero length.
-      s += size_t(20);
-      s += kv.second.length();
-    }
+  auto reply = fbs_bl_decode<cls_zlog::fbs::StatReply>(&bl);
+  if (!reply) {
+    return -EIO;
   }
 
-  *size = s;
+  *size = reply->size();
 
   return 0;
 }
@@ -538,6 +790,30 @@ int CephBackend::Seal(const std::string& oid, uint64_t epoch)
   return ioctx_->operate(oid, &op);
 }
 
+int CephBackend::SealAsync(const std::string& oid, uint64_t epoch,
+    std::function<void(int)> cb)
+{
+  if (oid.empty()) {
+    return -EINVAL;
+  }
+
+  librados::ObjectWriteOperation op;
+  cls_zlog_client::cls_zlog_seal(op, epoch, omap_max_size_);
+
+  auto ctx = new AioContext;
+  ctx->cb = cb;
+  ctx->completion = librados::Rados::aio_create_completion(ctx,
+      aio_complete, nullptr);
+
+  int ret = ioctx_->aio_operate(oid, ctx->completion, &op);
+  if (ret) {
+    ctx->completion->release();
+    delete ctx;
+  }
+
+  return ret;
+}
+
 int CephBackend::MaxPos(const std::string& oid, uint64_t *position_out, bool *empty_out)
 {
   if (oid.empty()) {
@@ -568,6 +844,121 @@ int CephBackend::MaxPos(const std::string& oid, uint64_t *position_out, bool *em
   return 0;
 }
 
+int CephBackend::SealAndMaxPos(const std::string& oid, uint64_t epoch,
+    uint64_t *position_out, bool *empty_out)
+{
+  struct {
+    int ret;
+    bool done = false;
+    std::mutex lock;
+    std::condition_variable cond;
+  } ctx;
+
+  int ret = SealAndMaxPosAsync(oid, epoch, position_out, empty_out,
+      [&](int ret) {
+    std::lock_guard<std::mutex> lk(ctx.lock);
+    ctx.ret = ret;
+    ctx.done = true;
+    ctx.cond.notify_one();
+  });
+
+  if (ret) {
+    return ret;
+  }
+
+  std::unique_lock<std::mutex> lk(ctx.lock);
+  ctx.cond.wait(lk, [&] { return ctx.done; });
+
+  return ctx.ret;
+}
+
+// the seal and the max position read are separate operations because a write
+// operation can't return the output of an object class method. they are
+// submitted back-to-back without waiting, and the osd applies operations from
+// a client to the same object in order, so the read observes the seal.
+int CephBackend::SealAndMaxPosAsync(const std::string& oid, uint64_t epoch,
+    uint64_t *position_out, bool *empty_out, std::function<void(int)> cb)
+{
+  if (oid.empty() || !position_out || !empty_out) {
+    return -EINVAL;
+  }
+
+  auto state = std::make_shared<SealAndMaxPosContext>();
+  state->cb = cb;
+
+  librados::ObjectWriteOperation seal_op;
+  cls_zlog_client::cls_zlog_seal(seal_op, epoch, omap_max_size_);
+
+  auto seal_ctx = new AioContext;
+  seal_ctx->cb = [state](int ret) {
+    state->seal_ret = ret;
+    state->complete();
+  };
+  seal_ctx->completion = librados::Rados::aio_create_completion(seal_ctx,
+      aio_complete, nullptr);
+
+  int ret = ioctx_->aio_operate(oid, seal_ctx->completion, &seal_op);
+  if (ret) {
+    seal_ctx->completion->release();
+    delete seal_ctx;
+    return ret;
+  }
+
+  librados::ObjectReadOperation max_pos_op;
+  cls_zlog_client::cls_zlog_max_position(max_pos_op);
+
+  auto max_pos_ctx = new AioContext;
+  max_pos_ctx->cb = [state](int ret) {
+    state->max_pos_ret = ret;
+    state->complete();
+  };
+  max_pos_ctx->pos_out = position_out;
+  max_pos_ctx->empty_out = empty_out;
+  max_pos_ctx->completion = librados::Rados::aio_create_completion(
+      max_pos_ctx, aio_complete, nullptr);
+
+  ret = ioctx_->aio_operate(oid, max_pos_ctx->completion, &max_pos_op,
+      &max_pos_ctx->bl);
+  if (ret) {
+    max_pos_ctx->completion->release();
+    delete max_pos_ctx;
+    // the seal was submitted, so the callback still runs once it completes
+    state->max_pos_ret = ret;
+    state->complete();
+  }
+
+  return 0;
+}
+
+int CephBackend::Scrub(const std::string& oid,
+    std::set<uint64_t> *corrupt_out)
+{
+  if (oid.empty() || !corrupt_out) {
+    return -EINVAL;
+  }
+
+  librados::ObjectReadOperation op;
+  cls_zlog_client::cls_zlog_scrub(op);
+
+  ::ceph::bufferlist bl;
+  int ret = ioctx_->operate(oid, &op, &bl);
+  if (ret) {
+    return ret;
+  }
+
+  auto reply = fbs_bl_decode<cls_zlog::fbs::ScrubReply>(&bl);
+  if (!reply) {
+    return -EIO;
+  }
+
+  corrupt_out->clear();
+  if (reply->corrupt()) {
+    corrupt_out->insert(reply->corrupt()->begin(), reply->corrupt()->end());
+  }
+
+  return 0;
+}
+
 std::string CephBackend::LinkObjectName(const std::string& name)
 {
   std::stringstream ss;
@@ -54,11 +54,136 @@ static int log_entry_read(cls_method_context_t hctx, ceph::bufferlist *in,
     return ret;
   }
 
+  if (!op->skip_verify() && !entry.verify(out)) {
+    CLS_ERR("ERROR: log_entry_read(): entry %llu failed checksum",
+        op->position());
+    return -EIO;
+  }
+
   return 0;
 }
 
-static int log_entry_write(cls_method_context_t hctx, ceph::bufferlist *in,
-    ceph::bufferlist *out)
+static int log_entry_read_range(cls_method_context_t hctx,
+    ceph::bufferlist *in, ceph::bufferlist *out)
+{
+  auto op = fbs_bl_decode<cls_zlog::fbs::ReadEntriesOp>(in);
+  if (!op) {
+    CLS_ERR("ERROR: log_entry_read_range(): failed to decode input");
+    return -EINVAL;
+  }
+
+  const uint64_t min_position = op->min_position();
+  const uint64_t max_position = op->max_position();
+  const uint32_t stride = op->stride();
+  if (min_position > max_position || stride == 0) {
+    CLS_ERR("ERROR: log_entry_read_range(): invalid range");
+    return -EINVAL;
+  }
+
+  cls_zlog::LogObjectHeader header(hctx);
+  int ret = header.read();
+  if (ret < 0) {
+    CLS_ERR("ERROR: log_entry_read_range(): failed to read header %d", ret);
+    return ret;
+  }
+
+  ret = header.epoch_guard(op->epoch());
+  if (ret < 0) {
+    CLS_LOG(10, "log_entry_read_range(): failed epoch guard %d", ret);
+    return ret;
+  }
+
+  flatbuffers::FlatBufferBuilder fbb;
+  std::vector<flatbuffers::Offset<cls_zlog::fbs::BatchEntry>> entries;
+  std::vector<uint64_t> invalid;
+
+  // positions covered by the trim limit don't need to be looked up
+  uint64_t position = min_position;
+  bool more = true;
+  while (header.position_trimmed(position)) {
+    invalid.push_back(position);
+    if (max_position - position < stride) {
+      more = false;
+      break;
+    }
+    position += stride;
+  }
+
+  // entry keys are zero-padded so the omap is ordered by position
+  const auto max_key = cls_zlog::u64tostr(max_position, ZLOG_ENTRY_KEY_PREFIX);
+  std::string start_after = position > 0 ?
+    cls_zlog::u64tostr(position - 1, ZLOG_ENTRY_KEY_PREFIX) : "";
+
+  while (more) {
+    std::map<std::string, ceph::bufferlist> vals;
+    ret = cls_cxx_map_get_vals(hctx, start_after, ZLOG_ENTRY_KEY_PREFIX,
+        ZLOG_MAX_RANGE_READS, &vals, &more);
+    if (ret < 0) {
+      CLS_ERR("ERROR: log_entry_read_range(): omap range read failed %d", ret);
+      return ret;
+    }
+
+    for (auto& val : vals) {
+      if (val.first > max_key) {
+        more = false;
+        break;
+      }
+
+      const uint64_t entry_pos = strtoull(
+          val.first.c_str() + strlen(ZLOG_ENTRY_KEY_PREFIX), NULL, 10);
+      if ((entry_pos - min_position) % stride) {
+        continue;
+      }
+
+      cls_zlog::LogEntry entry(hctx, entry_pos);
+      ret = entry.decode(&val.second);
+      if (ret < 0) {
+        CLS_ERR("ERROR: log_entry_read_range(): decode entry failed %d", ret);
+        return ret;
+      }
+
+      if (entry.invalid()) {
+        invalid.push_back(entry_pos);
+        continue;
+      }
+
+      ceph::bufferlist bl;
+      ret = entry.read(&bl);
+      if (ret < 0) {
+        CLS_ERR("ERROR: log_entry_read_range(): cannot read entry %d", ret);
+        return ret;
+      }
+
+      if (!op->skip_verify() && !entry.verify(&bl)) {
+        CLS_ERR("ERROR: log_entry_read_range(): entry %llu failed checksum",
+            entry_pos);
+        return -EIO;
+      }
+
+      auto data = fbb.CreateVector((uint8_t*)bl.c_str(), bl.length());
+      entries.push_back(cls_zlog::fbs::CreateBatchEntry(fbb, entry_pos, data));
+    }
+
+    if (!vals.empty()) {
+      start_after = vals.rbegin()->first;
+    }
+  }
+
+  auto reply = cls_zlog::fbs::CreateReadEntriesReplyDirect(fbb,
+      &entries, &invalid);
+  fbb.Finish(reply);
+
+  fbs_bl_encode(fbb, out);
+
+  return 0;
+}
+
+// entry_write takes the data and checksum in the op. entry_write2 takes a
+// LogEntry encoded by the client in the op's entry field. it is a separate
+// method so that an object class that predates the entry field fails the
+// write instead of ignoring the field and storing an empty entry.
+static int log_entry_write_op(cls_method_context_t hctx, ceph::bufferlist *in,
+    bool encoded)
 {
   auto op = fbs_bl_decode<cls_zlog::fbs::WriteEntryOp>(in);
   if (!op) {
@@ -66,6 +191,12 @@ static int log_entry_write(cls_method_context_t hctx, ceph::bufferlist *in,
     return -EINVAL;
   }
 
+  if (encoded != (op->entry() != nullptr)) {
+    CLS_ERR("ERROR: log_entry_write(): %s",
+        encoded ? "missing encoded entry" : "unexpected encoded entry");
+    return -EINVAL;
+  }
+
   cls_zlog::LogObjectHeader header(hctx);
   int ret = header.read();
   if (ret < 0) {
@@ -86,7 +217,9 @@ static int log_entry_write(cls_method_context_t hctx, ceph::bufferlist *in,
   }
 
   cls_zlog::LogEntry entry(hctx, op->position());
-  ret = entry.read();
+  cls_zlog::LogObjectStats stats(hctx);
+  ret = cls_zlog::read_entry_and_stats(hctx, op->position(), header, &entry,
+      &stats);
   if (ret < 0) {
     CLS_ERR("ERROR: log_entry_write(): init failed %d", ret);
     return ret;
@@ -97,12 +230,46 @@ static int log_entry_write(cls_method_context_t hctx, ceph::bufferlist *in,
     return -EROFS;
   }
 
-  std::string blob;
-  if (op->data()) {
-    blob = std::string(op->data()->begin(), op->data()->end());
+  // the data and checksum come from the entry encoded by the client, or from
+  // the op
+  const flatbuffers::Vector<uint8_t> *data = op->data();
+  boost::optional<uint32_t> crc;
+  if (op->has_crc()) {
+    crc = op->crc();
+  }
+
+  if (op->entry()) {
+    auto client_entry = fbs_decode<cls_zlog::fbs::LogEntry>(
+        op->entry()->data(), op->entry()->size());
+    if (!client_entry || client_entry->invalid() ||
+        client_entry->bytestream() || client_entry->offset() ||
+        client_entry->length()) {
+      CLS_ERR("ERROR: log_entry_write(): invalid encoded entry");
+      return -EINVAL;
+    }
+    data = client_entry->data();
+    crc = boost::none;
+    if (client_entry->has_crc()) {
+      crc = client_entry->crc();
+    }
+  }
+
+  const uint8_t *data_ptr = data ? data->data() : nullptr;
+  const size_t data_size = data ? data->size() : 0;
+
+  // the data is checked against the checksum computed by the client before
+  // it is stored
+  if (crc) {
+    if (zlog::crc32c::Value((const char*)data_ptr, data_size) != *crc) {
+      CLS_ERR("ERROR: log_entry_write(): data failed checksum");
+      return -EIO;
+    }
+    entry.set_crc(*crc);
   }
 
-  ret = entry.set_data(blob, header.omap_max_size());
+  ret = entry.set_data(in, data_ptr, data_size, header.omap_max_size(),
+      op->entry() ? op->entry()->data() : nullptr,
+      op->entry() ? op->entry()->size() : 0);
   if (ret < 0) {
     auto ms = header.omap_max_size();
     CLS_ERR("ERROR: log_entry_write(): set entry failed (b=%d) %d",
@@ -110,23 +277,217 @@ static int log_entry_write(cls_method_context_t hctx, ceph::bufferlist *in,
     return ret;
   }
 
-  ret = entry.write();
+  // the entry and the stats are written with one omap update, and the header
+  // isn't changed
+  std::map<std::string, ceph::bufferlist> vals;
+  entry.encode(&vals[entry.key()]);
+  stats.update_entry_bytes(0, entry.size());
+  stats.update_max_pos(op->position());
+  stats.encode(&vals[ZLOG_DATA_STATS_KEY]);
+
+  ret = cls_cxx_map_set_vals(hctx, &vals);
   if (ret < 0) {
     CLS_ERR("ERROR: log_entry_write(): entry write failed %d", ret);
     return ret;
   }
 
-  if (header.update_max_pos(op->position())) {
-    ret = header.write();
+  return 0;
+}
+
+static int log_entry_write(cls_method_context_t hctx, ceph::bufferlist *in,
+    ceph::bufferlist *out)
+{
+  return log_entry_write_op(hctx, in, false);
+}
+
+static int log_entry_write2(cls_method_context_t hctx, ceph::bufferlist *in,
+    ceph::bufferlist *out)
+{
+  return log_entry_write_op(hctx, in, true);
+}
+
+// writes a batch of entries with a single header read and update. the batch is
+// applied atomically: if any position has already been written or trimmed then
+// -EROFS is returned and no entries are written. write methods cannot return
+// per-entry results, so callers fall back to writing entries individually.
+static int log_entry_write_batch(cls_method_context_t hctx,
+    ceph::bufferlist *in, ceph::bufferlist *out)
+{
+  auto op = fbs_bl_decode<cls_zlog::fbs::WriteEntriesOp>(in);
+  if (!op) {
+    CLS_ERR("ERROR: log_entry_write_batch(): failed to decode input");
+    return -EINVAL;
+  }
+
+  if (!op->entries() || op->entries()->size() == 0) {
+    CLS_ERR("ERROR: log_entry_write_batch(): no entries");
+    return -EINVAL;
+  }
+
+  cls_zlog::LogObjectHeader header(hctx);
+  int ret = header.read();
+  if (ret < 0) {
+    CLS_ERR("ERROR: log_entry_write_batch(): failed to read header %d", ret);
+    return ret;
+  }
+
+  ret = header.epoch_guard(op->epoch());
+  if (ret < 0) {
+    CLS_LOG(10, "log_entry_write_batch(): failed epoch guard %d", ret);
+    return ret;
+  }
+
+  cls_zlog::LogObjectStats stats(hctx);
+  ret = stats.read(header);
+  if (ret < 0) {
+    CLS_ERR("ERROR: log_entry_write_batch(): failed to read stats %d", ret);
+    return ret;
+  }
+
+  std::map<std::string, ceph::bufferlist> entries;
+
+  for (const auto batch_entry : *op->entries()) {
+    const auto position = batch_entry->position();
+
+    if (header.position_trimmed(position)) {
+      CLS_LOG(10, "log_entry_write_batch(): position %llu in trim range",
+          position);
+      return -EROFS;
+    }
+
+    cls_zlog::LogEntry entry(hctx, position);
+    if (entries.count(entry.key())) {
+      CLS_ERR("ERROR: log_entry_write_batch(): duplicate position %llu",
+          position);
+      return -EINVAL;
+    }
+
+    ret = entry.read();
     if (ret < 0) {
-      CLS_ERR("ERROR: log_entry_write(): header update failed %d", ret);
+      CLS_ERR("ERROR: log_entry_write_batch(): init failed %d", ret);
       return ret;
     }
+
+    if (entry.exists()) {
+      CLS_LOG(10, "log_entry_write_batch(): entry %llu exists", position);
+      return -EROFS;
+    }
+
+    const auto data = batch_entry->data();
+    const uint8_t *data_ptr = data ? data->data() : nullptr;
+    const size_t data_size = data ? data->size() : 0;
+
+    if (batch_entry->has_crc()) {
+      if (zlog::crc32c::Value((const char*)data_ptr, data_size) !=
+          batch_entry->crc()) {
+        CLS_ERR("ERROR: log_entry_write_batch(): entry %llu failed checksum",
+            position);
+        return -EIO;
+      }
+      entry.set_crc(batch_entry->crc());
+    }
+
+    ret = entry.set_data(in, data_ptr, data_size, header.omap_max_size());
+    if (ret < 0) {
+      auto ms = header.omap_max_size();
+      CLS_ERR("ERROR: log_entry_write_batch(): set entry failed (b=%d) %d",
+          (ms ? (int)(*ms) : -1), ret);
+      return ret;
+    }
+
+    entry.encode(&entries[entry.key()]);
+
+    stats.update_entry_bytes(0, entry.size());
+    stats.update_max_pos(position);
+  }
+
+  stats.encode(&entries[ZLOG_DATA_STATS_KEY]);
+
+  ret = cls_cxx_map_set_vals(hctx, &entries);
+  if (ret < 0) {
+    CLS_ERR("ERROR: log_entry_write_batch(): entry write failed %d", ret);
+    return ret;
   }
 
   return 0;
 }
 
+// verifies the checksum of every readable entry, and returns the positions
+// that fail
+static int log_entry_scrub(cls_method_context_t hctx, ceph::bufferlist *in,
+    ceph::bufferlist *out)
+{
+  auto op = fbs_bl_decode<cls_zlog::fbs::ScrubOp>(in);
+  if (!op) {
+    CLS_ERR("ERROR: log_entry_scrub(): failed to decode input");
+    return -EINVAL;
+  }
+
+  cls_zlog::LogObjectHeader header(hctx);
+  int ret = header.read();
+  if (ret < 0) {
+    CLS_ERR("ERROR: log_entry_scrub(): failed to read header %d", ret);
+    return ret;
+  }
+
+  std::vector<uint64_t> corrupt;
+  std::string start_after;
+  bool more = true;
+  while (more) {
+    std::map<std::string, ceph::bufferlist> vals;
+    ret = cls_cxx_map_get_vals(hctx, start_after, ZLOG_ENTRY_KEY_PREFIX,
+        ZLOG_MAX_RANGE_READS, &vals, &more);
+    if (ret < 0) {
+      CLS_ERR("ERROR: log_entry_scrub(): omap range read failed %d", ret);
+      return ret;
+    }
+
+    for (auto& val : vals) {
+      const uint64_t entry_pos = strtoull(
+          val.first.c_str() + strlen(ZLOG_ENTRY_KEY_PREFIX), NULL, 10);
+      if (header.position_trimmed(entry_pos)) {
+        continue;
+      }
+
+      cls_zlog::LogEntry entry(hctx, entry_pos);
+      ret = entry.decode(&val.second);
+      if (ret < 0) {
+        CLS_ERR("ERROR: log_entry_scrub(): decode entry failed %d", ret);
+        return ret;
+      }
+
+      if (entry.invalid()) {
+        continue;
+      }
+
+      ceph::bufferlist bl;
+      ret = entry.read(&bl);
+      if (ret < 0) {
+        CLS_ERR("ERROR: log_entry_scrub(): cannot read entry %d", ret);
+        return ret;
+      }
+
+      if (!entry.verify(&bl)) {
+        CLS_LOG(0, "log_entry_scrub(): entry %llu failed checksum",
+            entry_pos);
+        corrupt.push_back(entry_pos);
+      }
+    }
+
+    if (!vals.empty()) {
+      start_after = vals.rbegin()->first;
+    }
+  }
+
+  flatbuffers::FlatBufferBuilder fbb;
+  auto reply = cls_zlog::fbs::CreateScrubReplyDirect(fbb, &corrupt);
+  fbb.Finish(reply);
+
+  fbs_bl_encode(fbb, out);
+
+  return 0;
+}
+
 static int log_entry_invalidate(cls_method_context_t hctx, ceph::bufferlist *in,
     ceph::bufferlist *out)
 {
@@ -154,6 +515,13 @@ static int log_entry_invalidate(cls_method_context_t hctx, ceph::bufferlist *in,
     return ret;
   }
 
+  cls_zlog::LogObjectStats stats(hctx);
+  ret = stats.read(header);
+  if (ret < 0) {
+    CLS_ERR("ERROR: log_entry_invalidate(): failed to read stats %d", ret);
+    return ret;
+  }
+
   // update the trim limit? actual gc is driven by the client
   if (op->limit()) {
     if (header.update_trim_limit(op->position())) {
@@ -163,6 +531,13 @@ static int log_entry_invalidate(cls_method_context_t hctx, ceph::bufferlist *in,
         return ret;
       }
     }
+    if (stats.update_max_pos(op->position())) {
+      ret = stats.write();
+      if (ret < 0) {
+        CLS_ERR("ERROR: log_entry_invalidate(): error writing stats %d", ret);
+        return ret;
+      }
+    }
     CLS_LOG(10, "log_entry_invalidate(): trim limit set %llu", op->position());
     return 0;
   }
@@ -193,21 +568,21 @@ static int log_entry_invalidate(cls_method_context_t hctx, ceph::bufferlist *in,
 
   // TODO: actually free data in omap?
 
+  const auto old_size = entry.size();
   entry.invalidate();
-  ret = entry.write();
+
+  std::map<std::string, ceph::bufferlist> vals;
+  entry.encode(&vals[entry.key()]);
+  stats.update_entry_bytes(old_size, entry.size());
+  stats.update_max_pos(op->position());
+  stats.encode(&vals[ZLOG_DATA_STATS_KEY]);
+
+  ret = cls_cxx_map_set_vals(hctx, &vals);
   if (ret < 0) {
     CLS_ERR("ERROR: log_entry_invalidate(): entry write failed %d", ret);
     return ret;
   }
 
-  if (header.update_max_pos(op->position())) {
-    ret = header.write();
-    if (ret < 0) {
-      CLS_ERR("ERROR: log_entry_invalidate(): header update failed %d", ret);
-      return ret;
-    }
-  }
-
   return 0;
 }
 
@@ -273,7 +648,14 @@ static int log_entry_max_position(cls_method_context_t hctx,
     return ret;
   }
 
-  auto max_pos = header.max_pos();
+  cls_zlog::LogObjectStats stats(hctx);
+  ret = stats.read(header);
+  if (ret < 0) {
+    CLS_ERR("ERROR: log_entry_max_position(): failed to read stats %d", ret);
+    return ret;
+  }
+
+  auto max_pos = stats.max_pos();
 
   flatbuffers::FlatBufferBuilder fbb;
   cls_zlog::fbs::ReadMaxPosReplyBuilder builder(fbb);
@@ -291,6 +673,157 @@ static int log_entry_max_position(cls_method_context_t hctx,
   return 0;
 }
 
+// removes the entries at or below the trim limit. every entry of the object
+// must be covered by the trim limit, so that the client can truncate the
+// bytestream in the same operation. keys are listed and removed in batches of
+// ZLOG_MAX_RANGE_READS.
+static int log_entry_trim_reclaim(cls_method_context_t hctx,
+    ceph::bufferlist *in, ceph::bufferlist *out)
+{
+  auto op = fbs_bl_decode<cls_zlog::fbs::TrimReclaimOp>(in);
+  if (!op) {
+    CLS_ERR("ERROR: log_entry_trim_reclaim(): failed to decode input");
+    return -EINVAL;
+  }
+
+  cls_zlog::LogObjectHeader header(hctx);
+  int ret = header.read();
+  if (ret < 0) {
+    CLS_ERR("ERROR: log_entry_trim_reclaim(): failed to read header %d", ret);
+    return ret;
+  }
+
+  ret = header.epoch_guard(op->epoch());
+  if (ret < 0) {
+    CLS_LOG(10, "log_entry_trim_reclaim(): failed epoch guard %d", ret);
+    return ret;
+  }
+
+  const auto trim_limit = header.trim_limit();
+  if (!trim_limit) {
+    CLS_ERR("ERROR: log_entry_trim_reclaim(): no trim limit");
+    return -EINVAL;
+  }
+
+  std::string start_after;
+  bool more = true;
+  while (more) {
+    std::set<std::string> keys;
+    ret = cls_cxx_map_get_keys(hctx, start_after, ZLOG_MAX_RANGE_READS,
+        &keys, &more);
+    if (ret < 0) {
+      CLS_ERR("ERROR: log_entry_trim_reclaim(): omap key read failed %d", ret);
+      return ret;
+    }
+
+    for (const auto& key : keys) {
+      if (key.compare(0, strlen(ZLOG_ENTRY_KEY_PREFIX),
+            ZLOG_ENTRY_KEY_PREFIX) != 0) {
+        continue;
+      }
+
+      const uint64_t entry_pos = strtoull(
+          key.c_str() + strlen(ZLOG_ENTRY_KEY_PREFIX), NULL, 10);
+      if (entry_pos > *trim_limit) {
+        CLS_ERR("ERROR: log_entry_trim_reclaim(): entry %llu above limit",
+            entry_pos);
+        return -EIO;
+      }
+
+      ret = cls_cxx_map_remove_key(hctx, key);
+      if (ret < 0) {
+        CLS_ERR("ERROR: log_entry_trim_reclaim(): remove key failed %d", ret);
+        return ret;
+      }
+    }
+
+    if (!keys.empty()) {
+      start_after = *keys.rbegin();
+    }
+  }
+
+  cls_zlog::LogObjectStats stats(hctx);
+  ret = stats.read(header);
+  if (ret < 0) {
+    CLS_ERR("ERROR: log_entry_trim_reclaim(): failed to read stats %d", ret);
+    return ret;
+  }
+
+  stats.reset_entry_bytes();
+  ret = stats.write();
+  if (ret < 0) {
+    CLS_ERR("ERROR: log_entry_trim_reclaim(): stats update failed %d", ret);
+    return ret;
+  }
+
+  return 0;
+}
+
+// the bytestream size plus the omap bytes used by entries
+static int log_entry_stat(cls_method_context_t hctx, ceph::bufferlist *in,
+    ceph::bufferlist *out)
+{
+  auto op = fbs_bl_decode<cls_zlog::fbs::StatOp>(in);
+  if (!op) {
+    CLS_ERR("ERROR: log_entry_stat(): failed to decode input");
+    return -EINVAL;
+  }
+
+  cls_zlog::LogObjectHeader header(hctx);
+  int ret = header.read();
+  if (ret < 0) {
+    CLS_ERR("ERROR: log_entry_stat(): failed to read header %d", ret);
+    return ret;
+  }
+
+  uint64_t size;
+  ret = cls_cxx_stat(hctx, &size, NULL);
+  if (ret < 0) {
+    CLS_ERR("ERROR: log_entry_stat(): stat failed %d", ret);
+    return ret;
+  }
+
+  cls_zlog::LogObjectStats stats(hctx);
+  ret = stats.read(header);
+  if (ret < 0) {
+    CLS_ERR("ERROR: log_entry_stat(): failed to read stats %d", ret);
+    return ret;
+  }
+
+  auto entry_bytes = stats.entry_bytes();
+  if (!entry_bytes) {
+    // the object predates the count of entry bytes
+    entry_bytes = 0;
+    std::string start_after;
+    bool more = true;
+    while (more) {
+      std::map<std::string, ceph::bufferlist> vals;
+      ret = cls_cxx_map_get_vals(hctx, start_after, ZLOG_ENTRY_KEY_PREFIX,
+          ZLOG_MAX_RANGE_READS, &vals, &more);
+      if (ret < 0) {
+        CLS_ERR("ERROR: log_entry_stat(): omap range read failed %d", ret);
+        return ret;
+      }
+
+      for (const auto& val : vals) {
+        *entry_bytes += val.first.size() + val.second.length();
+      }
+
+      if (!vals.empty()) {
+        start_after = vals.rbegin()->first;
+      }
+    }
+  }
+
+  flatbuffers::FlatBufferBuilder fbb;
+  auto reply = cls_zlog::fbs::CreateStatReply(fbb, size + *entry_bytes);
+  fbb.Finish(reply);
+
+  fbs_bl_encode(fbb, out);
+
+  return 0;
+}
+
 static int head_init(cls_method_context_t hctx, ceph::bufferlist *in,
     ceph::bufferlist *out)
 {
@@ -545,10 +1078,16 @@ void __cls_init()
 
   // log entry object methods
   cls_method_handle_t h_log_entry_read;
+  cls_method_handle_t h_log_entry_read_range;
   cls_method_handle_t h_log_entry_write;
+  cls_method_handle_t h_log_entry_write2;
+  cls_method_handle_t h_log_entry_write_batch;
   cls_method_handle_t h_log_entry_invalidate;
   cls_method_handle_t h_log_entry_seal;
   cls_method_handle_t h_log_entry_max_position;
+  cls_method_handle_t h_log_entry_scrub;
+  cls_method_handle_t h_log_entry_trim_reclaim;
+  cls_method_handle_t h_log_entry_stat;
 
   // head object methods
   cls_method_handle_t h_head_init;
@@ -564,10 +1103,22 @@ void __cls_init()
       CLS_METHOD_RD,
       log_entry_read, &h_log_entry_read);
 
+  cls_register_cxx_method(h_class, "entry_read_range",
+      CLS_METHOD_RD,
+      log_entry_read_range, &h_log_entry_read_range);
+
   cls_register_cxx_method(h_class, "entry_write",
       CLS_METHOD_RD | CLS_METHOD_WR,
       log_entry_write, &h_log_entry_write);
 
+  cls_register_cxx_method(h_class, "entry_write2",
+      CLS_METHOD_RD | CLS_METHOD_WR,
+      log_entry_write2, &h_log_entry_write2);
+
+  cls_register_cxx_method(h_class, "entry_write_batch",
+      CLS_METHOD_RD | CLS_METHOD_WR,
+      log_entry_write_batch, &h_log_entry_write_batch);
+
   cls_register_cxx_method(h_class, "entry_invalidate",
       CLS_METHOD_RD | CLS_METHOD_WR,
       log_entry_invalidate, &h_log_entry_invalidate);
@@ -580,6 +1131,18 @@ void __cls_init()
       CLS_METHOD_RD,
       log_entry_max_position, &h_log_entry_max_position);
 
+  cls_register_cxx_method(h_class, "entry_scrub",
+      CLS_METHOD_RD,
+      log_entry_scrub, &h_log_entry_scrub);
+
+  cls_register_cxx_method(h_class, "entry_trim_reclaim",
+      CLS_METHOD_RD | CLS_METHOD_WR,
+      log_entry_trim_reclaim, &h_log_entry_trim_reclaim);
+
+  cls_register_cxx_method(h_class, "entry_stat",
+      CLS_METHOD_RD,
+      log_entry_stat, &h_log_entry_stat);
+
   cls_register_cxx_method(h_class, "head_init",
       CLS_METHOD_RD | CLS_METHOD_WR,
       head_init, &h_head_init);
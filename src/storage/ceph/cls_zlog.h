@@ -1,18 +1,27 @@
 #pragma once
+#include <algorithm>
 #include <cerrno>
+#include <map>
+#include <set>
 #include <sstream>
 #include <string>
+#include <utility>
 #include <boost/optional.hpp>
 #include <rados/buffer.h>
 #include <rados/objclass.h>
 #include "storage/ceph/cls_zlog_generated.h"
+#include "util/crc32c.h"
 #include "fbs_helper.h"
 #include "common.h"
 
 #define ZLOG_MAX_VIEW_READS ((uint32_t)100)
+#define ZLOG_MAX_RANGE_READS ((uint64_t)1000)
 #define ZLOG_HEAD_HDR_KEY "zlog.head.header"
 #define ZLOG_VIEW_KEY_PREFIX "zlog.head.view."
 #define ZLOG_DATA_HDR_KEY "zlog.data.header"
+#define ZLOG_DATA_STATS_KEY "zlog.data.stats"
+// entry keys and the stats key. the header is an xattr.
+#define ZLOG_DATA_KEY_PREFIX "zlog.data."
 
 namespace cls_zlog {
 
@@ -29,7 +38,8 @@ class LogObjectHeader {
   explicit LogObjectHeader(cls_method_context_t hctx) :
     hctx_(hctx),
     empty_(true),
-    omap_max_size_(-1)
+    omap_max_size_(-1),
+    entry_bytes_(0)
   {}
 
   int read() {
@@ -59,6 +69,11 @@ class LogObjectHeader {
     if (header->trim_limit() >= 0) {
       trim_limit_ = uint64_t(header->trim_limit());
     }
+    if (header->entry_bytes() >= 0) {
+      entry_bytes_ = uint64_t(header->entry_bytes());
+    } else {
+      entry_bytes_ = boost::none;
+    }
 
     return 0;
   }
@@ -67,7 +82,8 @@ class LogObjectHeader {
     flatbuffers::FlatBufferBuilder fbb;
     auto header = fbs::CreateLogObjectHeader(fbb, epoch_,
         empty_, max_pos_, omap_max_size_,
-        (trim_limit_ ? int64_t(*trim_limit_) : -1));
+        (trim_limit_ ? int64_t(*trim_limit_) : -1),
+        (entry_bytes_ ? int64_t(*entry_bytes_) : -1));
     fbb.Finish(header);
 
     ceph::bufferlist bl;
@@ -94,21 +110,18 @@ class LogObjectHeader {
     epoch_ = epoch;
   }
 
-  boost::optional<uint64_t> max_pos() {
+  // the maximum position and entry bytes were kept in the header before
+  // they moved to LogObjectStats, which uses them for objects that don't
+  // have stats yet.
+  boost::optional<uint64_t> max_pos() const {
     if (!empty_) {
       return max_pos_;
     }
     return boost::none;
   }
 
-  bool update_max_pos(uint64_t pos) {
-    auto m = max_pos();
-    if (!m || pos > *m) {
-      max_pos_ = pos;
-      empty_ = false;
-      return true;
-    }
-    return false;
+  boost::optional<uint64_t> entry_bytes() const {
+    return entry_bytes_;
   }
 
   void set_omap_max_size(int32_t size) {
@@ -127,7 +140,6 @@ class LogObjectHeader {
   bool update_trim_limit(uint64_t position) {
     if (!trim_limit_ || position > *trim_limit_) {
       trim_limit_ = position;
-      update_max_pos(*trim_limit_);
       return true;
     }
     return false;
@@ -141,6 +153,10 @@ class LogObjectHeader {
     }
   }
 
+  boost::optional<uint64_t> trim_limit() const {
+    return trim_limit_;
+  }
+
  private:
   cls_method_context_t hctx_;
   uint64_t epoch_;
@@ -148,6 +164,121 @@ class LogObjectHeader {
   uint64_t max_pos_;
   int32_t omap_max_size_;
   boost::optional<uint64_t> trim_limit_;
+  boost::optional<uint64_t> entry_bytes_;
+};
+
+/*
+ * The maximum position and the entry bytes of a log object change with
+ * nearly every write. They are kept in an omap key rather than the header so
+ * that they are updated together with the entries in one omap update.
+ */
+class LogObjectStats {
+ public:
+  explicit LogObjectStats(cls_method_context_t hctx) :
+    hctx_(hctx),
+    empty_(true),
+    max_pos_(0),
+    entry_bytes_(0)
+  {}
+
+  // objects that haven't been written since the stats moved out of the
+  // header take their initial stats from it
+  int read(const LogObjectHeader& header) {
+    ceph::bufferlist bl;
+    int ret = cls_cxx_map_get_val(hctx_, ZLOG_DATA_STATS_KEY, &bl);
+    if (ret == -ENOENT) {
+      init(header);
+      return 0;
+    } else if (ret < 0) {
+      return ret;
+    }
+
+    return decode(&bl);
+  }
+
+  // initialize the stats of an object without a stats key
+  void init(const LogObjectHeader& header) {
+    const auto max_pos = header.max_pos();
+    empty_ = !max_pos;
+    max_pos_ = max_pos ? *max_pos : 0;
+    entry_bytes_ = header.entry_bytes();
+  }
+
+  // initialize the stats from the value of the stats key
+  int decode(ceph::bufferlist *bl) {
+    auto stats = fbs_bl_decode<fbs::LogObjectStats>(bl);
+    if (!stats) {
+      CLS_ERR("ERROR: LogObjectStats::read decode failed");
+      return -EIO;
+    }
+
+    empty_ = stats->empty();
+    max_pos_ = stats->max_pos();
+    if (stats->entry_bytes() >= 0) {
+      entry_bytes_ = uint64_t(stats->entry_bytes());
+    } else {
+      entry_bytes_ = boost::none;
+    }
+
+    return 0;
+  }
+
+  int write() {
+    ceph::bufferlist bl;
+    encode(&bl);
+    return cls_cxx_map_set_val(hctx_, ZLOG_DATA_STATS_KEY, &bl);
+  }
+
+  // encode the stats for callers that batch omap updates
+  void encode(ceph::bufferlist *bl) const {
+    flatbuffers::FlatBufferBuilder fbb;
+    auto stats = fbs::CreateLogObjectStats(fbb, empty_, max_pos_,
+        (entry_bytes_ ? int64_t(*entry_bytes_) : -1));
+    fbb.Finish(stats);
+
+    fbs_bl_encode(fbb, bl);
+  }
+
+  boost::optional<uint64_t> max_pos() const {
+    if (!empty_) {
+      return max_pos_;
+    }
+    return boost::none;
+  }
+
+  bool update_max_pos(uint64_t pos) {
+    auto m = max_pos();
+    if (!m || pos > *m) {
+      max_pos_ = pos;
+      empty_ = false;
+      return true;
+    }
+    return false;
+  }
+
+  // the omap bytes used by entries. boost::none if the object was created
+  // before the count was kept, in which case it must be computed.
+  boost::optional<uint64_t> entry_bytes() const {
+    return entry_bytes_;
+  }
+
+  // account for an entry whose size changed from old_size to new_size
+  void update_entry_bytes(uint64_t old_size, uint64_t new_size) {
+    if (entry_bytes_) {
+      *entry_bytes_ -= std::min(*entry_bytes_, old_size);
+      *entry_bytes_ += new_size;
+    }
+  }
+
+  void reset_entry_bytes() {
+    entry_bytes_ = 0;
+  }
+
+ private:
+  cls_method_context_t hctx_;
+  bool empty_;
+  uint64_t max_pos_;
+  boost::optional<uint64_t> entry_bytes_;
 };
 
 class LogEntry {
@@ -158,7 +289,10 @@ class LogEntry {
     hctx_(hctx),
     invalid_(false),
     offset_(0),
-    length_(0)
+    length_(0),
+    crc_(0),
+    has_crc_(false),
+    encoded_size_(0)
   {}
 
   int read() {
@@ -173,7 +307,19 @@ class LogEntry {
       return ret;
     }
 
-    auto entry = fbs_bl_decode<fbs::LogEntry>(&bl);
+    return decode(&bl);
+  }
+
+  // initialize an entry that was found not to exist
+  void init_missing() {
+    assert(!initialized());
+    exists_ = false;
+  }
+
+  // initialize the entry from its encoded omap value
+  int decode(ceph::bufferlist *bl) {
+    assert(!initialized());
+    auto entry = fbs_bl_decode<fbs::LogEntry>(bl);
     if (!entry) {
       CLS_ERR("ERROR: LogEntry::read decode failed");
       return -EIO;
@@ -182,10 +328,13 @@ class LogEntry {
     invalid_ = entry->invalid();
     bytestream_ = entry->bytestream();
     if (entry->data()) {
-      data_ = std::string(entry->data()->begin(), entry->data()->end());
+      data_.append((const char*)entry->data()->data(), entry->data()->size());
     }
     offset_ = entry->offset();
     length_ = entry->length();
+    crc_ = entry->crc();
+    has_crc_ = entry->has_crc();
+    encoded_size_ = bl->length();
 
     exists_ = true;
 
@@ -193,20 +342,44 @@ class LogEntry {
   }
 
   int write() {
-    flatbuffers::FlatBufferBuilder fbb(data_.size());
-    auto data = fbb.CreateVector((uint8_t*)data_.c_str(), data_.size());
+    ceph::bufferlist bl;
+    encode(&bl);
+    return cls_cxx_map_set_val(hctx_, entry_key_, &bl);
+  }
+
+  // encode the entry for callers that batch omap updates. an entry encoded
+  // by the client is used as is.
+  void encode(ceph::bufferlist *bl) {
+    if (value_.length()) {
+      bl->append(value_);
+      encoded_size_ = value_.length();
+      return;
+    }
+
+    flatbuffers::FlatBufferBuilder fbb(data_.length());
+    auto data = fbb.CreateVector((const uint8_t*)data_.c_str(),
+        data_.length());
     auto entry = fbs::CreateLogEntry(fbb,
         invalid_,
         bytestream_,
         data,
         offset_,
-        length_);
+        length_,
+        crc_,
+        has_crc_);
     fbb.Finish(entry);
 
-    ceph::bufferlist bl;
-    fbs_bl_encode(fbb, &bl);
+    fbs_bl_encode(fbb, bl);
+    encoded_size_ = bl->length();
+  }
 
-    return cls_cxx_map_set_val(hctx_, entry_key_, &bl);
+  const std::string& key() const {
+    return entry_key_;
+  }
+
+  // the omap bytes used by the entry as it was last read or encoded
+  uint64_t size() const {
+    return encoded_size_ ? entry_key_.size() + encoded_size_ : 0;
   }
 
   bool exists() const {
@@ -221,15 +394,38 @@ class LogEntry {
 
   void invalidate() {
     invalid_ = true;
+    value_.clear();
+  }
+
+  // the checksum computed by the client for data that will be set
+  void set_crc(uint32_t crc) {
+    crc_ = crc;
+    has_crc_ = true;
+  }
+
+  // check data read from the entry against its checksum, if it has one
+  bool verify(ceph::bufferlist *data) const {
+    return !has_crc_ ||
+      zlog::crc32c::Value(data->c_str(), data->length()) == crc_;
   }
 
-  int set_data(const std::string& data,
-      boost::optional<uint32_t> omap_max_size) {
+  // set the data of a new entry. data and encoded point into the input of the
+  // method, and are shared with it rather than copied. encoded is the entry as
+  // encoded by the client, if it sent one, and is stored as is when the entry
+  // is kept in omap.
+  int set_data(ceph::bufferlist *in, const uint8_t *data, size_t size,
+      boost::optional<uint32_t> omap_max_size,
+      const uint8_t *encoded = nullptr, size_t encoded_size = 0) {
     assert(offset_ == 0);
     assert(length_ == 0);
-    assert(data_.empty());
+    assert(data_.length() == 0);
 
-    if (omap_max_size && data.size() >= *omap_max_size) {
+    ceph::bufferlist bl;
+    if (size) {
+      bl.substr_of(*in, (const char*)data - in->c_str(), size);
+    }
+
+    if (omap_max_size && size >= *omap_max_size) {
       uint64_t obj_size;
       int ret = cls_cxx_stat(hctx_, &obj_size, NULL);
       if (ret < 0) {
@@ -238,10 +434,8 @@ class LogEntry {
       }
 
       offset_ = obj_size;
-      length_ = data.size();
+      length_ = size;
 
-      ceph::bufferlist bl;
-      bl.append(data.data(), data.size());
       ret = cls_cxx_write(hctx_, offset_, length_, &bl);
       if (ret < 0) {
         CLS_ERR("ERROR: set_data(): write failed %d", ret);
@@ -250,7 +444,11 @@ class LogEntry {
       return ret;
     } else {
       bytestream_ = false;
-      data_ = data;
+      data_ = std::move(bl);
+      if (encoded) {
+        value_.substr_of(*in, (const char*)encoded - in->c_str(),
+            encoded_size);
+      }
       return 0;
     }
   }
@@ -258,7 +456,7 @@ class LogEntry {
   int read(ceph::bufferlist *out) {
     assert(exists());
     if (bytestream_) {
-      if (!data_.empty()) {
+      if (data_.length()) {
         CLS_ERR("ERROR: unexpected data");
         return -EIO;
       }
@@ -272,7 +470,7 @@ class LogEntry {
         CLS_ERR("ERROR: unexpected offset / length");
         return -EIO;
       }
-      out->append(data_.c_str(), data_.size());
+      out->append(data_);
       return 0;
     }
   }
@@ -289,11 +487,65 @@ class LogEntry {
 
   bool invalid_;
   bool bytestream_;
-  std::string data_;
+  ceph::bufferlist data_;
   uint32_t offset_;
   uint32_t length_;
+  uint32_t crc_;
+  bool has_crc_;
+  uint32_t encoded_size_;
+  // the encoding of a new entry sent by the client
+  ceph::bufferlist value_;
 };
 
+/*
+ * Read an entry and the object stats with one omap lookup. Entry keys sort by
+ * position ahead of the stats key, so listing from the entry's key returns the
+ * entry if it exists and, unless more than one later position has been
+ * written, the stats key. Appends are usually at the highest position of an
+ * object, so the stats are only read separately when entries arrive out of
+ * order.
+ */
+static inline int read_entry_and_stats(cls_method_context_t hctx,
+    uint64_t pos, const LogObjectHeader& header, LogEntry *entry,
+    LogObjectStats *stats)
+{
+  // no key sorts between the key of the previous position and the entry
+  const auto start_after = pos ?
+    u64tostr(pos - 1, ZLOG_ENTRY_KEY_PREFIX) :
+    std::string(ZLOG_ENTRY_KEY_PREFIX);
+
+  std::map<std::string, ceph::bufferlist> vals;
+  bool more;
+  int ret = cls_cxx_map_get_vals(hctx, start_after, ZLOG_DATA_KEY_PREFIX, 2,
+      &vals, &more);
+  if (ret < 0) {
+    return ret;
+  }
+
+  auto it = vals.find(entry->key());
+  if (it != vals.end()) {
+    ret = entry->decode(&it->second);
+    if (ret < 0) {
+      return ret;
+    }
+  } else {
+    entry->init_missing();
+  }
+
+  it = vals.find(ZLOG_DATA_STATS_KEY);
+  if (it != vals.end()) {
+    return stats->decode(&it->second);
+  }
+
+  // every later key was listed, and the stats key wasn't among them
+  if (!more) {
+    stats->init(header);
+    return 0;
+  }
+
+  return stats->read(header);
+}
+
 /*
  * A head object contains log metadata including log views.
  */
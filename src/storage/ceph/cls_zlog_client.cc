@@ -3,14 +3,15 @@
 #include "cls_zlog_client.h"
 #include "storage/ceph/cls_zlog_generated.h"
 #include "fbs_helper.h"
+#include "util/crc32c.h"
 
 namespace cls_zlog_client {
 
 void cls_zlog_read(librados::ObjectReadOperation& op, uint64_t epoch,
-    uint64_t position)
+    uint64_t position, bool verify)
 {
   flatbuffers::FlatBufferBuilder fbb;
-  auto call = cls_zlog::fbs::CreateReadEntryOp(fbb, epoch, position);
+  auto call = cls_zlog::fbs::CreateReadEntryOp(fbb, epoch, position, !verify);
   fbb.Finish(call);
 
   ceph::bufferlist bl;
@@ -19,18 +20,77 @@ void cls_zlog_read(librados::ObjectReadOperation& op, uint64_t epoch,
   op.exec("zlog", "entry_read", bl);
 }
 
+void cls_zlog_read_range(librados::ObjectReadOperation& op, uint64_t epoch,
+    uint64_t min_position, uint64_t max_position, uint32_t stride,
+    bool verify)
+{
+  flatbuffers::FlatBufferBuilder fbb;
+  auto call = cls_zlog::fbs::CreateReadEntriesOp(fbb, epoch, min_position,
+      max_position, !verify, stride);
+  fbb.Finish(call);
+
+  ceph::bufferlist bl;
+  fbs_bl_encode(fbb, &bl);
+
+  op.exec("zlog", "entry_read_range", bl);
+}
+
 void cls_zlog_write(librados::ObjectWriteOperation& op, uint64_t epoch,
     uint64_t position, ceph::bufferlist& data)
 {
-  flatbuffers::FlatBufferBuilder fbb;
-  auto data_vec = fbb.CreateVector((uint8_t*)data.c_str(), data.length());
-  auto call = cls_zlog::fbs::CreateWriteEntryOp(fbb, epoch, position, data_vec);
+  // the entry is encoded here so that the object class can store it without
+  // encoding it again. it is sent to entry_write2, which an object class that
+  // can't decode it doesn't have.
+  const uint32_t crc = zlog::crc32c::Value(data.c_str(), data.length());
+  flatbuffers::FlatBufferBuilder entry_fbb(data.length() + 64);
+  auto entry_data = entry_fbb.CreateVector((uint8_t*)data.c_str(),
+      data.length());
+  auto entry = cls_zlog::fbs::CreateLogEntry(entry_fbb, false, false,
+      entry_data, 0, 0, crc, true);
+  entry_fbb.Finish(entry);
+
+  flatbuffers::FlatBufferBuilder fbb(entry_fbb.GetSize() + 64);
+  auto entry_vec = fbb.CreateVector(entry_fbb.GetBufferPointer(),
+      entry_fbb.GetSize());
+  cls_zlog::fbs::WriteEntryOpBuilder builder(fbb);
+  builder.add_epoch(epoch);
+  builder.add_position(position);
+  builder.add_entry(entry_vec);
+  auto call = builder.Finish();
   fbb.Finish(call);
 
   ceph::bufferlist bl;
   fbs_bl_encode(fbb, &bl);
 
-  op.exec("zlog", "entry_write", bl);
+  op.exec("zlog", "entry_write2", bl);
+}
+
+void cls_zlog_write_batch(librados::ObjectWriteOperation& op, uint64_t epoch,
+    const std::vector<std::pair<uint64_t, const std::string*>>& entries)
+{
+  size_t size = 0;
+  for (const auto& entry : entries) {
+    size += entry.second->size();
+  }
+
+  flatbuffers::FlatBufferBuilder fbb(size + 64 * entries.size());
+  std::vector<flatbuffers::Offset<cls_zlog::fbs::BatchEntry>> batch;
+  batch.reserve(entries.size());
+  for (const auto& entry : entries) {
+    auto data_vec = fbb.CreateVector((const uint8_t*)entry.second->data(),
+        entry.second->size());
+    const uint32_t crc = zlog::crc32c::Value(entry.second->data(),
+        entry.second->size());
+    batch.push_back(cls_zlog::fbs::CreateBatchEntry(fbb, entry.first,
+          data_vec, crc, true));
+  }
+  auto call = cls_zlog::fbs::CreateWriteEntriesOpDirect(fbb, epoch, &batch);
+  fbb.Finish(call);
+
+  ceph::bufferlist bl;
+  fbs_bl_encode(fbb, &bl);
+
+  op.exec("zlog", "entry_write_batch", bl);
 }
 
 void cls_zlog_invalidate(librados::ObjectWriteOperation& op,
@@ -74,6 +134,42 @@ void cls_zlog_max_position(librados::ObjectReadOperation& op)
   op.exec("zlog", "entry_max_position", bl);
 }
 
+void cls_zlog_scrub(librados::ObjectReadOperation& op)
+{
+  flatbuffers::FlatBufferBuilder fbb;
+  auto call = cls_zlog::fbs::CreateScrubOp(fbb);
+  fbb.Finish(call);
+
+  ceph::bufferlist bl;
+  fbs_bl_encode(fbb, &bl);
+
+  op.exec("zlog", "entry_scrub", bl);
+}
+
+void cls_zlog_trim_reclaim(librados::ObjectWriteOperation& op, uint64_t epoch)
+{
+  flatbuffers::FlatBufferBuilder fbb;
+  auto call = cls_zlog::fbs::CreateTrimReclaimOp(fbb, epoch);
+  fbb.Finish(call);
+
+  ceph::bufferlist bl;
+  fbs_bl_encode(fbb, &bl);
+
+  op.exec("zlog", "entry_trim_reclaim", bl);
+}
+
+void cls_zlog_stat(librados::ObjectReadOperation& op)
+{
+  flatbuffers::FlatBufferBuilder fbb;
+  auto call = cls_zlog::fbs::CreateStatOp(fbb);
+  fbb.Finish(call);
+
+  ceph::bufferlist bl;
+  fbs_bl_encode(fbb, &bl);
+
+  op.exec("zlog", "entry_stat", bl);
+}
+
 void cls_zlog_init_head(librados::ObjectWriteOperation& op,
     const std::string& prefix)
 {
@@ -1,4 +1,7 @@
 #pragma once
+#include <string>
+#include <utility>
+#include <vector>
 #include <boost/optional.hpp>
 #include <rados/librados.hpp>
 
@@ -7,12 +10,20 @@
 
 namespace cls_zlog_client {
 
+  // when verify is false the entry checksums aren't checked
   void cls_zlog_read(librados::ObjectReadOperation& op, uint64_t epoch,
-      uint64_t position);
+      uint64_t position, bool verify = true);
+
+  void cls_zlog_read_range(librados::ObjectReadOperation& op, uint64_t epoch,
+      uint64_t min_position, uint64_t max_position, uint32_t stride,
+      bool verify = true);
 
   void cls_zlog_write(librados::ObjectWriteOperation& op, uint64_t epoch,
       uint64_t position, ceph::bufferlist& data);
 
+  void cls_zlog_write_batch(librados::ObjectWriteOperation& op, uint64_t epoch,
+      const std::vector<std::pair<uint64_t, const std::string*>>& entries);
+
   // when force is true, limit=false -> position=log position
   //                     limit=true  -> position=upper-bound
   void cls_zlog_invalidate(librados::ObjectWriteOperation& op, uint64_t epoch,
@@ -23,6 +34,14 @@ namespace cls_zlog_client {
 
   void cls_zlog_max_position(librados::ObjectReadOperation& op);
 
+  void cls_zlog_scrub(librados::ObjectReadOperation& op);
+
+  // remove all entries at or below the trim limit
+  void cls_zlog_trim_reclaim(librados::ObjectWriteOperation& op,
+      uint64_t epoch);
+
+  void cls_zlog_stat(librados::ObjectReadOperation& op);
+
   void cls_zlog_init_head(librados::ObjectWriteOperation& op,
       const std::string& prefix);
 
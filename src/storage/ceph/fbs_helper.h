@@ -3,10 +3,8 @@
 #include "storage/ceph/cls_zlog_generated.h"
 
 template<typename T>
-static inline const T* fbs_bl_decode(ceph::bufferlist *bl)
+static inline const T* fbs_decode(const uint8_t *data, size_t len)
 {
-  const uint8_t *data = (const uint8_t*)bl->c_str();
-  const size_t len = bl->length();
   flatbuffers::Verifier verifier(data, len);
   if (!verifier.VerifyBuffer<T>(nullptr)) {
     return nullptr;
@@ -14,6 +12,12 @@ static inline const T* fbs_bl_decode(ceph::bufferlist *bl)
   return flatbuffers::GetRoot<T>(data);
 }
 
+template<typename T>
+static inline const T* fbs_bl_decode(ceph::bufferlist *bl)
+{
+  return fbs_decode<T>((const uint8_t*)bl->c_str(), bl->length());
+}
+
 static inline void fbs_bl_encode(flatbuffers::FlatBufferBuilder& fbb,
     ceph::bufferlist *bl)
 {
@@ -1,4 +1,5 @@
 #include <cerrno>
+#include <set>
 #include <string>
 #include <boost/uuid/uuid.hpp>
 #include <boost/uuid/uuid_generators.hpp>
@@ -9,6 +10,7 @@
 #include "port/stack_trace.h"
 #include "storage/ceph/cls_zlog_generated.h"
 #include "fbs_helper.h"
+#include "util/crc32c.h"
 
 class ClsZlogTest : public ::testing::Test {
  protected:
@@ -57,6 +59,14 @@ class ClsZlogTest : public ::testing::Test {
     return ioctx.operate(oid, &op);
   }
 
+  int entry_write_batch(uint64_t epoch,
+      const std::vector<std::pair<uint64_t, const std::string*>>& entries,
+      const std::string& oid = "obj") {
+    librados::ObjectWriteOperation op;
+    cls_zlog_client::cls_zlog_write_batch(op, epoch, entries);
+    return ioctx.operate(oid, &op);
+  }
+
   int entry_inval(uint64_t epoch, uint64_t pos,
       bool force, bool limit = false, const std::string& oid = "obj") {
     librados::ObjectWriteOperation op;
@@ -96,6 +106,57 @@ class ClsZlogTest : public ::testing::Test {
     return 0;
   }
 
+  int entry_scrub(std::set<uint64_t> *corrupt_out,
+      const std::string& oid = "obj") {
+    librados::ObjectReadOperation op;
+    cls_zlog_client::cls_zlog_scrub(op);
+
+    ceph::bufferlist bl;
+    int ret = ioctx.operate(oid, &op, &bl);
+    if (ret) {
+      return ret;
+    }
+
+    auto reply = fbs_bl_decode<cls_zlog::fbs::ScrubReply>(&bl);
+    if (!reply) {
+      return -EIO;
+    }
+
+    corrupt_out->clear();
+    if (reply->corrupt()) {
+      corrupt_out->insert(reply->corrupt()->begin(), reply->corrupt()->end());
+    }
+
+    return 0;
+  }
+
+  int entry_trim_reclaim(uint64_t epoch, const std::string& oid = "obj") {
+    librados::ObjectWriteOperation op;
+    cls_zlog_client::cls_zlog_trim_reclaim(op, epoch);
+    op.truncate(0);
+    return ioctx.operate(oid, &op);
+  }
+
+  int entry_stat(uint64_t *size_out, const std::string& oid = "obj") {
+    librados::ObjectReadOperation op;
+    cls_zlog_client::cls_zlog_stat(op);
+
+    ceph::bufferlist bl;
+    int ret = ioctx.operate(oid, &op, &bl);
+    if (ret) {
+      return ret;
+    }
+
+    auto reply = fbs_bl_decode<cls_zlog::fbs::StatReply>(&bl);
+    if (!reply) {
+      return -EIO;
+    }
+
+    *size_out = reply->size();
+
+    return 0;
+  }
+
   int view_create(uint64_t epoch, ceph::bufferlist& bl,
       const std::string& oid = "obj") {
     librados::ObjectWriteOperation op;
@@ -583,6 +644,421 @@ TEST_F(ClsZlogTest, WriteEntry_TrimLimit) {
   ASSERT_EQ(ret, 0);
 }
 
+TEST_F(ClsZlogTest, WriteEntryBatch_BadInput) {
+  ceph::bufferlist inbl, outbl;
+  inbl.append("foo", strlen("foo"));
+  int ret = exec("entry_write_batch", inbl, outbl);
+  ASSERT_EQ(ret, -EINVAL);
+}
+
+TEST_F(ClsZlogTest, WriteEntryBatch_StaleEpoch) {
+  std::string data("foo");
+  int ret = entry_write_batch(1, {{0, &data}});
+  ASSERT_EQ(ret, -ENOENT);
+
+  ret = entry_seal(2);
+  ASSERT_EQ(ret, 0);
+
+  ret = entry_write_batch(1, {{0, &data}, {1, &data}});
+  ASSERT_EQ(ret, -ESPIPE);
+
+  ret = entry_write_batch(2, {{0, &data}, {1, &data}});
+  ASSERT_EQ(ret, 0);
+}
+
+TEST_F(ClsZlogTest, WriteEntryBatch) {
+  int ret = entry_seal(1);
+  ASSERT_EQ(ret, 0);
+
+  std::string a("a"), b("bb"), c("ccc");
+  ret = entry_write_batch(1, {{10, &a}, {5, &b}, {20, &c}});
+  ASSERT_EQ(ret, 0);
+
+  ceph::bufferlist bl;
+  ret = entry_read(1, 5, bl);
+  ASSERT_EQ(ret, 0);
+  ASSERT_EQ(bl.to_str(), b);
+
+  bool empty;
+  uint64_t pos;
+  ret = entry_maxpos(&pos, &empty);
+  ASSERT_EQ(ret, 0);
+  ASSERT_FALSE(empty);
+  ASSERT_EQ(pos, 20u);
+
+  // the batch is all-or-nothing
+  ret = entry_write_batch(1, {{30, &a}, {10, &a}});
+  ASSERT_EQ(ret, -EROFS);
+  bl.clear();
+  ret = entry_read(1, 30, bl);
+  ASSERT_EQ(ret, -ERANGE);
+
+  ret = entry_write_batch(1, {{30, &a}, {30, &b}});
+  ASSERT_EQ(ret, -EINVAL);
+
+  ret = entry_inval(1, 40, true, true);
+  ASSERT_EQ(ret, 0);
+  ret = entry_write_batch(1, {{41, &a}, {40, &a}});
+  ASSERT_EQ(ret, -EROFS);
+}
+
+TEST_F(ClsZlogTest, WriteEntry_BadChecksum) {
+  int ret = entry_seal(1);
+  ASSERT_EQ(ret, 0);
+
+  flatbuffers::FlatBufferBuilder fbb;
+  std::vector<uint8_t> data{'f', 'o', 'o'};
+  auto call = cls_zlog::fbs::CreateWriteEntryOpDirect(fbb, 1, 160, &data,
+      1234, true);
+  fbb.Finish(call);
+
+  ceph::bufferlist inbl, outbl;
+  fbs_bl_encode(fbb, &inbl);
+  ret = exec("entry_write", inbl, outbl);
+  ASSERT_EQ(ret, -EIO);
+
+  ceph::bufferlist bl;
+  ret = entry_read(1, 160, bl);
+  ASSERT_EQ(ret, -ERANGE);
+}
+
+TEST_F(ClsZlogTest, Scrub) {
+  std::set<uint64_t> corrupt;
+  int ret = entry_scrub(&corrupt);
+  ASSERT_EQ(ret, -ENOENT);
+
+  ret = entry_seal(1);
+  ASSERT_EQ(ret, 0);
+
+  std::string a("a"), b("bb");
+  ret = entry_write_batch(1, {{10, &a}, {20, &b}});
+  ASSERT_EQ(ret, 0);
+
+  ret = entry_inval(1, 30, true);
+  ASSERT_EQ(ret, 0);
+
+  ret = entry_scrub(&corrupt);
+  ASSERT_EQ(ret, 0);
+  ASSERT_TRUE(corrupt.empty());
+
+  // replace entry 20 with one whose data doesn't match its checksum
+  flatbuffers::FlatBufferBuilder fbb;
+  std::vector<uint8_t> data{'c', 'c'};
+  auto entry = cls_zlog::fbs::CreateLogEntryDirect(fbb, false, false, &data,
+      0, 0, zlog::crc32c::Value(b.data(), b.size()), true);
+  fbb.Finish(entry);
+
+  ceph::bufferlist bl;
+  fbs_bl_encode(fbb, &bl);
+  std::map<std::string, ceph::bufferlist> keys;
+  keys["zlog.data.entry.00000000000000000020"] = bl;
+  ioctx.omap_set("obj", keys);
+
+  ret = entry_scrub(&corrupt);
+  ASSERT_EQ(ret, 0);
+  ASSERT_EQ(corrupt, std::set<uint64_t>({20}));
+
+  bl.clear();
+  ret = entry_read(1, 20, bl);
+  ASSERT_EQ(ret, -EIO);
+
+  librados::ObjectReadOperation op;
+  cls_zlog_client::cls_zlog_read(op, 1, 20, false);
+  bl.clear();
+  ret = ioctx.operate("obj", &op, &bl);
+  ASSERT_EQ(ret, 0);
+  ASSERT_EQ(bl.to_str(), "cc");
+
+  bl.clear();
+  ret = entry_read(1, 10, bl);
+  ASSERT_EQ(ret, 0);
+  ASSERT_EQ(bl.to_str(), a);
+}
+
+TEST_F(ClsZlogTest, WriteEntry_BadEncodedEntry) {
+  int ret = entry_seal(1);
+  ASSERT_EQ(ret, 0);
+
+  flatbuffers::FlatBufferBuilder entry_fbb;
+  std::vector<uint8_t> data{'f', 'o', 'o'};
+  auto entry = cls_zlog::fbs::CreateLogEntryDirect(entry_fbb, true, false,
+      &data);
+  entry_fbb.Finish(entry);
+
+  flatbuffers::FlatBufferBuilder fbb;
+  std::vector<uint8_t> encoded(entry_fbb.GetBufferPointer(),
+      entry_fbb.GetBufferPointer() + entry_fbb.GetSize());
+  auto call = cls_zlog::fbs::CreateWriteEntryOpDirect(fbb, 1, 160, nullptr,
+      0, false, &encoded);
+  fbb.Finish(call);
+
+  ceph::bufferlist inbl, outbl;
+  fbs_bl_encode(fbb, &inbl);
+  ret = exec("entry_write2", inbl, outbl);
+  ASSERT_EQ(ret, -EINVAL);
+
+  // not a LogEntry
+  encoded.assign(3, 'x');
+  fbb.Clear();
+  call = cls_zlog::fbs::CreateWriteEntryOpDirect(fbb, 1, 160, nullptr,
+      0, false, &encoded);
+  fbb.Finish(call);
+
+  inbl.clear();
+  fbs_bl_encode(fbb, &inbl);
+  ret = exec("entry_write2", inbl, outbl);
+  ASSERT_EQ(ret, -EINVAL);
+}
+
+// entry_write only takes the data in the op, and entry_write2 only takes an
+// encoded entry, so neither stores an empty entry for the other's op
+TEST_F(ClsZlogTest, WriteEntry_EncodedEntryMethod) {
+  int ret = entry_seal(1);
+  ASSERT_EQ(ret, 0);
+
+  std::vector<uint8_t> data{'f', 'o', 'o'};
+  flatbuffers::FlatBufferBuilder entry_fbb;
+  auto entry = cls_zlog::fbs::CreateLogEntryDirect(entry_fbb, false, false,
+      &data, 0, 0, zlog::crc32c::Value((const char*)data.data(), data.size()),
+      true);
+  entry_fbb.Finish(entry);
+
+  flatbuffers::FlatBufferBuilder fbb;
+  std::vector<uint8_t> encoded(entry_fbb.GetBufferPointer(),
+      entry_fbb.GetBufferPointer() + entry_fbb.GetSize());
+  auto call = cls_zlog::fbs::CreateWriteEntryOpDirect(fbb, 1, 160, nullptr,
+      0, false, &encoded);
+  fbb.Finish(call);
+
+  ceph::bufferlist inbl, outbl;
+  fbs_bl_encode(fbb, &inbl);
+  ret = exec("entry_write", inbl, outbl);
+  ASSERT_EQ(ret, -EINVAL);
+
+  ceph::bufferlist bl;
+  ret = entry_read(1, 160, bl);
+  ASSERT_EQ(ret, -ERANGE);
+
+  fbb.Clear();
+  call = cls_zlog::fbs::CreateWriteEntryOpDirect(fbb, 1, 160, &data);
+  fbb.Finish(call);
+
+  inbl.clear();
+  fbs_bl_encode(fbb, &inbl);
+  ret = exec("entry_write2", inbl, outbl);
+  ASSERT_EQ(ret, -EINVAL);
+
+  ret = entry_read(1, 160, bl);
+  ASSERT_EQ(ret, -ERANGE);
+
+  ret = exec("entry_write", inbl, outbl);
+  ASSERT_EQ(ret, 0);
+
+  ret = entry_read(1, 160, bl);
+  ASSERT_EQ(ret, 0);
+  ASSERT_EQ(bl.to_str(), "foo");
+}
+
+// objects written before the stats were kept in omap take them from the
+// header
+TEST_F(ClsZlogTest, StatsFromHeader) {
+  int ret = ioctx.create("obj", true);
+  ASSERT_EQ(ret, 0);
+
+  flatbuffers::FlatBufferBuilder fbb;
+  auto header = cls_zlog::fbs::CreateLogObjectHeader(fbb, 1, false, 7, -1,
+      -1, -1);
+  fbb.Finish(header);
+
+  ceph::bufferlist bl;
+  fbs_bl_encode(fbb, &bl);
+  ret = ioctx.setxattr("obj", "zlog.data.header", bl);
+  ASSERT_EQ(ret, 0);
+
+  bool empty;
+  uint64_t pos;
+  ret = entry_maxpos(&pos, &empty);
+  ASSERT_EQ(ret, 0);
+  ASSERT_FALSE(empty);
+  ASSERT_EQ(pos, 7u);
+
+  bl.clear();
+  bl.append("foo", strlen("foo"));
+  ret = entry_write(1, 3, bl);
+  ASSERT_EQ(ret, 0);
+
+  ret = entry_maxpos(&pos, &empty);
+  ASSERT_EQ(ret, 0);
+  ASSERT_FALSE(empty);
+  ASSERT_EQ(pos, 7u);
+
+  // the entry bytes weren't counted, and are computed
+  uint64_t size;
+  ret = entry_stat(&size);
+  ASSERT_EQ(ret, 0);
+  ASSERT_GT(size, 3u);
+
+  ret = entry_write(1, 9, bl);
+  ASSERT_EQ(ret, 0);
+
+  ret = entry_maxpos(&pos, &empty);
+  ASSERT_EQ(ret, 0);
+  ASSERT_FALSE(empty);
+  ASSERT_EQ(pos, 9u);
+
+  uint64_t size2;
+  ret = entry_stat(&size2);
+  ASSERT_EQ(ret, 0);
+  ASSERT_GT(size2, size);
+}
+
+// writes below positions that have already been written find the entry and
+// the stats with separate lookups
+TEST_F(ClsZlogTest, WriteEntry_OutOfOrder) {
+  int ret = entry_seal(1);
+  ASSERT_EQ(ret, 0);
+
+  ceph::bufferlist bl;
+  bl.append("foo", strlen("foo"));
+
+  for (uint64_t pos : {9, 8, 0, 5, 4, 1}) {
+    ret = entry_write(1, pos, bl);
+    ASSERT_EQ(ret, 0);
+
+    ret = entry_write(1, pos, bl);
+    ASSERT_EQ(ret, -EROFS);
+  }
+
+  bool empty;
+  uint64_t pos;
+  ret = entry_maxpos(&pos, &empty);
+  ASSERT_EQ(ret, 0);
+  ASSERT_FALSE(empty);
+  ASSERT_EQ(pos, 9u);
+
+  uint64_t size;
+  ret = entry_stat(&size);
+  ASSERT_EQ(ret, 0);
+
+  // the count of entry bytes was kept by every write
+  std::map<std::string, ceph::bufferlist> vals;
+  ret = ioctx.omap_get_vals("obj", "", "zlog.data.entry.", 100, &vals);
+  ASSERT_EQ(ret, 0);
+  ASSERT_EQ(vals.size(), 6u);
+
+  uint64_t entry_bytes = 0;
+  for (const auto& val : vals) {
+    entry_bytes += val.first.size() + val.second.length();
+  }
+  ASSERT_EQ(size, entry_bytes);
+}
+
+TEST_F(ClsZlogTest, TrimReclaim) {
+  int ret = entry_trim_reclaim(1);
+  ASSERT_EQ(ret, -ENOENT);
+
+  librados::ObjectWriteOperation op;
+  cls_zlog_client::cls_zlog_seal(op, 1, 0);
+  ret = ioctx.operate("obj", &op);
+  ASSERT_EQ(ret, 0);
+
+  // no trim limit
+  ret = entry_trim_reclaim(1);
+  ASSERT_EQ(ret, -EINVAL);
+
+  std::string data(100, 'a');
+  for (uint64_t pos = 0; pos < 2500; pos++) {
+    ret = entry_write_batch(1, {{pos, &data}});
+    ASSERT_EQ(ret, 0);
+  }
+
+  ret = entry_inval(1, 1000, true, true);
+  ASSERT_EQ(ret, 0);
+
+  // entries above the trim limit
+  ret = entry_trim_reclaim(1);
+  ASSERT_EQ(ret, -EIO);
+
+  ret = entry_inval(1, 2499, true, true);
+  ASSERT_EQ(ret, 0);
+
+  ret = entry_trim_reclaim(0);
+  ASSERT_EQ(ret, -EINVAL);
+
+  ret = entry_seal(2);
+  ASSERT_EQ(ret, 0);
+  ret = entry_trim_reclaim(1);
+  ASSERT_EQ(ret, -ESPIPE);
+
+  ret = entry_trim_reclaim(2);
+  ASSERT_EQ(ret, 0);
+
+  std::map<std::string, ceph::bufferlist> vals;
+  ret = ioctx.omap_get_vals("obj", "", "zlog.data.entry.", 100, &vals);
+  ASSERT_EQ(ret, 0);
+  ASSERT_TRUE(vals.empty());
+
+  uint64_t size;
+  ret = entry_stat(&size);
+  ASSERT_EQ(ret, 0);
+  ASSERT_EQ(size, 0u);
+
+  ceph::bufferlist bl;
+  ret = entry_read(2, 100, bl);
+  ASSERT_EQ(ret, -ENODATA);
+}
+
+TEST_F(ClsZlogTest, Stat) {
+  uint64_t size;
+  int ret = entry_stat(&size);
+  ASSERT_EQ(ret, -ENOENT);
+
+  ret = entry_seal(1);
+  ASSERT_EQ(ret, 0);
+
+  ret = entry_stat(&size);
+  ASSERT_EQ(ret, 0);
+  ASSERT_EQ(size, 0u);
+
+  std::string a("a"), b(100, 'b');
+  ret = entry_write_batch(1, {{0, &a}, {1, &b}});
+  ASSERT_EQ(ret, 0);
+
+  uint64_t size1;
+  ret = entry_stat(&size1);
+  ASSERT_EQ(ret, 0);
+  ASSERT_GT(size1, b.size());
+
+  ceph::bufferlist bl;
+  bl.append(b);
+  ret = entry_write(1, 2, bl);
+  ASSERT_EQ(ret, 0);
+
+  uint64_t size2;
+  ret = entry_stat(&size2);
+  ASSERT_EQ(ret, 0);
+  ASSERT_GT(size2, size1 + b.size());
+
+  // the count matches the omap
+  std::map<std::string, ceph::bufferlist> vals;
+  ret = ioctx.omap_get_vals("obj", "", "zlog.data.entry.", 100, &vals);
+  ASSERT_EQ(ret, 0);
+  uint64_t omap_size = 0;
+  for (const auto& val : vals) {
+    omap_size += val.first.size() + val.second.length();
+  }
+  ASSERT_EQ(size2, omap_size);
+
+  // filled positions are counted
+  ret = entry_inval(1, 10, false);
+  ASSERT_EQ(ret, 0);
+
+  uint64_t size3;
+  ret = entry_stat(&size3);
+  ASSERT_EQ(ret, 0);
+  ASSERT_GT(size3, size2);
+}
+
 TEST_F(ClsZlogTest, InvalidateEntry_BadInput) {
   ceph::bufferlist inbl, outbl;
   inbl.append("foo", strlen("foo"));
@@ -0,0 +1,576 @@
+#include "storage/io_engine.h"
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <errno.h>
+#include <limits.h>
+#include <unistd.h>
+#ifdef HAVE_IO_URING
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+
+namespace zlog {
+namespace storage {
+
+namespace {
+
+// a request is split into system calls of at most IOV_MAX iovecs and
+// resumed after short transfers
+struct Request {
+  enum Op {
+    READ,
+    WRITE,
+    SYNC,
+  };
+
+  Request(Op op, int fd, const struct iovec *iov, int iovcnt,
+      uint64_t offset, bool sync, std::function<void(ssize_t)> cb) :
+    op(op), fd(fd), iov(iov, iov + iovcnt), offset(offset),
+    sync(sync), cb(std::move(cb))
+  {}
+
+  Op op;
+  int fd;
+  std::vector<struct iovec> iov;
+  size_t next = 0;
+  uint64_t offset;
+  bool sync;
+  ssize_t transferred = 0;
+  std::function<void(ssize_t)> cb;
+
+  struct iovec *cur_iov() {
+    return iov.data() + next;
+  }
+
+  int cur_iovcnt() const {
+    return std::min(iov.size() - next, size_t(IOV_MAX));
+  }
+
+  bool remaining() const {
+    return next < iov.size();
+  }
+
+  void advance(size_t n) {
+    transferred += n;
+    offset += n;
+    while (n > 0) {
+      auto& v = iov[next];
+      if (n >= v.iov_len) {
+        n -= v.iov_len;
+        next++;
+      } else {
+        v.iov_base = static_cast<char*>(v.iov_base) + n;
+        v.iov_len -= n;
+        n = 0;
+      }
+    }
+    // skip empty iovecs so that a finished request has none left
+    while (next < iov.size() && iov[next].iov_len == 0) {
+      next++;
+    }
+  }
+
+  // update the request with the result of a system call. returns true when
+  // the request is finished, with @result set.
+  bool complete(ssize_t ret, ssize_t *result) {
+    if (ret == -EINTR || ret == -EAGAIN) {
+      return false;
+    }
+
+    if (ret < 0) {
+      *result = ret;
+      return true;
+    }
+
+    switch (op) {
+      case READ:
+        if (ret == 0) {
+          *result = transferred;
+          return true;
+        }
+        advance(ret);
+        if (remaining()) {
+          return false;
+        }
+        *result = transferred;
+        return true;
+
+      case WRITE:
+        if (ret == 0) {
+          *result = -EIO;
+          return true;
+        }
+        advance(ret);
+        if (remaining()) {
+          return false;
+        }
+        if (sync) {
+          op = SYNC;
+          return false;
+        }
+        *result = transferred;
+        return true;
+
+      case SYNC:
+        *result = transferred;
+        return true;
+    }
+
+    assert(0);
+    return true;
+  }
+};
+
+// runs each request with blocking system calls on a pool of threads. this
+// is used where io_uring isn't available.
+class ThreadPoolEngine : public IOEngine {
+ public:
+  explicit ThreadPoolEngine(unsigned num_threads) {
+    for (unsigned i = 0; i < std::max(num_threads, 1u); i++) {
+      threads_.emplace_back(&ThreadPoolEngine::Run, this);
+    }
+  }
+
+  ~ThreadPoolEngine() {
+    {
+      std::lock_guard<std::mutex> lk(lock_);
+      stop_ = true;
+    }
+    cond_.notify_all();
+    for (auto& thread : threads_) {
+      thread.join();
+    }
+    assert(queue_.empty());
+  }
+
+  std::string name() const override {
+    return "threads";
+  }
+
+  void Read(int fd, const struct iovec *iov, int iovcnt, uint64_t offset,
+      std::function<void(ssize_t)> cb) override {
+    Submit(new Request(Request::READ, fd, iov, iovcnt, offset, false,
+          std::move(cb)));
+  }
+
+  void Write(int fd, const struct iovec *iov, int iovcnt, uint64_t offset,
+      bool sync, std::function<void(ssize_t)> cb) override {
+    Submit(new Request(Request::WRITE, fd, iov, iovcnt, offset, sync,
+          std::move(cb)));
+  }
+
+ private:
+  void Submit(Request *req) {
+    {
+      std::lock_guard<std::mutex> lk(lock_);
+      queue_.push_back(req);
+    }
+    cond_.notify_one();
+  }
+
+  void Run() {
+    std::unique_lock<std::mutex> lk(lock_);
+    while (true) {
+      // requests submitted by callbacks are run before stopping
+      if (queue_.empty()) {
+        if (stop_) {
+          break;
+        }
+        cond_.wait(lk);
+        continue;
+      }
+
+      auto req = queue_.front();
+      queue_.pop_front();
+      lk.unlock();
+
+      ssize_t result;
+      while (true) {
+        ssize_t ret;
+        switch (req->op) {
+          case Request::READ:
+            ret = preadv(req->fd, req->cur_iov(), req->cur_iovcnt(),
+                req->offset);
+            break;
+          case Request::WRITE:
+            ret = pwritev(req->fd, req->cur_iov(), req->cur_iovcnt(),
+                req->offset);
+            break;
+          case Request::SYNC:
+            ret = fdatasync(req->fd);
+            break;
+          default:
+            assert(0);
+            ret = -EINVAL;
+        }
+        if (ret < 0) {
+          ret = -errno;
+        }
+        if (req->complete(ret, &result)) {
+          break;
+        }
+      }
+
+      req->cb(result);
+      delete req;
+
+      lk.lock();
+    }
+  }
+
+  std::mutex lock_;
+  std::condition_variable cond_;
+  std::deque<Request*> queue_;
+  bool stop_ = false;
+  std::vector<std::thread> threads_;
+};
+
+#ifdef HAVE_IO_URING
+static int io_uring_setup(unsigned entries, struct io_uring_params *p)
+{
+  int ret = syscall(__NR_io_uring_setup, entries, p);
+  return ret < 0 ? -errno : ret;
+}
+
+static int io_uring_enter(int fd, unsigned to_submit,
+    unsigned min_complete, unsigned flags)
+{
+  int ret = syscall(__NR_io_uring_enter, fd, to_submit, min_complete,
+      flags, nullptr, 0);
+  return ret < 0 ? -errno : ret;
+}
+
+/*
+ * Submits requests to an io_uring from the calling thread, and reaps
+ * completions on a dedicated thread that also runs the callbacks. The number
+ * of requests in the ring is bounded by the size of the submission queue,
+ * which is half the size of the completion queue, so completions can't
+ * overflow. Requests beyond that wait in a backlog.
+ */
+class UringEngine : public IOEngine {
+ public:
+  ~UringEngine() {
+    if (ring_fd_ < 0) {
+      return;
+    }
+
+    if (reaper_.joinable()) {
+      std::unique_lock<std::mutex> lk(lock_);
+      idle_.wait(lk, [this] { return outstanding_ == 0; });
+      // wake up the reaper
+      auto sqe = GetSqe();
+      sqe->opcode = IORING_OP_NOP;
+      sqe->user_data = 0;
+      Push();
+      lk.unlock();
+      reaper_.join();
+    }
+
+    if (sqes_) {
+      munmap(sqes_, sqes_size_);
+    }
+    if (cq_ring_ && cq_ring_ != sq_ring_) {
+      munmap(cq_ring_, cq_ring_size_);
+    }
+    if (sq_ring_) {
+      munmap(sq_ring_, sq_ring_size_);
+    }
+    close(ring_fd_);
+  }
+
+  int Init(unsigned depth) {
+    struct io_uring_params p;
+    memset(&p, 0, sizeof(p));
+    int ret = io_uring_setup(std::max(depth, 1u), &p);
+    if (ret < 0) {
+      return ret;
+    }
+    ring_fd_ = ret;
+
+    sq_ring_size_ = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    cq_ring_size_ = p.cq_off.cqes +
+      p.cq_entries * sizeof(struct io_uring_cqe);
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+      sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+    }
+
+    auto ptr = mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE,
+        MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQ_RING);
+    if (ptr == MAP_FAILED) {
+      return -errno;
+    }
+    sq_ring_ = static_cast<char*>(ptr);
+
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+      cq_ring_ = sq_ring_;
+    } else {
+      ptr = mmap(nullptr, cq_ring_size_, PROT_READ | PROT_WRITE,
+          MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_CQ_RING);
+      if (ptr == MAP_FAILED) {
+        return -errno;
+      }
+      cq_ring_ = static_cast<char*>(ptr);
+    }
+
+    sqes_size_ = p.sq_entries * sizeof(struct io_uring_sqe);
+    ptr = mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE,
+        MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQES);
+    if (ptr == MAP_FAILED) {
+      return -errno;
+    }
+    sqes_ = static_cast<struct io_uring_sqe*>(ptr);
+
+    sq_tail_ = reinterpret_cast<unsigned*>(sq_ring_ + p.sq_off.tail);
+    sq_mask_ = *reinterpret_cast<unsigned*>(sq_ring_ + p.sq_off.ring_mask);
+    sq_array_ = reinterpret_cast<unsigned*>(sq_ring_ + p.sq_off.array);
+    cq_head_ = reinterpret_cast<unsigned*>(cq_ring_ + p.cq_off.head);
+    cq_tail_ = reinterpret_cast<unsigned*>(cq_ring_ + p.cq_off.tail);
+    cq_mask_ = *reinterpret_cast<unsigned*>(cq_ring_ + p.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<struct io_uring_cqe*>(cq_ring_ + p.cq_off.cqes);
+
+    // one entry is kept for waking up the reaper
+    max_inflight_ = p.sq_entries > 1 ? p.sq_entries - 1 : 1;
+
+    reaper_ = std::thread(&UringEngine::Reap, this);
+
+    return 0;
+  }
+
+  std::string name() const override {
+    return "io_uring";
+  }
+
+  void Read(int fd, const struct iovec *iov, int iovcnt, uint64_t offset,
+      std::function<void(ssize_t)> cb) override {
+    Submit(new Request(Request::READ, fd, iov, iovcnt, offset, false,
+          std::move(cb)));
+  }
+
+  void Write(int fd, const struct iovec *iov, int iovcnt, uint64_t offset,
+      bool sync, std::function<void(ssize_t)> cb) override {
+    Submit(new Request(Request::WRITE, fd, iov, iovcnt, offset, sync,
+          std::move(cb)));
+  }
+
+ private:
+  struct io_uring_sqe *GetSqe() {
+    const unsigned tail = *sq_tail_;
+    const unsigned index = tail & sq_mask_;
+    auto sqe = &sqes_[index];
+    memset(sqe, 0, sizeof(*sqe));
+    sq_array_[index] = index;
+    return sqe;
+  }
+
+  // publish the entry returned by GetSqe and submit it
+  void Push() {
+    __atomic_store_n(sq_tail_, *sq_tail_ + 1, __ATOMIC_RELEASE);
+    queued_++;
+    unsubmitted_++;
+    Flush();
+  }
+
+  // submit the entries in the ring that haven't been submitted
+  void Flush() {
+    while (unsubmitted_ > 0) {
+      int ret = io_uring_enter(ring_fd_, unsubmitted_, 0, 0);
+      if (ret < 0) {
+        if (ret == -EINTR) {
+          continue;
+        }
+        // the kernel is short of resources. while some entries are in the
+        // kernel, the reaper submits the rest after their completions free
+        // up resources. otherwise nothing would wake up the reaper, so back
+        // off and try again.
+        if (ret == -EAGAIN || ret == -EBUSY) {
+          if (queued_ > unsubmitted_) {
+            break;
+          }
+          std::this_thread::sleep_for(std::chrono::microseconds(100));
+          continue;
+        }
+        std::cerr << "io_uring_enter: " << strerror(-ret) << std::endl;
+        assert(0);
+        break;
+      }
+      unsubmitted_ -= ret;
+    }
+  }
+
+  // called with the lock held
+  void Prep(Request *req) {
+    auto sqe = GetSqe();
+    sqe->fd = req->fd;
+    sqe->user_data = reinterpret_cast<uint64_t>(req);
+    switch (req->op) {
+      case Request::READ:
+        sqe->opcode = IORING_OP_READV;
+        break;
+      case Request::WRITE:
+        sqe->opcode = IORING_OP_WRITEV;
+        break;
+      case Request::SYNC:
+        sqe->opcode = IORING_OP_FSYNC;
+        sqe->fsync_flags = IORING_FSYNC_DATASYNC;
+        break;
+    }
+    if (req->op != Request::SYNC) {
+      sqe->addr = reinterpret_cast<uint64_t>(req->cur_iov());
+      sqe->len = req->cur_iovcnt();
+      sqe->off = req->offset;
+    }
+    inflight_++;
+    Push();
+  }
+
+  void Submit(Request *req) {
+    std::lock_guard<std::mutex> lk(lock_);
+    outstanding_++;
+    if (inflight_ < max_inflight_ && backlog_.empty()) {
+      Prep(req);
+    } else {
+      backlog_.push_back(req);
+    }
+  }
+
+  void Reap() {
+    std::vector<std::pair<Request*, int>> completions;
+    std::vector<std::pair<Request*, ssize_t>> finished;
+    while (true) {
+      int ret = io_uring_enter(ring_fd_, 0, 1, IORING_ENTER_GETEVENTS);
+      if (ret < 0 && ret != -EINTR && ret != -EAGAIN && ret != -EBUSY) {
+        std::cerr << "io_uring_enter: " << strerror(-ret) << std::endl;
+        assert(0);
+      }
+
+      unsigned head = *cq_head_;
+      const unsigned tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+      const unsigned reaped = tail - head;
+      bool stop = false;
+      for (; head != tail; head++) {
+        auto cqe = &cqes_[head & cq_mask_];
+        if (cqe->user_data == 0) {
+          stop = true;
+          continue;
+        }
+        completions.emplace_back(
+            reinterpret_cast<Request*>(cqe->user_data), cqe->res);
+      }
+      __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+
+      // requests are prepared with the lock held, which orders their setup
+      // before their completion is handled here
+      {
+        std::lock_guard<std::mutex> lk(lock_);
+        queued_ -= reaped;
+        for (auto& c : completions) {
+          auto req = c.first;
+          ssize_t result;
+          inflight_--;
+          if (req->complete(c.second, &result)) {
+            finished.emplace_back(req, result);
+          } else {
+            // continue the request before anything in the backlog
+            Prep(req);
+          }
+        }
+        while (inflight_ < max_inflight_ && !backlog_.empty()) {
+          Prep(backlog_.front());
+          backlog_.pop_front();
+        }
+        Flush();
+      }
+
+      // a request is outstanding until its callback, which may submit more
+      // requests, has returned
+      for (auto& f : finished) {
+        f.first->cb(f.second);
+        delete f.first;
+      }
+
+      if (!finished.empty()) {
+        std::lock_guard<std::mutex> lk(lock_);
+        outstanding_ -= finished.size();
+        if (outstanding_ == 0) {
+          idle_.notify_all();
+        }
+      }
+      finished.clear();
+      completions.clear();
+
+      if (stop) {
+        break;
+      }
+    }
+  }
+
+  int ring_fd_ = -1;
+  char *sq_ring_ = nullptr;
+  char *cq_ring_ = nullptr;
+  size_t sq_ring_size_ = 0;
+  size_t cq_ring_size_ = 0;
+  struct io_uring_sqe *sqes_ = nullptr;
+  size_t sqes_size_ = 0;
+
+  unsigned *sq_tail_;
+  unsigned sq_mask_;
+  unsigned *sq_array_;
+  unsigned *cq_head_;
+  unsigned *cq_tail_;
+  unsigned cq_mask_;
+  struct io_uring_cqe *cqes_;
+
+  std::mutex lock_;
+  std::condition_variable idle_;
+  unsigned inflight_ = 0;
+  unsigned max_inflight_ = 0;
+  unsigned unsubmitted_ = 0;
+  // entries in the ring whose completions haven't been reaped
+  unsigned queued_ = 0;
+  // submitted requests that haven't run their callbacks
+  unsigned outstanding_ = 0;
+  std::deque<Request*> backlog_;
+  std::thread reaper_;
+};
+#endif
+
+}
+
+int IOEngine::Create(const std::string& name, unsigned depth,
+    unsigned threads, std::unique_ptr<IOEngine>& engine)
+{
+  if (name == "io_uring" || name == "auto") {
+#ifdef HAVE_IO_URING
+    std::unique_ptr<UringEngine> e(new UringEngine);
+    int ret = e->Init(depth);
+    if (!ret) {
+      engine = std::move(e);
+      return 0;
+    }
+    if (name == "io_uring") {
+      return ret;
+    }
+#else
+    if (name == "io_uring") {
+      return -EOPNOTSUPP;
+    }
+#endif
+  } else if (name != "threads") {
+    return -EINVAL;
+  }
+
+  engine.reset(new ThreadPoolEngine(threads));
+  return 0;
+}
+
+}
+}
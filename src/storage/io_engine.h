@@ -0,0 +1,51 @@
+#pragma once
+#include <functional>
+#include <memory>
+#include <string>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+namespace zlog {
+namespace storage {
+
+/*
+ * Asynchronous file I/O for backends that store objects in local files.
+ *
+ * Requests are submitted without blocking the caller, and their callbacks
+ * run on an engine thread once the request completes. A callback may submit
+ * new requests. Destroying the engine waits for every submitted request,
+ * including those submitted by callbacks, to complete.
+ */
+class IOEngine {
+ public:
+  virtual ~IOEngine() {}
+
+  /*
+   * Create an engine.
+   *
+   * @name "io_uring", "threads", or "auto" for io_uring with a fallback to
+   *       the thread pool when io_uring is unavailable
+   * @depth maximum number of requests in flight in the kernel (io_uring)
+   * @threads number of threads issuing requests (thread pool)
+   */
+  static int Create(const std::string& name, unsigned depth,
+      unsigned threads, std::unique_ptr<IOEngine>& engine);
+
+  virtual std::string name() const = 0;
+
+  /*
+   * Read or write all of @iov at @offset in @fd, followed by an fdatasync
+   * when @sync is set. The callback receives the number of bytes transferred
+   * or a negative error code. Only a read that reaches the end of the file
+   * transfers fewer bytes than requested. The iovec array is copied, but the
+   * buffers it points to must remain valid until the callback has run.
+   */
+  virtual void Read(int fd, const struct iovec *iov, int iovcnt,
+      uint64_t offset, std::function<void(ssize_t)> cb) = 0;
+
+  virtual void Write(int fd, const struct iovec *iov, int iovcnt,
+      uint64_t offset, bool sync, std::function<void(ssize_t)> cb) = 0;
+};
+
+}
+}
@@ -1,12 +1,16 @@
 #include <vector>
 #include <atomic>
 #include <cassert>
+#include <chrono>
+#include <boost/algorithm/string.hpp>
+#include <boost/lexical_cast.hpp>
 #include <boost/uuid/uuid.hpp>
 #include <boost/uuid/uuid_generators.hpp>
 #include <boost/uuid/uuid_io.hpp>
 #include <lmdb.h>
 #include "zlog/backend.h"
 #include "zlog/backend/lmdb.h"
+#include "util/crc32c.h"
 
 namespace zlog {
 namespace storage {
@@ -27,12 +31,36 @@ LMDBBackend::Transaction LMDBBackend::NewTransaction(bool read_only)
 {
   MDB_txn *txn;
   int flags = read_only ? MDB_RDONLY : 0;
+  EnterTransaction();
   int ret = mdb_txn_begin(env, NULL, flags, &txn);
   assert(ret == 0);
   (void)ret;
   return Transaction(txn, this);
 }
 
+// parses an optional numeric backend option
+template<typename T>
+static int ParseOption(const std::map<std::string, std::string>& opts,
+    const std::string& name, T *value,
+    std::map<std::string, std::string>& options)
+{
+  auto it = opts.find(name);
+  if (it == opts.end()) {
+    return 0;
+  }
+
+  try {
+    *value = boost::lexical_cast<T>(it->second);
+  } catch (boost::bad_lexical_cast& e) {
+    std::cerr << "could not convert to integer: " << it->second << std::endl;
+    return -EINVAL;
+  }
+
+  options[name] = it->second;
+
+  return 0;
+}
+
 LMDBBackend::~LMDBBackend()
 {
   if (need_close) {
@@ -51,39 +79,111 @@ int LMDBBackend::Initialize(
   auto it = opts.find("path");
   if (it == opts.end())
     return -EINVAL;
+  const auto path = it->second;
+
+  it = opts.find("sync");
+  if (it != opts.end()) {
+    if (it->second == "none") {
+      sync_mode = SYNC_NONE;
+    } else if (it->second == "periodic") {
+      sync_mode = SYNC_PERIODIC;
+    } else if (it->second == "commit") {
+      sync_mode = SYNC_COMMIT;
+    } else {
+      std::cerr << "invalid sync mode: " << it->second << std::endl;
+      return -EINVAL;
+    }
+    options[it->first] = it->second;
+  }
 
-  Init(it->second);
+  int ret = ParseOption(opts, "sync_interval_ms", &sync_interval_ms, options);
+  if (ret) {
+    return ret;
+  }
 
-  return 0;
-}
+  ret = ParseOption(opts, "sync_bytes", &sync_bytes, options);
+  if (ret) {
+    return ret;
+  }
 
-int LMDBBackend::uniqueId(const std::string& hoid, uint64_t *id_out)
-{
-  if (hoid.empty()) {
+  if (sync_mode == SYNC_PERIODIC && sync_interval_ms == 0 && sync_bytes == 0) {
     return -EINVAL;
   }
 
-  auto txn = NewTransaction();
+  ret = ParseOption(opts, "map_size", &map_size, options);
+  if (ret) {
+    return ret;
+  }
 
-  MDB_val val;
-  int ret = txn.Get(hoid, val);
+  ret = ParseOption(opts, "map_max_size", &map_max_size, options);
   if (ret) {
-    txn.Abort();
     return ret;
   }
 
-  ProjectionObject *proj_obj = (ProjectionObject*)val.mv_data;
-  assert(val.mv_size == sizeof(*proj_obj));
+  if (map_size == 0 || (map_max_size && map_max_size < map_size)) {
+    return -EINVAL;
+  }
 
-  auto id = proj_obj->unique_id++;
+  ret = ParseOption(opts, "reclaim_batch_size", &reclaim_batch_size, options);
+  if (ret) {
+    return ret;
+  }
 
-  ret = txn.Put(hoid, val, false);
+  ret = ParseOption(opts, "group_commit_window_us",
+      &group_commit_window_us, options);
   if (ret) {
-    txn.Abort();
     return ret;
   }
 
-  txn.Commit();
+  ret = ParseOption(opts, "group_commit_max_batch",
+      &group_commit_max_batch, options);
+  if (ret) {
+    return ret;
+  }
+
+  if (group_commit_max_batch == 0) {
+    return -EINVAL;
+  }
+
+  it = opts.find("verify_checksums");
+  if (it != opts.end()) {
+    verify_checksums = boost::iequals(it->second, "yes") ||
+      boost::iequals(it->second, "true");
+    options[it->first] = it->second;
+  }
+
+  Init(path);
+
+  return 0;
+}
+
+int LMDBBackend::uniqueId(const std::string& hoid, uint64_t *id_out)
+{
+  if (hoid.empty()) {
+    return -EINVAL;
+  }
+
+  uint64_t id = 0;
+  int ret = GroupCommit([&](Transaction& txn) {
+    MDB_val val;
+    int ret = txn.Get(hoid, val);
+    if (ret) {
+      return ret;
+    }
+
+    ProjectionObject proj_obj;
+    assert(val.mv_size == sizeof(proj_obj));
+    proj_obj = *((ProjectionObject*)val.mv_data);
+
+    id = proj_obj.unique_id++;
+
+    val.mv_data = &proj_obj;
+    val.mv_size = sizeof(proj_obj);
+    return txn.Put(hoid, val, false);
+  });
+  if (ret) {
+    return ret;
+  }
 
   *id_out = id;
 
@@ -102,48 +202,40 @@ int LMDBBackend::CreateLog(const std::string& name, const std::string& view,
   auto hoid = std::string("zlog.head.").append(key);
   auto prefix = std::string("zlog.data.").append(key);
 
-  auto txn = NewTransaction();
+  int ret = GroupCommit([&](Transaction& txn) {
+    ProjectionObject proj_obj;
+    proj_obj.epoch = 1;
+    proj_obj.unique_id = 0;
+    strcpy(proj_obj.prefix, prefix.c_str());
 
-  ProjectionObject proj_obj;
-  proj_obj.epoch = 1;
-  proj_obj.unique_id = 0;
-  strcpy(proj_obj.prefix, prefix.c_str());
-
-  MDB_val val;
-  val.mv_data = &proj_obj;
-  val.mv_size = sizeof(proj_obj);
-  int ret = txn.Put(hoid, val, true);
-  if (ret) {
-    txn.Abort();
-    if (ret == -EEXIST) {
-      // ensure unique hoid. a more robust implementation can
-      // retry generating a unique object name.
-      return -EIO;
+    MDB_val val;
+    val.mv_data = &proj_obj;
+    val.mv_size = sizeof(proj_obj);
+    int ret = txn.Put(hoid, val, true);
+    if (ret) {
+      if (ret == -EEXIST) {
+        // ensure unique hoid. a more robust implementation can
+        // retry generating a unique object name.
+        return -EIO;
+      }
+      return ret;
     }
-    return ret;
-  }
-
-  std::string proj_key = ProjectionKey(hoid, proj_obj.epoch);
-  val.mv_data = (void*)view.data();
-  val.mv_size = view.size();
-  ret = txn.Put(proj_key, val, true);
-  if (ret) {
-    txn.Abort();
-    return ret;
-  }
 
-  auto prefixed_name = std::string("head.").append(name);
-  LinkObject link;
-  strcpy(link.hoid, hoid.c_str());
-  val.mv_data = &link;
-  val.mv_size = sizeof(link);
-  ret = txn.Put(prefixed_name, val, true);
-  if (ret) {
-    txn.Abort();
-    return ret;
-  }
+    std::string proj_key = ProjectionKey(hoid, proj_obj.epoch);
+    val.mv_data = (void*)view.data();
+    val.mv_size = view.size();
+    ret = txn.Put(db_views, proj_key, val, true);
+    if (ret) {
+      return ret;
+    }
 
-  ret = txn.Commit();
+    auto prefixed_name = std::string("head.").append(name);
+    LinkObject link;
+    strcpy(link.hoid, hoid.c_str());
+    val.mv_data = &link;
+    val.mv_size = sizeof(link);
+    return txn.Put(prefixed_name, val, true);
+  });
   if (ret) {
     return ret;
   }
@@ -166,7 +258,7 @@ int LMDBBackend::OpenLog(const std::string& name, std::string *hoid_out,
     return -EINVAL;
   }
 
-  auto txn = NewTransaction();
+  auto txn = NewTransaction(true);
 
   auto prefixed_name = std::string("head.").append(name);
   MDB_val val;
@@ -206,41 +298,103 @@ int LMDBBackend::OpenLog(const std::string& name, std::string *hoid_out,
 
 int LMDBBackend::Stat(const std::string& oid, size_t *size)
 {
-  std::stringstream ss;
-  ss << oid << ".entry.";
-  auto prefix = ss.str();
-
   auto txn = NewTransaction(true);
 
+  MDB_val val;
+  int ret = txn.Get(oid, val);
+  if (ret) {
+    txn.Abort();
+    if (ret == -ENOENT) {
+      *size = 0;
+      return 0;
+    }
+    return ret;
+  }
+
+  LogObject lobj;
+  assert(val.mv_size == sizeof(lobj));
+  lobj = *((LogObject*)val.mv_data);
+
   std::vector<MDB_val> keys;
-  int ret = txn.GetAll(prefix, keys);
+  std::vector<MDB_val> vals;
+  ret = txn.GetAll(db_entries, LogEntryPrefix(lobj.id), keys, &vals);
   if (ret) {
     txn.Abort();
     return ret;
   }
 
   size_t s = 0;
-  for (auto k : keys) {
+  for (size_t i = 0; i < keys.size(); i++) {
+    s += keys[i].mv_size;
+    s += vals[i].mv_size;
+  }
+
+  *size = s;
+
+  return txn.Commit();
+}
+
+// the scan runs in a read transaction over the entries in the memory map, so
+// it doesn't block writers
+int LMDBBackend::Scrub(const std::string& oid, std::set<uint64_t> *corrupt_out)
+{
+  if (oid.empty() || !corrupt_out) {
+    return -EINVAL;
+  }
+
+  auto txn = NewTransaction(true);
+
+  LogObject lobj;
+  {
     MDB_val val;
-    std::string key((char*)k.mv_data, k.mv_size);
-    ret = txn.Get(key, val);
+    int ret = txn.Get(oid, val);
     if (ret) {
       txn.Abort();
       return ret;
     }
-    s += k.mv_size;
-    s += val.mv_size;
+
+    assert(val.mv_size == sizeof(lobj));
+    lobj = *((LogObject*)val.mv_data);
   }
 
-  *size = s;
+  std::set<uint64_t> corrupt;
 
-  return txn.Commit();
+  const auto prefix = LogEntryPrefix(lobj.id);
+  txn.Seek(db_entries, prefix, [&](const MDB_val& key, const MDB_val& val) {
+    if (std::memcmp(key.mv_data, prefix.data(), prefix.size())) {
+      return false;
+    }
+    const uint64_t pos = KeyNumber(key);
+    if (lobj.trim_limit >= 0 && pos <= uint64_t(lobj.trim_limit)) {
+      return true;
+    }
+    const LogEntry *entry = (const LogEntry*)val.mv_data;
+    if (!entry->trimmed && !entry->invalidated && !VerifyEntry(val)) {
+      corrupt.insert(pos);
+    }
+    return true;
+  });
+
+  int ret = txn.Commit();
+  if (ret)
+    return ret;
+
+  corrupt_out->swap(corrupt);
+
+  return 0;
+}
+
+bool LMDBBackend::VerifyEntry(const MDB_val& val)
+{
+  const LogEntry *entry = (const LogEntry*)val.mv_data;
+  return crc32c::Value((const char *)val.mv_data + sizeof(*entry),
+      val.mv_size - sizeof(*entry)) == entry->crc;
 }
 
 int LMDBBackend::ListLinks(std::vector<std::string> &loids_out) {
   auto txn = NewTransaction(true);
   std::vector<MDB_val> keys;
-  int ret = txn.GetAll("head.", keys);
+  int ret = txn.GetAll(db_obj, "head.", keys);
   if (ret) {
     txn.Abort();
     return ret;
@@ -255,16 +409,14 @@ int LMDBBackend::ListHeads(std::vector<std::string> &ooids_out) {
   auto txn = NewTransaction(true);
   std::vector<MDB_val> keys;
   std::string prefix("zlog.head.");
-  int ret = txn.GetAll(prefix, keys);
+  int ret = txn.GetAll(db_obj, prefix, keys);
   if (ret) {
     txn.Abort();
     return ret;
   }
-  size_t prefixLength = prefix.size();
   for (auto &key : keys) {
-    std::string prefixStripped(reinterpret_cast<const char*>(key.mv_data) + prefixLength, key.mv_size - prefixLength);
-    // Filter out 'zlog.head.*.N'
-    if (prefixStripped.find('.') != std::string::npos) {
+    // filter out the max position keys stored next to each object
+    if (std::memchr(key.mv_data, '\0', key.mv_size)) {
       continue;
     }
     ooids_out.emplace_back(reinterpret_cast<const char*>(key.mv_data), key.mv_size);
@@ -306,7 +458,7 @@ int LMDBBackend::ReadViews(const std::string& hoid, uint64_t epoch,
     }
 
     std::string proj_key = ProjectionKey(hoid, proj_obj->epoch);
-    ret = txn.Get(proj_key, val);
+    ret = txn.Get(db_views, proj_key, val);
     if (ret) {
       if (ret == -ENOENT) {
         ret = -EIO;
@@ -329,7 +481,7 @@ int LMDBBackend::ReadViews(const std::string& hoid, uint64_t epoch,
     }
 
     std::string proj_key = ProjectionKey(hoid, epoch);
-    ret = txn.Get(proj_key, val);
+    ret = txn.Get(db_views, proj_key, val);
     if (ret) {
       if (ret == -ENOENT) {
         break;
@@ -365,55 +517,40 @@ int LMDBBackend::ProposeView(const std::string& hoid,
     return -EINVAL;
   }
 
-  auto txn = NewTransaction();
-
-  MDB_val val;
-  int ret = txn.Get(hoid, val);
-  if (ret) {
-    if (ret == -ENOENT) {
-      txn.Abort();
-      return ret;
-    } else {
-      txn.Abort();
+  return GroupCommit([&](Transaction& txn) {
+    MDB_val val;
+    int ret = txn.Get(hoid, val);
+    if (ret) {
       return ret;
     }
-  }
 
-  ProjectionObject *proj_obj = (ProjectionObject*)val.mv_data;
-  assert(val.mv_size == sizeof(*proj_obj));
-
-  const auto required_epoch = proj_obj->epoch + 1;
-  if (epoch > required_epoch) {
-    txn.Abort();
-    return -EINVAL;
-  }
-  if (epoch != required_epoch) {
-    txn.Abort();
-    return -ESPIPE;
-  }
+    ProjectionObject proj_obj;
+    assert(val.mv_size == sizeof(proj_obj));
+    proj_obj = *((ProjectionObject*)val.mv_data);
 
-  // write new projection
-  MDB_val proj_val;
-  std::string proj_key = ProjectionKey(hoid, epoch);
-  proj_val.mv_data = (void*)view.data();
-  proj_val.mv_size = view.size();
-  ret = txn.Put(proj_key, proj_val, true);
-  if (ret) {
-    txn.Abort();
-    return ret;
-  }
+    const auto required_epoch = proj_obj.epoch + 1;
+    if (epoch > required_epoch) {
+      return -EINVAL;
+    }
+    if (epoch != required_epoch) {
+      return -ESPIPE;
+    }
 
-  proj_obj->epoch = epoch;
-  val.mv_data = proj_obj;
-  val.mv_size = sizeof(*proj_obj);
-  ret = txn.Put(hoid, val, false);
-  if (ret) {
-    txn.Abort();
-    return ret;
-  }
+    // write new projection
+    MDB_val proj_val;
+    std::string proj_key = ProjectionKey(hoid, epoch);
+    proj_val.mv_data = (void*)view.data();
+    proj_val.mv_size = view.size();
+    ret = txn.Put(db_views, proj_key, proj_val, true);
+    if (ret) {
+      return ret;
+    }
 
-  txn.Commit();
-  return 0;
+    proj_obj.epoch = epoch;
+    val.mv_data = &proj_obj;
+    val.mv_size = sizeof(proj_obj);
+    return txn.Put(hoid, val, false);
+  });
 }
 
 int LMDBBackend::Write(const std::string& oid, const std::string& data,
@@ -427,28 +564,35 @@ int LMDBBackend::Write(const std::string& oid, const std::string& data,
     return -EINVAL;
   }
 
-  auto txn = NewTransaction();
+  // checksummed before joining a group commit, so that the commit leader
+  // doesn't compute it for every update in the batch
+  const uint32_t crc = crc32c::Value(data.data(), data.size());
+
+  return GroupCommit([&](Transaction& txn) {
+    return ApplyWrite(txn, oid, data, crc, epoch, position);
+  });
+}
 
+int LMDBBackend::ApplyWrite(Transaction& txn, const std::string& oid,
+    const std::string& data, uint32_t crc, uint64_t epoch, uint64_t position)
+{
   int ret = CheckEpoch(txn, epoch, oid);
   if (ret) {
-    txn.Abort();
     return ret;
   }
 
+  LogObject lobj;
   {
     MDB_val val;
     ret = txn.Get(oid, val);
     if (ret) {
-      txn.Abort();
       return ret;
     }
 
-    LogObject lobj;
     assert(val.mv_size == sizeof(lobj));
     lobj = *((LogObject*)val.mv_data);
 
     if (lobj.trim_limit >= 0 && position <= uint64_t(lobj.trim_limit)) {
-      txn.Abort();
       return -EROFS;
     }
   }
@@ -460,7 +604,6 @@ int LMDBBackend::Write(const std::string& oid, const std::string& data,
   ret = txn.Get(maxkey, maxval);
   // TODO: enoent here?
   if (ret < 0 && ret != -ENOENT) {
-    txn.Abort();
     return ret;
   } else if (ret == 0) {
     LogMaxPos *maxpos = (LogMaxPos*)maxval.mv_data;
@@ -469,6 +612,7 @@ int LMDBBackend::Write(const std::string& oid, const std::string& data,
   }
 
   LogEntry entry;
+  entry.crc = crc;
   entry.position = position;
   const size_t size = sizeof(entry) + data.size();
   std::vector<unsigned char> blob;
@@ -478,11 +622,12 @@ int LMDBBackend::Write(const std::string& oid, const std::string& data,
   blob.insert(blob.end(), (unsigned char *)data.data(),
       ((unsigned char *)data.data()) + data.size());
 
-  std::string key = LogEntryKey(oid, position);
-  ret = txn.Put(key, blob, true);
+  std::string key = LogEntryKey(lobj.id, position);
+  ret = txn.Put(db_entries, key, blob, true);
   if (ret == -EEXIST) {
-    txn.Abort();
     return -EROFS;
+  } else if (ret) {
+    return ret;
   }
 
   // update max pos
@@ -490,19 +635,14 @@ int LMDBBackend::Write(const std::string& oid, const std::string& data,
   new_maxpos.maxpos = std::max(pos, position);
   maxval.mv_data = &new_maxpos;
   maxval.mv_size = sizeof(new_maxpos);
-  txn.Put(maxkey, maxval, false);
-
-  ret = txn.Commit();
-  if (ret)
-    return ret;
-
-  return 0;
+  return txn.Put(maxkey, maxval, false);
 }
 
-int LMDBBackend::Read(const std::string& oid, uint64_t epoch,
-    uint64_t position, std::string *data)
+int LMDBBackend::WriteBatch(const std::string& oid, uint64_t epoch,
+    const std::vector<std::pair<uint64_t, const std::string*>>& entries,
+    std::vector<int> *results)
 {
-  if (oid.empty()) {
+  if (oid.empty() || entries.empty() || !results) {
     return -EINVAL;
   }
 
@@ -510,59 +650,350 @@ int LMDBBackend::Read(const std::string& oid, uint64_t epoch,
     return -EINVAL;
   }
 
-  auto txn = NewTransaction(true);
+  std::vector<uint32_t> crcs;
+  crcs.reserve(entries.size());
+  for (const auto& entry : entries) {
+    crcs.push_back(crc32c::Value(entry.second->data(),
+          entry.second->size()));
+  }
+
+  int ret = GroupCommit([&](Transaction& txn) {
+    return ApplyWriteBatch(txn, oid, epoch, entries, crcs, results);
+  });
+  if (ret) {
+    results->assign(entries.size(), ret);
+    return ret;
+  }
+
+  return 0;
+}
 
+int LMDBBackend::ApplyWriteBatch(Transaction& txn, const std::string& oid,
+    uint64_t epoch,
+    const std::vector<std::pair<uint64_t, const std::string*>>& entries,
+    const std::vector<uint32_t>& crcs, std::vector<int> *results)
+{
   int ret = CheckEpoch(txn, epoch, oid);
   if (ret) {
-    txn.Abort();
     return ret;
   }
 
+  LogObject lobj;
   {
     MDB_val val;
     ret = txn.Get(oid, val);
     if (ret) {
-      txn.Abort();
       return ret;
     }
 
-    LogObject lobj;
     assert(val.mv_size == sizeof(lobj));
     lobj = *((LogObject*)val.mv_data);
+  }
+
+  // read max position
+  uint64_t pos = 0;
+  MDB_val maxval;
+  auto maxkey = MaxPosKey(oid);
+  ret = txn.Get(maxkey, maxval);
+  if (ret < 0 && ret != -ENOENT) {
+    return ret;
+  } else if (ret == 0) {
+    LogMaxPos *maxpos = (LogMaxPos*)maxval.mv_data;
+    assert(maxval.mv_size == sizeof(*maxpos));
+    pos = maxpos->maxpos;
+  }
+
+  results->assign(entries.size(), 0);
+
+  bool updated = false;
+  std::vector<unsigned char> blob;
+  for (size_t i = 0; i < entries.size(); i++) {
+    const auto position = entries[i].first;
+    const auto& data = *entries[i].second;
 
     if (lobj.trim_limit >= 0 && position <= uint64_t(lobj.trim_limit)) {
-      txn.Abort();
-      return -ENODATA;
+      (*results)[i] = -EROFS;
+      continue;
     }
-  }
 
-  MDB_val val;
-  std::string key = LogEntryKey(oid, position);
-  ret = txn.Get(key, val);
-  if (ret == -ENOENT) {
-    txn.Abort();
-    return -ERANGE;
-  }
+    LogEntry entry;
+    entry.crc = crcs[i];
+    entry.position = position;
+    blob.clear();
+    blob.reserve(sizeof(entry) + data.size());
+    blob.insert(blob.end(), (unsigned char *)&entry,
+        ((unsigned char *)&entry) + sizeof(entry));
+    blob.insert(blob.end(), (unsigned char *)data.data(),
+        ((unsigned char *)data.data()) + data.size());
+
+    std::string key = LogEntryKey(lobj.id, position);
+    ret = txn.Put(db_entries, key, blob, true);
+    if (ret == -EEXIST) {
+      (*results)[i] = -EROFS;
+      continue;
+    } else if (ret) {
+      return ret;
+    }
 
-  LogEntry *entry = (LogEntry*)val.mv_data;
-  assert(entry->position == position);
-  if (entry->trimmed || entry->invalidated) {
-    txn.Abort();
-    return -ENODATA;
+    pos = std::max(pos, position);
+    updated = true;
   }
 
-  if (data) {
-    const char *blob = (const char *)val.mv_data + sizeof(*entry);
-    data->assign(blob, val.mv_size - sizeof(*entry));
+  // update max pos once for the whole batch
+  if (updated) {
+    LogMaxPos new_maxpos;
+    new_maxpos.maxpos = pos;
+    maxval.mv_data = &new_maxpos;
+    maxval.mv_size = sizeof(new_maxpos);
+    return txn.Put(maxkey, maxval, false);
   }
 
-  ret = txn.Commit();
-  if (ret)
+  return 0;
+}
+
+// looks up a readable entry. on success @blob references the entry data in
+// the memory map, and remains valid until the transaction is closed.
+int LMDBBackend::GetEntry(Transaction& txn, const std::string& oid,
+    uint64_t epoch, uint64_t position, MDB_val *blob)
+{
+  int ret = CheckEpoch(txn, epoch, oid);
+  if (ret) {
+    return ret;
+  }
+
+  LogObject lobj;
+  {
+    MDB_val val;
+    ret = txn.Get(oid, val);
+    if (ret) {
+      return ret;
+    }
+
+    assert(val.mv_size == sizeof(lobj));
+    lobj = *((LogObject*)val.mv_data);
+
+    if (lobj.trim_limit >= 0 && position <= uint64_t(lobj.trim_limit)) {
+      return -ENODATA;
+    }
+  }
+
+  MDB_val val;
+  std::string key = LogEntryKey(lobj.id, position);
+  ret = txn.Get(db_entries, key, val);
+  if (ret == -ENOENT) {
+    return -ERANGE;
+  }
+
+  LogEntry *entry = (LogEntry*)val.mv_data;
+  assert(entry->position == position);
+  if (entry->trimmed || entry->invalidated) {
+    return -ENODATA;
+  }
+
+  if (verify_checksums && !VerifyEntry(val)) {
+    return -EIO;
+  }
+
+  blob->mv_data = (char *)val.mv_data + sizeof(*entry);
+  blob->mv_size = val.mv_size - sizeof(*entry);
+
+  return 0;
+}
+
+int LMDBBackend::Read(const std::string& oid, uint64_t epoch,
+    uint64_t position, std::string *data)
+{
+  if (oid.empty()) {
+    return -EINVAL;
+  }
+
+  if (epoch == 0) {
+    return -EINVAL;
+  }
+
+  auto txn = NewTransaction(true);
+
+  MDB_val blob;
+  int ret = GetEntry(txn, oid, epoch, position, &blob);
+  if (ret) {
+    txn.Abort();
+    return ret;
+  }
+
+  if (data) {
+    data->assign((const char *)blob.mv_data, blob.mv_size);
+  }
+
+  ret = txn.Commit();
+  if (ret)
     return ret;
 
   return 0;
 }
 
+// the read transaction is kept open and owned by the slice, which keeps the
+// entry's pages mapped and unchanged. leases are bounded so that long-lived
+// slices can't use up the environment's reader slots, and reads fall back to
+// copying the entry when the bound is reached. open read transactions also
+// keep pages written since they started from being reused, and keep the map
+// from being resized, so no new leases are handed out while the map needs to
+// grow.
+int LMDBBackend::ReadSlice(const std::string& oid, uint64_t epoch,
+    uint64_t position, Slice *data_out)
+{
+  if (oid.empty()) {
+    return -EINVAL;
+  }
+
+  if (epoch == 0) {
+    return -EINVAL;
+  }
+
+  if (grow_wanted) {
+    return Backend::ReadSlice(oid, epoch, position, data_out);
+  }
+
+  if (++leased_txns > max_leased_txns) {
+    leased_txns--;
+    return Backend::ReadSlice(oid, epoch, position, data_out);
+  }
+
+  auto txn = NewTransaction(true);
+
+  MDB_val blob;
+  int ret = GetEntry(txn, oid, epoch, position, &blob);
+  if (ret) {
+    txn.Abort();
+    leased_txns--;
+    return ret;
+  }
+
+  // transfer ownership of the transaction to the slice
+  txn.closed = true;
+  std::shared_ptr<MDB_txn> lease(txn.txn, [this](MDB_txn *txn) {
+    mdb_txn_abort(txn);
+    ExitTransaction();
+    leased_txns--;
+  });
+
+  *data_out = Slice(std::move(lease), (const char *)blob.mv_data,
+      blob.mv_size);
+
+  return 0;
+}
+
+int LMDBBackend::ReadSliceAsync(const std::string& oid, uint64_t epoch,
+    uint64_t position, Slice *data_out, std::function<void(int)> cb)
+{
+  cb(ReadSlice(oid, epoch, position, data_out));
+  return 0;
+}
+
+int LMDBBackend::ReadRange(const std::string& oid, uint64_t epoch,
+    uint64_t min_position, uint64_t max_position, uint32_t stride,
+    std::map<uint64_t, std::string> *entries_out,
+    std::set<uint64_t> *invalid_out)
+{
+  if (oid.empty() || min_position > max_position || stride == 0) {
+    return -EINVAL;
+  }
+
+  if (epoch == 0) {
+    return -EINVAL;
+  }
+
+  auto txn = NewTransaction(true);
+
+  int ret = CheckEpoch(txn, epoch, oid);
+  if (ret) {
+    txn.Abort();
+    return ret;
+  }
+
+  LogObject lobj;
+  {
+    MDB_val val;
+    ret = txn.Get(oid, val);
+    if (ret) {
+      txn.Abort();
+      return ret;
+    }
+
+    assert(val.mv_size == sizeof(lobj));
+    lobj = *((LogObject*)val.mv_data);
+  }
+
+  std::map<uint64_t, std::string> entries;
+  std::set<uint64_t> invalid;
+
+  // positions at or below the trim limit are invalid whether or not an entry
+  // exists for them
+  uint64_t position = min_position;
+  bool done = false;
+  if (lobj.trim_limit >= 0) {
+    const auto last = std::min(max_position, uint64_t(lobj.trim_limit));
+    while (position <= last) {
+      invalid.insert(position);
+      if (max_position - position < stride) {
+        done = true;
+        break;
+      }
+      position += stride;
+    }
+  }
+
+  // walk the object's entries in the rest of the range with a cursor
+  if (!done) {
+    const auto prefix = LogEntryPrefix(lobj.id);
+    txn.Seek(db_entries, LogEntryKey(lobj.id, position),
+        [&](const MDB_val& key, const MDB_val& val) {
+      if (std::memcmp(key.mv_data, prefix.data(), prefix.size())) {
+        return false;
+      }
+      const uint64_t pos = KeyNumber(key);
+      if (pos > max_position) {
+        return false;
+      }
+      if ((pos - min_position) % stride) {
+        return true;
+      }
+      const LogEntry *entry = (const LogEntry*)val.mv_data;
+      assert(entry->position == pos);
+      if (entry->trimmed || entry->invalidated) {
+        invalid.insert(pos);
+      } else {
+        if (verify_checksums && !VerifyEntry(val)) {
+          ret = -EIO;
+          return false;
+        }
+        const char *blob = (const char *)val.mv_data + sizeof(*entry);
+        entries.emplace(pos,
+            std::string(blob, val.mv_size - sizeof(*entry)));
+      }
+      return true;
+    });
+  }
+
+  if (ret) {
+    txn.Abort();
+    return ret;
+  }
+
+  ret = txn.Commit();
+  if (ret)
+    return ret;
+
+  if (entries_out) {
+    entries_out->swap(entries);
+  }
+
+  if (invalid_out) {
+    invalid_out->swap(invalid);
+  }
+
+  return 0;
+}
+
 int LMDBBackend::Trim(const std::string& oid, uint64_t epoch,
     uint64_t position, bool trim_limit, bool trim_full)
 {
@@ -578,26 +1009,42 @@ int LMDBBackend::Trim(const std::string& oid, uint64_t epoch,
     return -EINVAL;
   }
 
-  auto txn = NewTransaction();
+  int ret = GroupCommit([&](Transaction& txn) {
+    return ApplyTrim(txn, oid, epoch, position, trim_limit, trim_full);
+  });
+  if (ret) {
+    return ret;
+  }
+
+  if (trim_limit && !trim_full && reclaim_batch_size > 0) {
+    std::lock_guard<std::mutex> lk(reclaim_lock);
+    reclaim_pending = true;
+    reclaim_cond.notify_one();
+  }
 
+  return 0;
+}
+
+int LMDBBackend::ApplyTrim(Transaction& txn, const std::string& oid,
+    uint64_t epoch, uint64_t position, bool trim_limit, bool trim_full)
+{
   int ret = CheckEpoch(txn, epoch, oid);
   if (ret) {
-    txn.Abort();
     return ret;
   }
 
+  LogObject lobj;
   {
     MDB_val val;
     ret = txn.Get(oid, val);
     if (ret) {
-      txn.Abort();
       return ret;
     }
 
-    LogObject lobj;
     assert(val.mv_size == sizeof(lobj));
     lobj = *((LogObject*)val.mv_data);
 
+    const auto prev_trim_limit = lobj.trim_limit;
     if (trim_limit) {
       if (lobj.trim_limit >= 0)
         lobj.trim_limit = std::max(position, uint64_t(lobj.trim_limit));
@@ -609,10 +1056,20 @@ int LMDBBackend::Trim(const std::string& oid, uint64_t epoch,
     val.mv_size = sizeof(lobj);
     ret = txn.Put(oid, val, false);
     if (ret) {
-      txn.Abort();
       return ret;
     }
 
+    // entries at or below a new trim limit are deleted in the background
+    if (lobj.trim_limit != prev_trim_limit && !trim_full) {
+      MDB_val marker;
+      marker.mv_data = nullptr;
+      marker.mv_size = 0;
+      ret = txn.Put(db_reclaim, oid, marker, false);
+      if (ret) {
+        return ret;
+      }
+    }
+
     // TODO: trim full should probably set a max pos that isn't the global trim
     // limit for this operation instance as is the case now, but rather we
     // should add metadata to each object so it can be set correctly and catch
@@ -624,50 +1081,19 @@ int LMDBBackend::Trim(const std::string& oid, uint64_t epoch,
     // only removing data when trim full is set to behave like ceph backend.
     // see note on trim method in ram.cc.
     if (trim_full) {
-      std::stringstream ss;
-      ss << oid << ".entry.";
-      auto prefix = ss.str();
-
-      std::vector<MDB_val> keys;
-      int ret = txn.GetAll(prefix, keys);
+      const auto prefix = LogEntryPrefix(lobj.id);
+      size_t count;
+      ret = txn.DeleteRange(db_entries, prefix, [&](const MDB_val& key) {
+        return std::memcmp(key.mv_data, prefix.data(), prefix.size()) == 0;
+      }, 0, &count);
       if (ret) {
-        txn.Abort();
         return ret;
       }
 
-      std::vector<std::string> delete_keys;
-
-      // scan the keys from the cursor first. the docs make it sound like the
-      // key pointers won't remain valid if we start mutating things.
-      for (auto k : keys) {
-        MDB_val val;
-        std::string key((char*)k.mv_data, k.mv_size);
-        ret = txn.Get(key, val);
-        if (ret) {
-          txn.Abort();
-          return ret;
-        }
-
-        assert(val.mv_size >= sizeof(LogEntry));
-
-        delete_keys.push_back(key);
-      }
-
-      for (auto key : delete_keys) {
-        ret = txn.Delete(key);
-        if (ret) {
-          txn.Abort();
-          return ret;
-        }
-      }
-
-      return txn.Commit();
+      return FinishReclaim(txn, oid, lobj, true);
     }
 
     if (lobj.trim_limit >= 0 && position <= uint64_t(lobj.trim_limit)) {
-      ret = txn.Commit();
-      if (ret)
-        return ret;
       return 0;
     }
   }
@@ -679,14 +1105,16 @@ int LMDBBackend::Trim(const std::string& oid, uint64_t epoch,
   LogEntry entry;
 
   MDB_val val;
-  std::string key = LogEntryKey(oid, position);
-  ret = txn.Get(key, val);
+  std::string key = LogEntryKey(lobj.id, position);
+  ret = txn.Get(db_entries, key, val);
   if (!ret) {
     assert(val.mv_size >= sizeof(entry));
     entry = *((LogEntry*)val.mv_data);
     assert(entry.position == position);
-  } else {
+  } else if (ret == -ENOENT) {
     entry.position = position;
+  } else {
+    return ret;
   }
 
   // read max position
@@ -695,7 +1123,6 @@ int LMDBBackend::Trim(const std::string& oid, uint64_t epoch,
   auto maxkey = MaxPosKey(oid);
   ret = txn.Get(maxkey, maxval);
   if (ret < 0 && ret != -ENOENT) {
-    txn.Abort();
     return ret;
   } else if (ret == 0) {
     LogMaxPos *maxpos = (LogMaxPos*)maxval.mv_data;
@@ -708,24 +1135,17 @@ int LMDBBackend::Trim(const std::string& oid, uint64_t epoch,
   new_maxpos.maxpos = std::max(pos, position);
   maxval.mv_data = &new_maxpos;
   maxval.mv_size = sizeof(new_maxpos);
-  txn.Put(maxkey, maxval, false);
+  ret = txn.Put(maxkey, maxval, false);
+  if (ret) {
+    return ret;
+  }
 
   entry.trimmed = true;
 
   val.mv_size = sizeof(entry);
   val.mv_data = &entry;
 
-  ret = txn.Put(key, val, false);
-  if (ret) {
-    txn.Abort();
-    return ret;
-  }
-
-  ret = txn.Commit();
-  if (ret)
-    return ret;
-
-  return 0;
+  return txn.Put(db_entries, key, val, false);
 }
 
 int LMDBBackend::Fill(const std::string& oid, uint64_t epoch,
@@ -739,28 +1159,31 @@ int LMDBBackend::Fill(const std::string& oid, uint64_t epoch,
     return -EINVAL;
   }
 
-  auto txn = NewTransaction();
+  return GroupCommit([&](Transaction& txn) {
+    return ApplyFill(txn, oid, epoch, position);
+  });
+}
 
+int LMDBBackend::ApplyFill(Transaction& txn, const std::string& oid,
+    uint64_t epoch, uint64_t position)
+{
   int ret = CheckEpoch(txn, epoch, oid);
   if (ret) {
-    txn.Abort();
     return ret;
   }
 
+  LogObject lobj;
   {
     MDB_val val;
     ret = txn.Get(oid, val);
     if (ret) {
-      txn.Abort();
       return ret;
     }
 
-    LogObject lobj;
     assert(val.mv_size == sizeof(lobj));
     lobj = *((LogObject*)val.mv_data);
 
     if (lobj.trim_limit >= 0 && position <= uint64_t(lobj.trim_limit)) {
-      txn.Abort();
       return 0;
     }
   }
@@ -768,18 +1191,18 @@ int LMDBBackend::Fill(const std::string& oid, uint64_t epoch,
   LogEntry entry;
 
   MDB_val val;
-  std::string key = LogEntryKey(oid, position);
-  ret = txn.Get(key, val);
+  std::string key = LogEntryKey(lobj.id, position);
+  ret = txn.Get(db_entries, key, val);
   if (!ret) {
     assert(val.mv_size >= sizeof(entry));
     entry = *((LogEntry*)val.mv_data);
     assert(entry.position == position);
     if (entry.trimmed || entry.invalidated) {
-      txn.Abort();
       return 0;
     }
-    txn.Abort();
     return -EROFS;
+  } else if (ret != -ENOENT) {
+    return ret;
   }
 
   entry.position = position;
@@ -790,7 +1213,6 @@ int LMDBBackend::Fill(const std::string& oid, uint64_t epoch,
   auto maxkey = MaxPosKey(oid);
   ret = txn.Get(maxkey, maxval);
   if (ret < 0 && ret != -ENOENT) {
-    txn.Abort();
     return ret;
   } else if (ret == 0) {
     LogMaxPos *maxpos = (LogMaxPos*)maxval.mv_data;
@@ -803,7 +1225,10 @@ int LMDBBackend::Fill(const std::string& oid, uint64_t epoch,
   new_maxpos.maxpos = std::max(pos, position);
   maxval.mv_data = &new_maxpos;
   maxval.mv_size = sizeof(new_maxpos);
-  txn.Put(maxkey, maxval, false);
+  ret = txn.Put(maxkey, maxval, false);
+  if (ret) {
+    return ret;
+  }
 
   entry.trimmed = true;
   entry.invalidated = true;
@@ -811,17 +1236,7 @@ int LMDBBackend::Fill(const std::string& oid, uint64_t epoch,
   val.mv_size = sizeof(entry);
   val.mv_data = &entry;
 
-  ret = txn.Put(key, val, false);
-  if (ret) {
-    txn.Abort();
-    return ret;
-  }
-
-  ret = txn.Commit();
-  if (ret)
-    return ret;
-
-  return 0;
+  return txn.Put(db_entries, key, val, false);
 }
 
 int LMDBBackend::CheckEpoch(Transaction& txn, uint64_t epoch,
@@ -829,7 +1244,7 @@ int LMDBBackend::CheckEpoch(Transaction& txn, uint64_t epoch,
 {
   MDB_val val;
   int ret = txn.Get(oid, val);
-  if (ret == -ENOENT)
+  if (ret)
     return ret;
   LogObject *obj = (LogObject*)val.mv_data;
   assert(val.mv_size == sizeof(*obj));
@@ -905,12 +1320,20 @@ int LMDBBackend::Seal(const std::string& oid, uint64_t epoch)
     return -EINVAL;
   }
 
-  auto txn = NewTransaction();
+  return GroupCommit([&](Transaction& txn) {
+    return ApplySeal(txn, oid, epoch);
+  });
+}
 
+int LMDBBackend::ApplySeal(Transaction& txn, const std::string& oid,
+    uint64_t epoch)
+{
   // read current epoch value (if its been set yet)
   MDB_val val;
   int ret = txn.Get(oid, val);
-  assert(ret == 0 || ret == -ENOENT);
+  if (ret && ret != -ENOENT) {
+    return ret;
+  }
 
   // if exists, verify the new epoch is larger
   LogObject obj;
@@ -918,24 +1341,367 @@ int LMDBBackend::Seal(const std::string& oid, uint64_t epoch)
     assert(val.mv_size == sizeof(obj));
     obj = *((LogObject*)val.mv_data);
     if (epoch <= obj.epoch) {
-      txn.Abort();
       return -ESPIPE;
     }
+  } else {
+    // assign an id to the new object
+    MDB_val idval;
+    const auto idkey = NextObjectIdKey();
+    ret = txn.Get(idkey, idval);
+    if (ret && ret != -ENOENT) {
+      return ret;
+    }
+    if (ret == 0) {
+      assert(idval.mv_size == sizeof(obj.id));
+      memcpy(&obj.id, idval.mv_data, sizeof(obj.id));
+    }
+    uint64_t next_id = obj.id + 1;
+    idval.mv_data = &next_id;
+    idval.mv_size = sizeof(next_id);
+    ret = txn.Put(idkey, idval, false);
+    if (ret) {
+      return ret;
+    }
   }
 
   // write new epoch
   obj.epoch = epoch;
   val.mv_data = &obj;
   val.mv_size = sizeof(obj);
-  txn.Put(oid, val, false);
+  return txn.Put(oid, val, false);
+}
 
-  ret = txn.Commit();
-  if (ret)
+int LMDBBackend::ApplyReclaim(Transaction& txn, const std::string& oid,
+    bool *done)
+{
+  *done = true;
+
+  MDB_val val;
+  int ret = txn.Get(oid, val);
+  if (ret == -ENOENT) {
+    ret = txn.Delete(db_reclaim, oid);
+    return ret == MDB_NOTFOUND ? 0 : ret;
+  } else if (ret) {
     return ret;
+  }
+
+  LogObject lobj;
+  assert(val.mv_size == sizeof(lobj));
+  lobj = *((LogObject*)val.mv_data);
+
+  if (lobj.trim_limit < 0) {
+    return FinishReclaim(txn, oid, lobj, false);
+  }
+
+  const auto prefix = LogEntryPrefix(lobj.id);
+  size_t count;
+  ret = txn.DeleteRange(db_entries, prefix, [&](const MDB_val& key) {
+    return std::memcmp(key.mv_data, prefix.data(), prefix.size()) == 0 &&
+      KeyNumber(key) <= uint64_t(lobj.trim_limit);
+  }, reclaim_batch_size, &count);
+  if (ret) {
+    return ret;
+  }
+
+  if (count == reclaim_batch_size) {
+    *done = false;
+    return 0;
+  }
+
+  return FinishReclaim(txn, oid, lobj, false);
+}
+
+int LMDBBackend::FinishReclaim(Transaction& txn, const std::string& oid,
+    const LogObject& lobj, bool trim_full)
+{
+  int ret = txn.Delete(db_reclaim, oid);
+  if (ret && ret != MDB_NOTFOUND) {
+    return ret;
+  }
+
+  // a partially trimmed object keeps its max position record, since the trim
+  // limit may be past the last position that was written.
+  if (!trim_full || lobj.trim_limit < 0) {
+    return 0;
+  }
+
+  // MaxPos falls back to the trim limit when there is no max position
+  MDB_val maxval;
+  const auto maxkey = MaxPosKey(oid);
+  ret = txn.Get(maxkey, maxval);
+  if (ret == 0) {
+    LogMaxPos *maxpos = (LogMaxPos*)maxval.mv_data;
+    assert(maxval.mv_size == sizeof(*maxpos));
+    if (maxpos->maxpos <= uint64_t(lobj.trim_limit)) {
+      ret = txn.Delete(db_obj, maxkey);
+      if (ret) {
+        return ret;
+      }
+    }
+  } else if (ret != -ENOENT) {
+    return ret;
+  }
 
   return 0;
 }
 
+void LMDBBackend::ReclaimThread()
+{
+  std::unique_lock<std::mutex> lk(reclaim_lock);
+  while (!stop_reclaim) {
+    if (!reclaim_pending) {
+      reclaim_cond.wait(lk);
+      continue;
+    }
+    reclaim_pending = false;
+    lk.unlock();
+    Reclaim();
+    lk.lock();
+  }
+}
+
+// works through the reclaim markers, including those left by a previous run,
+// one batch of entries per group commit so that writers aren't held up.
+void LMDBBackend::Reclaim()
+{
+  while (!stop_reclaim) {
+    std::vector<std::string> oids;
+    {
+      auto txn = NewTransaction(true);
+      txn.Seek(db_reclaim, "", [&](const MDB_val& key, const MDB_val& val) {
+        oids.emplace_back((const char*)key.mv_data, key.mv_size);
+        return oids.size() < 128;
+      });
+      txn.Abort();
+    }
+
+    if (oids.empty()) {
+      return;
+    }
+
+    for (const auto& oid : oids) {
+      bool done = false;
+      while (!done) {
+        if (stop_reclaim) {
+          return;
+        }
+        int ret = GroupCommit([&](Transaction& txn) {
+          return ApplyReclaim(txn, oid, &done);
+        });
+        if (ret) {
+          // the markers remain, and are retried after the next trim
+          std::cerr << "reclaim failed: " << ret << std::endl;
+          return;
+        }
+      }
+    }
+  }
+}
+
+int LMDBBackend::GroupCommit(const std::function<int(Transaction&)>& update)
+{
+  PendingUpdate pending{&update, 0, false};
+
+  std::unique_lock<std::mutex> lk(commit_lock);
+
+  commit_queue.push_back(&pending);
+  if (commit_queue.size() >= group_commit_max_batch) {
+    leader_cond.notify_one();
+  }
+
+  while (!pending.done) {
+    if (committing) {
+      commit_cond.wait(lk);
+      continue;
+    }
+
+    committing = true;
+
+    if (group_commit_window_us > 0) {
+      leader_cond.wait_for(lk,
+          std::chrono::microseconds(group_commit_window_us), [this] {
+        return commit_queue.size() >= group_commit_max_batch;
+      });
+    }
+
+    const size_t count = std::min(commit_queue.size(), group_commit_max_batch);
+    std::vector<PendingUpdate*> batch(commit_queue.begin(),
+        commit_queue.begin() + count);
+    commit_queue.erase(commit_queue.begin(), commit_queue.begin() + count);
+
+    lk.unlock();
+    CommitBatch(batch);
+    lk.lock();
+
+    for (auto p : batch) {
+      p->done = true;
+    }
+    committing = false;
+    commit_cond.notify_all();
+  }
+
+  return pending.result;
+}
+
+void LMDBBackend::CommitBatch(const std::vector<PendingUpdate*>& batch)
+{
+  while (true) {
+    auto txn = NewTransaction();
+
+    // once the map is full the transaction can only be aborted
+    for (auto p : batch) {
+      if (txn.map_full) {
+        break;
+      }
+      p->result = (*p->update)(txn);
+    }
+
+    int ret;
+    if (txn.map_full) {
+      txn.Abort();
+      ret = MDB_MAP_FULL;
+    } else {
+      ret = txn.Commit();
+    }
+
+    // the updates are applied again to the resized map
+    if (ret == MDB_MAP_FULL) {
+      ret = GrowMap(true);
+      if (ret == 0) {
+        continue;
+      }
+    } else if (ret) {
+      // lmdb returns errno values and its own negative error codes
+      ret = ret > 0 ? -ret : -EIO;
+    } else if (sync_mode == SYNC_PERIODIC) {
+      std::lock_guard<std::mutex> lk(sync_lock);
+      unsynced_bytes += txn.bytes;
+      if (sync_bytes > 0 && unsynced_bytes >= sync_bytes) {
+        sync_cond.notify_one();
+      }
+    }
+
+    // the results of updates that failed may depend on updates in the batch
+    // that weren't committed, so every update fails.
+    if (ret) {
+      for (auto p : batch) {
+        p->result = ret;
+      }
+    } else {
+      MaybeGrowMap();
+    }
+
+    return;
+  }
+}
+
+void LMDBBackend::EnterTransaction()
+{
+  while (true) {
+    active_txns++;
+    if (!resizing) {
+      return;
+    }
+    ExitTransaction();
+    std::unique_lock<std::mutex> lk(resize_lock);
+    resize_cond.wait(lk, [this] { return !resizing; });
+  }
+}
+
+void LMDBBackend::ExitTransaction()
+{
+  if (--active_txns == 0 && resizing) {
+    std::lock_guard<std::mutex> lk(resize_lock);
+    resize_cond.notify_all();
+  }
+}
+
+// doubles the map size. the map can't be resized while slices hold read
+// transactions, so slices stop leasing transactions until the map has grown.
+// when @wait is set this waits for open transactions to finish, but gives up
+// if a slice isn't released in time, such as one held by the thread waiting
+// for the write. otherwise the map only grows if no transactions are open.
+int LMDBBackend::GrowMap(bool wait)
+{
+  MDB_envinfo info;
+  int ret = mdb_env_info(env, &info);
+  assert(ret == 0);
+
+  const size_t size = info.me_mapsize;
+  if (map_max_size && size >= map_max_size) {
+    return -ENOSPC;
+  }
+
+  size_t new_size = size * 2;
+  if (map_max_size) {
+    new_size = std::min(new_size, map_max_size);
+  }
+
+  grow_wanted = true;
+
+  std::unique_lock<std::mutex> lk(resize_lock);
+
+  resizing = true;
+  const auto idle = [this] { return active_txns == 0; };
+  if (wait ? resize_cond.wait_for(lk, std::chrono::seconds(1), idle) :
+      idle()) {
+    ret = mdb_env_set_mapsize(env, new_size);
+    ret = ret ? -ret : 0;
+    if (!ret) {
+      grow_wanted = false;
+    }
+  } else {
+    ret = -ENOSPC;
+  }
+  resizing = false;
+  resize_cond.notify_all();
+
+  return ret;
+}
+
+// grows the map once it is more than three quarters full, before writes find
+// it full and have to wait for open transactions. runs after a commit, and
+// is retried by later commits while transactions are open.
+void LMDBBackend::MaybeGrowMap()
+{
+  MDB_envinfo info;
+  int ret = mdb_env_info(env, &info);
+  assert(ret == 0);
+
+  MDB_stat stat;
+  ret = mdb_env_stat(env, &stat);
+  assert(ret == 0);
+  (void)ret;
+
+  const size_t used = (info.me_last_pgno + 1) * stat.ms_psize;
+  if (used > info.me_mapsize / 4 * 3) {
+    GrowMap(false);
+  }
+}
+
+void LMDBBackend::SyncThread()
+{
+  std::unique_lock<std::mutex> lk(sync_lock);
+  while (!stop_sync) {
+    auto ready = [this] {
+      return stop_sync || (sync_bytes > 0 && unsynced_bytes >= sync_bytes);
+    };
+    if (sync_interval_ms > 0) {
+      sync_cond.wait_for(lk, std::chrono::milliseconds(sync_interval_ms),
+          ready);
+    } else {
+      sync_cond.wait(lk, ready);
+    }
+    if (stop_sync || unsynced_bytes == 0) {
+      continue;
+    }
+    unsynced_bytes = 0;
+    lk.unlock();
+    mdb_env_sync(env, 1);
+    lk.lock();
+  }
+}
+
 void LMDBBackend::Init(const std::string& path)
 {
   options["path"] = path;
@@ -946,20 +1712,16 @@ void LMDBBackend::Init(const std::string& path)
 
   need_close = true;
 
-  ret = mdb_env_set_maxdbs(env, 2);
+  ret = mdb_env_set_maxdbs(env, 4);
   assert(ret == 0);
 
-  size_t gbs = 1;
-  char *size_str = getenv("ZLOG_LMDB_BE_SIZE");
-  if (size_str) {
-    gbs = atoi(size_str);
-  }
-
-  gbs = gbs << 30;
-  ret = mdb_env_set_mapsize(env, gbs);
+  ret = mdb_env_set_mapsize(env, map_size);
   assert(ret == 0);
 
-  unsigned int flags = MDB_NOTLS | MDB_NOSYNC | MDB_NOMETASYNC | MDB_WRITEMAP | MDB_NOMEMINIT;
+  unsigned int flags = MDB_NOTLS | MDB_WRITEMAP | MDB_NOMEMINIT;
+  if (sync_mode != SYNC_COMMIT) {
+    flags |= MDB_NOSYNC | MDB_NOMETASYNC;
+  }
   ret = mdb_env_open(env, path.c_str(), flags, 0644);
   assert(ret == 0);
 
@@ -970,13 +1732,46 @@ void LMDBBackend::Init(const std::string& path)
   ret = mdb_dbi_open(txn, "objs", MDB_CREATE, &db_obj);
   assert(ret == 0);
 
+  ret = mdb_dbi_open(txn, "views", MDB_CREATE, &db_views);
+  assert(ret == 0);
+
+  ret = mdb_dbi_open(txn, "entries", MDB_CREATE, &db_entries);
+  assert(ret == 0);
+
+  ret = mdb_dbi_open(txn, "reclaim", MDB_CREATE, &db_reclaim);
+  assert(ret == 0);
+
   ret = mdb_txn_commit(txn);
   assert(ret == 0);
+
+  if (sync_mode == SYNC_PERIODIC) {
+    sync_thread = std::thread(&LMDBBackend::SyncThread, this);
+  }
+
+  if (reclaim_batch_size > 0) {
+    reclaim_thread = std::thread(&LMDBBackend::ReclaimThread, this);
+  }
 }
 
 void LMDBBackend::Close()
 {
   need_close = false;
+  if (reclaim_thread.joinable()) {
+    {
+      std::lock_guard<std::mutex> lk(reclaim_lock);
+      stop_reclaim = true;
+    }
+    reclaim_cond.notify_one();
+    reclaim_thread.join();
+  }
+  if (sync_thread.joinable()) {
+    {
+      std::lock_guard<std::mutex> lk(sync_lock);
+      stop_sync = true;
+    }
+    sync_cond.notify_one();
+    sync_thread.join();
+  }
   mdb_env_sync(env, 1);
   mdb_env_close(env);
 }
@@ -2,6 +2,7 @@
 #include "libzlog/test_libzlog.h"
 #include "include/zlog/backend/lmdb.h"
 #include "port/stack_trace.h"
+#include <fstream>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
@@ -204,6 +205,244 @@ void LibZLogCAPITest::TearDown() {
   }
 }
 
+struct LMDBBackendTest : public ::testing::Test {
+  void SetUp() override {
+    context.dbpath = strdup("/tmp/zlog.db.XXXXXX");
+    ASSERT_NE(mkdtemp(context.dbpath), nullptr);
+  }
+
+  DBPathContext context;
+};
+
+TEST_F(LMDBBackendTest, Initialize_Options) {
+  const std::string path(context.dbpath);
+  std::vector<std::map<std::string, std::string>> invalid{
+    {},
+    {{"path", path}, {"sync", "sometimes"}},
+    {{"path", path}, {"sync", "periodic"}, {"sync_interval_ms", "0"}},
+    {{"path", path}, {"sync_bytes", "lots"}},
+    {{"path", path}, {"map_size", "0"}},
+    {{"path", path}, {"map_size", "2097152"}, {"map_max_size", "1048576"}},
+    {{"path", path}, {"group_commit_max_batch", "0"}},
+    {{"path", path}, {"reclaim_batch_size", "some"}},
+  };
+
+  for (const auto& opts : invalid) {
+    zlog::storage::lmdb::LMDBBackend be;
+    ASSERT_EQ(be.Initialize(opts), -EINVAL);
+  }
+
+  zlog::storage::lmdb::LMDBBackend be;
+  ASSERT_EQ(be.Initialize({{"path", path}, {"sync", "commit"},
+        {"map_size", "1048576"}}), 0);
+  ASSERT_EQ(be.meta()["sync"], "commit");
+  ASSERT_EQ(be.meta()["map_size"], "1048576");
+}
+
+// writes continue past the initial map size
+TEST_F(LMDBBackendTest, MapGrowth) {
+  zlog::storage::lmdb::LMDBBackend be;
+  ASSERT_EQ(be.Initialize({{"path", context.dbpath},
+        {"map_size", "1048576"}, {"sync", "periodic"},
+        {"sync_bytes", "65536"}}), 0);
+
+  const std::string data(4096, 'x');
+  ASSERT_EQ(be.Seal("a", 1), 0);
+  for (uint64_t pos = 0; pos < 1024; pos++) {
+    ASSERT_EQ(be.Write("a", data, 1, pos), 0);
+  }
+
+  for (uint64_t pos = 0; pos < 1024; pos++) {
+    std::string out;
+    ASSERT_EQ(be.Read("a", 1, pos, &out), 0);
+    ASSERT_EQ(out, data);
+  }
+}
+
+// a slice holds a read transaction, and the map can't be resized while it is
+// open. here the writer always holds a slice of the previous entry.
+TEST_F(LMDBBackendTest, MapGrowth_Slice) {
+  zlog::storage::lmdb::LMDBBackend be;
+  ASSERT_EQ(be.Initialize({{"path", context.dbpath},
+        {"map_size", "1048576"}}), 0);
+
+  const std::string data(4096, 'x');
+  ASSERT_EQ(be.Seal("a", 1), 0);
+  ASSERT_EQ(be.Write("a", data, 1, 0), 0);
+
+  zlog::Slice slice;
+  for (uint64_t pos = 1; pos < 1024; pos++) {
+    ASSERT_EQ(be.ReadSlice("a", 1, pos - 1, &slice), 0);
+    ASSERT_EQ(be.Write("a", data, 1, pos), 0);
+    ASSERT_EQ(slice.ToString(), data);
+  }
+}
+
+TEST_F(LMDBBackendTest, MapMaxSize) {
+  zlog::storage::lmdb::LMDBBackend be;
+  ASSERT_EQ(be.Initialize({{"path", context.dbpath},
+        {"map_size", "1048576"}, {"map_max_size", "2097152"}}), 0);
+
+  const std::string data(4096, 'x');
+  ASSERT_EQ(be.Seal("a", 1), 0);
+  int ret;
+  uint64_t pos = 0;
+  while ((ret = be.Write("a", data, 1, pos)) == 0) {
+    pos++;
+  }
+  ASSERT_EQ(ret, -ENOSPC);
+  ASSERT_GT(pos, 0u);
+
+  // the failed write didn't take the position
+  std::string out;
+  ASSERT_EQ(be.Read("a", 1, pos, &out), -ERANGE);
+  ASSERT_EQ(be.Read("a", 1, pos - 1, &out), 0);
+  ASSERT_EQ(be.Write("a", data, 1, pos), -ENOSPC);
+}
+
+// waits for background reclamation to bring an object's size to @size
+static void WaitForSize(zlog::Backend *be, const std::string& oid,
+    size_t size)
+{
+  for (int i = 0; i < 1000; i++) {
+    size_t cur;
+    ASSERT_EQ(be->Stat(oid, &cur), 0);
+    if (cur == size) {
+      return;
+    }
+    usleep(10000);
+  }
+  FAIL() << "size of " << oid << " didn't reach " << size;
+}
+
+// entries at or below the trim limit are deleted in the background
+TEST_F(LMDBBackendTest, Reclaim) {
+  zlog::storage::lmdb::LMDBBackend be;
+  ASSERT_EQ(be.Initialize({{"path", context.dbpath},
+        {"reclaim_batch_size", "7"}}), 0);
+
+  ASSERT_EQ(be.Seal("a", 1), 0);
+  for (uint64_t pos = 0; pos < 100; pos++) {
+    ASSERT_EQ(be.Write("a", "data", 1, pos), 0);
+  }
+
+  size_t size;
+  ASSERT_EQ(be.Stat("a", &size), 0);
+  ASSERT_GT(size, 0u);
+
+  ASSERT_EQ(be.Trim("a", 1, 49, true, false), 0);
+  WaitForSize(&be, "a", size / 2);
+
+  std::string data;
+  ASSERT_EQ(be.Read("a", 1, 49, &data), -ENODATA);
+  ASSERT_EQ(be.Read("a", 1, 50, &data), 0);
+  ASSERT_EQ(data, "data");
+
+  ASSERT_EQ(be.Trim("a", 1, 99, true, false), 0);
+  WaitForSize(&be, "a", 0);
+
+  uint64_t pos;
+  bool empty;
+  ASSERT_EQ(be.MaxPos("a", &pos, &empty), 0);
+  ASSERT_FALSE(empty);
+  ASSERT_EQ(pos, 99u);
+
+  ASSERT_EQ(be.Write("a", "data", 1, 99), -EROFS);
+  ASSERT_EQ(be.Write("a", "data", 1, 100), 0);
+  ASSERT_EQ(be.MaxPos("a", &pos, &empty), 0);
+  ASSERT_EQ(pos, 100u);
+}
+
+// trims that weren't reclaimed before the backend was closed are reclaimed
+// after it is opened again
+TEST_F(LMDBBackendTest, Reclaim_Reopen) {
+  size_t size;
+  {
+    zlog::storage::lmdb::LMDBBackend be;
+    ASSERT_EQ(be.Initialize({{"path", context.dbpath},
+          {"reclaim_batch_size", "0"}}), 0);
+    ASSERT_EQ(be.Seal("a", 1), 0);
+    for (uint64_t pos = 0; pos < 10; pos++) {
+      ASSERT_EQ(be.Write("a", "data", 1, pos), 0);
+    }
+    ASSERT_EQ(be.Stat("a", &size), 0);
+    ASSERT_EQ(be.Trim("a", 1, 4, true, false), 0);
+    usleep(100000);
+    size_t size2;
+    ASSERT_EQ(be.Stat("a", &size2), 0);
+    ASSERT_EQ(size, size2);
+  }
+
+  zlog::storage::lmdb::LMDBBackend be;
+  ASSERT_EQ(be.Initialize({{"path", context.dbpath}}), 0);
+  WaitForSize(&be, "a", size / 2);
+}
+
+// lmdb doesn't checksum its pages, so a payload corrupted in the database
+// file is returned as is unless the entry checksum is verified
+TEST_F(LMDBBackendTest, Checksums) {
+  const std::string data = "an entry that is only stored once";
+  {
+    zlog::storage::lmdb::LMDBBackend be;
+    ASSERT_EQ(be.Initialize({{"path", context.dbpath}}), 0);
+    ASSERT_EQ(be.Seal("a", 1), 0);
+    ASSERT_EQ(be.Write("a", data, 1, 0), 0);
+    ASSERT_EQ(be.Write("a", "abc", 1, 1), 0);
+    ASSERT_EQ(be.Fill("a", 1, 2), 0);
+
+    std::set<uint64_t> corrupt;
+    ASSERT_EQ(be.Scrub("a", &corrupt), 0);
+    ASSERT_TRUE(corrupt.empty());
+  }
+
+  // flip a bit of the payload in the closed database
+  const auto path = std::string(context.dbpath) + "/data.mdb";
+  std::ifstream ifs(path, std::ios::binary);
+  std::string contents((std::istreambuf_iterator<char>(ifs)),
+      std::istreambuf_iterator<char>());
+  ifs.close();
+  const auto offset = contents.find(data);
+  ASSERT_NE(offset, std::string::npos);
+  ASSERT_EQ(contents.find(data, offset + 1), std::string::npos);
+  contents[offset + 1] ^= 1;
+  std::ofstream ofs(path, std::ios::binary | std::ios::in);
+  ofs.seekp(offset + 1);
+  ofs.put(contents[offset + 1]);
+  ofs.close();
+
+  {
+    zlog::storage::lmdb::LMDBBackend be;
+    ASSERT_EQ(be.Initialize({{"path", context.dbpath}}), 0);
+
+    std::string out;
+    ASSERT_EQ(be.Read("a", 1, 0, &out), -EIO);
+    zlog::Slice slice;
+    ASSERT_EQ(be.ReadSlice("a", 1, 0, &slice), -EIO);
+    ASSERT_EQ(be.ReadRange("a", 1, 0, 2, 1, nullptr, nullptr), -EIO);
+    ASSERT_EQ(be.Read("a", 1, 1, &out), 0);
+    ASSERT_EQ(out, "abc");
+
+    std::set<uint64_t> corrupt;
+    ASSERT_EQ(be.Scrub("a", &corrupt), 0);
+    ASSERT_EQ(corrupt, std::set<uint64_t>({0}));
+  }
+
+  // verification can be skipped on reads, but not when scrubbing
+  zlog::storage::lmdb::LMDBBackend be;
+  ASSERT_EQ(be.Initialize({{"path", context.dbpath},
+        {"verify_checksums", "false"}}), 0);
+  ASSERT_EQ(be.meta()["verify_checksums"], "false");
+
+  std::string out;
+  ASSERT_EQ(be.Read("a", 1, 0, &out), 0);
+  ASSERT_EQ(out.size(), data.size());
+  ASSERT_NE(out, data);
+
+  std::set<uint64_t> corrupt;
+  ASSERT_EQ(be.Scrub("a", &corrupt), 0);
+  ASSERT_EQ(corrupt, std::set<uint64_t>({0}));
+}
+
 INSTANTIATE_TEST_CASE_P(Level, ZLogTest,
     ::testing::Values(
       std::make_tuple(true, true),
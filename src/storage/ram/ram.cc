@@ -1,11 +1,16 @@
 #include <vector>
 #include <atomic>
+#include <cstring>
+#include <iostream>
+#include <limits>
 #include <boost/algorithm/string.hpp>
+#include <boost/lexical_cast.hpp>
 #include <boost/uuid/uuid.hpp>
 #include <boost/uuid/uuid_generators.hpp>
 #include <boost/uuid/uuid_io.hpp>
 #include "zlog/backend.h"
 #include "zlog/backend/ram.h"
+#include "util/crc32c.h"
 
 namespace zlog {
 namespace storage {
@@ -23,12 +28,34 @@ int RAMBackend::Initialize(
     blackhole_ = boost::iequals(it->second, "yes") ||
       boost::iequals(it->second, "true");
   }
+
+  it = opts.find("verify_checksums");
+  if (it != opts.end()) {
+    verify_checksums_ = boost::iequals(it->second, "yes") ||
+      boost::iequals(it->second, "true");
+    options_[it->first] = it->second;
+  }
+
+  it = opts.find("max_bytes");
+  if (it != opts.end()) {
+    try {
+      max_bytes_ = boost::lexical_cast<size_t>(it->second);
+    } catch (boost::bad_lexical_cast& e) {
+      std::cerr << "could not convert to integer: " << it->second << std::endl;
+      return -EINVAL;
+    }
+    options_[it->first] = it->second;
+  }
+
   return 0;
 }
 
 std::map<std::string, std::string> RAMBackend::meta()
 {
-  return options_;
+  auto meta = options_;
+  meta["bytes_allocated"] = std::to_string(bytes_allocated_.load());
+  meta["bytes_used"] = std::to_string(bytes_used_.load());
+  return meta;
 }
 
 int RAMBackend::uniqueId(const std::string& hoid, uint64_t *id)
@@ -61,8 +88,9 @@ int RAMBackend::CreateLog(const std::string& name, const std::string& view,
   proj.projections.emplace(proj.epoch, view);
 
   {
-    std::lock_guard<std::mutex> lk(lock_);
-    auto ret = objects_.emplace(hoid, proj);
+    auto& shard = shard_for(hoid);
+    std::lock_guard<std::mutex> lk(shard.lock);
+    auto ret = shard.objects.emplace(hoid, proj);
     // assert that this was a unique hoid. a more robust implementation can
     // retry generating a unique object name.
     assert(ret.second);
@@ -75,8 +103,9 @@ int RAMBackend::CreateLog(const std::string& name, const std::string& view,
   link.hoid = hoid;
   auto prefixed_name = std::string("head.").append(name);
   {
-    std::lock_guard<std::mutex> lk(lock_);
-    auto ret = objects_.emplace(prefixed_name, link);
+    auto& shard = shard_for(prefixed_name);
+    std::lock_guard<std::mutex> lk(shard.lock);
+    auto ret = shard.objects.emplace(prefixed_name, link);
     if (!ret.second) {
       return -EEXIST;
     }
@@ -100,40 +129,50 @@ int RAMBackend::OpenLog(const std::string& name, std::string *hoid_out,
     return -EINVAL;
   }
 
-  std::lock_guard<std::mutex> lk(lock_);
-
-  auto prefixed_name = std::string("head.").append(name);
-  auto link_it = objects_.find(prefixed_name);
-  if (link_it == objects_.end()) {
-    return -ENOENT;
+  // the link and the head object may live in different shards
+  std::string hoid;
+  {
+    auto prefixed_name = std::string("head.").append(name);
+    auto& shard = shard_for(prefixed_name);
+    std::lock_guard<std::mutex> lk(shard.lock);
+    auto link_it = shard.objects.find(prefixed_name);
+    if (link_it == shard.objects.end()) {
+      return -ENOENT;
+    }
+    hoid = boost::get<LinkObject>(link_it->second).hoid;
   }
-  auto& link = boost::get<LinkObject>(link_it->second);
 
-  auto hoid_it = objects_.find(link.hoid);
-  if (hoid_it == objects_.end()) {
-    return -EIO;
+  std::string prefix;
+  {
+    auto& shard = shard_for(hoid);
+    std::lock_guard<std::mutex> lk(shard.lock);
+    auto hoid_it = shard.objects.find(hoid);
+    if (hoid_it == shard.objects.end()) {
+      return -EIO;
+    }
+    prefix = boost::get<ProjectionObject>(hoid_it->second).prefix;
   }
-  auto& hoid = boost::get<ProjectionObject>(hoid_it->second);
 
   if (hoid_out) {
-    *hoid_out = link.hoid;
+    *hoid_out = hoid;
   }
 
   if (prefix_out) {
-    *prefix_out = hoid.prefix;
+    *prefix_out = prefix;
   }
 
   return 0;
 }
 
 int RAMBackend::ListLinks(std::vector<std::string> &loids_out) {
-  std::lock_guard<std::mutex> lk(lock_);
-
   auto prefix = std::string("head.");
-  for (const auto &entry : objects_) {
-    const auto &key = entry.first;
-    if (startsWith(key, prefix)) {
-      loids_out.emplace_back(key);
+  for (auto& shard : shards_) {
+    std::lock_guard<std::mutex> lk(shard.lock);
+    for (const auto &entry : shard.objects) {
+      const auto &key = entry.first;
+      if (startsWith(key, prefix)) {
+        loids_out.emplace_back(key);
+      }
     }
   }
 
@@ -141,18 +180,19 @@ int RAMBackend::ListLinks(std::vector<std::string> &loids_out) {
 }
 
 int RAMBackend::ListHeads(std::vector<std::string> &ooids_out) {
-  std::lock_guard<std::mutex> lk(lock_);
-
   auto prefix = std::string("zlog.head.");
-  for (const auto &entry : objects_) {
-    const auto &key = entry.first;
-    if (startsWith(key, prefix)) {
-      auto prefix_stripped = key.substr(prefix.size());
-      // Filter zlog.head.*.N entries
-      if (prefix_stripped.find('.') != std::string::npos) {
-        continue;
+  for (auto& shard : shards_) {
+    std::lock_guard<std::mutex> lk(shard.lock);
+    for (const auto &entry : shard.objects) {
+      const auto &key = entry.first;
+      if (startsWith(key, prefix)) {
+        auto prefix_stripped = key.substr(prefix.size());
+        // Filter zlog.head.*.N entries
+        if (prefix_stripped.find('.') != std::string::npos) {
+          continue;
+        }
+        ooids_out.emplace_back(key);
       }
-      ooids_out.emplace_back(key);
     }
   }
 
@@ -165,10 +205,11 @@ int RAMBackend::ReadViews(const std::string& hoid, uint64_t epoch,
   if (hoid.empty())
     return -EINVAL;
 
-  std::lock_guard<std::mutex> lk(lock_);
+  auto& shard = shard_for(hoid);
+  std::lock_guard<std::mutex> lk(shard.lock);
 
-  auto it = objects_.find(hoid);
-  if (it == objects_.end()) {
+  auto it = shard.objects.find(hoid);
+  if (it == shard.objects.end()) {
     return -ENOENT;
   }
 
@@ -231,10 +272,11 @@ int RAMBackend::ProposeView(const std::string& hoid,
     return -EINVAL;
   }
 
-  std::lock_guard<std::mutex> lk(lock_);
+  auto& shard = shard_for(hoid);
+  std::lock_guard<std::mutex> lk(shard.lock);
 
-  auto it = objects_.find(hoid);
-  if (it == objects_.end()) {
+  auto it = shard.objects.find(hoid);
+  if (it == shard.objects.end()) {
     return -ENOENT;
   }
 
@@ -257,10 +299,102 @@ int RAMBackend::ProposeView(const std::string& hoid,
   return 0;
 }
 
+int RAMBackend::ReadEntry(const std::string& oid, uint64_t epoch,
+    uint64_t position, Slice *data)
+{
+  if (oid.empty()) {
+    return -EINVAL;
+  }
+
+  if (epoch == 0) {
+    return -EINVAL;
+  }
+
+  LogEntry entry;
+  {
+    auto& shard = shard_for(oid);
+    std::lock_guard<std::mutex> lk(shard.lock);
+
+    LogObject *lobj = nullptr;
+    int ret = CheckEpoch(epoch, oid, false, lobj);
+    if (ret) {
+      return ret;
+    }
+
+    assert(lobj);
+
+    if (lobj->trim_limit && position <= *lobj->trim_limit) {
+      return -ENODATA;
+    }
+
+    const LogEntry *found = lobj->entries.find(position);
+    if (!found)
+      return -ERANGE;
+
+    if (found->trimmed || found->invalidated)
+      return -ENODATA;
+
+    entry = *found;
+    if (entry.data) {
+      *data = Slice(lobj->arena.chunks[entry.chunk], entry.data, entry.size);
+    }
+  }
+
+  // the slice keeps the entry alive, so it is verified without the lock
+  if (verify_checksums_ && !VerifyEntry(entry)) {
+    data->clear();
+    return -EIO;
+  }
+
+  return 0;
+}
+
 int RAMBackend::Read(const std::string& oid, uint64_t epoch,
     uint64_t position, std::string *data)
 {
-  if (oid.empty()) {
+  Slice entry;
+  int ret = ReadEntry(oid, epoch, position, &entry);
+  if (ret) {
+    return ret;
+  }
+
+  // entries are immutable, so the copy is made without holding the lock
+  if (entry.data()) {
+    data->assign(entry.data(), entry.size());
+  } else {
+    data->clear();
+  }
+
+  return 0;
+}
+
+int RAMBackend::ReadSlice(const std::string& oid, uint64_t epoch,
+    uint64_t position, Slice *data_out)
+{
+  Slice entry;
+  int ret = ReadEntry(oid, epoch, position, &entry);
+  if (ret) {
+    return ret;
+  }
+
+  *data_out = std::move(entry);
+
+  return 0;
+}
+
+int RAMBackend::ReadSliceAsync(const std::string& oid, uint64_t epoch,
+    uint64_t position, Slice *data_out, std::function<void(int)> cb)
+{
+  cb(ReadSlice(oid, epoch, position, data_out));
+  return 0;
+}
+
+int RAMBackend::ReadRange(const std::string& oid, uint64_t epoch,
+    uint64_t min_position, uint64_t max_position, uint32_t stride,
+    std::map<uint64_t, std::string> *entries_out,
+    std::set<uint64_t> *invalid_out)
+{
+  if (oid.empty() || min_position > max_position || stride == 0) {
     return -EINVAL;
   }
 
@@ -268,7 +402,8 @@ int RAMBackend::Read(const std::string& oid, uint64_t epoch,
     return -EINVAL;
   }
 
-  std::lock_guard<std::mutex> lk(lock_);
+  auto& shard = shard_for(oid);
+  std::lock_guard<std::mutex> lk(shard.lock);
 
   LogObject *lobj = nullptr;
   int ret = CheckEpoch(epoch, oid, false, lobj);
@@ -276,24 +411,43 @@ int RAMBackend::Read(const std::string& oid, uint64_t epoch,
     return ret;
   }
 
-  if (lobj) {
+  assert(lobj);
+
+  std::map<uint64_t, std::string> entries;
+  std::set<uint64_t> invalid;
+
+  for (uint64_t position = min_position;; position += stride) {
     if (lobj->trim_limit && position <= *lobj->trim_limit) {
-      return -ENODATA;
+      invalid.insert(position);
+    } else {
+      const LogEntry *entry = lobj->entries.find(position);
+      if (entry) {
+        if (entry->trimmed || entry->invalidated) {
+          invalid.insert(position);
+        } else {
+          if (verify_checksums_ && !VerifyEntry(*entry)) {
+            return -EIO;
+          }
+          entries.emplace(position, entry->data ?
+              std::string(entry->data, entry->size) : std::string());
+        }
+      }
     }
 
-    const auto it = lobj->entries.find(position);
-    if (it == lobj->entries.end())
-      return -ERANGE;
+    if (max_position - position < stride) {
+      break;
+    }
+  }
 
-    const LogEntry& entry = it->second;
-    if (entry.trimmed || entry.invalidated)
-      return -ENODATA;
+  if (entries_out) {
+    entries_out->swap(entries);
+  }
 
-    data->assign(entry.data);
-    return 0;
-  } else {
-    return -ENOENT;
+  if (invalid_out) {
+    invalid_out->swap(invalid);
   }
+
+  return 0;
 }
 
 int RAMBackend::Write(const std::string& oid, const std::string& data,
@@ -307,7 +461,10 @@ int RAMBackend::Write(const std::string& oid, const std::string& data,
     return -EINVAL;
   }
 
-  std::lock_guard<std::mutex> lk(lock_);
+  const uint32_t crc = crc32c::Value(data.data(), data.size());
+
+  auto& shard = shard_for(oid);
+  std::lock_guard<std::mutex> lk(shard.lock);
 
   LogObject *lobj = nullptr;
   int ret = CheckEpoch(epoch, oid, false, lobj);
@@ -316,22 +473,18 @@ int RAMBackend::Write(const std::string& oid, const std::string& data,
   }
 
   assert(lobj);
-  {
-    auto ret = objects_.emplace(oid, LogObject());
-    lobj = &boost::get<LogObject>(ret.first->second);
-  }
 
   if (lobj->trim_limit && position <= *lobj->trim_limit) {
     return -EROFS;
   }
 
-  auto it = lobj->entries.find(position);
-  if (it == lobj->entries.end()) {
+  if (!lobj->entries.find(position)) {
     LogEntry entry;
-    if (!blackhole_) {
-      entry.data = data;
+    ret = StoreEntry(lobj, data, crc, &entry);
+    if (ret) {
+      return ret;
     }
-    lobj->entries.emplace(position, entry);
+    lobj->entries.insert(position) = entry;
     lobj->maxpos = std::max(lobj->maxpos, position);
     return 0;
   } else {
@@ -339,6 +492,63 @@ int RAMBackend::Write(const std::string& oid, const std::string& data,
   }
 }
 
+int RAMBackend::WriteBatch(const std::string& oid, uint64_t epoch,
+    const std::vector<std::pair<uint64_t, const std::string*>>& entries,
+    std::vector<int> *results)
+{
+  if (oid.empty() || entries.empty() || !results) {
+    return -EINVAL;
+  }
+
+  if (epoch == 0) {
+    return -EINVAL;
+  }
+
+  std::vector<uint32_t> crcs;
+  crcs.reserve(entries.size());
+  for (const auto& entry : entries) {
+    crcs.push_back(crc32c::Value(entry.second->data(),
+          entry.second->size()));
+  }
+
+  auto& shard = shard_for(oid);
+  std::lock_guard<std::mutex> lk(shard.lock);
+
+  LogObject *lobj = nullptr;
+  int ret = CheckEpoch(epoch, oid, false, lobj);
+  if (ret) {
+    results->assign(entries.size(), ret);
+    return ret;
+  }
+
+  assert(lobj);
+  results->assign(entries.size(), 0);
+
+  for (size_t i = 0; i < entries.size(); i++) {
+    const auto position = entries[i].first;
+
+    if (lobj->trim_limit && position <= *lobj->trim_limit) {
+      (*results)[i] = -EROFS;
+      continue;
+    }
+
+    if (!lobj->entries.find(position)) {
+      LogEntry entry;
+      ret = StoreEntry(lobj, *entries[i].second, crcs[i], &entry);
+      if (ret) {
+        (*results)[i] = ret;
+        continue;
+      }
+      lobj->entries.insert(position) = entry;
+      lobj->maxpos = std::max(lobj->maxpos, position);
+    } else {
+      (*results)[i] = -EROFS;
+    }
+  }
+
+  return 0;
+}
+
 int RAMBackend::Trim(const std::string& oid, uint64_t epoch,
     const uint64_t position, bool trim_limit, bool trim_full)
 {
@@ -354,7 +564,8 @@ int RAMBackend::Trim(const std::string& oid, uint64_t epoch,
     return -EINVAL;
   }
 
-  std::lock_guard<std::mutex> lk(lock_);
+  auto& shard = shard_for(oid);
+  std::lock_guard<std::mutex> lk(shard.lock);
 
   LogObject *lobj = nullptr;
   int ret = CheckEpoch(epoch, oid, false, lobj);
@@ -363,7 +574,7 @@ int RAMBackend::Trim(const std::string& oid, uint64_t epoch,
   }
 
   if (!lobj) {
-    auto ret = objects_.emplace(oid, LogObject());
+    auto ret = shard.objects.emplace(oid, LogObject());
     lobj = &boost::get<LogObject>(ret.first->second);
   }
 
@@ -382,6 +593,7 @@ int RAMBackend::Trim(const std::string& oid, uint64_t epoch,
    */
   if (trim_full) {
     lobj->entries.clear();
+    ReleaseArena(lobj);
     return 0;
   }
 
@@ -393,19 +605,14 @@ int RAMBackend::Trim(const std::string& oid, uint64_t epoch,
   assert(!trim_limit);
   assert(!trim_full);
 
-  auto it = lobj->entries.find(position);
-  if (it == lobj->entries.end()) {
-    LogEntry entry;
-    entry.trimmed = true;
-    entry.invalidated = true;
-    lobj->entries.emplace(position, entry);
-    lobj->maxpos = std::max(lobj->maxpos, position);
-  } else {
-    auto& entry = it->second;
-    entry.trimmed = true;
-    entry.data.clear();
-    lobj->maxpos = std::max(lobj->maxpos, position);
+  LogEntry *entry = lobj->entries.find(position);
+  if (!entry) {
+    entry = &lobj->entries.insert(position);
+    entry->invalidated = true;
   }
+  entry->trimmed = true;
+  ReleaseEntry(lobj, entry);
+  lobj->maxpos = std::max(lobj->maxpos, position);
 
   return 0;
 }
@@ -416,7 +623,8 @@ int RAMBackend::Stat(const std::string& oid, size_t *size)
     return -EINVAL;
   }
 
-  std::lock_guard<std::mutex> lk(lock_);
+  auto& shard = shard_for(oid);
+  std::lock_guard<std::mutex> lk(shard.lock);
 
   LogObject *lobj = nullptr;
   int ret = CheckEpoch(std::numeric_limits<uint64_t>::max(), oid, false, lobj);
@@ -426,15 +634,42 @@ int RAMBackend::Stat(const std::string& oid, size_t *size)
 
   assert(lobj);
 
-  size_t s = 0;
-  for (auto entry : lobj->entries) {
-    s += entry.second.data.size();
+  if (size) {
+    *size = lobj->arena.allocated;
   }
 
-  if (size) {
-    *size = s;
+  return 0;
+}
+
+int RAMBackend::Scrub(const std::string& oid, std::set<uint64_t> *corrupt_out)
+{
+  if (oid.empty() || !corrupt_out) {
+    return -EINVAL;
   }
 
+  auto& shard = shard_for(oid);
+  std::lock_guard<std::mutex> lk(shard.lock);
+
+  LogObject *lobj = nullptr;
+  int ret = CheckEpoch(std::numeric_limits<uint64_t>::max(), oid, false, lobj);
+  if (ret) {
+    return ret;
+  }
+
+  assert(lobj);
+
+  std::set<uint64_t> corrupt;
+  lobj->entries.for_each([&](uint64_t position, const LogEntry& entry) {
+    if (lobj->trim_limit && position <= *lobj->trim_limit) {
+      return;
+    }
+    if (!entry.trimmed && !entry.invalidated && !VerifyEntry(entry)) {
+      corrupt.insert(position);
+    }
+  });
+
+  corrupt_out->swap(corrupt);
+
   return 0;
 }
 
@@ -449,7 +684,8 @@ int RAMBackend::Fill(const std::string& oid, uint64_t epoch,
     return -EINVAL;
   }
 
-  std::lock_guard<std::mutex> lk(lock_);
+  auto& shard = shard_for(oid);
+  std::lock_guard<std::mutex> lk(shard.lock);
 
   LogObject *lobj = nullptr;
   int ret = CheckEpoch(epoch, oid, false, lobj);
@@ -458,7 +694,7 @@ int RAMBackend::Fill(const std::string& oid, uint64_t epoch,
   }
 
   if (!lobj) {
-    auto ret = objects_.emplace(oid, LogObject());
+    auto ret = shard.objects.emplace(oid, LogObject());
     lobj = &boost::get<LogObject>(ret.first->second);
   }
 
@@ -466,17 +702,15 @@ int RAMBackend::Fill(const std::string& oid, uint64_t epoch,
     return 0;
   }
 
-  auto it = lobj->entries.find(position);
-  if (it == lobj->entries.end()) {
-    LogEntry entry;
-    entry.trimmed = true;
-    entry.invalidated = true;
-    lobj->entries.emplace(position, entry);
+  LogEntry *entry = lobj->entries.find(position);
+  if (!entry) {
+    entry = &lobj->entries.insert(position);
+    entry->trimmed = true;
+    entry->invalidated = true;
     lobj->maxpos = std::max(lobj->maxpos, position);
     return 0;
   } else {
-    auto& entry = it->second;
-    if (entry.trimmed || entry.invalidated) {
+    if (entry->trimmed || entry->invalidated) {
       return 0;
     }
     return -EROFS;
@@ -493,9 +727,10 @@ int RAMBackend::Seal(const std::string& oid, uint64_t epoch)
     return -EINVAL;
   }
 
-  std::lock_guard<std::mutex> lk(lock_);
+  auto& shard = shard_for(oid);
+  std::lock_guard<std::mutex> lk(shard.lock);
 
-  auto ret = objects_.emplace(oid, LogObject());
+  auto ret = shard.objects.emplace(oid, LogObject());
   auto& obj = boost::get<LogObject>(ret.first->second);
 
   // if exists, verify the new epoch is larger
@@ -516,42 +751,272 @@ int RAMBackend::MaxPos(const std::string& oid, uint64_t *pos, bool *empty)
     return -EINVAL;
   }
 
-  std::lock_guard<std::mutex> lk(lock_);
+  auto& shard = shard_for(oid);
+  std::lock_guard<std::mutex> lk(shard.lock);
 
-  auto it = objects_.find(oid);
-  if (it == objects_.end()) {
+  auto it = shard.objects.find(oid);
+  if (it == shard.objects.end()) {
     return -ENOENT;
   }
 
-  LogObject *lobj = &boost::get<LogObject>(it->second);
+  GetMaxPos(boost::get<LogObject>(it->second), pos, empty);
+
+  return 0;
+}
+
+int RAMBackend::SealAndMaxPos(const std::string& oid, uint64_t epoch,
+    uint64_t *pos, bool *empty)
+{
+  if (oid.empty()) {
+    return -EINVAL;
+  }
+
+  if (epoch == 0) {
+    return -EINVAL;
+  }
+
+  auto& shard = shard_for(oid);
+  std::lock_guard<std::mutex> lk(shard.lock);
 
-  if (lobj) {
-    bool is_empty = lobj->entries.empty();
-    if (!is_empty) {
+  auto ret = shard.objects.emplace(oid, LogObject());
+  auto& obj = boost::get<LogObject>(ret.first->second);
+
+  // a stale epoch leaves the object sealed at the stored epoch
+  if (ret.second || epoch > obj.epoch) {
+    obj.epoch = epoch;
+  }
+
+  GetMaxPos(obj, pos, empty);
+
+  return 0;
+}
+
+void RAMBackend::GetMaxPos(const LogObject& lobj, uint64_t *pos, bool *empty)
+{
+  bool is_empty = lobj.entries.empty();
+  if (!is_empty) {
+    *empty = false;
+    *pos = lobj.maxpos;
+    if (lobj.trim_limit)
+      *pos = std::max(*pos, *lobj.trim_limit);
+  } else {
+    if (lobj.trim_limit) {
       *empty = false;
-      *pos = lobj->maxpos;
-      if (lobj->trim_limit)
-        *pos = std::max(*pos, *lobj->trim_limit);
+      *pos = *lobj.trim_limit;
     } else {
-      if (lobj->trim_limit) {
-        *empty = false;
-        *pos = *lobj->trim_limit;
-      } else {
-        *empty = true;
-      }
+      *empty = true;
     }
-  } else {
-    *empty = true;
   }
+}
+
+int RAMBackend::StoreEntry(LogObject *lobj, const std::string& data,
+    uint32_t crc, LogEntry *entry)
+{
+  entry->exists = true;
+  if (blackhole_ || data.empty()) {
+    return 0;
+  }
+
+  auto& arena = lobj->arena;
+  if (data.size() > arena.avail) {
+    const size_t min_chunk_size = 4096;
+    const size_t max_chunk_size = 1 << 20;
+    size_t chunk_size = arena.allocated ?
+      std::min(arena.allocated, max_chunk_size) : min_chunk_size;
+    chunk_size = std::max(chunk_size, data.size());
+
+    // near the limit, fall back to a chunk that only fits this entry
+    size_t allocated = bytes_allocated_.fetch_add(chunk_size) + chunk_size;
+    if (max_bytes_ && allocated > max_bytes_ && chunk_size > data.size()) {
+      bytes_allocated_ -= chunk_size - data.size();
+      allocated -= chunk_size - data.size();
+      chunk_size = data.size();
+    }
+    if (max_bytes_ && allocated > max_bytes_) {
+      bytes_allocated_ -= chunk_size;
+      return -ENOSPC;
+    }
+
+    assert(arena.chunks.size() < std::numeric_limits<uint32_t>::max());
+    arena.chunks.emplace_back(new char[chunk_size],
+        std::default_delete<char[]>());
+    arena.next = arena.chunks.back().get();
+    arena.avail = chunk_size;
+    arena.allocated += chunk_size;
+  }
+
+  entry->chunk = arena.chunks.size() - 1;
+  entry->crc = crc;
+  entry->data = arena.next;
+  entry->size = data.size();
+  memcpy(arena.next, data.data(), data.size());
+  arena.next += data.size();
+  arena.avail -= data.size();
+  arena.used += data.size();
+  bytes_used_ += data.size();
 
   return 0;
 }
 
+bool RAMBackend::VerifyEntry(const LogEntry& entry)
+{
+  return crc32c::Value(entry.data, entry.size) == entry.crc;
+}
+
+void RAMBackend::ReleaseEntry(LogObject *lobj, LogEntry *entry)
+{
+  if (entry->data) {
+    lobj->arena.used -= entry->size;
+    bytes_used_ -= entry->size;
+    entry->data = nullptr;
+    entry->size = 0;
+  }
+}
+
+void RAMBackend::ReleaseArena(LogObject *lobj)
+{
+  auto& arena = lobj->arena;
+  bytes_allocated_ -= arena.allocated;
+  bytes_used_ -= arena.used;
+  arena = Arena();
+}
+
+static uint64_t gcd(uint64_t a, uint64_t b)
+{
+  while (b) {
+    const uint64_t t = a % b;
+    a = b;
+    b = t;
+  }
+  return a;
+}
+
+bool RAMBackend::EntryTable::dense_index(uint64_t position,
+    uint64_t *index) const
+{
+  if (stride_ == 0 || position < base_ ||
+      (position - base_) % stride_ != 0) {
+    return false;
+  }
+  *index = (position - base_) / stride_;
+  return true;
+}
+
+RAMBackend::LogEntry *RAMBackend::EntryTable::find(uint64_t position)
+{
+  uint64_t index;
+  if (dense_index(position, &index) && index < dense_.size() &&
+      dense_[index].exists) {
+    return &dense_[index];
+  }
+
+  if (sparse_.empty()) {
+    return nullptr;
+  }
+
+  auto it = sparse_.find(position);
+  if (it == sparse_.end()) {
+    return nullptr;
+  }
+
+  return &it->second;
+}
+
+RAMBackend::LogEntry& RAMBackend::EntryTable::insert(uint64_t position)
+{
+  count_++;
+
+  // the vector grows by at most its own size at a time, so a single far away
+  // position doesn't allocate a large mostly empty vector.
+  uint64_t index;
+  if (dense_index(position, &index) &&
+      index < dense_.size() + std::max(dense_.size(), size_t(1024))) {
+    if (index >= dense_.size()) {
+      dense_.resize(index + 1);
+    }
+    auto& entry = dense_[index];
+    entry.exists = true;
+    return entry;
+  }
+
+  sparse_[position].exists = true;
+
+  if (sparse_.size() >= relayout_at_) {
+    relayout();
+  }
+
+  return *find(position);
+}
+
+void RAMBackend::EntryTable::clear()
+{
+  std::vector<LogEntry>().swap(dense_);
+  sparse_.clear();
+  base_ = 0;
+  stride_ = 0;
+  count_ = 0;
+  relayout_at_ = 2;
+}
+
+// choose the layout that fits every position: the smallest position as the
+// base and the gcd of the distances from it as the stride. if the result
+// would be mostly empty slots, everything stays in the overflow map.
+void RAMBackend::EntryTable::relayout()
+{
+  std::vector<std::pair<uint64_t, LogEntry>> entries;
+  entries.reserve(count_);
+  for (uint64_t index = 0; index < dense_.size(); index++) {
+    if (dense_[index].exists) {
+      entries.emplace_back(base_ + index * stride_,
+          std::move(dense_[index]));
+    }
+  }
+  for (auto& entry : sparse_) {
+    entries.emplace_back(entry.first, std::move(entry.second));
+  }
+  std::vector<LogEntry>().swap(dense_);
+  sparse_.clear();
+
+  uint64_t min = std::numeric_limits<uint64_t>::max();
+  uint64_t max = 0;
+  for (const auto& entry : entries) {
+    min = std::min(min, entry.first);
+    max = std::max(max, entry.first);
+  }
+
+  uint64_t stride = 0;
+  for (const auto& entry : entries) {
+    stride = gcd(stride, entry.first - min);
+  }
+  if (stride == 0) {
+    stride = 1;
+  }
+
+  const uint64_t slots = (max - min) / stride + 1;
+  if (slots > 2 * entries.size() + 16) {
+    stride_ = 0;
+    for (auto& entry : entries) {
+      sparse_.emplace(entry.first, std::move(entry.second));
+    }
+    relayout_at_ = 2 * sparse_.size();
+    return;
+  }
+
+  base_ = min;
+  stride_ = stride;
+  dense_.resize(slots);
+  for (auto& entry : entries) {
+    dense_[(entry.first - base_) / stride_] = std::move(entry.second);
+  }
+  relayout_at_ = std::max(size_t(2), count_ / 2);
+}
+
 int RAMBackend::CheckEpoch(uint64_t epoch, const std::string& oid,
     bool eq, LogObject*& lobj)
 {
-  auto it = objects_.find(oid);
-  if (it == objects_.end()) {
+  auto& objects = shard_for(oid).objects;
+  auto it = objects.find(oid);
+  if (it == objects.end()) {
     return -ENOENT;
   }
 
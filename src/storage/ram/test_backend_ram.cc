@@ -88,6 +88,104 @@ void LibZLogCAPITest::TearDown() {
   }
 }
 
+TEST(RAMBackendTest, Initialize_Options) {
+  zlog::storage::ram::RAMBackend be;
+  ASSERT_EQ(be.Initialize({{"max_bytes", "x"}}), -EINVAL);
+  ASSERT_EQ(be.Initialize({{"max_bytes", "1048576"}}), 0);
+  ASSERT_EQ(be.meta()["max_bytes"], "1048576");
+}
+
+TEST(RAMBackendTest, MaxBytes) {
+  zlog::storage::ram::RAMBackend be;
+  ASSERT_EQ(be.Initialize({{"max_bytes", "65536"}}), 0);
+  ASSERT_EQ(be.Seal("a", 1), 0);
+  ASSERT_EQ(be.Seal("b", 1), 0);
+
+  const std::string data(1000, 'x');
+  uint64_t pos = 0;
+  int ret;
+  while ((ret = be.Write("a", data, 1, pos)) == 0) {
+    pos++;
+  }
+  ASSERT_EQ(ret, -ENOSPC);
+  ASSERT_GT(pos, 32u);
+  ASSERT_EQ(be.Write("b", data, 1, 0), -ENOSPC);
+
+  // the position is still free
+  std::string out;
+  ASSERT_EQ(be.Read("a", 1, pos, &out), -ERANGE);
+
+  auto meta = be.meta();
+  ASSERT_LE(std::stoull(meta["bytes_allocated"]), 65536u);
+  ASSERT_EQ(std::stoull(meta["bytes_used"]), pos * data.size());
+
+  size_t size;
+  ASSERT_EQ(be.Stat("a", &size), 0);
+  ASSERT_EQ(size, std::stoull(meta["bytes_allocated"]));
+
+  // trimming single entries doesn't free their chunks
+  ASSERT_EQ(be.Trim("a", 1, 0, false, false), 0);
+  ASSERT_EQ(be.Write("b", data, 1, 0), -ENOSPC);
+  meta = be.meta();
+  ASSERT_EQ(std::stoull(meta["bytes_used"]), (pos - 1) * data.size());
+
+  // slices keep their chunk alive after a full trim releases the arena
+  zlog::Slice slice;
+  ASSERT_EQ(be.ReadSlice("a", 1, 1, &slice), 0);
+  ASSERT_EQ(be.Trim("a", 1, pos, true, true), 0);
+  ASSERT_EQ(slice.ToString(), data);
+
+  meta = be.meta();
+  ASSERT_EQ(meta["bytes_allocated"], "0");
+  ASSERT_EQ(meta["bytes_used"], "0");
+  ASSERT_EQ(be.Stat("a", &size), 0);
+  ASSERT_EQ(size, 0u);
+
+  ASSERT_EQ(be.Write("b", data, 1, 0), 0);
+}
+
+// entries are immutable, so corrupting one in place stands in for a memory
+// error
+TEST(RAMBackendTest, Checksums) {
+  zlog::storage::ram::RAMBackend be;
+  ASSERT_EQ(be.Seal("a", 1), 0);
+  ASSERT_EQ(be.Write("a", "abc", 1, 0), 0);
+  ASSERT_EQ(be.Write("a", "def", 1, 1), 0);
+  ASSERT_EQ(be.Write("a", "", 1, 2), 0);
+  ASSERT_EQ(be.Fill("a", 1, 3), 0);
+
+  std::set<uint64_t> corrupt;
+  ASSERT_EQ(be.Scrub("a", &corrupt), 0);
+  ASSERT_TRUE(corrupt.empty());
+
+  zlog::Slice slice;
+  ASSERT_EQ(be.ReadSlice("a", 1, 1, &slice), 0);
+  const_cast<char*>(slice.data())[1] = 'x';
+
+  std::string data;
+  ASSERT_EQ(be.Read("a", 1, 0, &data), 0);
+  ASSERT_EQ(data, "abc");
+  ASSERT_EQ(be.Read("a", 1, 1, &data), -EIO);
+  ASSERT_EQ(be.ReadSlice("a", 1, 1, &slice), -EIO);
+  ASSERT_EQ(be.ReadRange("a", 1, 0, 3, 1, nullptr, nullptr), -EIO);
+
+  ASSERT_EQ(be.Scrub("a", &corrupt), 0);
+  ASSERT_EQ(corrupt, std::set<uint64_t>({1}));
+
+  // verification can be skipped on reads, but not when scrubbing
+  ASSERT_EQ(be.Initialize({{"verify_checksums", "false"}}), 0);
+  ASSERT_EQ(be.meta()["verify_checksums"], "false");
+  ASSERT_EQ(be.Read("a", 1, 1, &data), 0);
+  ASSERT_EQ(data, "dxf");
+  ASSERT_EQ(be.Scrub("a", &corrupt), 0);
+  ASSERT_EQ(corrupt, std::set<uint64_t>({1}));
+
+  // trimmed entries aren't checked
+  ASSERT_EQ(be.Trim("a", 1, 1, false, false), 0);
+  ASSERT_EQ(be.Scrub("a", &corrupt), 0);
+  ASSERT_TRUE(corrupt.empty());
+}
+
 INSTANTIATE_TEST_CASE_P(Level, ZLogTest,
     ::testing::Values(
       std::make_tuple(true, true),
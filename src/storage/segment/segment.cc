@@ -0,0 +1,1745 @@
+#include <algorithm>
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <dirent.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <linux/falloc.h>
+#include <boost/algorithm/string.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/uuid/uuid.hpp>
+#include <boost/uuid/uuid_generators.hpp>
+#include <boost/uuid/uuid_io.hpp>
+#include "zlog/backend.h"
+#include "zlog/backend/segment.h"
+#include "storage/io_engine.h"
+#include "util/crc32c.h"
+
+namespace zlog {
+namespace storage {
+namespace segment {
+
+static uint64_t AlignUp(uint64_t n, uint64_t align)
+{
+  return (n + align - 1) / align * align;
+}
+
+// records are padded so that the next one starts at an 8 byte boundary
+static const size_t record_header_size = 24;
+
+static uint64_t RecordSize(uint32_t payload_size)
+{
+  return AlignUp(record_header_size + payload_size, sizeof(uint64_t));
+}
+
+static const char zeros[4096] = {};
+
+template<typename T>
+static int ParseOption(const std::map<std::string, std::string>& opts,
+    const std::string& name, T *value,
+    std::map<std::string, std::string>& options)
+{
+  auto it = opts.find(name);
+  if (it == opts.end()) {
+    return 0;
+  }
+
+  try {
+    *value = boost::lexical_cast<T>(it->second);
+  } catch (boost::bad_lexical_cast& e) {
+    std::cerr << "could not convert to integer: " << it->second << std::endl;
+    return -EINVAL;
+  }
+
+  options[name] = it->second;
+
+  return 0;
+}
+
+// the write of a batch owns the iovecs, or the aligned buffer for direct io
+struct SegmentBackend::Batch {
+  ~Batch() {
+    free(buf);
+  }
+
+  std::shared_ptr<Segment> seg;
+  std::vector<PendingRecord*> records;
+  uint64_t start;
+  uint64_t end;
+  std::vector<struct iovec> iov;
+  void *buf = nullptr;
+};
+
+SegmentBackend::SegmentBackend() :
+  sync_mode(SYNC_COMMIT),
+  direct_io(false),
+  verify_checksums(true),
+  io_engine_name("auto"),
+  io_depth(256),
+  io_threads(4),
+  max_open_segments(512),
+  dirfd(-1)
+{
+  options["scheme"] = "segment";
+}
+
+SegmentBackend::~SegmentBackend()
+{
+  Close();
+}
+
+std::map<std::string, std::string> SegmentBackend::meta()
+{
+  return options;
+}
+
+int SegmentBackend::Initialize(
+    const std::map<std::string, std::string>& opts)
+{
+  auto it = opts.find("path");
+  if (it == opts.end())
+    return -EINVAL;
+  const auto path = it->second;
+
+  it = opts.find("sync");
+  if (it != opts.end()) {
+    if (it->second == "none") {
+      sync_mode = SYNC_NONE;
+    } else if (it->second == "commit") {
+      sync_mode = SYNC_COMMIT;
+    } else {
+      std::cerr << "invalid sync mode: " << it->second << std::endl;
+      return -EINVAL;
+    }
+    options[it->first] = it->second;
+  }
+
+  it = opts.find("direct_io");
+  if (it != opts.end()) {
+    direct_io = boost::iequals(it->second, "yes") ||
+      boost::iequals(it->second, "true");
+    options[it->first] = it->second;
+  }
+
+  it = opts.find("verify_checksums");
+  if (it != opts.end()) {
+    verify_checksums = boost::iequals(it->second, "yes") ||
+      boost::iequals(it->second, "true");
+    options[it->first] = it->second;
+  }
+
+  it = opts.find("io_engine");
+  if (it != opts.end()) {
+    io_engine_name = it->second;
+  }
+
+  int ret = ParseOption(opts, "io_depth", &io_depth, options);
+  if (ret) {
+    return ret;
+  }
+
+  ret = ParseOption(opts, "io_threads", &io_threads, options);
+  if (ret) {
+    return ret;
+  }
+
+  ret = ParseOption(opts, "max_open_segments", &max_open_segments, options);
+  if (ret) {
+    return ret;
+  }
+  if (max_open_segments == 0) {
+    std::cerr << "invalid max open segments: 0" << std::endl;
+    return -EINVAL;
+  }
+
+  return Init(path);
+}
+
+int SegmentBackend::Init(const std::string& path)
+{
+  options["path"] = path;
+  this->path = path;
+
+  if (mkdir(path.c_str(), 0755) && errno != EEXIST) {
+    return -errno;
+  }
+
+  dirfd = open(path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (dirfd < 0) {
+    return -errno;
+  }
+
+  int ret = IOEngine::Create(io_engine_name, io_depth, io_threads, engine);
+  if (ret) {
+    std::cerr << "invalid io engine: " << io_engine_name << std::endl;
+    return ret;
+  }
+  options["io_engine"] = engine->name();
+
+  return 0;
+}
+
+void SegmentBackend::Close()
+{
+  // completing an append may start the next one, so appends are waited for
+  // before the engine is destroyed, which waits for reads in flight.
+  for (auto& it : segments) {
+    auto seg = it.second.get();
+    std::unique_lock<std::mutex> lk(seg->lock);
+    WaitIdle(seg, lk);
+  }
+  engine.reset();
+
+  segments.clear();
+  lru.clear();
+
+  if (dirfd >= 0) {
+    close(dirfd);
+    dirfd = -1;
+  }
+}
+
+SegmentBackend::Segment::~Segment()
+{
+  if (map) {
+    munmap(map, map_size);
+  }
+  if (fd >= 0) {
+    close(fd);
+  }
+}
+
+// object names are used as file names. characters other than letters,
+// digits, '_', '-' and '.' are escaped as %XX, as is a leading '.'.
+std::string SegmentBackend::FileName(const std::string& oid) const
+{
+  static const char hex[] = "0123456789abcdef";
+  std::string name;
+  name.reserve(oid.size());
+  for (size_t i = 0; i < oid.size(); i++) {
+    const unsigned char c = oid[i];
+    if (isalnum(c) || c == '_' || c == '-' || (c == '.' && i > 0)) {
+      name.push_back(c);
+    } else {
+      name.push_back('%');
+      name.push_back(hex[c >> 4]);
+      name.push_back(hex[c & 0xf]);
+    }
+  }
+  return name;
+}
+
+bool SegmentBackend::ParseFileName(const std::string& name, std::string *oid)
+{
+  std::string out;
+  for (size_t i = 0; i < name.size(); i++) {
+    if (name[i] != '%') {
+      out.push_back(name[i]);
+      continue;
+    }
+    if (i + 2 >= name.size()) {
+      return false;
+    }
+    char buf[3] = {name[i + 1], name[i + 2], 0};
+    char *end;
+    const long c = strtol(buf, &end, 16);
+    if (*end) {
+      return false;
+    }
+    out.push_back(static_cast<char>(c));
+    i += 2;
+  }
+  oid->swap(out);
+  return true;
+}
+
+std::shared_ptr<SegmentBackend::Segment> SegmentBackend::GetSegment(
+    const std::string& oid)
+{
+  std::lock_guard<std::mutex> lk(lock);
+
+  auto it = segments.find(oid);
+  if (it != segments.end()) {
+    lru.splice(lru.begin(), lru, it->second->lru);
+    return it->second;
+  }
+
+  auto seg = std::make_shared<Segment>();
+  lru.push_front(oid);
+  seg->lru = lru.begin();
+  segments.emplace(oid, seg);
+
+  return seg;
+}
+
+void SegmentBackend::ReleaseSegment(Segment *seg)
+{
+  std::lock_guard<std::mutex> lk(lock);
+  lru.splice(lru.end(), lru, seg->lru);
+}
+
+int SegmentBackend::Load(Segment *seg, const std::string& oid, bool create)
+{
+  if (seg->loaded) {
+    return seg->error;
+  }
+
+  int ret = Scan(seg, oid, create);
+
+  std::lock_guard<std::mutex> lk(lock);
+
+  if (ret) {
+    // lookups of objects that don't exist don't leave an entry behind. the
+    // object is kept if another operation is waiting to load it.
+    auto it = segments.find(oid);
+    if (it != segments.end() && it->second.get() == seg &&
+        it->second.use_count() == 2) {
+      lru.erase(seg->lru);
+      segments.erase(it);
+    }
+    return ret;
+  }
+
+  // close the least recently used objects that are idle. an object that
+  // only the map references has no operation or i/o in flight, and no new
+  // reference can be taken while the lock is held.
+  for (auto pos = lru.end(); segments.size() > max_open_segments &&
+      pos != lru.begin();) {
+    auto victim = segments.find(*--pos);
+    assert(victim != segments.end());
+    if (victim->second.use_count() > 1) {
+      continue;
+    }
+    pos = lru.erase(pos);
+    segments.erase(victim);
+  }
+
+  return 0;
+}
+
+int SegmentBackend::Scan(Segment *seg, const std::string& oid, bool create)
+{
+  static_assert(sizeof(RecordHeader) == record_header_size,
+      "unexpected record header size");
+
+  const auto name = FileName(oid);
+  if (name.size() > NAME_MAX) {
+    return -ENAMETOOLONG;
+  }
+
+  int flags = O_RDWR | O_CLOEXEC;
+  if (direct_io) {
+    flags |= O_DIRECT;
+  }
+
+  int fd = openat(dirfd, name.c_str(), flags);
+  if (fd < 0 && errno == ENOENT && create) {
+    fd = openat(dirfd, name.c_str(), flags | O_CREAT, 0644);
+    if (fd >= 0 && sync_mode == SYNC_COMMIT && fsync(dirfd)) {
+      int ret = -errno;
+      close(fd);
+      return ret;
+    }
+  }
+  if (fd < 0) {
+    return -errno;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st)) {
+    int ret = -errno;
+    close(fd);
+    return ret;
+  }
+  const uint64_t size = st.st_size;
+
+  // replay the records up to the first one that is incomplete or fails its
+  // checksum. a torn append leaves a bad record at the end of the file,
+  // where it is truncated. a bad record that is followed by intact records
+  // was damaged after it was written. the checksum covers the header, so
+  // even the position of a damaged entry can't be trusted, and the state of
+  // the object is unknown.
+  uint64_t end = 0;
+  if (size > 0) {
+    void *base = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    if (base == MAP_FAILED) {
+      int ret = -errno;
+      close(fd);
+      return ret;
+    }
+    const char *data = static_cast<const char*>(base);
+
+    uint64_t offset = 0;
+    while (offset + sizeof(RecordHeader) <= size) {
+      RecordHeader header;
+      memcpy(&header, data + offset, sizeof(header));
+
+      if (memcmp(&header, zeros, sizeof(header)) == 0) {
+        offset = AlignUp(offset + 1, block_size);
+        continue;
+      }
+
+      const bool sane = header.magic == record_magic &&
+        header.size <= size - offset - sizeof(header);
+      if (!sane || !VerifyRecord(data + offset, header.size, true)) {
+        if (!FollowedByRecord(data, size, offset)) {
+          break;
+        }
+        std::cerr << "corrupt record in " << name << " at offset "
+          << offset << std::endl;
+        munmap(base, size);
+        close(fd);
+        return -EIO;
+      }
+
+      Apply(seg, header, data + offset + sizeof(header),
+          offset + sizeof(header));
+
+      offset += RecordSize(header.size);
+      end = offset;
+    }
+
+    munmap(base, size);
+  }
+
+  if (end < size && ftruncate(fd, end)) {
+    int ret = -errno;
+    close(fd);
+    return ret;
+  }
+
+  seg->fd = fd;
+  seg->tail = direct_io ? AlignUp(end, block_size) : end;
+  seg->loaded = true;
+
+  return 0;
+}
+
+void SegmentBackend::Apply(Segment *seg, const RecordHeader& header,
+    const char *payload, uint64_t offset)
+{
+  switch (header.type) {
+    case RECORD_ENTRY:
+    case RECORD_FILL:
+    case RECORD_TRIM:
+      {
+        seg->kind = OBJECT_LOG;
+        seg->maxpos = std::max(seg->maxpos, header.arg);
+        auto ret = seg->index.emplace(header.arg, IndexEntry());
+        auto& entry = ret.first->second;
+        if (ret.second) {
+          entry.offset = offset;
+          entry.size = header.size;
+          entry.trimmed = header.type != RECORD_ENTRY;
+          entry.invalidated = header.type != RECORD_ENTRY;
+          entry.pending = false;
+          if (header.type == RECORD_ENTRY) {
+            seg->data_bytes += header.size;
+          }
+        } else if (header.type == RECORD_TRIM) {
+          if (!entry.trimmed && !entry.invalidated) {
+            seg->data_bytes -= entry.size;
+          }
+          entry.trimmed = true;
+        }
+      }
+      break;
+
+    case RECORD_TRIM_LIMIT:
+    case RECORD_TRIM_FULL:
+      seg->kind = OBJECT_LOG;
+      if (seg->trim_limit) {
+        seg->trim_limit = std::max(*seg->trim_limit, header.arg);
+      } else {
+        seg->trim_limit = header.arg;
+      }
+      if (header.type == RECORD_TRIM_FULL) {
+        seg->index.clear();
+        seg->data_bytes = 0;
+        seg->maxpos = 0;
+      }
+      break;
+
+    case RECORD_SEAL:
+      seg->kind = OBJECT_LOG;
+      seg->epoch = std::max(seg->epoch, header.arg);
+      break;
+
+    case RECORD_LINK:
+      seg->kind = OBJECT_LINK;
+      seg->hoid.assign(payload, header.size);
+      break;
+
+    case RECORD_HEAD:
+      seg->kind = OBJECT_HEAD;
+      seg->prefix.assign(payload, header.size);
+      break;
+
+    case RECORD_VIEW:
+      seg->views[header.arg].assign(payload, header.size);
+      seg->view_epoch = std::max(seg->view_epoch, header.arg);
+      break;
+
+    case RECORD_UNIQUE_ID:
+      seg->unique_id = std::max(seg->unique_id, header.arg);
+      break;
+
+    default:
+      break;
+  }
+}
+
+SegmentBackend::PendingRecord SegmentBackend::MakeRecord(RecordType type,
+    uint64_t arg, const std::string *payload)
+{
+  PendingRecord record;
+  memset(&record.header, 0, sizeof(record.header));
+  record.header.magic = record_magic;
+  record.header.size = payload ? payload->size() : 0;
+  record.header.type = type;
+  record.header.arg = arg;
+  record.header.crc = crc32c::Extend(
+      crc32c::Value((const char *)&record.header, sizeof(record.header)),
+      payload ? payload->data() : nullptr, record.header.size);
+  record.data = payload ? payload->data() : nullptr;
+  record.align = false;
+  record.reserved = false;
+  record.offset = 0;
+  record.result = 0;
+  record.done = false;
+  return record;
+}
+
+int SegmentBackend::Commit(Segment *seg, std::unique_lock<std::mutex>& lk,
+    std::vector<PendingRecord>& records)
+{
+  assert(!records.empty());
+  for (auto& record : records) {
+    seg->queue.push_back(&record);
+  }
+
+  StartCommit(seg, lk);
+
+  auto& last = records.back();
+  seg->cond.wait(lk, [&last] { return last.done; });
+
+  return last.result;
+}
+
+// one write is in flight per object. records queued while it is in flight
+// are appended together by the next write, which is started when the
+// previous one completes.
+void SegmentBackend::StartCommit(Segment *seg,
+    std::unique_lock<std::mutex>& lk)
+{
+  if (seg->committing || seg->queue.empty()) {
+    return;
+  }
+
+  seg->committing = true;
+
+  auto batch = new Batch;
+  batch->seg = seg->shared_from_this();
+  batch->records.assign(seg->queue.begin(), seg->queue.end());
+  seg->queue.clear();
+
+  uint64_t offset = seg->tail;
+  batch->start = offset;
+  for (auto record : batch->records) {
+    if (record->align) {
+      offset = AlignUp(offset, block_size);
+    }
+    record->offset = offset;
+    offset += RecordSize(record->header.size);
+  }
+  if (direct_io) {
+    offset = AlignUp(offset, block_size);
+  }
+  batch->end = offset;
+  seg->tail = offset;
+
+  // records following a failed write would be lost when the file is scanned
+  const int error = seg->error;
+  const int fd = seg->fd;
+
+  lk.unlock();
+
+  if (error) {
+    FinishCommit(batch, error);
+    lk.lock();
+    return;
+  }
+
+  if (direct_io) {
+    // o_direct needs block aligned buffers, offsets and sizes. the batch
+    // starts at a block boundary and is padded to the next one.
+    const size_t size = batch->end - batch->start;
+    if (posix_memalign(&batch->buf, block_size, size)) {
+      batch->buf = nullptr;
+      FinishCommit(batch, -ENOMEM);
+      lk.lock();
+      return;
+    }
+    memset(batch->buf, 0, size);
+    for (auto record : batch->records) {
+      char *dst = static_cast<char*>(batch->buf) +
+        (record->offset - batch->start);
+      memcpy(dst, &record->header, sizeof(record->header));
+      if (record->header.size) {
+        memcpy(dst + sizeof(record->header), record->data,
+            record->header.size);
+      }
+    }
+    batch->iov.push_back({batch->buf, size});
+  } else {
+    auto& iov = batch->iov;
+    iov.reserve(batch->records.size() * 3);
+    offset = batch->start;
+    for (auto record : batch->records) {
+      if (record->offset > offset) {
+        iov.push_back({(void*)zeros, record->offset - offset});
+      }
+      iov.push_back({(void*)&record->header, sizeof(record->header)});
+      if (record->header.size) {
+        iov.push_back({(void*)record->data, record->header.size});
+      }
+      const uint64_t size = RecordSize(record->header.size);
+      const uint64_t pad = size - sizeof(record->header) - record->header.size;
+      if (pad) {
+        iov.push_back({(void*)zeros, pad});
+      }
+      offset = record->offset + size;
+    }
+    assert(offset == batch->end);
+  }
+
+  engine->Write(fd, batch->iov.data(), batch->iov.size(), batch->start,
+      sync_mode == SYNC_COMMIT, [this, batch](ssize_t ret) {
+    FinishCommit(batch, ret < 0 ? ret : 0);
+  });
+
+  lk.lock();
+}
+
+void SegmentBackend::FinishCommit(Batch *batch, int ret)
+{
+  auto seg = batch->seg.get();
+  std::vector<PendingRecord*> completed;
+
+  std::unique_lock<std::mutex> lk(seg->lock);
+
+  if (ret) {
+    seg->error = ret;
+  }
+
+  for (auto record : batch->records) {
+    if (!ret && record->reserved) {
+      auto it = seg->index.find(record->header.arg);
+      assert(it != seg->index.end());
+      it->second.pending = false;
+      it->second.offset = record->offset + sizeof(RecordHeader);
+    }
+    record->result = ret;
+    record->done = true;
+    if (record->cb) {
+      completed.push_back(record);
+    }
+  }
+
+  seg->committing = false;
+  seg->cond.notify_all();
+
+  StartCommit(seg, lk);
+
+  lk.unlock();
+
+  delete batch;
+
+  for (auto record : completed) {
+    record->cb(record->result);
+    delete record;
+  }
+}
+
+void SegmentBackend::WaitIdle(Segment *seg, std::unique_lock<std::mutex>& lk)
+{
+  seg->cond.wait(lk, [seg] {
+    return !seg->committing && seg->queue.empty();
+  });
+}
+
+int SegmentBackend::MapRecord(Segment *seg, const IndexEntry& entry,
+    const char **record)
+{
+  const uint64_t start = entry.offset - sizeof(RecordHeader);
+  const uint64_t end = entry.offset + entry.size;
+  if (end > seg->map_size) {
+    if (seg->map) {
+      munmap(seg->map, seg->map_size);
+      seg->map = nullptr;
+      seg->map_size = 0;
+    }
+    // map past the end of the file so that the mapping covers appends for a
+    // while. only the written part of the mapping is ever read.
+    const size_t page_size = sysconf(_SC_PAGESIZE);
+    const size_t size = AlignUp(std::max({end, 2 * seg->tail,
+          uint64_t(1) << 20}), page_size);
+    void *map = mmap(nullptr, size, PROT_READ, MAP_SHARED, seg->fd, 0);
+    if (map == MAP_FAILED) {
+      return -errno;
+    }
+    seg->map = static_cast<char*>(map);
+    seg->map_size = size;
+  }
+
+  *record = seg->map + start;
+
+  return 0;
+}
+
+int SegmentBackend::ReadPayload(Segment *seg, const IndexEntry& entry,
+    std::string *data)
+{
+  const char *record;
+  int ret = MapRecord(seg, entry, &record);
+  if (ret) {
+    return ret;
+  }
+
+  if (!VerifyRecord(record, entry.size, verify_checksums)) {
+    return -EIO;
+  }
+
+  if (data) {
+    data->assign(record + sizeof(RecordHeader), entry.size);
+  }
+
+  return 0;
+}
+
+bool SegmentBackend::VerifyRecord(const char *record, uint32_t size,
+    bool checksum)
+{
+  RecordHeader header;
+  memcpy(&header, record, sizeof(header));
+  if (header.magic != record_magic || header.size != size) {
+    return false;
+  }
+  if (!checksum) {
+    return true;
+  }
+  const uint32_t crc = header.crc;
+  header.crc = 0;
+  uint32_t check = crc32c::Value((const char *)&header, sizeof(header));
+  check = crc32c::Extend(check, record + sizeof(header), size);
+  return check == crc;
+}
+
+bool SegmentBackend::FollowedByRecord(const char *data, uint64_t size,
+    uint64_t offset)
+{
+  for (offset += sizeof(uint64_t); offset + sizeof(RecordHeader) <= size;
+      offset += sizeof(uint64_t)) {
+    RecordHeader header;
+    memcpy(&header, data + offset, sizeof(header));
+    if (header.magic == record_magic &&
+        header.size <= size - offset - sizeof(header) &&
+        VerifyRecord(data + offset, header.size, true)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+int SegmentBackend::uniqueId(const std::string& hoid, uint64_t *id)
+{
+  if (hoid.empty()) {
+    return -EINVAL;
+  }
+
+  auto seg = GetSegment(hoid);
+  std::unique_lock<std::mutex> lk(seg->lock);
+
+  int ret = Load(seg.get(), hoid, false);
+  if (ret) {
+    return ret;
+  }
+
+  if (seg->kind != OBJECT_HEAD) {
+    return -ENOENT;
+  }
+
+  const uint64_t unique_id = seg->unique_id;
+  std::vector<PendingRecord> records{
+    MakeRecord(RECORD_UNIQUE_ID, unique_id + 1)};
+  Apply(seg.get(), records[0].header, nullptr, 0);
+
+  ret = Commit(seg.get(), lk, records);
+  if (ret) {
+    return ret;
+  }
+
+  *id = unique_id;
+
+  return 0;
+}
+
+int SegmentBackend::CreateLog(const std::string& name, const std::string& view,
+    std::string *hoid_out, std::string *prefix_out)
+{
+  if (name.empty()) {
+    return -EINVAL;
+  }
+
+  boost::uuids::uuid uuid = boost::uuids::random_generator()();
+  const auto key = boost::uuids::to_string(uuid);
+  auto hoid = std::string("zlog.head.").append(key);
+  auto prefix = std::string("zlog.data.").append(key);
+
+  {
+    auto seg = GetSegment(hoid);
+    std::unique_lock<std::mutex> lk(seg->lock);
+
+    int ret = Load(seg.get(), hoid, true);
+    if (ret) {
+      return ret;
+    }
+
+    // assert that this was a unique hoid. a more robust implementation can
+    // retry generating a unique object name.
+    assert(seg->kind == OBJECT_NONE);
+    if (seg->kind != OBJECT_NONE) {
+      return -EIO;
+    }
+
+    std::vector<PendingRecord> records{
+      MakeRecord(RECORD_HEAD, 0, &prefix),
+      MakeRecord(RECORD_VIEW, 1, &view)};
+    Apply(seg.get(), records[0].header, prefix.data(), 0);
+    Apply(seg.get(), records[1].header, view.data(), 0);
+
+    ret = Commit(seg.get(), lk, records);
+    if (ret) {
+      return ret;
+    }
+  }
+
+  auto prefixed_name = std::string("head.").append(name);
+  {
+    auto seg = GetSegment(prefixed_name);
+    std::unique_lock<std::mutex> lk(seg->lock);
+
+    int ret = Load(seg.get(), prefixed_name, true);
+    if (ret) {
+      return ret;
+    }
+
+    if (seg->kind != OBJECT_NONE) {
+      return -EEXIST;
+    }
+
+    std::vector<PendingRecord> records{MakeRecord(RECORD_LINK, 0, &hoid)};
+    Apply(seg.get(), records[0].header, hoid.data(), 0);
+
+    ret = Commit(seg.get(), lk, records);
+    if (ret) {
+      return ret;
+    }
+  }
+
+  if (hoid_out) {
+    *hoid_out = hoid;
+  }
+
+  if (prefix_out) {
+    *prefix_out = prefix;
+  }
+
+  return 0;
+}
+
+int SegmentBackend::OpenLog(const std::string& name, std::string *hoid_out,
+    std::string *prefix_out)
+{
+  if (name.empty()) {
+    return -EINVAL;
+  }
+
+  std::string hoid;
+  {
+    auto prefixed_name = std::string("head.").append(name);
+    auto seg = GetSegment(prefixed_name);
+    std::unique_lock<std::mutex> lk(seg->lock);
+
+    int ret = Load(seg.get(), prefixed_name, false);
+    if (ret) {
+      return ret;
+    }
+
+    WaitIdle(seg.get(), lk);
+    if (seg->error) {
+      return seg->error;
+    }
+
+    if (seg->kind != OBJECT_LINK) {
+      return -ENOENT;
+    }
+
+    hoid = seg->hoid;
+  }
+
+  std::string prefix;
+  {
+    auto seg = GetSegment(hoid);
+    std::unique_lock<std::mutex> lk(seg->lock);
+
+    int ret = Load(seg.get(), hoid, false);
+    if (ret) {
+      return ret == -ENOENT ? -EIO : ret;
+    }
+
+    WaitIdle(seg.get(), lk);
+    if (seg->error) {
+      return seg->error;
+    }
+
+    if (seg->kind != OBJECT_HEAD) {
+      return -EIO;
+    }
+
+    prefix = seg->prefix;
+  }
+
+  if (hoid_out) {
+    *hoid_out = hoid;
+  }
+
+  if (prefix_out) {
+    *prefix_out = prefix;
+  }
+
+  return 0;
+}
+
+int SegmentBackend::ListLinks(std::vector<std::string> &loids_out)
+{
+  DIR *dir = opendir(path.c_str());
+  if (!dir) {
+    return -errno;
+  }
+
+  auto prefix = std::string("head.");
+  while (auto entry = readdir(dir)) {
+    std::string oid;
+    if (ParseFileName(entry->d_name, &oid) &&
+        oid.compare(0, prefix.size(), prefix) == 0) {
+      loids_out.emplace_back(oid);
+    }
+  }
+
+  closedir(dir);
+
+  return 0;
+}
+
+int SegmentBackend::ListHeads(std::vector<std::string> &ooids_out)
+{
+  DIR *dir = opendir(path.c_str());
+  if (!dir) {
+    return -errno;
+  }
+
+  auto prefix = std::string("zlog.head.");
+  while (auto entry = readdir(dir)) {
+    std::string oid;
+    if (ParseFileName(entry->d_name, &oid) &&
+        oid.compare(0, prefix.size(), prefix) == 0) {
+      auto prefix_stripped = oid.substr(prefix.size());
+      // Filter zlog.head.*.N entries
+      if (prefix_stripped.find('.') != std::string::npos) {
+        continue;
+      }
+      ooids_out.emplace_back(oid);
+    }
+  }
+
+  closedir(dir);
+
+  return 0;
+}
+
+int SegmentBackend::ReadViews(const std::string& hoid, uint64_t epoch,
+    uint32_t max_views, std::map<uint64_t, std::string> *views_out)
+{
+  if (hoid.empty())
+    return -EINVAL;
+
+  auto seg = GetSegment(hoid);
+  std::unique_lock<std::mutex> lk(seg->lock);
+
+  int ret = Load(seg.get(), hoid, false);
+  if (ret) {
+    return ret;
+  }
+
+  // only views that have been written are returned
+  WaitIdle(seg.get(), lk);
+  if (seg->error) {
+    return seg->error;
+  }
+
+  if (seg->kind != OBJECT_HEAD) {
+    return -ENOENT;
+  }
+
+  std::map<uint64_t, std::string> views;
+  if (epoch > seg->view_epoch) {
+    views_out->swap(views);
+    return 0;
+  }
+
+  // epoch = 0 -> get latest view
+  if (epoch == 0) {
+    auto it = seg->views.crbegin();
+    if (it == seg->views.crend()) {
+      views_out->swap(views);
+      return 0;
+    }
+    views.emplace(it->first, it->second);
+    views_out->swap(views);
+    return 0;
+  }
+
+  auto it = seg->views.find(epoch);
+  if (it == seg->views.end()) {
+    return -EIO;
+  }
+
+  uint32_t count = 0;
+  while (count < max_views && it != seg->views.end()) {
+    assert(it->first == epoch);
+    views.emplace(epoch, it->second);
+    it++;
+    epoch++;
+    count++;
+  }
+
+  views_out->swap(views);
+
+  return 0;
+}
+
+int SegmentBackend::ProposeView(const std::string& hoid,
+    uint64_t epoch, const std::string& view)
+{
+  if (hoid.empty()) {
+    return -EINVAL;
+  }
+
+  if (epoch == 0) {
+    return -EINVAL;
+  }
+
+  auto seg = GetSegment(hoid);
+  std::unique_lock<std::mutex> lk(seg->lock);
+
+  int ret = Load(seg.get(), hoid, false);
+  if (ret) {
+    return ret;
+  }
+
+  if (seg->kind != OBJECT_HEAD) {
+    return -ENOENT;
+  }
+
+  const auto required_epoch = seg->view_epoch + 1;
+  if (epoch > required_epoch) {
+    return -EINVAL;
+  }
+  if (epoch != required_epoch) {
+    return -ESPIPE;
+  }
+
+  std::vector<PendingRecord> records{MakeRecord(RECORD_VIEW, epoch, &view)};
+  Apply(seg.get(), records[0].header, view.data(), 0);
+
+  return Commit(seg.get(), lk, records);
+}
+
+int SegmentBackend::CheckEpoch(Segment *seg, uint64_t epoch, bool eq)
+{
+  if (seg->kind != OBJECT_LOG) {
+    return -ENOENT;
+  }
+
+  if (eq) {
+    if (epoch != seg->epoch) {
+      return -ESPIPE;
+    }
+  } else if (epoch < seg->epoch) {
+    return -ESPIPE;
+  }
+
+  return 0;
+}
+
+int SegmentBackend::GetEntry(Segment *seg, uint64_t epoch, uint64_t position,
+    const IndexEntry **entry)
+{
+  int ret = CheckEpoch(seg, epoch);
+  if (ret) {
+    return ret;
+  }
+
+  if (seg->trim_limit && position <= *seg->trim_limit) {
+    return -ENODATA;
+  }
+
+  auto it = seg->index.find(position);
+  if (it == seg->index.end() || it->second.pending) {
+    return -ERANGE;
+  }
+
+  if (it->second.trimmed || it->second.invalidated) {
+    return -ENODATA;
+  }
+
+  *entry = &it->second;
+
+  return 0;
+}
+
+int SegmentBackend::Read(const std::string& oid, uint64_t epoch,
+    uint64_t position, std::string *data)
+{
+  if (oid.empty()) {
+    return -EINVAL;
+  }
+
+  if (epoch == 0) {
+    return -EINVAL;
+  }
+
+  auto seg = GetSegment(oid);
+  std::unique_lock<std::mutex> lk(seg->lock);
+
+  int ret = Load(seg.get(), oid, false);
+  if (ret) {
+    return ret;
+  }
+
+  const IndexEntry *entry;
+  ret = GetEntry(seg.get(), epoch, position, &entry);
+  if (ret) {
+    return ret;
+  }
+
+  return ReadPayload(seg.get(), *entry, data);
+}
+
+int SegmentBackend::ReadAsync(const std::string& oid, uint64_t epoch,
+    uint64_t position, std::string *data_out, std::function<void(int)> cb)
+{
+  if (oid.empty() || !data_out) {
+    return -EINVAL;
+  }
+
+  if (epoch == 0) {
+    return -EINVAL;
+  }
+
+  auto seg = GetSegment(oid);
+  std::unique_lock<std::mutex> lk(seg->lock);
+
+  const IndexEntry *entry;
+  int ret = Load(seg.get(), oid, false);
+  if (!ret) {
+    ret = GetEntry(seg.get(), epoch, position, &entry);
+  }
+
+  if (ret) {
+    lk.unlock();
+    cb(ret);
+    return 0;
+  }
+
+  // the header is read with the payload to verify the checksum. o_direct
+  // reads whole blocks.
+  const uint64_t start = entry->offset - sizeof(RecordHeader);
+  const uint64_t end = entry->offset + entry->size;
+  const uint32_t size = entry->size;
+  const uint64_t read_start = direct_io ?
+    start / block_size * block_size : start;
+  const uint64_t read_end = direct_io ? AlignUp(end, block_size) : end;
+
+  void *buf;
+  if (posix_memalign(&buf, block_size, read_end - read_start)) {
+    lk.unlock();
+    cb(-ENOMEM);
+    return 0;
+  }
+
+  const struct iovec iov = {buf, read_end - read_start};
+  const int fd = seg->fd;
+
+  lk.unlock();
+
+  engine->Read(fd, &iov, 1, read_start, [=](ssize_t bytes) {
+    const char *record = static_cast<char*>(buf) + (start - read_start);
+    int ret = 0;
+    if (bytes < 0) {
+      ret = bytes;
+    } else if (bytes < (ssize_t)(end - read_start) ||
+        !VerifyRecord(record, size, verify_checksums)) {
+      ret = -EIO;
+    } else {
+      data_out->assign(record + sizeof(RecordHeader), size);
+    }
+    free(buf);
+
+    // a full trim may have punched the entry out of the file after it was
+    // looked up
+    if (ret == -EIO) {
+      std::lock_guard<std::mutex> lk(seg->lock);
+      const IndexEntry *entry;
+      int err = GetEntry(seg.get(), epoch, position, &entry);
+      if (err) {
+        ret = err;
+      }
+    }
+
+    cb(ret);
+  });
+
+  return 0;
+}
+
+int SegmentBackend::ReadRange(const std::string& oid, uint64_t epoch,
+    uint64_t min_position, uint64_t max_position, uint32_t stride,
+    std::map<uint64_t, std::string> *entries_out,
+    std::set<uint64_t> *invalid_out)
+{
+  if (oid.empty() || min_position > max_position || stride == 0) {
+    return -EINVAL;
+  }
+
+  if (epoch == 0) {
+    return -EINVAL;
+  }
+
+  auto seg = GetSegment(oid);
+  std::unique_lock<std::mutex> lk(seg->lock);
+
+  int ret = Load(seg.get(), oid, false);
+  if (ret) {
+    return ret;
+  }
+
+  ret = CheckEpoch(seg.get(), epoch);
+  if (ret) {
+    return ret;
+  }
+
+  std::map<uint64_t, std::string> entries;
+  std::set<uint64_t> invalid;
+
+  for (uint64_t position = min_position;; position += stride) {
+    if (seg->trim_limit && position <= *seg->trim_limit) {
+      invalid.insert(position);
+    } else {
+      auto it = seg->index.find(position);
+      if (it != seg->index.end() && !it->second.pending) {
+        const auto& entry = it->second;
+        if (entry.trimmed || entry.invalidated) {
+          invalid.insert(position);
+        } else {
+          std::string data;
+          ret = ReadPayload(seg.get(), entry, &data);
+          if (ret) {
+            return ret;
+          }
+          entries.emplace(position, std::move(data));
+        }
+      }
+    }
+
+    if (max_position - position < stride) {
+      break;
+    }
+  }
+
+  if (entries_out) {
+    entries_out->swap(entries);
+  }
+
+  if (invalid_out) {
+    invalid_out->swap(invalid);
+  }
+
+  return 0;
+}
+
+int SegmentBackend::Write(const std::string& oid, const std::string& data,
+    uint64_t epoch, uint64_t position)
+{
+  if (oid.empty()) {
+    return -EINVAL;
+  }
+
+  if (epoch == 0) {
+    return -EINVAL;
+  }
+
+  if (data.size() > std::numeric_limits<uint32_t>::max()) {
+    return -EINVAL;
+  }
+
+  // the checksum is computed before taking the lock
+  std::vector<PendingRecord> records{
+    MakeRecord(RECORD_ENTRY, position, &data)};
+
+  auto seg = GetSegment(oid);
+  std::unique_lock<std::mutex> lk(seg->lock);
+
+  int ret = Load(seg.get(), oid, false);
+  if (ret) {
+    return ret;
+  }
+
+  ret = PrepareWrite(seg.get(), epoch, records[0]);
+  if (ret) {
+    return ret;
+  }
+
+  return Commit(seg.get(), lk, records);
+}
+
+int SegmentBackend::WriteAsync(const std::string& oid,
+    const std::string& data, uint64_t epoch, uint64_t position,
+    std::function<void(int)> cb)
+{
+  if (oid.empty()) {
+    return -EINVAL;
+  }
+
+  if (epoch == 0) {
+    return -EINVAL;
+  }
+
+  if (data.size() > std::numeric_limits<uint32_t>::max()) {
+    return -EINVAL;
+  }
+
+  std::unique_ptr<PendingRecord> record(new PendingRecord(
+        MakeRecord(RECORD_ENTRY, position, &data)));
+  record->payload = data;
+  record->data = record->payload.data();
+  record->cb = std::move(cb);
+
+  auto seg = GetSegment(oid);
+  std::unique_lock<std::mutex> lk(seg->lock);
+
+  int ret = Load(seg.get(), oid, false);
+  if (!ret) {
+    ret = PrepareWrite(seg.get(), epoch, *record);
+  }
+
+  if (ret) {
+    lk.unlock();
+    record->cb(ret);
+    return 0;
+  }
+
+  // completed by FinishCommit
+  seg->queue.push_back(record.release());
+  StartCommit(seg.get(), lk);
+
+  return 0;
+}
+
+int SegmentBackend::PrepareWrite(Segment *seg, uint64_t epoch,
+    PendingRecord& record)
+{
+  int ret = CheckEpoch(seg, epoch);
+  if (ret) {
+    return ret;
+  }
+
+  const uint64_t position = record.header.arg;
+  if (seg->trim_limit && position <= *seg->trim_limit) {
+    return -EROFS;
+  }
+
+  // a pending entry is either written or the object fails, so it is already
+  // taken
+  if (seg->index.count(position)) {
+    return -EROFS;
+  }
+
+  Apply(seg, record.header, record.data, 0);
+  seg->index[position].pending = true;
+  record.reserved = true;
+
+  return 0;
+}
+
+int SegmentBackend::WriteBatch(const std::string& oid, uint64_t epoch,
+    const std::vector<std::pair<uint64_t, const std::string*>>& entries,
+    std::vector<int> *results)
+{
+  if (oid.empty() || entries.empty() || !results) {
+    return -EINVAL;
+  }
+
+  if (epoch == 0) {
+    return -EINVAL;
+  }
+
+  std::vector<PendingRecord> records;
+  records.reserve(entries.size());
+  for (const auto& entry : entries) {
+    if (entry.second->size() > std::numeric_limits<uint32_t>::max()) {
+      results->assign(entries.size(), -EINVAL);
+      return -EINVAL;
+    }
+    records.push_back(MakeRecord(RECORD_ENTRY, entry.first, entry.second));
+  }
+
+  auto seg = GetSegment(oid);
+  std::unique_lock<std::mutex> lk(seg->lock);
+
+  int ret = Load(seg.get(), oid, false);
+  if (!ret) {
+    ret = CheckEpoch(seg.get(), epoch);
+  }
+  if (ret) {
+    results->assign(entries.size(), ret);
+    return ret;
+  }
+
+  results->assign(entries.size(), 0);
+
+  // the entries that can be written are appended together
+  std::vector<PendingRecord> batch;
+  std::vector<size_t> batch_index;
+  batch.reserve(entries.size());
+  for (size_t i = 0; i < entries.size(); i++) {
+    ret = PrepareWrite(seg.get(), epoch, records[i]);
+    if (ret) {
+      (*results)[i] = ret;
+      continue;
+    }
+
+    batch.push_back(records[i]);
+    batch_index.push_back(i);
+  }
+
+  if (batch.empty()) {
+    return 0;
+  }
+
+  ret = Commit(seg.get(), lk, batch);
+  for (auto i : batch_index) {
+    (*results)[i] = ret;
+  }
+
+  return 0;
+}
+
+int SegmentBackend::Fill(const std::string& oid, uint64_t epoch,
+    uint64_t position)
+{
+  if (oid.empty()) {
+    return -EINVAL;
+  }
+
+  if (epoch == 0) {
+    return -EINVAL;
+  }
+
+  auto seg = GetSegment(oid);
+  std::unique_lock<std::mutex> lk(seg->lock);
+
+  int ret = Load(seg.get(), oid, false);
+  if (ret) {
+    return ret;
+  }
+
+  ret = CheckEpoch(seg.get(), epoch);
+  if (ret) {
+    return ret;
+  }
+
+  if (seg->trim_limit && position <= *seg->trim_limit) {
+    return 0;
+  }
+
+  auto it = seg->index.find(position);
+  if (it != seg->index.end()) {
+    if (it->second.trimmed || it->second.invalidated) {
+      return 0;
+    }
+    return -EROFS;
+  }
+
+  std::vector<PendingRecord> records{MakeRecord(RECORD_FILL, position)};
+  Apply(seg.get(), records[0].header, nullptr, 0);
+  seg->index[position].pending = true;
+  records[0].reserved = true;
+
+  return Commit(seg.get(), lk, records);
+}
+
+int SegmentBackend::Trim(const std::string& oid, uint64_t epoch,
+    const uint64_t position, bool trim_limit, bool trim_full)
+{
+  if (trim_full && !trim_limit) {
+    return -EINVAL;
+  }
+
+  if (oid.empty()) {
+    return -EINVAL;
+  }
+
+  if (epoch == 0) {
+    return -EINVAL;
+  }
+
+  auto seg = GetSegment(oid);
+  std::unique_lock<std::mutex> lk(seg->lock);
+
+  int ret = Load(seg.get(), oid, false);
+  if (ret) {
+    return ret;
+  }
+
+  ret = CheckEpoch(seg.get(), epoch);
+  if (ret) {
+    return ret;
+  }
+
+  /*
+   * as in the other backends, space is only reclaimed when the whole object
+   * is trimmed. the object's metadata is appended again at a block boundary,
+   * after which everything before it is punched out of the file.
+   */
+  if (trim_full) {
+    WaitIdle(seg.get(), lk);
+    if (seg->error) {
+      return seg->error;
+    }
+
+    const uint64_t limit = seg->trim_limit ?
+      std::max(*seg->trim_limit, position) : position;
+
+    std::vector<PendingRecord> records{
+      MakeRecord(RECORD_SEAL, seg->epoch),
+      MakeRecord(RECORD_TRIM_FULL, limit)};
+    records[0].align = true;
+    Apply(seg.get(), records[1].header, nullptr, 0);
+
+    ret = Commit(seg.get(), lk, records);
+    if (ret) {
+      return ret;
+    }
+
+    const uint64_t end = records[0].offset;
+    if (end > 0 && fallocate(seg->fd,
+          FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, 0, end)) {
+      // the file system can't reclaim the space, which is only wasteful
+      if (errno != EOPNOTSUPP) {
+        return -errno;
+      }
+    }
+
+    // nothing is left to read from a fully trimmed object
+    ReleaseSegment(seg.get());
+
+    return 0;
+  }
+
+  if (trim_limit) {
+    if (seg->trim_limit && position <= *seg->trim_limit) {
+      return 0;
+    }
+
+    std::vector<PendingRecord> records{
+      MakeRecord(RECORD_TRIM_LIMIT, position)};
+    Apply(seg.get(), records[0].header, nullptr, 0);
+
+    return Commit(seg.get(), lk, records);
+  }
+
+  if (seg->trim_limit && position <= *seg->trim_limit) {
+    return 0;
+  }
+
+  // removing a single position
+  std::vector<PendingRecord> records{MakeRecord(RECORD_TRIM, position)};
+  const bool exists = seg->index.count(position);
+  Apply(seg.get(), records[0].header, nullptr, 0);
+  if (!exists) {
+    seg->index[position].pending = true;
+    records[0].reserved = true;
+  }
+
+  return Commit(seg.get(), lk, records);
+}
+
+int SegmentBackend::Seal(const std::string& oid, uint64_t epoch)
+{
+  if (oid.empty()) {
+    return -EINVAL;
+  }
+
+  if (epoch == 0) {
+    return -EINVAL;
+  }
+
+  auto seg = GetSegment(oid);
+  std::unique_lock<std::mutex> lk(seg->lock);
+
+  int ret = Load(seg.get(), oid, true);
+  if (ret) {
+    return ret;
+  }
+
+  if (seg->kind == OBJECT_LOG) {
+    // if exists, verify the new epoch is larger
+    if (epoch <= seg->epoch) {
+      return -ESPIPE;
+    }
+  } else if (seg->kind != OBJECT_NONE) {
+    return -EINVAL;
+  }
+
+  std::vector<PendingRecord> records{MakeRecord(RECORD_SEAL, epoch)};
+  Apply(seg.get(), records[0].header, nullptr, 0);
+
+  return Commit(seg.get(), lk, records);
+}
+
+int SegmentBackend::MaxPos(const std::string& oid, uint64_t *pos, bool *empty)
+{
+  if (oid.empty()) {
+    return -EINVAL;
+  }
+
+  auto seg = GetSegment(oid);
+  std::unique_lock<std::mutex> lk(seg->lock);
+
+  int ret = Load(seg.get(), oid, false);
+  if (ret) {
+    return ret;
+  }
+
+  if (seg->kind != OBJECT_LOG) {
+    return -ENOENT;
+  }
+
+  if (!seg->index.empty()) {
+    *empty = false;
+    *pos = seg->maxpos;
+    if (seg->trim_limit)
+      *pos = std::max(*pos, *seg->trim_limit);
+  } else {
+    if (seg->trim_limit) {
+      *empty = false;
+      *pos = *seg->trim_limit;
+    } else {
+      *empty = true;
+    }
+  }
+
+  return 0;
+}
+
+int SegmentBackend::Stat(const std::string& oid, size_t *size)
+{
+  if (oid.empty()) {
+    return -EINVAL;
+  }
+
+  auto seg = GetSegment(oid);
+  std::unique_lock<std::mutex> lk(seg->lock);
+
+  int ret = Load(seg.get(), oid, false);
+  if (ret) {
+    return ret;
+  }
+
+  if (seg->kind != OBJECT_LOG) {
+    return -ENOENT;
+  }
+
+  if (size) {
+    *size = seg->data_bytes;
+  }
+
+  return 0;
+}
+
+int SegmentBackend::Scrub(const std::string& oid,
+    std::set<uint64_t> *corrupt_out)
+{
+  if (oid.empty() || !corrupt_out) {
+    return -EINVAL;
+  }
+
+  auto seg = GetSegment(oid);
+  std::unique_lock<std::mutex> lk(seg->lock);
+
+  int ret = Load(seg.get(), oid, false);
+  if (ret) {
+    return ret;
+  }
+
+  if (seg->kind != OBJECT_LOG) {
+    return -ENOENT;
+  }
+
+  std::set<uint64_t> corrupt;
+  for (const auto& it : seg->index) {
+    const auto& entry = it.second;
+    if (entry.pending || entry.trimmed || entry.invalidated ||
+        (seg->trim_limit && it.first <= *seg->trim_limit)) {
+      continue;
+    }
+    const char *record;
+    ret = MapRecord(seg.get(), entry, &record);
+    if (ret) {
+      return ret;
+    }
+    if (!VerifyRecord(record, entry.size, true)) {
+      corrupt.insert(it.first);
+    }
+  }
+
+  corrupt_out->swap(corrupt);
+
+  return 0;
+}
+
+extern "C" Backend *__backend_allocate(void)
+{
+  auto b = new SegmentBackend();
+  return b;
+}
+
+extern "C" void __backend_release(Backend *p)
+{
+  SegmentBackend *backend = (SegmentBackend*)p;
+  delete backend;
+}
+
+}
+}
+}
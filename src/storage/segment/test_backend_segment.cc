@@ -0,0 +1,660 @@
+#include "storage/test_backend.h"
+#include "libzlog/test_libzlog.h"
+#include "include/zlog/backend/segment.h"
+#include "port/stack_trace.h"
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+#include <limits.h>
+#include <condition_variable>
+#include <fstream>
+#include <mutex>
+
+struct DBPathContext {
+  char *dbpath = nullptr;
+  virtual ~DBPathContext() {
+    if (dbpath) {
+      struct stat st;
+      if (stat(dbpath, &st) == 0) {
+        char cmd[PATH_MAX];
+        sprintf(cmd, "rm -rf %s", dbpath);
+        EXPECT_EQ(system(cmd), 0);
+      }
+      free(dbpath);
+    }
+  }
+};
+
+struct ViewReaderTest::Context : public DBPathContext {
+};
+
+void ViewReaderTest::SetUp() {
+  context = new Context;
+
+  context->dbpath = strdup("/tmp/zlog.db.XXXXXX");
+  ASSERT_NE(mkdtemp(context->dbpath), nullptr);
+  ASSERT_GT(strlen(context->dbpath), (unsigned)0);
+
+  auto be = std::shared_ptr<zlog::storage::segment::SegmentBackend>(
+      new zlog::storage::segment::SegmentBackend());
+  be->Init(context->dbpath);
+  backend = std::move(be);
+}
+
+void ViewReaderTest::TearDown() {
+  if (context)
+    delete context;
+}
+
+struct BackendTest::Context : public DBPathContext {
+};
+
+std::unique_ptr<zlog::Backend> BackendTest::create_minimal_backend()
+{
+  return std::unique_ptr<zlog::storage::segment::SegmentBackend>(
+      new zlog::storage::segment::SegmentBackend());
+}
+
+void BackendTest::SetUp() {
+  context = new Context;
+
+  context->dbpath = strdup("/tmp/zlog.db.XXXXXX");
+  ASSERT_NE(mkdtemp(context->dbpath), nullptr);
+  ASSERT_GT(strlen(context->dbpath), (unsigned)0);
+
+  auto be = std::unique_ptr<zlog::storage::segment::SegmentBackend>(
+      new zlog::storage::segment::SegmentBackend());
+  be->Init(context->dbpath);
+  backend = std::move(be);
+}
+
+void BackendTest::TearDown() {
+  backend.reset();
+  if (context)
+    delete context;
+}
+
+struct ZLogTest::Context : public DBPathContext {
+};
+
+void ZLogTest::DoSetUp() {
+  context = new Context;
+
+  context->dbpath = strdup("/tmp/zlog.db.XXXXXX");
+  ASSERT_NE(mkdtemp(context->dbpath), nullptr);
+  ASSERT_GT(strlen(context->dbpath), (unsigned)0);
+
+  if (lowlevel()) {
+    ASSERT_TRUE(exclusive());
+    auto backend = std::unique_ptr<zlog::storage::segment::SegmentBackend>(
+        new zlog::storage::segment::SegmentBackend());
+    backend->Init(context->dbpath);
+    options.backend = std::move(backend);
+    options.create_if_missing = true;
+    options.error_if_exists = true;
+    int ret = zlog::Log::Open(options, "mylog", &log);
+    ASSERT_EQ(ret, 0);
+  } else {
+    std::string host = "";
+    std::string port = "";
+    if (exclusive()) {
+    } else {
+      assert(0);
+      host = "localhost";
+      port = "5678";
+    }
+    options.backend_name = "segment";
+    options.backend_options = {
+      {"path", context->dbpath}
+    };
+    options.create_if_missing = true;
+    options.error_if_exists= true;
+    //options.seq_host = host;
+    //options.seq_port = port;
+    int ret = zlog::Log::Open(options, "mylog", &log);
+    ASSERT_EQ(ret, 0);
+  }
+}
+
+void ZLogTest::TearDown() {
+  if (log)
+    delete log;
+  if (context)
+    delete context;
+}
+
+int ZLogTest::reopen()
+{
+  // close the current log before creating a new one. otherwise civetweb
+  // complains about a bunch of stuff like ports being reused.
+  if (log)
+    delete log;
+
+  zlog::Log *new_log = nullptr;
+
+  if (lowlevel()) {
+    auto backend = std::unique_ptr<zlog::storage::segment::SegmentBackend>(
+        new zlog::storage::segment::SegmentBackend());
+    backend->Init(context->dbpath);
+    options.backend = std::move(backend);
+    options.create_if_missing = false;
+    options.error_if_exists = false;
+    int ret = zlog::Log::Open(options, "mylog", &new_log);
+    if (ret)
+      return ret;
+  } else {
+    std::string host = "";
+    std::string port = "";
+    if (exclusive()) {
+    } else {
+      assert(0);
+      host = "localhost";
+      port = "5678";
+    }
+    options.backend_name = "segment";
+    options.backend_options = {
+      {"path", context->dbpath}
+    };
+    options.create_if_missing = false;
+    options.error_if_exists = false;
+    //options.seq_host = host;
+    //options.seq_port = port;
+    int ret = zlog::Log::Open(options, "mylog", &new_log);
+    if (ret)
+      return ret;
+  }
+
+  log = new_log;
+  return 0;
+}
+
+std::string ZLogTest::backend()
+{
+  return "segment";
+}
+
+struct LibZLogCAPITest::Context : public DBPathContext {
+};
+
+void LibZLogCAPITest::SetUp() {
+  context = new Context;
+
+  context->dbpath = strdup("/tmp/zlog.db.XXXXXX");
+  ASSERT_NE(mkdtemp(context->dbpath), nullptr);
+  ASSERT_GT(strlen(context->dbpath), (unsigned)0);
+
+  ASSERT_FALSE(lowlevel());
+
+  options = zlog_options_create();
+  zlog_options_set_backend_name(options, "segment");
+  zlog_options_set_backend_option(options, "path", context->dbpath);
+  zlog_options_set_create_if_missing(options, 1);
+  zlog_options_set_error_if_exists(options, 1);
+
+  int ret = zlog_open(options, "log", &log);
+  ASSERT_EQ(ret, 0);
+}
+
+void LibZLogCAPITest::TearDown() {
+  if (log) {
+    zlog_destroy(log);
+  }
+  if (options) {
+    zlog_options_destroy(options);
+  }
+  if (context) {
+    delete context;
+  }
+}
+
+struct SegmentBackendTest : public ::testing::Test {
+  void SetUp() override {
+    context.dbpath = strdup("/tmp/zlog.db.XXXXXX");
+    ASSERT_NE(mkdtemp(context.dbpath), nullptr);
+  }
+
+  std::string file(const std::string& name) {
+    return std::string(context.dbpath).append("/").append(name);
+  }
+
+  // number of segment files the process has open whose names start with
+  // prefix
+  size_t open_files(const std::string& name = "") {
+    const auto prefix = file(name);
+    size_t count = 0;
+    DIR *dir = opendir("/proc/self/fd");
+    EXPECT_NE(dir, nullptr);
+    while (auto entry = readdir(dir)) {
+      char target[PATH_MAX];
+      const auto link = std::string("/proc/self/fd/").append(entry->d_name);
+      const ssize_t len = readlink(link.c_str(), target, sizeof(target));
+      if (len > 0 && std::string(target, len).compare(0, prefix.size(),
+            prefix) == 0) {
+        count++;
+      }
+    }
+    closedir(dir);
+    return count;
+  }
+
+  DBPathContext context;
+};
+
+TEST_F(SegmentBackendTest, Initialize_Options) {
+  const std::string path(context.dbpath);
+  std::vector<std::map<std::string, std::string>> invalid{
+    {},
+    {{"path", path}, {"sync", "sometimes"}},
+    {{"path", path}, {"io_engine", "aio"}},
+    {{"path", path}, {"io_depth", "deep"}},
+    {{"path", path}, {"max_open_segments", "0"}},
+  };
+
+  for (const auto& opts : invalid) {
+    zlog::storage::segment::SegmentBackend be;
+    ASSERT_EQ(be.Initialize(opts), -EINVAL);
+  }
+
+  zlog::storage::segment::SegmentBackend be;
+  ASSERT_EQ(be.Initialize({{"path", path}, {"sync", "none"},
+        {"io_engine", "threads"}}), 0);
+  ASSERT_EQ(be.meta()["sync"], "none");
+  ASSERT_EQ(be.meta()["path"], path);
+  ASSERT_EQ(be.meta()["io_engine"], "threads");
+}
+
+// many asynchronous writes and reads in flight, on each io engine
+TEST_F(SegmentBackendTest, AsyncIO) {
+  for (auto engine : {"io_uring", "threads"}) {
+    zlog::storage::segment::SegmentBackend be;
+    int ret = be.Initialize({{"path", context.dbpath},
+        {"io_engine", engine}, {"io_depth", "8"}, {"io_threads", "2"}});
+    if (ret && std::string(engine) == "io_uring") {
+      std::cout << "io_uring not available: " << ret << std::endl;
+      continue;
+    }
+    ASSERT_EQ(ret, 0);
+
+    const auto oid = std::string("obj.").append(engine);
+    ASSERT_EQ(be.Seal(oid, 1), 0);
+
+    const uint64_t count = 1000;
+    std::mutex lock;
+    std::condition_variable cond;
+    uint64_t completed = 0;
+    std::vector<int> results(count, 1);
+
+    for (uint64_t pos = 0; pos < count; pos++) {
+      ASSERT_EQ(be.WriteAsync(oid, std::to_string(pos), 1, pos,
+            [&, pos](int ret) {
+        std::lock_guard<std::mutex> lk(lock);
+        results[pos] = ret;
+        if (++completed == count) {
+          cond.notify_one();
+        }
+      }), 0);
+    }
+
+    {
+      std::unique_lock<std::mutex> lk(lock);
+      cond.wait(lk, [&] { return completed == count; });
+    }
+    ASSERT_EQ(results, std::vector<int>(count, 0));
+
+    // a batch needing more than IOV_MAX iovecs
+    std::vector<std::string> data;
+    for (uint64_t pos = count; pos < 3 * count; pos++) {
+      data.emplace_back(std::to_string(pos));
+    }
+    std::vector<std::pair<uint64_t, const std::string*>> entries;
+    for (uint64_t pos = count; pos < 3 * count; pos++) {
+      entries.emplace_back(pos, &data[pos - count]);
+    }
+    ASSERT_EQ(be.WriteBatch(oid, 1, entries, &results), 0);
+    ASSERT_EQ(results, std::vector<int>(2 * count, 0));
+
+    completed = 0;
+    std::vector<std::string> out(3 * count);
+    results.assign(3 * count, 1);
+    for (uint64_t pos = 0; pos < 3 * count; pos++) {
+      ASSERT_EQ(be.ReadAsync(oid, 1, pos, &out[pos], [&, pos](int ret) {
+        std::lock_guard<std::mutex> lk(lock);
+        results[pos] = ret;
+        if (++completed == 3 * count) {
+          cond.notify_one();
+        }
+      }), 0);
+    }
+
+    {
+      std::unique_lock<std::mutex> lk(lock);
+      cond.wait(lk, [&] { return completed == 3 * count; });
+    }
+    ASSERT_EQ(results, std::vector<int>(3 * count, 0));
+    for (uint64_t pos = 0; pos < 3 * count; pos++) {
+      ASSERT_EQ(out[pos], std::to_string(pos));
+    }
+  }
+}
+
+// idle objects are closed once more than max_open_segments are open, and
+// are scanned again when they are next used
+TEST_F(SegmentBackendTest, MaxOpenSegments) {
+  zlog::storage::segment::SegmentBackend be;
+  ASSERT_EQ(be.Initialize({{"path", context.dbpath},
+        {"max_open_segments", "4"}}), 0);
+
+  for (int i = 0; i < 32; i++) {
+    const auto oid = std::string("obj.").append(std::to_string(i));
+    ASSERT_EQ(be.Seal(oid, 1), 0);
+    ASSERT_EQ(be.Write(oid, oid, 1, 0), 0);
+    ASSERT_LE(open_files(), 4u);
+  }
+
+  std::string data;
+  for (int i = 0; i < 32; i++) {
+    const auto oid = std::string("obj.").append(std::to_string(i));
+    ASSERT_EQ(be.Read(oid, 1, 0, &data), 0);
+    ASSERT_EQ(data, oid);
+    ASSERT_EQ(be.Write(oid, oid, 1, 1), 0);
+    ASSERT_EQ(be.Write(oid, oid, 1, 0), -EROFS);
+    ASSERT_LE(open_files(), 4u);
+  }
+  ASSERT_EQ(open_files(), 4u);
+
+  // lookups of objects that don't exist don't push the open objects out
+  for (int i = 0; i < 32; i++) {
+    const auto oid = std::string("missing.").append(std::to_string(i));
+    ASSERT_EQ(be.Read(oid, 1, 0, &data), -ENOENT);
+    ASSERT_EQ(be.MaxPos(oid, nullptr, nullptr), -ENOENT);
+  }
+  ASSERT_EQ(open_files(), 4u);
+
+  // a fully trimmed object is the first to be closed
+  ASSERT_EQ(be.Trim("obj.31", 1, 1, true, true), 0);
+  ASSERT_EQ(open_files("obj.28"), 1u);
+  ASSERT_EQ(be.Read("obj.0", 1, 0, &data), 0);
+  ASSERT_EQ(open_files(), 4u);
+  ASSERT_EQ(open_files("obj.28"), 1u);
+  ASSERT_EQ(open_files("obj.31"), 0u);
+  ASSERT_EQ(be.Read("obj.31", 1, 0, &data), -ENODATA);
+}
+
+// object state is rebuilt from the segment files
+TEST_F(SegmentBackendTest, Reopen) {
+  std::string hoid, prefix;
+  {
+    zlog::storage::segment::SegmentBackend be;
+    ASSERT_EQ(be.Init(context.dbpath), 0);
+    ASSERT_EQ(be.CreateLog("log", "view", &hoid, &prefix), 0);
+    ASSERT_EQ(be.ProposeView(hoid, 2, "view2"), 0);
+    ASSERT_EQ(be.Seal("a/b", 3), 0);
+    for (uint64_t pos = 0; pos < 10; pos++) {
+      ASSERT_EQ(be.Write("a/b", std::to_string(pos), 3, pos), 0);
+    }
+    ASSERT_EQ(be.Fill("a/b", 3, 10), 0);
+    ASSERT_EQ(be.Trim("a/b", 3, 5, false, false), 0);
+    ASSERT_EQ(be.Trim("a/b", 3, 2, true, false), 0);
+  }
+
+  zlog::storage::segment::SegmentBackend be;
+  ASSERT_EQ(be.Init(context.dbpath), 0);
+
+  std::string hoid2, prefix2;
+  ASSERT_EQ(be.OpenLog("log", &hoid2, &prefix2), 0);
+  ASSERT_EQ(hoid, hoid2);
+  ASSERT_EQ(prefix, prefix2);
+
+  std::map<uint64_t, std::string> views;
+  ASSERT_EQ(be.ReadViews(hoid, 0, 1, &views), 0);
+  ASSERT_EQ(views.size(), 1u);
+  ASSERT_EQ(views.at(2), "view2");
+
+  ASSERT_EQ(be.Seal("a/b", 3), -ESPIPE);
+  ASSERT_EQ(be.Write("a/b", "x", 2, 20), -ESPIPE);
+
+  std::string data;
+  for (uint64_t pos = 0; pos < 10; pos++) {
+    int ret = be.Read("a/b", 3, pos, &data);
+    if (pos <= 2 || pos == 5) {
+      ASSERT_EQ(ret, -ENODATA);
+    } else {
+      ASSERT_EQ(ret, 0);
+      ASSERT_EQ(data, std::to_string(pos));
+    }
+  }
+  ASSERT_EQ(be.Read("a/b", 3, 10, &data), -ENODATA);
+  ASSERT_EQ(be.Read("a/b", 3, 11, &data), -ERANGE);
+
+  uint64_t pos;
+  bool empty;
+  ASSERT_EQ(be.MaxPos("a/b", &pos, &empty), 0);
+  ASSERT_FALSE(empty);
+  ASSERT_EQ(pos, 10u);
+
+  std::vector<std::string> links;
+  ASSERT_EQ(be.ListLinks(links), 0);
+  ASSERT_EQ(links, std::vector<std::string>{"head.log"});
+}
+
+// a partially written record at the end of a file is discarded
+TEST_F(SegmentBackendTest, TornTail) {
+  {
+    zlog::storage::segment::SegmentBackend be;
+    ASSERT_EQ(be.Init(context.dbpath), 0);
+    ASSERT_EQ(be.Seal("a", 1), 0);
+    ASSERT_EQ(be.Write("a", "data0", 1, 0), 0);
+    ASSERT_EQ(be.Write("a", std::string(100, 'x'), 1, 1), 0);
+  }
+
+  struct stat st;
+  ASSERT_EQ(stat(file("a").c_str(), &st), 0);
+  ASSERT_EQ(truncate(file("a").c_str(), st.st_size - 10), 0);
+
+  {
+    zlog::storage::segment::SegmentBackend be;
+    ASSERT_EQ(be.Init(context.dbpath), 0);
+    std::string data;
+    ASSERT_EQ(be.Read("a", 1, 0, &data), 0);
+    ASSERT_EQ(data, "data0");
+    ASSERT_EQ(be.Read("a", 1, 1, &data), -ERANGE);
+    ASSERT_EQ(be.Write("a", "data1", 1, 1), 0);
+  }
+
+  zlog::storage::segment::SegmentBackend be;
+  ASSERT_EQ(be.Init(context.dbpath), 0);
+  std::string data;
+  ASSERT_EQ(be.Read("a", 1, 1, &data), 0);
+  ASSERT_EQ(data, "data1");
+}
+
+// flips a bit of the byte at @offset in an object's file
+static void FlipBit(const std::string& path, size_t offset)
+{
+  std::fstream fs(path, std::ios::binary | std::ios::in | std::ios::out);
+  fs.seekg(offset);
+  const char c = fs.get();
+  fs.seekp(offset);
+  fs.put(c ^ 2);
+}
+
+// an entry damaged while its object is open fails verification when it is
+// read. a damaged record in the middle of the file fails the scan when the
+// object is opened again.
+TEST_F(SegmentBackendTest, Checksums) {
+  const std::string data = "an entry that is only stored once";
+  {
+    zlog::storage::segment::SegmentBackend be;
+    ASSERT_EQ(be.Init(context.dbpath), 0);
+    ASSERT_EQ(be.Seal("a", 1), 0);
+    ASSERT_EQ(be.Write("a", "data0", 1, 0), 0);
+    ASSERT_EQ(be.Write("a", data, 1, 1), 0);
+    ASSERT_EQ(be.Write("a", "data2", 1, 2), 0);
+  }
+
+  zlog::storage::segment::SegmentBackend be;
+  ASSERT_EQ(be.Init(context.dbpath), 0);
+
+  // verification can be skipped on reads, but not when scrubbing
+  zlog::storage::segment::SegmentBackend noverify_be;
+  ASSERT_EQ(noverify_be.Initialize({{"path", context.dbpath},
+        {"verify_checksums", "false"}}), 0);
+  ASSERT_EQ(noverify_be.meta()["verify_checksums"], "false");
+
+  std::string out;
+  ASSERT_EQ(be.Read("a", 1, 0, &out), 0);
+  ASSERT_EQ(noverify_be.Read("a", 1, 0, &out), 0);
+
+  std::ifstream ifs(file("a"), std::ios::binary);
+  std::string contents((std::istreambuf_iterator<char>(ifs)),
+      std::istreambuf_iterator<char>());
+  ifs.close();
+  const auto offset = contents.find(data);
+  ASSERT_NE(offset, std::string::npos);
+  FlipBit(file("a"), offset + 1);
+
+  ASSERT_EQ(be.Read("a", 1, 1, &out), -EIO);
+  ASSERT_EQ(be.ReadRange("a", 1, 0, 2, 1, nullptr, nullptr), -EIO);
+  ASSERT_EQ(be.Read("a", 1, 2, &out), 0);
+  ASSERT_EQ(out, "data2");
+
+  AsyncCompletion completion;
+  ASSERT_EQ(be.ReadAsync("a", 1, 1, &out, completion.callback()), 0);
+  ASSERT_EQ(completion.wait(), -EIO);
+
+  std::set<uint64_t> corrupt;
+  ASSERT_EQ(be.Scrub("a", &corrupt), 0);
+  ASSERT_EQ(corrupt, std::set<uint64_t>({1}));
+
+  ASSERT_EQ(noverify_be.Read("a", 1, 1, &out), 0);
+  ASSERT_EQ(out.size(), data.size());
+  ASSERT_NE(out, data);
+  corrupt.clear();
+  ASSERT_EQ(noverify_be.Scrub("a", &corrupt), 0);
+  ASSERT_EQ(corrupt, std::set<uint64_t>({1}));
+
+  // appends continue after the damaged record
+  ASSERT_EQ(be.Write("a", "data3", 1, 3), 0);
+
+  zlog::storage::segment::SegmentBackend reopened_be;
+  ASSERT_EQ(reopened_be.Init(context.dbpath), 0);
+  ASSERT_EQ(reopened_be.Read("a", 1, 2, &out), -EIO);
+}
+
+// the checksum of a record covers its header, so an entry whose position was
+// damaged isn't indexed at the wrong position, and the position it was
+// written at doesn't look unwritten
+TEST_F(SegmentBackendTest, Checksums_DamagedPosition) {
+  {
+    zlog::storage::segment::SegmentBackend be;
+    ASSERT_EQ(be.Init(context.dbpath), 0);
+    ASSERT_EQ(be.Seal("a", 1), 0);
+    ASSERT_EQ(be.Write("a", "data0", 1, 0), 0);
+    ASSERT_EQ(be.Write("a", "data1", 1, 1), 0);
+    ASSERT_EQ(be.Write("a", "data2", 1, 2), 0);
+  }
+
+  std::ifstream ifs(file("a"), std::ios::binary);
+  std::string contents((std::istreambuf_iterator<char>(ifs)),
+      std::istreambuf_iterator<char>());
+  ifs.close();
+  const auto offset = contents.find("data1");
+  ASSERT_NE(offset, std::string::npos);
+
+  // the position is the last field of the record header before the payload
+  FlipBit(file("a"), offset - sizeof(uint64_t));
+
+  zlog::storage::segment::SegmentBackend be;
+  ASSERT_EQ(be.Init(context.dbpath), 0);
+
+  std::string out;
+  ASSERT_EQ(be.Read("a", 1, 1, &out), -EIO);
+  ASSERT_EQ(be.Read("a", 1, 3, &out), -EIO);
+  ASSERT_EQ(be.Fill("a", 1, 1), -EIO);
+  ASSERT_EQ(be.Write("a", "data3", 1, 3), -EIO);
+
+  uint64_t pos;
+  bool empty;
+  ASSERT_EQ(be.MaxPos("a", &pos, &empty), -EIO);
+
+  std::set<uint64_t> corrupt;
+  ASSERT_EQ(be.Scrub("a", &corrupt), -EIO);
+}
+
+// a full trim releases the space used by the object's file
+TEST_F(SegmentBackendTest, TrimFull) {
+  {
+    zlog::storage::segment::SegmentBackend be;
+    ASSERT_EQ(be.Init(context.dbpath), 0);
+    ASSERT_EQ(be.Seal("a", 1), 0);
+    const std::string data(4096, 'x');
+    for (uint64_t pos = 0; pos < 100; pos++) {
+      ASSERT_EQ(be.Write("a", data, 1, pos), 0);
+    }
+    ASSERT_EQ(be.Trim("a", 1, 99, true, true), 0);
+    ASSERT_EQ(be.Write("a", "data", 1, 100), 0);
+
+    size_t size;
+    ASSERT_EQ(be.Stat("a", &size), 0);
+    ASSERT_EQ(size, 4u);
+  }
+
+  zlog::storage::segment::SegmentBackend be;
+  ASSERT_EQ(be.Init(context.dbpath), 0);
+
+  std::string data;
+  ASSERT_EQ(be.Read("a", 1, 50, &data), -ENODATA);
+  ASSERT_EQ(be.Read("a", 1, 100, &data), 0);
+  ASSERT_EQ(data, "data");
+  ASSERT_EQ(be.Write("a", "data", 1, 99), -EROFS);
+  ASSERT_EQ(be.Seal("a", 1), -ESPIPE);
+}
+
+TEST_F(SegmentBackendTest, DirectIO) {
+  zlog::storage::segment::SegmentBackend be;
+  ASSERT_EQ(be.Initialize({{"path", context.dbpath},
+        {"direct_io", "true"}}), 0);
+
+  // not all file systems support o_direct
+  int ret = be.Seal("a", 1);
+  if (ret == -EINVAL) {
+    return;
+  }
+  ASSERT_EQ(ret, 0);
+
+  for (uint64_t pos = 0; pos < 10; pos++) {
+    ASSERT_EQ(be.Write("a", std::string(pos * 1000, 'x'), 1, pos), 0);
+  }
+
+  zlog::storage::segment::SegmentBackend be2;
+  ASSERT_EQ(be2.Init(context.dbpath), 0);
+  for (uint64_t pos = 0; pos < 10; pos++) {
+    std::string data;
+    ASSERT_EQ(be2.Read("a", 1, pos, &data), 0);
+    ASSERT_EQ(data, std::string(pos * 1000, 'x'));
+  }
+}
+
+INSTANTIATE_TEST_CASE_P(Level, ZLogTest,
+    ::testing::Values(
+      std::make_tuple(true, true),
+      std::make_tuple(false, true)));
+
+INSTANTIATE_TEST_CASE_P(Level, LibZLogTest,
+    ::testing::Values(
+      std::make_tuple(true, true),
+      std::make_tuple(false, true)));
+
+INSTANTIATE_TEST_CASE_P(LevelCAPI, LibZLogCAPITest,
+    ::testing::Values(
+      std::make_tuple(false, true),
+      std::make_tuple(false, false)));
+
+int main(int argc, char **argv)
+{
+  rocksdb::port::InstallStackTraceHandler();
+  ::testing::InitGoogleTest(&argc, argv);
+  int ret = RUN_ALL_TESTS();
+  return ret;
+}
@@ -1,7 +1,9 @@
 #include "test_backend.h"
+#include <limits>
 #include <sstream>
 #include <map>
 #include <set>
+#include <thread>
 
 TEST_F(BackendTest, DeleteBeforeInit) {
   auto no_init_be = create_minimal_backend();
@@ -354,6 +356,176 @@ TEST_F(BackendTest, Write_MaxPos) {
   ASSERT_EQ(pos, 5000u);
 }
 
+// writers racing for the same positions each get their own result: exactly
+// one write or fill of each position succeeds.
+TEST_F(BackendTest, Write_Concurrent) {
+  ASSERT_EQ(backend->Seal("a", 1), 0);
+
+  const int num_threads = 8;
+  const uint64_t num_positions = 200;
+
+  std::vector<std::vector<uint64_t>> written(num_threads);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < num_threads; i++) {
+    threads.emplace_back([&, i] {
+      for (uint64_t pos = 0; pos < num_positions; pos++) {
+        int ret;
+        if (i == 0 && pos % 10 == 0) {
+          ret = backend->Fill("a", 1, pos);
+        } else {
+          ret = backend->Write("a", std::to_string(i), 1, pos);
+        }
+        if (ret == 0) {
+          written[i].push_back(pos);
+        } else {
+          ASSERT_EQ(ret, -EROFS);
+        }
+      }
+    });
+  }
+
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  std::map<uint64_t, int> owner;
+  for (int i = 0; i < num_threads; i++) {
+    for (auto pos : written[i]) {
+      ASSERT_TRUE(owner.emplace(pos, i).second);
+    }
+  }
+  ASSERT_EQ(owner.size(), num_positions);
+
+  for (const auto& it : owner) {
+    std::string data;
+    int ret = backend->Read("a", 1, it.first, &data);
+    if (ret == -ENODATA) {
+      // a fill won the position
+      ASSERT_EQ(it.second, 0);
+    } else {
+      ASSERT_EQ(ret, 0);
+      ASSERT_EQ(data, std::to_string(it.second));
+    }
+  }
+
+  uint64_t pos;
+  bool empty;
+  ASSERT_EQ(backend->MaxPos("a", &pos, &empty), 0);
+  ASSERT_FALSE(empty);
+  ASSERT_EQ(pos, num_positions - 1);
+}
+
+TEST_F(BackendTest, Write_Strided) {
+  ASSERT_EQ(backend->Seal("a", 1), 0);
+
+  // positions an object sees in a striped log, written out of order, mixed
+  // with positions that don't follow the stride and ones far beyond it.
+  std::vector<uint64_t> positions;
+  for (uint64_t i = 0; i < 300; i++) {
+    positions.push_back(3 + ((i * 7) % 300) * 5);
+  }
+  positions.push_back(1);
+  positions.push_back(1004);
+  positions.push_back(1000000);
+  positions.push_back(std::numeric_limits<uint64_t>::max() - 1);
+
+  for (auto pos : positions) {
+    ASSERT_EQ(backend->Write("a", std::to_string(pos), 1, pos), 0);
+  }
+
+  for (auto pos : positions) {
+    std::string data;
+    ASSERT_EQ(backend->Read("a", 1, pos, &data), 0);
+    ASSERT_EQ(data, std::to_string(pos));
+    ASSERT_EQ(backend->Write("a", "x", 1, pos), -EROFS);
+  }
+
+  std::string data;
+  ASSERT_EQ(backend->Read("a", 1, 0, &data), -ERANGE);
+  ASSERT_EQ(backend->Read("a", 1, 5, &data), -ERANGE);
+  ASSERT_EQ(backend->Read("a", 1, 1500, &data), -ERANGE);
+  ASSERT_EQ(backend->Read("a", 1, 1002, &data), -ERANGE);
+
+  ASSERT_EQ(backend->Fill("a", 1, 5), 0);
+  ASSERT_EQ(backend->Read("a", 1, 5, &data), -ENODATA);
+
+  std::map<uint64_t, std::string> entries;
+  ASSERT_EQ(backend->ReadRange("a", 1, 0, 20, 1, &entries, nullptr), 0);
+  ASSERT_EQ(entries.size(), 5u);
+
+  uint64_t pos;
+  bool empty;
+  ASSERT_EQ(backend->MaxPos("a", &pos, &empty), 0);
+  ASSERT_FALSE(empty);
+  ASSERT_EQ(pos, std::numeric_limits<uint64_t>::max() - 1);
+}
+
+TEST_F(BackendTest, WriteBatch_Args) {
+  std::string data("x");
+  std::vector<std::pair<uint64_t, const std::string*>> entries{{0, &data}};
+  std::vector<int> results;
+
+  ASSERT_EQ(backend->WriteBatch("", 1, entries, &results), -EINVAL);
+  ASSERT_EQ(backend->Seal("a", 1), 0);
+  ASSERT_EQ(backend->WriteBatch("a", 0, entries, &results), -EINVAL);
+  ASSERT_EQ(backend->WriteBatch("a", 1, {}, &results), -EINVAL);
+  ASSERT_EQ(backend->WriteBatch("a", 1, entries, nullptr), -EINVAL);
+}
+
+TEST_F(BackendTest, WriteBatch_NoInit_StaleEpoch) {
+  std::string data("x");
+  std::vector<std::pair<uint64_t, const std::string*>> entries{
+    {0, &data}, {1, &data}};
+  std::vector<int> results;
+
+  ASSERT_EQ(backend->WriteBatch("a", 1, entries, &results), -ENOENT);
+  ASSERT_EQ(results, std::vector<int>({-ENOENT, -ENOENT}));
+
+  ASSERT_EQ(backend->Seal("a", 10), 0);
+  ASSERT_EQ(backend->WriteBatch("a", 9, entries, &results), -ESPIPE);
+  ASSERT_EQ(results, std::vector<int>({-ESPIPE, -ESPIPE}));
+
+  std::string out;
+  ASSERT_EQ(backend->Read("a", 10, 0, &out), -ERANGE);
+  ASSERT_EQ(backend->Read("a", 10, 1, &out), -ERANGE);
+}
+
+TEST_F(BackendTest, WriteBatch) {
+  ASSERT_EQ(backend->Seal("a", 1), 0);
+  ASSERT_EQ(backend->Write("a", "taken", 1, 2), 0);
+  ASSERT_EQ(backend->Fill("a", 1, 4), 0);
+
+  std::vector<std::string> data{"d0", "d1", "d2", "d3", "d4", "d20"};
+  std::vector<std::pair<uint64_t, const std::string*>> entries{
+    {0, &data[0]}, {1, &data[1]}, {2, &data[2]},
+    {3, &data[3]}, {4, &data[4]}, {20, &data[5]}};
+
+  std::vector<int> results;
+  ASSERT_EQ(backend->WriteBatch("a", 1, entries, &results), 0);
+  ASSERT_EQ(results, std::vector<int>({0, 0, -EROFS, 0, -EROFS, 0}));
+
+  std::string out;
+  for (auto pos : {0, 1, 3}) {
+    ASSERT_EQ(backend->Read("a", 1, pos, &out), 0);
+    ASSERT_EQ(out, data[pos]);
+  }
+  ASSERT_EQ(backend->Read("a", 1, 2, &out), 0);
+  ASSERT_EQ(out, "taken");
+  ASSERT_EQ(backend->Read("a", 1, 4, &out), -ENODATA);
+  ASSERT_EQ(backend->Read("a", 1, 20, &out), 0);
+  ASSERT_EQ(out, data[5]);
+
+  bool empty;
+  uint64_t pos;
+  ASSERT_EQ(backend->MaxPos("a", &pos, &empty), 0);
+  ASSERT_FALSE(empty);
+  ASSERT_EQ(pos, 20u);
+
+  // nothing can be written again
+  ASSERT_EQ(backend->WriteBatch("a", 1, entries, &results), 0);
+  ASSERT_EQ(results, std::vector<int>(entries.size(), -EROFS));
+}
+
 TEST_F(BackendTest, Read_Args) {
   std::string data;
   ASSERT_EQ(backend->Read("", 1, 0, &data), -EINVAL);
@@ -482,6 +654,325 @@ TEST_F(BackendTest, Read_FillTrimLimit) {
   ASSERT_EQ(backend->Read("a", 10, 10, &data), -ENODATA);
 }
 
+TEST_F(BackendTest, ReadWriteAsync) {
+  AsyncCompletion completion;
+  auto cb = completion.callback();
+
+  std::string data;
+  ASSERT_EQ(backend->WriteAsync("a", "abc", 10, 0, cb), 0);
+  ASSERT_EQ(completion.wait(), -ENOENT);
+  ASSERT_EQ(backend->ReadAsync("a", 10, 0, &data, cb), 0);
+  ASSERT_EQ(completion.wait(), -ENOENT);
+
+  ASSERT_EQ(backend->Seal("a", 10), 0);
+
+  ASSERT_EQ(backend->ReadAsync("a", 10, 0, &data, cb), 0);
+  ASSERT_EQ(completion.wait(), -ERANGE);
+  ASSERT_EQ(backend->WriteAsync("a", "abc", 10, 0, cb), 0);
+  ASSERT_EQ(completion.wait(), 0);
+  ASSERT_EQ(backend->WriteAsync("a", "abc", 10, 0, cb), 0);
+  ASSERT_EQ(completion.wait(), -EROFS);
+  ASSERT_EQ(backend->WriteAsync("a", "abc", 9, 1, cb), 0);
+  ASSERT_EQ(completion.wait(), -ESPIPE);
+
+  ASSERT_EQ(backend->ReadAsync("a", 10, 0, &data, cb), 0);
+  ASSERT_EQ(completion.wait(), 0);
+  ASSERT_EQ(data, "abc");
+}
+
+TEST_F(BackendTest, FillSealAsync) {
+  AsyncCompletion completion;
+  auto cb = completion.callback();
+
+  ASSERT_EQ(backend->FillAsync("a", 10, 0, cb), 0);
+  ASSERT_EQ(completion.wait(), -ENOENT);
+
+  ASSERT_EQ(backend->SealAsync("a", 10, cb), 0);
+  ASSERT_EQ(completion.wait(), 0);
+  ASSERT_EQ(backend->SealAsync("a", 10, cb), 0);
+  ASSERT_EQ(completion.wait(), -ESPIPE);
+
+  uint64_t pos;
+  bool empty;
+  ASSERT_EQ(backend->MaxPos("a", &pos, &empty), 0);
+  ASSERT_TRUE(empty);
+
+  ASSERT_EQ(backend->FillAsync("a", 9, 3, cb), 0);
+  ASSERT_EQ(completion.wait(), -ESPIPE);
+  ASSERT_EQ(backend->FillAsync("a", 10, 3, cb), 0);
+  ASSERT_EQ(completion.wait(), 0);
+
+  std::string data;
+  ASSERT_EQ(backend->Read("a", 10, 3, &data), -ENODATA);
+
+  ASSERT_EQ(backend->MaxPos("a", &pos, &empty), 0);
+  ASSERT_FALSE(empty);
+  ASSERT_EQ(pos, 3u);
+}
+
+TEST_F(BackendTest, WriteBatchAsync) {
+  AsyncCompletion completion;
+  auto cb = completion.callback();
+
+  std::vector<std::string> data{"d0", "d1", "d2"};
+  std::vector<std::pair<uint64_t, const std::string*>> entries{
+    {0, &data[0]}, {1, &data[1]}, {2, &data[2]}};
+
+  std::vector<int> results;
+  ASSERT_EQ(backend->WriteBatchAsync("a", 1, entries, &results, cb), 0);
+  ASSERT_EQ(completion.wait(), -ENOENT);
+  ASSERT_EQ(results, std::vector<int>(entries.size(), -ENOENT));
+
+  ASSERT_EQ(backend->Seal("a", 2), 0);
+  ASSERT_EQ(backend->WriteBatchAsync("a", 1, entries, &results, cb), 0);
+  ASSERT_EQ(completion.wait(), -ESPIPE);
+  ASSERT_EQ(results, std::vector<int>(entries.size(), -ESPIPE));
+
+  ASSERT_EQ(backend->Write("a", "taken", 2, 1), 0);
+  ASSERT_EQ(backend->WriteBatchAsync("a", 2, entries, &results, cb), 0);
+  ASSERT_EQ(completion.wait(), 0);
+  ASSERT_EQ(results, std::vector<int>({0, -EROFS, 0}));
+
+  std::string out;
+  for (auto pos : {0, 2}) {
+    ASSERT_EQ(backend->Read("a", 2, pos, &out), 0);
+    ASSERT_EQ(out, data[pos]);
+  }
+  ASSERT_EQ(backend->Read("a", 2, 1, &out), 0);
+  ASSERT_EQ(out, "taken");
+}
+
+// the object name and data passed to an asynchronous call can be reused by
+// the callback, as when a callback that runs inline formats the name of the
+// next object it accesses into the same buffer
+TEST_F(BackendTest, Async_ReuseInputs) {
+  std::string oid;
+  std::string data;
+
+  AsyncCompletion completion;
+  auto cb = completion.callback([&] {
+    oid.assign("b");
+    data.assign("clobbered");
+  });
+
+  oid.assign("a");
+  ASSERT_EQ(backend->SealAsync(oid, 1, cb), 0);
+  ASSERT_EQ(completion.wait(), 0);
+
+  for (uint64_t pos = 0; pos < 10; pos++) {
+    oid.assign("a");
+    data.assign("data" + std::to_string(pos));
+    ASSERT_EQ(backend->WriteAsync(oid, data, 1, pos, cb), 0);
+    ASSERT_EQ(completion.wait(), 0);
+  }
+
+  oid.assign("a");
+  ASSERT_EQ(backend->FillAsync(oid, 1, 10, cb), 0);
+  ASSERT_EQ(completion.wait(), 0);
+
+  std::string out;
+  oid.assign("a");
+  ASSERT_EQ(backend->ReadAsync(oid, 1, 3, &out, cb), 0);
+  ASSERT_EQ(completion.wait(), 0);
+  ASSERT_EQ(out, "data3");
+
+  uint64_t pos;
+  bool empty;
+  oid.assign("a");
+  ASSERT_EQ(backend->SealAndMaxPosAsync(oid, 2, &pos, &empty, cb), 0);
+  ASSERT_EQ(completion.wait(), 0);
+  ASSERT_FALSE(empty);
+  ASSERT_EQ(pos, 10u);
+
+  for (uint64_t pos = 0; pos < 10; pos++) {
+    ASSERT_EQ(backend->Read("a", 2, pos, &out), 0);
+    ASSERT_EQ(out, "data" + std::to_string(pos));
+  }
+  ASSERT_EQ(backend->Read("a", 2, 10, &out), -ENODATA);
+  ASSERT_EQ(backend->MaxPos("b", &pos, &empty), -ENOENT);
+}
+
+TEST_F(BackendTest, SealAndMaxPos) {
+  uint64_t pos;
+  bool empty;
+  ASSERT_EQ(backend->SealAndMaxPos("", 1, &pos, &empty), -EINVAL);
+  ASSERT_EQ(backend->SealAndMaxPos("a", 0, &pos, &empty), -EINVAL);
+
+  // creates the object
+  ASSERT_EQ(backend->SealAndMaxPos("a", 10, &pos, &empty), 0);
+  ASSERT_TRUE(empty);
+  ASSERT_EQ(backend->Write("a", "abc", 9, 0), -ESPIPE);
+  ASSERT_EQ(backend->Write("a", "abc", 10, 4), 0);
+
+  // a stale epoch still returns the max position
+  ASSERT_EQ(backend->SealAndMaxPos("a", 10, &pos, &empty), 0);
+  ASSERT_FALSE(empty);
+  ASSERT_EQ(pos, 4u);
+
+  ASSERT_EQ(backend->SealAndMaxPos("a", 11, &pos, &empty), 0);
+  ASSERT_FALSE(empty);
+  ASSERT_EQ(pos, 4u);
+  ASSERT_EQ(backend->Write("a", "abc", 10, 5), -ESPIPE);
+  ASSERT_EQ(backend->Seal("a", 11), -ESPIPE);
+
+  AsyncCompletion completion;
+  ASSERT_EQ(backend->Write("a", "abc", 11, 7), 0);
+  ASSERT_EQ(backend->SealAndMaxPosAsync("a", 12, &pos, &empty,
+        completion.callback()), 0);
+  ASSERT_EQ(completion.wait(), 0);
+  ASSERT_FALSE(empty);
+  ASSERT_EQ(pos, 7u);
+  ASSERT_EQ(backend->Seal("a", 12), -ESPIPE);
+}
+
+TEST_F(BackendTest, ReadSlice) {
+  zlog::Slice data;
+  ASSERT_EQ(backend->ReadSlice("", 1, 0, &data), -EINVAL);
+  ASSERT_EQ(backend->ReadSlice("a", 0, 0, &data), -EINVAL);
+  ASSERT_EQ(backend->ReadSlice("a", 1, 0, &data), -ENOENT);
+
+  ASSERT_EQ(backend->Seal("a", 10), 0);
+  ASSERT_EQ(backend->ReadSlice("a", 9, 0, &data), -ESPIPE);
+  ASSERT_EQ(backend->ReadSlice("a", 10, 0, &data), -ERANGE);
+
+  ASSERT_EQ(backend->Write("a", "abc", 10, 0), 0);
+  ASSERT_EQ(backend->ReadSlice("a", 10, 0, &data), 0);
+  ASSERT_EQ(data.ToString(), "abc");
+
+  // copies share the entry
+  zlog::Slice copy = data;
+  ASSERT_EQ(copy.data(), data.data());
+
+  // the slice remains readable after the entry is trimmed
+  ASSERT_EQ(backend->Trim("a", 10, 0, false, false), 0);
+  zlog::Slice trimmed;
+  ASSERT_EQ(backend->ReadSlice("a", 10, 0, &trimmed), -ENODATA);
+  ASSERT_EQ(data.ToString(), "abc");
+
+  AsyncCompletion completion;
+  ASSERT_EQ(backend->Write("a", "xyz", 10, 1), 0);
+  zlog::Slice async_data;
+  ASSERT_EQ(backend->ReadSliceAsync("a", 10, 1, &async_data,
+        completion.callback()), 0);
+  ASSERT_EQ(completion.wait(), 0);
+  ASSERT_EQ(async_data.ToString(), "xyz");
+}
+
+TEST_F(BackendTest, ReadRange_Args) {
+  std::map<uint64_t, std::string> entries;
+  std::set<uint64_t> invalid;
+  ASSERT_EQ(backend->ReadRange("", 1, 0, 1, 1, &entries, &invalid), -EINVAL);
+  ASSERT_EQ(backend->Seal("a", 1), 0);
+  ASSERT_EQ(backend->ReadRange("a", 0, 0, 1, 1, &entries, &invalid), -EINVAL);
+  ASSERT_EQ(backend->ReadRange("a", 1, 2, 1, 1, &entries, &invalid), -EINVAL);
+  ASSERT_EQ(backend->ReadRange("a", 1, 0, 1, 0, &entries, &invalid), -EINVAL);
+}
+
+TEST_F(BackendTest, ReadRange_NoInit_StaleEpoch) {
+  std::map<uint64_t, std::string> entries;
+  std::set<uint64_t> invalid;
+  ASSERT_EQ(backend->ReadRange("a", 1, 0, 1, 1, &entries, &invalid), -ENOENT);
+  ASSERT_EQ(backend->Seal("a", 10), 0);
+  ASSERT_EQ(backend->ReadRange("a", 9, 0, 1, 1, &entries, &invalid), -ESPIPE);
+  ASSERT_EQ(backend->ReadRange("a", 10, 0, 1, 1, &entries, &invalid), 0);
+  ASSERT_TRUE(entries.empty());
+  ASSERT_TRUE(invalid.empty());
+}
+
+TEST_F(BackendTest, ReadRange) {
+  ASSERT_EQ(backend->Seal("a", 1), 0);
+
+  for (uint64_t pos = 0; pos < 30; pos += 3) {
+    ASSERT_EQ(backend->Write("a", "d" + std::to_string(pos), 1, pos), 0);
+  }
+  ASSERT_EQ(backend->Fill("a", 1, 31), 0);
+  ASSERT_EQ(backend->Trim("a", 1, 6), 0);
+  ASSERT_EQ(backend->Trim("a", 1, 1), 0);
+
+  std::map<uint64_t, std::string> entries;
+  std::set<uint64_t> invalid;
+  ASSERT_EQ(backend->ReadRange("a", 1, 3, 31, 1, &entries, &invalid), 0);
+
+  std::map<uint64_t, std::string> expected;
+  for (uint64_t pos = 3; pos < 30; pos += 3) {
+    if (pos != 6) {
+      expected.emplace(pos, "d" + std::to_string(pos));
+    }
+  }
+  ASSERT_EQ(entries, expected);
+  ASSERT_EQ(invalid, std::set<uint64_t>({6, 31}));
+
+  ASSERT_EQ(backend->ReadRange("a", 1, 100, 200, 1, &entries, &invalid), 0);
+  ASSERT_TRUE(entries.empty());
+  ASSERT_TRUE(invalid.empty());
+
+  // positions covered by the trim limit are invalid
+  ASSERT_EQ(backend->Trim("a", 1, 10, true), 0);
+  ASSERT_EQ(backend->ReadRange("a", 1, 8, 12, 1, &entries, &invalid), 0);
+  ASSERT_EQ(entries, (std::map<uint64_t, std::string>{{12, "d12"}}));
+  ASSERT_EQ(invalid, std::set<uint64_t>({8, 9, 10}));
+}
+
+// only the positions at the stride are read, including those covered by the
+// trim limit
+TEST_F(BackendTest, ReadRange_Stride) {
+  ASSERT_EQ(backend->Seal("a", 1), 0);
+
+  for (uint64_t pos = 0; pos < 20; pos++) {
+    ASSERT_EQ(backend->Write("a", "d" + std::to_string(pos), 1, pos), 0);
+  }
+  ASSERT_EQ(backend->Fill("a", 1, 21), 0);
+  ASSERT_EQ(backend->Trim("a", 1, 8, true), 0);
+
+  std::map<uint64_t, std::string> entries;
+  std::set<uint64_t> invalid;
+  ASSERT_EQ(backend->ReadRange("a", 1, 1, 23, 5, &entries, &invalid), 0);
+  ASSERT_EQ(entries, (std::map<uint64_t, std::string>{
+        {11, "d11"}, {16, "d16"}}));
+  ASSERT_EQ(invalid, std::set<uint64_t>({1, 6, 21}));
+
+  // the range is entirely below the trim limit
+  ASSERT_EQ(backend->ReadRange("a", 1, 2, 8, 3, &entries, &invalid), 0);
+  ASSERT_TRUE(entries.empty());
+  ASSERT_EQ(invalid, std::set<uint64_t>({2, 5, 8}));
+
+  // the last position is the one at or below max_position
+  ASSERT_EQ(backend->ReadRange("a", 1, 9, 18, 4, &entries, &invalid), 0);
+  ASSERT_EQ(entries, (std::map<uint64_t, std::string>{
+        {9, "d9"}, {13, "d13"}, {17, "d17"}}));
+  ASSERT_TRUE(invalid.empty());
+}
+
+// objects whose names share a prefix don't see each other's entries, and
+// positions are ordered numerically
+TEST_F(BackendTest, ReadRange_ObjectPrefix) {
+  ASSERT_EQ(backend->Seal("a", 1), 0);
+  ASSERT_EQ(backend->Seal("a.1", 1), 0);
+  ASSERT_EQ(backend->Seal("ab", 1), 0);
+
+  for (uint64_t pos : {2, 10, 100, 1000}) {
+    ASSERT_EQ(backend->Write("a", "a" + std::to_string(pos), 1, pos), 0);
+    ASSERT_EQ(backend->Write("a.1", "x", 1, pos + 1), 0);
+    ASSERT_EQ(backend->Write("ab", "x", 1, pos + 2), 0);
+  }
+
+  std::map<uint64_t, std::string> entries;
+  std::set<uint64_t> invalid;
+  ASSERT_EQ(backend->ReadRange("a", 1, 0, 999, 1, &entries, &invalid), 0);
+  ASSERT_EQ(entries, (std::map<uint64_t, std::string>{
+        {2, "a2"}, {10, "a10"}, {100, "a100"}}));
+  ASSERT_TRUE(invalid.empty());
+
+  // removing the entries of one object leaves the others alone
+  size_t size1, size2;
+  ASSERT_EQ(backend->Stat("a.1", &size1), 0);
+  ASSERT_EQ(backend->Trim("a", 1, 5000, true, true), 0);
+  ASSERT_EQ(backend->Stat("a.1", &size2), 0);
+  ASSERT_EQ(size1, size2);
+  ASSERT_EQ(backend->ReadRange("ab", 1, 0, 2000, 1, &entries, &invalid), 0);
+  ASSERT_EQ(entries.size(), 4u);
+}
+
 TEST_F(BackendTest, Fill_Args) {
   ASSERT_EQ(backend->Fill("", 1, 0), -EINVAL);
 
@@ -1032,6 +1523,38 @@ TEST_F(BackendTest, MaxPos) {
   ASSERT_EQ(pos, 200000001u);
 }
 
+TEST_F(BackendTest, Scrub_Args) {
+  std::set<uint64_t> corrupt;
+  ASSERT_EQ(backend->Scrub("", &corrupt), -EINVAL);
+}
+
+TEST_F(BackendTest, Scrub_NoInit) {
+  std::set<uint64_t> corrupt;
+  ASSERT_EQ(backend->Scrub("a", &corrupt), -ENOENT);
+  ASSERT_EQ(backend->Seal("a", 1), 0);
+  ASSERT_EQ(backend->Scrub("a", &corrupt), 0);
+  ASSERT_TRUE(corrupt.empty());
+}
+
+TEST_F(BackendTest, Scrub) {
+  ASSERT_EQ(backend->Seal("a", 1), 0);
+  for (uint64_t pos = 0; pos < 100; pos++) {
+    ASSERT_EQ(backend->Write("a", std::string(pos * 10, 'a' + pos % 26), 1,
+          pos), 0);
+  }
+  ASSERT_EQ(backend->Fill("a", 1, 100), 0);
+  ASSERT_EQ(backend->Trim("a", 1, 50), 0);
+  ASSERT_EQ(backend->Trim("a", 1, 10, true), 0);
+
+  std::set<uint64_t> corrupt{1, 2, 3};
+  ASSERT_EQ(backend->Scrub("a", &corrupt), 0);
+  ASSERT_TRUE(corrupt.empty());
+
+  ASSERT_EQ(backend->Trim("a", 1, 200, true, true), 0);
+  ASSERT_EQ(backend->Scrub("a", &corrupt), 0);
+  ASSERT_TRUE(corrupt.empty());
+}
+
 TEST_F(BackendTest, ListHeads_Empty) {
   std::vector<std::string> output;
   ASSERT_EQ(backend->ListHeads(output), 0);
@@ -1,5 +1,8 @@
 #pragma once
+#include <condition_variable>
+#include <functional>
 #include <memory>
+#include <mutex>
 #include "zlog/backend.h"
 #include "zlog/options.h"
 #include "gtest/gtest.h"
@@ -16,3 +19,34 @@ class BackendTest : public ::testing::Test {
   std::unique_ptr<zlog::Backend> backend;
   Context *context = nullptr;
 };
+
+// completion of an asynchronous backend call. the callback may be passed to
+// one call at a time, and wait() returns its result.
+class AsyncCompletion {
+ public:
+  // @fn runs in the callback before the waiter is woken up
+  std::function<void(int)> callback(std::function<void()> fn = nullptr) {
+    return [this, fn](int ret) {
+      std::lock_guard<std::mutex> lk(lock_);
+      if (fn) {
+        fn();
+      }
+      ret_ = ret;
+      done_ = true;
+      cond_.notify_one();
+    };
+  }
+
+  int wait() {
+    std::unique_lock<std::mutex> lk(lock_);
+    cond_.wait(lk, [this] { return done_; });
+    done_ = false;
+    return ret_;
+  }
+
+ private:
+  std::mutex lock_;
+  std::condition_variable cond_;
+  bool done_ = false;
+  int ret_ = 0;
+};
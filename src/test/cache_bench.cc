@@ -0,0 +1,159 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "zlog/cache.h"
+
+// measures cache read throughput as the number of reader threads grows. an
+// optional writer thread keeps inserting new entries at the tail.
+//
+// usage: cache_bench [max_threads] [seconds_per_step] [writer (0/1)]
+//
+// with "policies" as the first argument, instead compares the hit ratio of
+// the eviction policies on a trace of tailing readers, and of replays of the
+// whole log that periodically start and run alongside them.
+//
+// usage: cache_bench policies [log_entries] [replay_interval]
+
+static const uint64_t num_entries = 100000;
+static const size_t entry_size = 1024;
+
+static void compare_policies(uint64_t log_entries, uint64_t replay_interval)
+{
+  const std::vector<std::pair<std::string,
+        zlog::Eviction::Eviction_Policy>> policies = {
+    {"lru", zlog::Eviction::Eviction_Policy::LRU},
+    {"arc", zlog::Eviction::Eviction_Policy::ARC},
+    {"tinylfu", zlog::Eviction::Eviction_Policy::TINYLFU},
+    {"clock", zlog::Eviction::Eviction_Policy::CLOCK},
+  };
+
+  const std::string data(entry_size, 'x');
+
+  for (const auto& policy : policies) {
+    zlog::Options options;
+    // room for 10% of the log
+    options.cache_size = log_entries / 10 * entry_size;
+    options.eviction = policy.second;
+    zlog::Cache cache(options);
+
+    std::mt19937_64 gen(0);
+    // tailing readers mostly read the last few thousand entries
+    std::geometric_distribution<uint64_t> dist(0.0005);
+
+    uint64_t tail_reads = 0, tail_hits = 0;
+    uint64_t replay_reads = 0, replay_hits = 0;
+    bool replaying = false;
+    uint64_t replay_pos = 0;
+
+    auto read = [&](uint64_t pos, uint64_t& reads, uint64_t& hits) {
+      reads++;
+      if (cache.get(pos)) {
+        hits++;
+      } else {
+        cache.put(pos, data);
+      }
+    };
+
+    const auto start = std::chrono::steady_clock::now();
+
+    for (uint64_t tail = 0; tail < log_entries; tail++) {
+      cache.put(tail, data);
+      for (int i = 0; i < 4; i++) {
+        read(tail - std::min(tail, dist(gen)), tail_reads, tail_hits);
+      }
+      // a replay reads the log from the start, concurrently with the tail
+      if (tail > 0 && tail % replay_interval == 0 && !replaying) {
+        replaying = true;
+        replay_pos = 0;
+      }
+      for (int i = 0; replaying && i < 8; i++) {
+        read(replay_pos++, replay_reads, replay_hits);
+        replaying = replay_pos < tail;
+      }
+    }
+
+    const std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+
+    std::cout << policy.first
+      << " tail_hit_ratio " << ((double)tail_hits / tail_reads)
+      << " replay_hit_ratio " << ((double)replay_hits / replay_reads)
+      << " secs " << elapsed.count() << std::endl;
+  }
+}
+
+int main(int argc, char **argv)
+{
+  if (argc > 1 && std::string(argv[1]) == "policies") {
+    const uint64_t log_entries = argc > 2 ? std::stoull(argv[2]) : 100000;
+    const uint64_t replay_interval = argc > 3 ? std::stoull(argv[3]) : 20000;
+    compare_policies(log_entries, replay_interval);
+    return 0;
+  }
+
+  const int max_threads = argc > 1 ? std::stoi(argv[1]) : 32;
+  const int seconds = argc > 2 ? std::stoi(argv[2]) : 2;
+  const bool writer = argc > 3 ? std::stoi(argv[3]) != 0 : false;
+
+  zlog::Options options;
+  options.cache_size = num_entries * entry_size * 2;
+  options.eviction = zlog::Eviction::Eviction_Policy::LRU;
+
+  zlog::Cache cache(options);
+
+  const std::string data(entry_size, 'x');
+  for (uint64_t pos = 0; pos < num_entries; pos++) {
+    cache.put(pos, data);
+  }
+
+  for (int threads = 1; threads <= max_threads; threads *= 2) {
+    std::atomic<bool> stop(false);
+    std::atomic<uint64_t> ops(0);
+    std::vector<std::thread> workers;
+
+    for (int t = 0; t < threads; t++) {
+      workers.emplace_back([&, t] {
+        std::mt19937_64 gen(t);
+        // readers mostly target recent positions
+        std::geometric_distribution<uint64_t> dist(0.001);
+        uint64_t count = 0;
+        while (!stop.load(std::memory_order_relaxed)) {
+          const uint64_t pos = num_entries - 1 - (dist(gen) % num_entries);
+          auto entry = cache.get(pos);
+          (void)entry;
+          count++;
+        }
+        ops += count;
+      });
+    }
+
+    std::thread tail_writer;
+    if (writer) {
+      tail_writer = std::thread([&] {
+        uint64_t pos = num_entries;
+        while (!stop.load(std::memory_order_relaxed)) {
+          cache.put(pos++, data);
+        }
+      });
+    }
+
+    std::this_thread::sleep_for(std::chrono::seconds(seconds));
+    stop = true;
+    for (auto& worker : workers) {
+      worker.join();
+    }
+    if (tail_writer.joinable()) {
+      tail_writer.join();
+    }
+
+    std::cout << "threads " << threads << " reads/sec "
+      << (ops.load() / seconds) << std::endl;
+  }
+
+  return 0;
+}
@@ -0,0 +1,188 @@
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include "zlog/backend/ram.h"
+#include "zlog/log.h"
+
+// measures sequencer failover latency as the stripe width grows. a log is
+// created with a single stripe, and is then opened repeatedly. every open
+// proposes a new sequencer, which seals the objects of the stripe to find the
+// tail. the backend adds a fixed latency to every request to model a remote
+// store, and seals are run with and without concurrency.
+//
+// usage: failover_bench [max_width] [latency_us] [trials]
+
+namespace {
+
+// forwards requests to a ram backend after a delay. asynchronous seals run on
+// their own thread so that concurrent requests overlap.
+class DelayBackend : public zlog::Backend {
+ public:
+  DelayBackend(std::chrono::microseconds latency) :
+    latency_(latency)
+  {}
+
+  int Initialize(const std::map<std::string, std::string>& opts) override {
+    return backend_.Initialize(opts);
+  }
+
+  std::map<std::string, std::string> meta() override {
+    return backend_.meta();
+  }
+
+  int CreateLog(const std::string& name, const std::string& view,
+      std::string *hoid_out, std::string *prefix_out) override {
+    delay();
+    return backend_.CreateLog(name, view, hoid_out, prefix_out);
+  }
+
+  int OpenLog(const std::string& name, std::string *hoid_out,
+      std::string *prefix_out) override {
+    delay();
+    return backend_.OpenLog(name, hoid_out, prefix_out);
+  }
+
+  int ReadViews(const std::string& hoid, uint64_t epoch, uint32_t max_views,
+      std::map<uint64_t, std::string> *views_out) override {
+    delay();
+    return backend_.ReadViews(hoid, epoch, max_views, views_out);
+  }
+
+  int ProposeView(const std::string& hoid, uint64_t epoch,
+      const std::string& view) override {
+    delay();
+    return backend_.ProposeView(hoid, epoch, view);
+  }
+
+  int uniqueId(const std::string& hoid, uint64_t *id_out) override {
+    delay();
+    return backend_.uniqueId(hoid, id_out);
+  }
+
+  int Read(const std::string& oid, uint64_t epoch, uint64_t position,
+      std::string *data_out) override {
+    delay();
+    return backend_.Read(oid, epoch, position, data_out);
+  }
+
+  int Write(const std::string& oid, const std::string& data, uint64_t epoch,
+      uint64_t position) override {
+    delay();
+    return backend_.Write(oid, data, epoch, position);
+  }
+
+  int Fill(const std::string& oid, uint64_t epoch,
+      uint64_t position) override {
+    delay();
+    return backend_.Fill(oid, epoch, position);
+  }
+
+  int Trim(const std::string& oid, uint64_t epoch, uint64_t position,
+      bool trim_limit, bool trim_full) override {
+    delay();
+    return backend_.Trim(oid, epoch, position, trim_limit, trim_full);
+  }
+
+  int Seal(const std::string& oid, uint64_t epoch) override {
+    delay();
+    return backend_.Seal(oid, epoch);
+  }
+
+  int MaxPos(const std::string& oid, uint64_t *pos_out,
+      bool *empty_out) override {
+    delay();
+    return backend_.MaxPos(oid, pos_out, empty_out);
+  }
+
+  int Stat(const std::string& oid, size_t *size) override {
+    delay();
+    return backend_.Stat(oid, size);
+  }
+
+  int SealAndMaxPos(const std::string& oid, uint64_t epoch,
+      uint64_t *pos_out, bool *empty_out) override {
+    delay();
+    return backend_.SealAndMaxPos(oid, epoch, pos_out, empty_out);
+  }
+
+  int SealAndMaxPosAsync(const std::string& oid, uint64_t epoch,
+      uint64_t *pos_out, bool *empty_out,
+      std::function<void(int)> cb) override {
+    std::thread([=] {
+      cb(SealAndMaxPos(oid, epoch, pos_out, empty_out));
+    }).detach();
+    return 0;
+  }
+
+ private:
+  void delay() const {
+    std::this_thread::sleep_for(latency_);
+  }
+
+  const std::chrono::microseconds latency_;
+  zlog::storage::ram::RAMBackend backend_;
+};
+
+}
+
+int main(int argc, char **argv)
+{
+  const uint32_t max_width = argc > 1 ? std::stoul(argv[1]) : 128;
+  const int latency_us = argc > 2 ? std::stoi(argv[2]) : 500;
+  const int trials = argc > 3 ? std::stoi(argv[3]) : 5;
+
+  for (uint32_t width = 1; width <= max_width; width *= 2) {
+    auto backend = std::make_shared<DelayBackend>(
+        std::chrono::microseconds(latency_us));
+
+    zlog::Options options;
+    options.backend = backend;
+    options.create_if_missing = true;
+    options.stripe_width = width;
+
+    zlog::Log *log;
+    int ret = zlog::Log::Open(options, "log", &log);
+    if (ret) {
+      std::cerr << "open failed " << ret << std::endl;
+      return 1;
+    }
+
+    for (uint32_t i = 0; i < width; i++) {
+      uint64_t pos;
+      ret = log->Append("x", &pos);
+      if (ret) {
+        std::cerr << "append failed " << ret << std::endl;
+        return 1;
+      }
+    }
+    delete log;
+
+    std::cout << "width " << width;
+
+    for (uint32_t seals : {uint32_t(1), zlog::Options().max_inflight_seals}) {
+      options.create_if_missing = false;
+      options.max_inflight_seals = seals;
+
+      const auto start = std::chrono::steady_clock::now();
+      for (int t = 0; t < trials; t++) {
+        ret = zlog::Log::Open(options, "log", &log);
+        if (ret) {
+          std::cerr << "open failed " << ret << std::endl;
+          return 1;
+        }
+        delete log;
+      }
+      const auto elapsed = std::chrono::duration_cast<
+        std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+
+      std::cout << " seals " << seals
+        << " failover_ms " << (elapsed.count() / 1000.0 / trials);
+    }
+
+    std::cout << std::endl;
+  }
+
+  return 0;
+}
@@ -0,0 +1,91 @@
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "zlog/backend/ram.h"
+
+// measures ram backend write and read throughput as the number of threads
+// grows. threads append to a shared log striped over a number of objects,
+// the same way the client places positions, and then read it back.
+//
+// usage: ram_bench [max_threads] [seconds_per_step] [stripe_width] [entry_size]
+
+int main(int argc, char **argv)
+{
+  const int max_threads = argc > 1 ? std::stoi(argv[1]) : 32;
+  const int seconds = argc > 2 ? std::stoi(argv[2]) : 2;
+  const uint64_t width = argc > 3 ? std::stoull(argv[3]) : 100;
+  const size_t entry_size = argc > 4 ? std::stoull(argv[4]) : 1024;
+
+  const std::string data(entry_size, 'x');
+
+  for (int threads = 1; threads <= max_threads; threads *= 2) {
+    zlog::storage::ram::RAMBackend backend;
+
+    std::vector<std::string> oids;
+    for (uint64_t i = 0; i < width; i++) {
+      oids.emplace_back(std::string("obj.").append(std::to_string(i)));
+      backend.Seal(oids.back(), 1);
+    }
+
+    std::atomic<bool> stop(false);
+    std::atomic<uint64_t> tail(0);
+    std::vector<std::thread> workers;
+
+    for (int t = 0; t < threads; t++) {
+      workers.emplace_back([&] {
+        while (!stop.load(std::memory_order_relaxed)) {
+          const uint64_t pos = tail++;
+          int ret = backend.Write(oids[pos % width], data, 1, pos);
+          if (ret) {
+            std::cerr << "write failed " << ret << std::endl;
+            exit(1);
+          }
+        }
+      });
+    }
+
+    std::this_thread::sleep_for(std::chrono::seconds(seconds));
+    stop = true;
+    for (auto& worker : workers) {
+      worker.join();
+    }
+    workers.clear();
+
+    const uint64_t written = tail.load();
+
+    stop = false;
+    std::atomic<uint64_t> reads(0);
+    for (int t = 0; t < threads; t++) {
+      workers.emplace_back([&, t] {
+        uint64_t pos = t;
+        uint64_t count = 0;
+        std::string out;
+        while (!stop.load(std::memory_order_relaxed)) {
+          pos = (pos + 7919) % written;
+          int ret = backend.Read(oids[pos % width], 1, pos, &out);
+          if (ret) {
+            std::cerr << "read failed " << ret << std::endl;
+            exit(1);
+          }
+          count++;
+        }
+        reads += count;
+      });
+    }
+
+    std::this_thread::sleep_for(std::chrono::seconds(seconds));
+    stop = true;
+    for (auto& worker : workers) {
+      worker.join();
+    }
+
+    std::cout << "threads " << threads
+      << " writes/sec " << (written / seconds)
+      << " reads/sec " << (reads.load() / seconds) << std::endl;
+  }
+
+  return 0;
+}
@@ -0,0 +1,317 @@
+// crc32c (castagnoli polynomial). the hardware version computes three
+// independent crcs over adjacent blocks to hide the latency of the crc
+// instruction, and combines them by shifting the crc of the earlier blocks
+// over the length of the later ones, as described by Mark Adler in
+// https://stackoverflow.com/a/17646775.
+#include "util/crc32c.h"
+#include <string.h>
+#if defined(__x86_64__)
+#include <nmmintrin.h>
+#elif defined(__aarch64__) && defined(__linux__)
+#include <arm_acle.h>
+#include <sys/auxv.h>
+#ifndef HWCAP_CRC32
+#define HWCAP_CRC32 (1 << 7)
+#endif
+#endif
+
+namespace zlog {
+namespace crc32c {
+
+namespace {
+
+const uint32_t kPoly = 0x82f63b78;
+
+// lengths of the blocks processed in parallel
+const size_t kLong = 8192;
+const size_t kShort = 256;
+
+uint32_t gf2_matrix_times(const uint32_t *mat, uint32_t vec) {
+  uint32_t sum = 0;
+  while (vec) {
+    if (vec & 1) {
+      sum ^= *mat;
+    }
+    vec >>= 1;
+    mat++;
+  }
+  return sum;
+}
+
+void gf2_matrix_square(uint32_t *square, const uint32_t *mat) {
+  for (int n = 0; n < 32; n++) {
+    square[n] = gf2_matrix_times(mat, mat[n]);
+  }
+}
+
+// the operator that applies len zero bytes to a crc
+void zeros_op(uint32_t *even, size_t len) {
+  uint32_t odd[32];
+
+  // one zero bit
+  odd[0] = kPoly;
+  uint32_t row = 1;
+  for (int n = 1; n < 32; n++) {
+    odd[n] = row;
+    row <<= 1;
+  }
+
+  // two, then four zero bits
+  gf2_matrix_square(even, odd);
+  gf2_matrix_square(odd, even);
+
+  // the first square puts the operator for one zero byte in even, the next
+  // one puts the operator for two zero bytes in odd, and so on
+  do {
+    gf2_matrix_square(even, odd);
+    len >>= 1;
+    if (len == 0) {
+      return;
+    }
+    gf2_matrix_square(odd, even);
+    len >>= 1;
+  } while (len);
+
+  for (int n = 0; n < 32; n++) {
+    even[n] = odd[n];
+  }
+}
+
+struct Tables {
+  // byte-wise crc, in slicing-by-8 form
+  uint32_t table[8][256];
+  // shift a crc over kLong and kShort zero bytes
+  uint32_t long_shift[4][256];
+  uint32_t short_shift[4][256];
+
+  Tables() {
+    for (uint32_t n = 0; n < 256; n++) {
+      uint32_t crc = n;
+      for (int k = 0; k < 8; k++) {
+        crc = crc & 1 ? (crc >> 1) ^ kPoly : crc >> 1;
+      }
+      table[0][n] = crc;
+    }
+    for (uint32_t n = 0; n < 256; n++) {
+      uint32_t crc = table[0][n];
+      for (int k = 1; k < 8; k++) {
+        crc = table[0][crc & 0xff] ^ (crc >> 8);
+        table[k][n] = crc;
+      }
+    }
+    make_shift(long_shift, kLong);
+    make_shift(short_shift, kShort);
+  }
+
+  static void make_shift(uint32_t shift[][256], size_t len) {
+    uint32_t op[32];
+    zeros_op(op, len);
+    for (uint32_t n = 0; n < 256; n++) {
+      shift[0][n] = gf2_matrix_times(op, n);
+      shift[1][n] = gf2_matrix_times(op, n << 8);
+      shift[2][n] = gf2_matrix_times(op, n << 16);
+      shift[3][n] = gf2_matrix_times(op, n << 24);
+    }
+  }
+};
+
+const Tables& tables() {
+  static const Tables t;
+  return t;
+}
+
+inline uint32_t shift(const uint32_t zeros[][256], uint32_t crc) {
+  return zeros[0][crc & 0xff] ^ zeros[1][(crc >> 8) & 0xff] ^
+    zeros[2][(crc >> 16) & 0xff] ^ zeros[3][crc >> 24];
+}
+
+inline uint64_t load64(const unsigned char *p) {
+  uint64_t v;
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+#if defined(__x86_64__)
+__attribute__((target("sse4.2")))
+uint32_t ExtendHW(uint32_t init_crc, const char *data, size_t len) {
+  const auto& t = tables();
+  auto next = reinterpret_cast<const unsigned char*>(data);
+  uint64_t crc0 = init_crc ^ 0xffffffff;
+
+  while (len && (reinterpret_cast<uintptr_t>(next) & 7) != 0) {
+    crc0 = _mm_crc32_u8(crc0, *next);
+    next++;
+    len--;
+  }
+
+  while (len >= kLong * 3) {
+    uint64_t crc1 = 0;
+    uint64_t crc2 = 0;
+    const auto end = next + kLong;
+    do {
+      crc0 = _mm_crc32_u64(crc0, load64(next));
+      crc1 = _mm_crc32_u64(crc1, load64(next + kLong));
+      crc2 = _mm_crc32_u64(crc2, load64(next + kLong * 2));
+      next += 8;
+    } while (next < end);
+    crc0 = shift(t.long_shift, crc0) ^ crc1;
+    crc0 = shift(t.long_shift, crc0) ^ crc2;
+    next += kLong * 2;
+    len -= kLong * 3;
+  }
+
+  while (len >= kShort * 3) {
+    uint64_t crc1 = 0;
+    uint64_t crc2 = 0;
+    const auto end = next + kShort;
+    do {
+      crc0 = _mm_crc32_u64(crc0, load64(next));
+      crc1 = _mm_crc32_u64(crc1, load64(next + kShort));
+      crc2 = _mm_crc32_u64(crc2, load64(next + kShort * 2));
+      next += 8;
+    } while (next < end);
+    crc0 = shift(t.short_shift, crc0) ^ crc1;
+    crc0 = shift(t.short_shift, crc0) ^ crc2;
+    next += kShort * 2;
+    len -= kShort * 3;
+  }
+
+  const auto end = next + (len - (len & 7));
+  while (next < end) {
+    crc0 = _mm_crc32_u64(crc0, load64(next));
+    next += 8;
+  }
+  len &= 7;
+
+  while (len) {
+    crc0 = _mm_crc32_u8(crc0, *next);
+    next++;
+    len--;
+  }
+
+  return static_cast<uint32_t>(crc0) ^ 0xffffffff;
+}
+
+bool HaveHW() {
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("sse4.2");
+}
+#elif defined(__aarch64__) && defined(__linux__)
+__attribute__((target("+crc")))
+uint32_t ExtendHW(uint32_t init_crc, const char *data, size_t len) {
+  const auto& t = tables();
+  auto next = reinterpret_cast<const unsigned char*>(data);
+  uint32_t crc0 = init_crc ^ 0xffffffff;
+
+  while (len && (reinterpret_cast<uintptr_t>(next) & 7) != 0) {
+    crc0 = __crc32cb(crc0, *next);
+    next++;
+    len--;
+  }
+
+  while (len >= kLong * 3) {
+    uint32_t crc1 = 0;
+    uint32_t crc2 = 0;
+    const auto end = next + kLong;
+    do {
+      crc0 = __crc32cd(crc0, load64(next));
+      crc1 = __crc32cd(crc1, load64(next + kLong));
+      crc2 = __crc32cd(crc2, load64(next + kLong * 2));
+      next += 8;
+    } while (next < end);
+    crc0 = shift(t.long_shift, crc0) ^ crc1;
+    crc0 = shift(t.long_shift, crc0) ^ crc2;
+    next += kLong * 2;
+    len -= kLong * 3;
+  }
+
+  while (len >= kShort * 3) {
+    uint32_t crc1 = 0;
+    uint32_t crc2 = 0;
+    const auto end = next + kShort;
+    do {
+      crc0 = __crc32cd(crc0, load64(next));
+      crc1 = __crc32cd(crc1, load64(next + kShort));
+      crc2 = __crc32cd(crc2, load64(next + kShort * 2));
+      next += 8;
+    } while (next < end);
+    crc0 = shift(t.short_shift, crc0) ^ crc1;
+    crc0 = shift(t.short_shift, crc0) ^ crc2;
+    next += kShort * 2;
+    len -= kShort * 3;
+  }
+
+  const auto end = next + (len - (len & 7));
+  while (next < end) {
+    crc0 = __crc32cd(crc0, load64(next));
+    next += 8;
+  }
+  len &= 7;
+
+  while (len) {
+    crc0 = __crc32cb(crc0, *next);
+    next++;
+    len--;
+  }
+
+  return crc0 ^ 0xffffffff;
+}
+
+bool HaveHW() {
+  return getauxval(AT_HWCAP) & HWCAP_CRC32;
+}
+#else
+uint32_t ExtendHW(uint32_t init_crc, const char *data, size_t len) {
+  return ExtendPortable(init_crc, data, len);
+}
+
+bool HaveHW() {
+  return false;
+}
+#endif
+
+typedef uint32_t (*Function)(uint32_t, const char*, size_t);
+
+// chosen on first use, so that static initializers in other files can use
+// Extend()
+Function Choose() {
+  static const Function f = HaveHW() ? ExtendHW : ExtendPortable;
+  return f;
+}
+
+}  // namespace
+
+uint32_t ExtendPortable(uint32_t init_crc, const char* data, size_t n) {
+  const auto& t = tables().table;
+  auto p = reinterpret_cast<const unsigned char*>(data);
+  uint32_t crc = init_crc ^ 0xffffffff;
+
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  while (n >= 8) {
+    const uint64_t v = load64(p) ^ crc;
+    crc = t[7][v & 0xff] ^ t[6][(v >> 8) & 0xff] ^
+      t[5][(v >> 16) & 0xff] ^ t[4][(v >> 24) & 0xff] ^
+      t[3][(v >> 32) & 0xff] ^ t[2][(v >> 40) & 0xff] ^
+      t[1][(v >> 48) & 0xff] ^ t[0][v >> 56];
+    p += 8;
+    n -= 8;
+  }
+#endif
+
+  while (n--) {
+    crc = t[0][(crc ^ *p++) & 0xff] ^ (crc >> 8);
+  }
+
+  return crc ^ 0xffffffff;
+}
+
+uint32_t Extend(uint32_t init_crc, const char* data, size_t n) {
+  return Choose()(init_crc, data, n);
+}
+
+bool IsFastCrc32Supported() {
+  return Choose() != ExtendPortable;
+}
+
+}  // namespace crc32c
+}  // namespace zlog
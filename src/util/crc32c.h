@@ -0,0 +1,25 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+namespace zlog {
+namespace crc32c {
+
+// Return the crc32c of concat(A, data[0,n-1]) where init_crc is the crc32c
+// of some string A. Extend() is often used to maintain the crc32c of a
+// stream of data. The crc instructions of the cpu are used when available.
+extern uint32_t Extend(uint32_t init_crc, const char* data, size_t n);
+
+// Return the crc32c of data[0,n-1]
+inline uint32_t Value(const char* data, size_t n) {
+  return Extend(0, data, n);
+}
+
+// Extend() computed with lookup tables only
+extern uint32_t ExtendPortable(uint32_t init_crc, const char* data, size_t n);
+
+// True if Extend() uses crc instructions
+extern bool IsFastCrc32Supported();
+
+}  // namespace crc32c
+}  // namespace zlog
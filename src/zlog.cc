@@ -108,7 +108,7 @@ int main(int argc, char **argv)
     options.backend_options["pool"] = pool;
     // zero-length string here causes default path search
     options.backend_options["conf_file"] = "";
-  } else if (backend_name == "lmdb") {
+  } else if (backend_name == "lmdb" || backend_name == "segment") {
     options.backend_options["path"] = db_path;
   }
 
@@ -165,6 +165,7 @@ int main(int argc, char **argv)
  * - dump <log name>
  * - trim <log name>
  * - fill <log name>
+ * - scrub <log name>
  *
  * @param command  the command to execute
  * @param backend  the backend to use
@@ -182,6 +183,7 @@ int handle_log(std::vector<std::string> command, std::shared_ptr<zlog::Backend>
           { "fill", "zlog log fill <log name> <position>" },
           { "views", "zlog log views <log name>" },
           { "get", "zlog log get <log name>" },
+          { "scrub", "zlog log scrub <log name>" },
   };
 
   if (command.size() > 0 && usages.find(command[0]) == usages.end()) {
@@ -380,6 +382,51 @@ int handle_log(std::vector<std::string> command, std::shared_ptr<zlog::Backend>
       std::cerr << "log::Fill " << ret << std::endl;
     }
     return ret;
+  } else if (command[0] == "scrub") {
+    if (command.size() != 2) { // scrub <log name>
+      std::cerr << usages.at("scrub") << std::endl;
+      return 1;
+    }
+    uint64_t tail;
+    int ret = log->CheckTail(&tail);
+    if (ret != 0) {
+      std::cerr << "log::CheckTail " << ret << std::endl;
+      return ret;
+    }
+    if (tail == 0) {
+      return 0;
+    }
+    // verify every object that maps a position below the tail
+    const auto view = log->view_mgr->view();
+    uint64_t stripe_id = 0;
+    bool done = false;
+    size_t num_corrupt = 0;
+    while (true) {
+      const auto objects = log->view_mgr->map_to(view, tail - 1, stripe_id, done);
+      if (done) {
+        break;
+      }
+      if (!objects) {
+        std::cerr << "position " << (tail - 1) << " is not mapped" << std::endl;
+        return -EINVAL;
+      }
+      for (const auto& obj : *objects) {
+        std::set<uint64_t> corrupt;
+        int ret = log->backend->Scrub(obj.first, &corrupt);
+        if (ret == -ENOENT) {
+          // the object hasn't been initialized yet
+          continue;
+        } else if (ret != 0) {
+          std::cerr << "backend::Scrub " << obj.first << " " << ret << std::endl;
+          return ret;
+        }
+        for (auto pos : corrupt) {
+          std::cout << pos << ": corrupt" << std::endl;
+        }
+        num_corrupt += corrupt.size();
+      }
+    }
+    return num_corrupt ? -EIO : 0;
   }
 
   // Should never reach here, but just to be safe